@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+
+#include "runtime/script_host.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+
+namespace {
+
+/** `console.log` throughput with fd 1 on a pipe drained by another thread (the shape of `qianjs run app | shipper`). */
+void BM_ConsoleLogToPipe(benchmark::State& state) {
+    const int64_t lines = state.range(0);
+    const std::filesystem::path script = std::filesystem::temp_directory_path() / "qianjs_console_bench.js";
+    std::ofstream(script) << "import { log } from 'console';\n"
+                             "for (let i = 0; i < "
+                          << lines << "; i++) log('request', i, 'done in', 12.5, 'ms');\n";
+
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        state.SkipWithError("pipe failed");
+        return;
+    }
+    const int saved = ::dup(1);
+    ::dup2(fds[1], 1);
+    ::close(fds[1]);
+    std::thread reader([fd = fds[0]] {
+        char buf[1 << 16];
+        while (::read(fd, buf, sizeof(buf)) > 0) {
+        }
+    });
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(qianjs::runScriptFile(script));
+
+    ::dup2(saved, 1);
+    ::close(saved);
+    reader.join();
+    ::close(fds[0]);
+    std::filesystem::remove(script);
+    state.SetItemsProcessed(state.iterations() * lines);
+}
+BENCHMARK(BM_ConsoleLogToPipe)->Arg(100000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+#endif
@@ -0,0 +1,191 @@
+#include <benchmark/benchmark.h>
+
+#include "native/fs/fs_batch.h"
+#include "native/fs/fs_js_io.h"
+#include "native/fs/fs_stat_js.h"
+#include "native/fs/fs_uv.h"
+#include "runtime/script_host.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** Scratch file of `size` bytes under the temp directory; removed with the fixture. */
+struct ScratchFile {
+    std::filesystem::path path;
+
+    explicit ScratchFile(int64_t size) {
+        path = std::filesystem::temp_directory_path() / ("qianjs_fs_bench_" + std::to_string(size) + ".bin");
+        std::vector<char> data(static_cast<size_t>(size), 'x');
+        std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    ~ScratchFile() {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+};
+
+/** Settle one promise-returning call and drop the promise. */
+void await_value(qjs::JSEngine& engine, qjs::RawJSValue p) {
+    JSValue v = qjs::JSConv<qjs::RawJSValue>::to(engine.ctx(), p);
+    qianjs::drainAsyncWork(engine);
+    JS_FreeValue(engine.ctx(), v);
+}
+
+/** `readFileBytes`: the kernel reads into the block that becomes the ArrayBuffer storage. */
+void BM_FsReadFileBytes(benchmark::State& state) {
+    ScratchFile file(state.range(0));
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    for (auto _ : state)
+        await_value(engine, fsReadFileAsync(engine, FsPath(file.path.string()), true));
+    engine.cleanup();
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FsReadFileBytes)->Arg(1 << 20)->Arg(64 << 20)->Arg(256 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** Small `readFile` (UTF-8 string): per-request cost of open + fstat + read + close on the threadpool. */
+void BM_FsReadFileSmall(benchmark::State& state) {
+    ScratchFile file(state.range(0));
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    for (auto _ : state)
+        await_value(engine, fsReadFileAsync(engine, FsPath(file.path.string()), false));
+    engine.cleanup();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FsReadFileSmall)->Arg(0)->Arg(4 << 10)->Arg(64 << 10)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/** `writeFile` with an ArrayBuffer: written in place from the pinned source. */
+void BM_FsWriteFileBytes(benchmark::State& state) {
+    ScratchFile file(0);
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    std::vector<uint8_t> src(static_cast<size_t>(state.range(0)), 'y');
+    JSValue ab = JS_NewArrayBufferCopy(engine.ctx(), src.data(), src.size());
+    for (auto _ : state) {
+        FsBytesRef ref;
+        fs_js_bytes_ref(engine.ctx(), ab, ref);
+        await_value(engine, fsWriteFileAsync(engine, FsPath(file.path.string()), std::move(ref)));
+    }
+    JS_FreeValue(engine.ctx(), ab);
+    engine.cleanup();
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FsWriteFileBytes)->Arg(1 << 20)->Arg(64 << 20)->Arg(256 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/**
+ * The two full copies the previous read path added on top of the kernel read (uvw buffer → `std::string` →
+ * `JS_NewArrayBufferCopy`); the write path had the same pair. Upper bound on what the in-place paths save.
+ */
+void BM_FsRemovedCopies(benchmark::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    std::vector<char> kernel(n, 'z');
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    for (auto _ : state) {
+        std::string staged(kernel.data(), n);
+        JSValue ab = JS_NewArrayBufferCopy(engine.ctx(), reinterpret_cast<const uint8_t*>(staged.data()), n);
+        benchmark::DoNotOptimize(ab);
+        JS_FreeValue(engine.ctx(), ab);
+    }
+    engine.cleanup();
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FsRemovedCopies)->Arg(1 << 20)->Arg(64 << 20)->Arg(256 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** Directory of `n` empty files (the 50k-file build-cache check scaled down). */
+struct ScratchTree {
+    std::filesystem::path root;
+    std::vector<std::string> files;
+
+    explicit ScratchTree(int64_t n) {
+        root = std::filesystem::temp_directory_path() / ("qianjs_fs_bench_tree_" + std::to_string(n));
+        std::filesystem::create_directories(root);
+        for (int64_t i = 0; i < n; i++) {
+            files.push_back((root / ("f" + std::to_string(i))).string());
+            std::ofstream(files.back()).put('x');
+        }
+    }
+
+    ~ScratchTree() {
+        std::error_code ec;
+        std::filesystem::remove_all(root, ec);
+    }
+};
+
+/** One `fs.stat` promise per file, all issued up front (`Promise.all` shape). */
+void BM_FsStatEach(benchmark::State& state) {
+    ScratchTree tree(state.range(0));
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    std::vector<JSValue> pending(tree.files.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < tree.files.size(); i++)
+            pending[i] = qjs::JSConv<qjs::RawJSValue>::to(engine.ctx(), fsStatAsync(engine, FsPath(tree.files[i])));
+        qianjs::drainAsyncWork(engine);
+        for (JSValue v : pending)
+            JS_FreeValue(engine.ctx(), v);
+    }
+    engine.cleanup();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FsStatEach)->Arg(1000)->Arg(50000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** `fs.statMany` over the same files: one promise, one settle. */
+void BM_FsStatMany(benchmark::State& state) {
+    ScratchTree tree(state.range(0));
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    for (auto _ : state) {
+        std::vector<FsBatchItem> items(tree.files.size());
+        for (size_t i = 0; i < items.size(); i++)
+            items[i].path = tree.files[i];
+        await_value(engine, fsBatchAsync(engine, std::move(items), kFsBatchDefaultConcurrency, true));
+    }
+    engine.cleanup();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FsStatMany)->Arg(1000)->Arg(50000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** `fs.statManyInto`: the same batch packed into one reused `Float64Array`, no per-file JS objects. */
+void BM_FsStatManyInto(benchmark::State& state) {
+    ScratchTree tree(state.range(0));
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    const std::string make = "new Float64Array(" + std::to_string(tree.files.size() * kFsStatFieldCount) + ")";
+    JSValue target = JS_Eval(engine.ctx(), make.c_str(), make.size(), "<bench>", JS_EVAL_TYPE_GLOBAL);
+    for (auto _ : state) {
+        std::vector<FsBatchItem> items(tree.files.size());
+        for (size_t i = 0; i < items.size(); i++)
+            items[i].path = tree.files[i];
+        await_value(engine, fsStatManyIntoAsync(engine, std::move(items), kFsBatchDefaultConcurrency, target));
+    }
+    JS_FreeValue(engine.ctx(), target);
+    engine.cleanup();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FsStatManyInto)->Arg(1000)->Arg(50000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,203 @@
+#include <benchmark/benchmark.h>
+
+#include "runtime/script_host.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <uv.h>
+
+namespace {
+
+constexpr int kRequests = 20000;
+constexpr char kRequest[] = "GET /bench HTTP/1.1\r\nHost: bench\r\n\r\n";
+constexpr char kStop[] = "GET /stop HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n";
+constexpr char kCannedResponse[] = "HTTP/1.1 200 OK\r\ncontent-length: 2\r\n\r\nok";
+
+/** A port the kernel just handed out; the server binds it right after (fine for a benchmark). */
+int free_port() {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+/** Connects to 127.0.0.1:`port`, retrying while the server is still starting; -1 after ~2 s. */
+int connect_with_retry(int port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int attempt = 0; attempt < 200; attempt++) {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+/** Sends `request` and reads one Content-Length framed response; false on EOF or error. */
+bool round_trip(int fd, const char* request, std::string& buf) {
+    const size_t len = std::strlen(request);
+    if (::send(fd, request, len, 0) != static_cast<ssize_t>(len))
+        return false;
+    buf.clear();
+    char chunk[4096];
+    size_t need = std::string::npos;
+    while (need == std::string::npos || buf.size() < need) {
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            return false;
+        buf.append(chunk, static_cast<size_t>(n));
+        const size_t head_end = buf.find("\r\n\r\n");
+        if (need == std::string::npos && head_end != std::string::npos) {
+            const size_t cl = buf.find("content-length: ");
+            const size_t body = cl == std::string::npos || cl > head_end ? 0 : std::strtoul(&buf[cl + 16], nullptr, 10);
+            need = head_end + 4 + body;
+        }
+    }
+    return true;
+}
+
+/** Sequential keep-alive requests on one connection, then the stop request; returns requests answered. */
+int run_client(int port) {
+    const int fd = connect_with_retry(port);
+    if (fd < 0)
+        return 0;
+    std::string buf;
+    int done = 0;
+    while (done < kRequests && round_trip(fd, kRequest, buf))
+        done++;
+    round_trip(fd, kStop, buf);
+    ::close(fd);
+    return done;
+}
+
+/** `http.createServer` on the embedded loop, answering a blocking keep-alive client on another thread. */
+void BM_HttpServerKeepAlive(benchmark::State& state) {
+    const std::filesystem::path script = std::filesystem::temp_directory_path() / "qianjs_http_bench.js";
+    int64_t answered = 0;
+    for (auto _ : state) {
+        const int port = free_port();
+        std::ofstream(script) << "import * as http from 'http';\n"
+                                 "const server = http.createServer((req, res) => {\n"
+                                 "    http.respond(res, 200, undefined, 'ok');\n"
+                                 "    if (req.url === '/stop') http.closeServer(server);\n"
+                                 "}, { port: "
+                              << port << " });\n";
+        int done = 0;
+        std::thread client([&done, port] { done = run_client(port); });
+        benchmark::DoNotOptimize(qianjs::runScriptFile(script));
+        client.join();
+        if (done != kRequests) {
+            state.SkipWithError("client did not get every response");
+            break;
+        }
+        answered += done;
+    }
+    std::filesystem::remove(script);
+    state.SetItemsProcessed(answered);
+}
+BENCHMARK(BM_HttpServerKeepAlive)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+struct EchoConn {
+    uv_tcp_t tcp;
+    uv_stream_t* server;
+    char buf[64 * 1024];
+    /** Bytes of the request head seen so far without its terminating blank line. */
+    std::string pending;
+};
+
+/**
+ * Bare libuv baseline: one canned response per request head, written with `uv_try_write`, no parser and no JS. The
+ * server stops after the request carrying `Connection: close`; the gap to `BM_HttpServerKeepAlive` is the cost of
+ * parsing, the JS handler and response assembly.
+ */
+void BM_UvEchoBaseline(benchmark::State& state) {
+    int64_t answered = 0;
+    for (auto _ : state) {
+        uv_loop_t loop;
+        uv_loop_init(&loop);
+        uv_tcp_t server;
+        uv_tcp_init(&loop, &server);
+        const int port = free_port();
+        sockaddr_in addr{};
+        uv_ip4_addr("127.0.0.1", port, &addr);
+        uv_tcp_bind(&server, reinterpret_cast<const sockaddr*>(&addr), 0);
+        uv_listen(reinterpret_cast<uv_stream_t*>(&server), 128, [](uv_stream_t* srv, int status) {
+            if (status < 0)
+                return;
+            auto* conn = new EchoConn;
+            uv_tcp_init(srv->loop, &conn->tcp);
+            conn->tcp.data = conn;
+            conn->server = srv;
+            uv_accept(srv, reinterpret_cast<uv_stream_t*>(&conn->tcp));
+            uv_tcp_nodelay(&conn->tcp, 1);
+            uv_read_start(
+                reinterpret_cast<uv_stream_t*>(&conn->tcp),
+                [](uv_handle_t* h, size_t, uv_buf_t* out) {
+                    auto* c = static_cast<EchoConn*>(h->data);
+                    *out = uv_buf_init(c->buf, sizeof(c->buf));
+                },
+                [](uv_stream_t* s, ssize_t n, const uv_buf_t*) {
+                    auto* c = static_cast<EchoConn*>(s->data);
+                    bool stop = n < 0;
+                    if (n > 0) {
+                        c->pending.append(c->buf, static_cast<size_t>(n));
+                        size_t end;
+                        while ((end = c->pending.find("\r\n\r\n")) != std::string::npos) {
+                            stop = stop || c->pending.compare(0, 9, "GET /stop") == 0;
+                            uv_buf_t reply =
+                                uv_buf_init(const_cast<char*>(kCannedResponse), sizeof(kCannedResponse) - 1);
+                            uv_try_write(s, &reply, 1);
+                            c->pending.erase(0, end + 4);
+                        }
+                    }
+                    if (!stop)
+                        return;
+                    uv_close(reinterpret_cast<uv_handle_t*>(c->server), nullptr);
+                    uv_close(reinterpret_cast<uv_handle_t*>(s), [](uv_handle_t* h) {
+                        delete static_cast<EchoConn*>(h->data);
+                    });
+                });
+        });
+
+        int done = 0;
+        std::thread client([&done, port] { done = run_client(port); });
+        uv_run(&loop, UV_RUN_DEFAULT);
+        client.join();
+        uv_loop_close(&loop);
+        if (done != kRequests) {
+            state.SkipWithError("client did not get every response");
+            break;
+        }
+        answered += done;
+    }
+    state.SetItemsProcessed(answered);
+}
+BENCHMARK(BM_UvEchoBaseline)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+#endif
@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+
+#include "native/timers/timer_queue.h"
+#include "runtime/event_loop/event_loop.h"
+
+#include <uvw.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using steady = std::chrono::steady_clock;
+
+/** Lateness of each fire relative to its requested deadline. */
+struct Drift {
+    double sum_ms = 0;
+    double max_ms = 0;
+    int64_t count = 0;
+
+    void add(steady::time_point due, steady::time_point fired) {
+        const double ms = std::chrono::duration<double, std::milli>(fired - due).count();
+        sum_ms += ms;
+        max_ms = std::max(max_ms, ms);
+        count++;
+    }
+
+    void report(benchmark::State& state) const {
+        state.counters["drift_avg_ms"] = count ? sum_ms / static_cast<double>(count) : 0.0;
+        state.counters["drift_max_ms"] = max_ms;
+    }
+};
+
+uint64_t delay_for(int64_t i) { return 1 + static_cast<uint64_t>(i % 20); }
+
+/** All timers share one uv timer handle; the loop blocks until the earliest deadline. */
+void BM_TimerQueueFire(benchmark::State& state) {
+    const int64_t n = state.range(0);
+    qianjs::event_loop::EventLoop event_loop;
+    const qianjs::event_loop::EventLoop::Scope bind(event_loop);
+    auto loop = qianjs::event_loop::uv::uvw_loop();
+    Drift drift;
+
+    for (auto _ : state) {
+        std::vector<steady::time_point> due(static_cast<size_t>(n));
+        int64_t fired = 0;
+        qianjs::timers::TimerQueue queue([&](int64_t id, bool) {
+            drift.add(due[static_cast<size_t>(id)], steady::now());
+            fired++;
+        });
+
+        for (int64_t i = 0; i < n; i++) {
+            const uint64_t d = delay_for(i);
+            due[static_cast<size_t>(i)] = steady::now() + std::chrono::milliseconds(d);
+            queue.start(i, d, 0);
+        }
+        while (fired < n)
+            loop->run(uvw::loop::run_mode::ONCE);
+    }
+
+    drift.report(state);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_TimerQueueFire)->Arg(100)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** Previous implementation: one sleeping thread per timer, handed back through a locked queue polled every 1 ms. */
+void BM_ThreadPerTimerFire(benchmark::State& state) {
+    const int64_t n = state.range(0);
+    Drift drift;
+
+    for (auto _ : state) {
+        std::vector<steady::time_point> due(static_cast<size_t>(n));
+        std::mutex mu;
+        std::vector<int64_t> ready;
+        std::vector<std::thread> threads;
+        threads.reserve(static_cast<size_t>(n));
+
+        for (int64_t i = 0; i < n; i++) {
+            const uint64_t d = delay_for(i);
+            due[static_cast<size_t>(i)] = steady::now() + std::chrono::milliseconds(d);
+            threads.emplace_back([&mu, &ready, i, d]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(d));
+                std::lock_guard<std::mutex> lock(mu);
+                ready.push_back(i);
+            });
+        }
+
+        int64_t fired = 0;
+        std::vector<int64_t> batch;
+        while (fired < n) {
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                batch.swap(ready);
+            }
+            const auto now = steady::now();
+            for (int64_t id : batch)
+                drift.add(due[static_cast<size_t>(id)], now);
+            fired += static_cast<int64_t>(batch.size());
+            batch.clear();
+            if (fired < n)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (auto& t : threads)
+            t.join();
+    }
+
+    drift.report(state);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_ThreadPerTimerFire)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
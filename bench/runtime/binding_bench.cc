@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+
+#include <js_engine.h>
+#include <js_module.h>
+#include <quickjs.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr int64_t kCalls = 1000000;
+
+/**
+ * One engine with a `qianjs_bench` module of trivial bindings and a driver per binding shape. Each driver calls its
+ * binding `n` times in a JS loop, so a benchmark iteration is pure call overhead (argument conversion, `JSValue`
+ * boxing, the wrapper's dispatch) plus the loop itself, which `BM_CallPureJs` measures on its own.
+ */
+struct BindingBench {
+    qjs::JSEngine engine;
+    JSValue global = JS_UNDEFINED;
+
+    BindingBench() {
+        engine.initialize();
+        auto& m = engine.root().module("qianjs_bench");
+        m.funcDynamic("nop", 0, 0, [](JSContext*, int, JSValue*) -> JSValue { return JS_UNDEFINED; });
+        m.funcDynamic("addDynamic", 2, 2, [](JSContext* c, int, JSValue* argv) -> JSValue {
+            int32_t a = 0;
+            int32_t b = 0;
+            if (JS_ToInt32(c, &a, argv[0]) < 0 || JS_ToInt32(c, &b, argv[1]) < 0)
+                return JS_EXCEPTION;
+            return JS_NewInt32(c, a + b);
+        });
+        m.func("addTyped", [](int a, int b) { return a + b; });
+        m.funcDynamic("echoString", 1, 1, [](JSContext* c, int, JSValue* argv) -> JSValue {
+            return JS_DupValue(c, argv[0]);
+        });
+
+        const std::filesystem::path script = std::filesystem::temp_directory_path() / "qianjs_binding_bench.js";
+        std::ofstream(script) << "import { nop, addDynamic, addTyped, echoString } from 'qianjs_bench';\n"
+                                 "const add = (a, b) => a + b;\n"
+                                 "const loop = (n, f) => {\n"
+                                 "  let s = 0;\n"
+                                 "  for (let i = 0; i < n; i++) s = f(s);\n"
+                                 "  return s;\n"
+                                 "};\n"
+                                 "globalThis.benchPureJs = (n) => loop(n, (s) => add(s, 1));\n"
+                                 "globalThis.benchNop = (n) => { for (let i = 0; i < n; i++) nop(); return n; };\n"
+                                 "globalThis.benchAddDynamic = (n) => loop(n, (s) => addDynamic(s, 1));\n"
+                                 "globalThis.benchAddTyped = (n) => loop(n, (s) => addTyped(s, 1));\n"
+                                 "globalThis.benchEchoString = (n) => loop(n, (s) => echoString('x').length + s);\n";
+        engine.runFile(script.string());
+        std::filesystem::remove(script);
+        global = JS_GetGlobalObject(engine.ctx());
+    }
+
+    ~BindingBench() {
+        JS_FreeValue(engine.ctx(), global);
+        engine.cleanup();
+    }
+
+    /** `driver(kCalls)`; false (and the exception dropped) when it threw or does not exist. */
+    bool call(const char* driver) {
+        JSContext* c = engine.ctx();
+        JSValue fn = JS_GetPropertyStr(c, global, driver);
+        JSValue n = JS_NewInt64(c, kCalls);
+        JSValue r = JS_Call(c, fn, JS_UNDEFINED, 1, &n);
+        const bool ok = !JS_IsException(r);
+        if (!ok)
+            JS_FreeValue(c, JS_GetException(c));
+        JS_FreeValue(c, r);
+        JS_FreeValue(c, fn);
+        return ok;
+    }
+};
+
+BindingBench& bench() {
+    static BindingBench* instance = new BindingBench();
+    return *instance;
+}
+
+void run_driver(benchmark::State& state, const char* driver) {
+    BindingBench& b = bench();
+    for (auto _ : state) {
+        if (!b.call(driver)) {
+            state.SkipWithError("driver threw");
+            return;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCalls);
+}
+
+/** Baseline: the same loop calling a JS arrow function. */
+void BM_CallPureJs(benchmark::State& state) {
+    run_driver(state, "benchPureJs");
+}
+BENCHMARK(BM_CallPureJs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** `funcDynamic` with no arguments: the floor of crossing into native code. */
+void BM_CallFuncDynamicNop(benchmark::State& state) {
+    run_driver(state, "benchNop");
+}
+BENCHMARK(BM_CallFuncDynamicNop)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** `funcDynamic` converting two numbers by hand, the shape most plugin bindings use. */
+void BM_CallFuncDynamicAdd(benchmark::State& state) {
+    run_driver(state, "benchAddDynamic");
+}
+BENCHMARK(BM_CallFuncDynamicAdd)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** Typed `func`: arguments and result converted by `qjs::JSConv`. */
+void BM_CallFuncTypedAdd(benchmark::State& state) {
+    run_driver(state, "benchAddTyped");
+}
+BENCHMARK(BM_CallFuncTypedAdd)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** `funcDynamic` returning its string argument (reference count only, no copy). */
+void BM_CallFuncDynamicString(benchmark::State& state) {
+    run_driver(state, "benchEchoString");
+}
+BENCHMARK(BM_CallFuncDynamicString)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,146 @@
+#include <benchmark/benchmark.h>
+
+#include "runtime/event_loop/event_loop.h"
+
+#include <js_engine.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int64_t kTasksPerProducer = 100000;
+
+/** Set by the deferred task of `BM_DeferWakeLatency`; only the consumer thread touches it. */
+thread_local uint64_t t_wake_latency_ns = 0;
+
+qjs::JSEngine& bench_engine() {
+    static qjs::JSEngine* engine = [] {
+        auto* e = new qjs::JSEngine();
+        e->initialize();
+        return e;
+    }();
+    return *engine;
+}
+
+/** `EventLoop::defer` with 1..N producer threads; the benchmark thread is the single consumer (`run_deferred`). */
+void BM_DeferMpsc(benchmark::State& state) {
+    const int producers = static_cast<int>(state.range(0));
+    qjs::JSEngine& engine = bench_engine();
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qianjs::event_loop::ensure_started();
+
+    for (auto _ : state) {
+        int64_t done = 0;
+        const int64_t total = kTasksPerProducer * producers;
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&done, &loop]() {
+                for (int64_t i = 0; i < kTasksPerProducer; i++)
+                    loop.defer([&done, i](qjs::JSEngine&) { done += (i >= 0); });
+            });
+        }
+        while (done < total) {
+            if (!qianjs::event_loop::has_deferred())
+                qianjs::event_loop::run_once();
+            qianjs::event_loop::run_deferred(engine);
+        }
+        for (auto& t : threads)
+            t.join();
+    }
+
+    state.SetItemsProcessed(state.iterations() * kTasksPerProducer * producers);
+}
+BENCHMARK(BM_DeferMpsc)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/** Previous scheme for comparison: `std::function` pushed into a mutex-guarded vector, swapped out per batch. */
+void BM_DeferMutexVector(benchmark::State& state) {
+    const int producers = static_cast<int>(state.range(0));
+    qjs::JSEngine& engine = bench_engine();
+
+    for (auto _ : state) {
+        std::mutex mu;
+        std::vector<std::function<void(qjs::JSEngine&)>> pending;
+        std::atomic<int> running{producers};
+        int64_t done = 0;
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&]() {
+                for (int64_t i = 0; i < kTasksPerProducer; i++) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    pending.emplace_back([&done, i](qjs::JSEngine&) { done += (i >= 0); });
+                }
+                running.fetch_sub(1);
+            });
+        }
+        std::vector<std::function<void(qjs::JSEngine&)>> batch;
+        while (running.load() > 0 || done < kTasksPerProducer * producers) {
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                batch.swap(pending);
+            }
+            for (auto& f : batch)
+                f(engine);
+            batch.clear();
+        }
+        for (auto& t : threads)
+            t.join();
+    }
+
+    state.SetItemsProcessed(state.iterations() * kTasksPerProducer * producers);
+}
+BENCHMARK(BM_DeferMutexVector)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/**
+ * Wake-up latency of a cross-thread `defer`: the consumer blocks in `run_once` and a producer thread defers one task
+ * per iteration. `latency_avg_us` / `latency_max_us` run from just before `defer` to the task starting.
+ */
+void BM_DeferWakeLatency(benchmark::State& state) {
+    qjs::JSEngine& engine = bench_engine();
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qianjs::event_loop::ensure_started();
+
+    std::atomic<bool> go{false};
+    std::atomic<bool> quit{false};
+    std::thread producer([&]() {
+        while (!quit.load(std::memory_order_acquire)) {
+            if (!go.exchange(false, std::memory_order_acq_rel)) {
+                std::this_thread::yield();
+                continue;
+            }
+            const uint64_t stamp = qianjs::event_loop::now_ns();
+            loop.defer([stamp](qjs::JSEngine&) { t_wake_latency_ns = qianjs::event_loop::now_ns() - stamp; });
+        }
+    });
+
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    for (auto _ : state) {
+        t_wake_latency_ns = 0;
+        loop.begin_operation();
+        go.store(true, std::memory_order_release);
+        while (t_wake_latency_ns == 0) {
+            if (!loop.has_deferred())
+                loop.run_once();
+            loop.run_deferred(engine);
+        }
+        loop.end_operation();
+        total_ns += t_wake_latency_ns;
+        max_ns = t_wake_latency_ns > max_ns ? t_wake_latency_ns : max_ns;
+    }
+    quit.store(true, std::memory_order_release);
+    producer.join();
+
+    const double n = static_cast<double>(state.iterations());
+    state.counters["latency_avg_us"] = n > 0 ? static_cast<double>(total_ns) / n / 1e3 : 0.0;
+    state.counters["latency_max_us"] = static_cast<double>(max_ns) / 1e3;
+}
+BENCHMARK(BM_DeferWakeLatency)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+
+#include "runtime/bundle/module_bundle.h"
+#include "runtime/embed.h"
+#include "runtime/script_host.h"
+#include "runtime/snapshot/snapshot.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+/**
+ * A short CLI-shaped app: `main.js` does trivial work on a table that `table.js` builds at top level (parses a
+ * 2k-row CSV literal and indexes it), i.e. the fixed setup a snapshot is meant to skip.
+ */
+struct StartupApp {
+    fs::path root = fs::temp_directory_path() / "qianjs_startup_bench";
+    fs::path source = root / "main.js";
+    fs::path bytecode = root / "main.qbc";
+    fs::path snapshot = root / "main.snap.qbc";
+    /** This benchmark binary with `main.qbc` appended, i.e. what `qianjs embed` ships. */
+    fs::path embedded = root / "main.embedded";
+
+    StartupApp() {
+        fs::remove_all(root);
+        fs::create_directories(root);
+        std::string csv;
+        for (int i = 0; i < 2000; i++)
+            csv += "item" + std::to_string(i) + "," + std::to_string(i * 7 % 997) + "," + std::to_string(i % 13) + "\\n";
+        std::ofstream(root / "table.js") << "'use snapshot';\n"
+                                            "const csv = \"" << csv << "\";\n"
+                                            "export const rows = csv.trim().split('\\n').map((l) => {\n"
+                                            "  const [name, price, group] = l.split(',');\n"
+                                            "  return { name, price: Number(price), group: Number(group) };\n"
+                                            "});\n"
+                                            "export const byGroup = {};\n"
+                                            "for (const r of rows) (byGroup[r.group] || (byGroup[r.group] = [])).push(r.name);\n";
+        std::ofstream(source) << "import { rows, byGroup } from './table.js';\n"
+                                 "globalThis.result = rows.length + byGroup[3].length;\n";
+
+        std::vector<qianjs::bundle::BuiltModule> modules;
+        std::string error;
+        qianjs::bundle::compileModuleGraph(source, modules, error);
+        const std::vector<uint8_t> bundle = qianjs::bundle::writeBundle(std::move(modules));
+        Embed::writeBinaryFile(bytecode, bundle);
+        Embed::createEmbeddedExecutable(bundle, embedded);
+
+        modules.clear();
+        size_t snapshotted = 0;
+        qianjs::snapshot::buildSnapshot(source, modules, snapshotted, error);
+        Embed::writeBinaryFile(snapshot, qianjs::bundle::writeBundle(std::move(modules)));
+    }
+
+    ~StartupApp() {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+};
+
+const StartupApp& app() {
+    static StartupApp instance;
+    return instance;
+}
+
+/** Full in-process launch: engine + default plugins, load, evaluate, drain. Excludes process exec / dynamic linking. */
+void run_startup(benchmark::State& state, const fs::path& path) {
+    for (auto _ : state)
+        benchmark::DoNotOptimize(qianjs::runScriptFile(path));
+}
+
+void BM_StartupSource(benchmark::State& state) {
+    run_startup(state, app().source);
+}
+BENCHMARK(BM_StartupSource)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+void BM_StartupBytecode(benchmark::State& state) {
+    run_startup(state, app().bytecode);
+}
+BENCHMARK(BM_StartupBytecode)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+void BM_StartupSnapshot(benchmark::State& state) {
+    run_startup(state, app().snapshot);
+}
+BENCHMARK(BM_StartupSnapshot)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/** The bundle appended to an executable: footer probe + `mmap` of the payload instead of reading a `.qbc`. */
+void BM_StartupEmbedded(benchmark::State& state) {
+    if (Embed::mapEmbeddedBytecode(app().embedded).empty()) {
+        state.SkipWithError("cannot build embedded executable");
+        return;
+    }
+    for (auto _ : state)
+        benchmark::DoNotOptimize(qianjs::runEmbeddedBytecode({}, app().embedded));
+}
+BENCHMARK(BM_StartupEmbedded)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/** Same bundle through `EnginePool`: after the first iteration only the entry is evaluated on a warm engine. */
+void BM_StartupPooled(benchmark::State& state) {
+    qianjs::EnginePool pool;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(pool.run(app().bytecode));
+}
+BENCHMARK(BM_StartupPooled)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/** `JSEngine::initialize` + every default plugin installed up front (`installAll`), nothing evaluated. */
+void BM_StartupEngineOnly(benchmark::State& state) {
+    for (auto _ : state) {
+        qjs::JSEngine engine;
+        engine.initialize();
+        qianjs::RuntimeContext runtime;
+        engine.setHost<qianjs::RuntimeContext>(&runtime);
+        defaultPlugins().installAll(engine, engine.root());
+        engine.cleanup();
+    }
+}
+BENCHMARK(BM_StartupEngineOnly)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+/** What the run paths pay instead: `LazyPlugins` installs only the eager plugins until a module is imported. */
+void BM_StartupEngineLazy(benchmark::State& state) {
+    for (auto _ : state) {
+        qjs::JSEngine engine;
+        engine.initialize();
+        qianjs::RuntimeContext runtime;
+        engine.setHost<qianjs::RuntimeContext>(&runtime);
+        {
+            const qianjs::plugins::LazyPlugins lazy(engine, lazyDefaultPlugins());
+            benchmark::DoNotOptimize(lazy.installedCount());
+        }
+        engine.cleanup();
+    }
+}
+BENCHMARK(BM_StartupEngineLazy)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+} // namespace
@@ -5,62 +5,161 @@
 #include "cli/cli_runner.h"
 
 #include "native/default_plugins.h"
+#include "runtime/bundle/parallel_build.h"
 #include "runtime/embed.h"
 #include "runtime/script_host.h"
 
 #include <js_engine.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace fs = std::filesystem;
 
+static int currentPid() {
+#ifdef _WIN32
+    return static_cast<int>(_getpid());
+#else
+    return static_cast<int>(::getpid());
+#endif
+}
+
 static void printUsage(const char* progName) {
     std::cout << "QianJS — JavaScript runtime\n\n"
               << "Usage:\n"
-              << "  " << progName << " run <file.js|qbc> [args...]   Run JS or bytecode\n"
-              << "  " << progName << " build <file.js>     Compile JS to ./dist/<name>.qbc\n"
-              << "  " << progName << " embed <file.qbc>    Embed bytecode into a standalone executable\n"
+              << "  " << progName << " run [--cache] [--prof[=file]] <file.js|qbc> [args...]   Run JS or bytecode\n"
+              << "  " << progName << " build <file.js|glob>...     Compile entries and imports to ./dist/<name>.qbc\n"
+              << "  " << progName << " snapshot <file.js|glob>...  Like build, \"use snapshot\" modules pre-evaluated\n"
+              << "  " << progName << " embed [--compress] <file.qbc>   Embed bytecode into a standalone executable\n"
               << "  " << progName << " help                Show this help\n"
+              << "\n"
+              << "Run options:\n"
+              << "  --cache    Reuse compiled bytecode for the script and its imports (also enabled by QIANJS_CACHE_DIR)\n"
+              << "  --prof[=file]         Sample the JS stack and write collapsed stacks for flame graphs\n"
+              << "                        (default file: qianjs-<pid>.folded)\n"
+              << "  --prof-interval=<us>  Sampling interval in microseconds (default 10000)\n"
+              << "  --loop-stats[=file]   Time event-loop turns and native ops; print the table at exit\n"
+              << "                        (default: stderr; also enabled by QIANJS_LOOP_STATS)\n"
+              << "\n"
+              << "Build options:\n"
+              << "  --jobs=N   Worker threads (default: one per CPU)\n"
+              << "  --force    Rebuild every entry even if dist/.qianjs-build says it is up to date\n"
+              << "\n"
+              << "Embed options:\n"
+              << "  --compress Store the payload LZ4-compressed (smaller download, decompressed once at startup)\n"
               << std::endl;
 }
 
-static int cmdBuild(const fs::path& inputPath) {
-    if (!fs::exists(inputPath)) {
-        std::cerr << "Error: File not found: " << inputPath << std::endl;
-        return 1;
-    }
+static std::string formatMs(std::chrono::microseconds us) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f ms", static_cast<double>(us.count()) / 1000.0);
+    return buf;
+}
 
-    std::string code = Embed::readTextFile(inputPath);
-    if (code.empty()) {
-        std::cerr << "Error: Cannot read file: " << inputPath << std::endl;
+/**
+ * `build`, or `snapshot` when `options.snapshot` is set: every entry (globs expanded) is bundled into its own
+ * `dist/<name>.qbc` across worker threads, skipping the ones whose sources are unchanged since the last build.
+ */
+static int cmdBuild(const std::vector<std::string>& patterns, const qianjs::bundle::BuildOptions& options) {
+    using qianjs::bundle::BuildResult;
+    using qianjs::bundle::BuildStatus;
+
+    std::vector<fs::path> entries;
+    std::string error;
+    if (!qianjs::bundle::expandEntries(patterns, entries, error)) {
+        std::cerr << "Error: " << error << std::endl;
         return 1;
     }
 
-    qjs::JSEngine engine;
-    engine.initialize();
-    defaultPlugins().installAll(engine, engine.root());
-    qjs::JSEngine::CompileResult result = engine.compileModuleFromSource(code, inputPath.string());
-    engine.cleanup();
-    if (!result.success) {
-        std::cerr << "Compile error: " << result.error << std::endl;
-        return 1;
+    const auto started = std::chrono::steady_clock::now();
+    const bool snapshot = options.snapshot;
+    const auto report = [snapshot](const BuildResult& r) {
+        if (r.status == BuildStatus::Failed) {
+            std::cerr << (snapshot ? "Snapshot error: " : "Compile error: ") << r.input.string() << ": " << r.error
+                      << std::endl;
+            return;
+        }
+        std::cout << (r.status == BuildStatus::UpToDate ? "Up to date: " : snapshot ? "Snapshot: " : "Compiled: ")
+                  << r.input.string() << " -> " << r.output.string() << " (" << r.modules
+                  << (r.modules == 1 ? " module, " : " modules, ");
+        if (r.status == BuildStatus::Built) {
+            if (snapshot)
+                std::cout << r.snapshotted << " snapshotted, ";
+            std::cout << r.bytes << " bytes, ";
+        }
+        std::cout << formatMs(r.elapsed) << ")" << std::endl;
+    };
+    const std::vector<BuildResult> results = qianjs::bundle::buildEntries(entries, options, report);
+    const auto total =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+
+    size_t counts[3] = {0, 0, 0};
+    std::vector<const BuildResult*> built;
+    for (const BuildResult& r : results) {
+        counts[static_cast<int>(r.status)]++;
+        if (r.status == BuildStatus::Built)
+            built.push_back(&r);
     }
+    if (results.size() > 1) {
+        std::cout << "Built " << counts[0] << ", up to date " << counts[1] << ", failed " << counts[2] << " of "
+                  << results.size() << " entries in " << formatMs(total) << std::endl;
+    }
+    /** Completion order interleaves across workers; repeat the slowest so they stand out in long builds. */
+    if (built.size() > 5) {
+        const size_t shown = 3;
+        std::partial_sort(built.begin(), built.begin() + shown, built.end(),
+                          [](const BuildResult* a, const BuildResult* b) { return a->elapsed > b->elapsed; });
+        std::cout << "Slowest:";
+        for (size_t i = 0; i < shown; i++)
+            std::cout << (i ? ", " : " ") << built[i]->input.string() << " " << formatMs(built[i]->elapsed);
+        std::cout << std::endl;
+    }
+    return counts[2] == 0 ? 0 : 1;
+}
 
-    fs::path outputPath = fs::path("dist") / inputPath.stem();
-    outputPath.replace_extension(".qbc");
-
-    if (!Embed::writeBinaryFile(outputPath, result.bytecode)) {
-        std::cerr << "Error: Cannot write file: " << outputPath << std::endl;
+/** `build` / `snapshot` arguments: `[--jobs=N] [--force] <file|glob>...`. */
+static int parseBuild(int argc, char* argv[], bool snapshot) {
+    qianjs::bundle::BuildOptions options;
+    options.snapshot = snapshot;
+    std::vector<std::string> patterns;
+    for (int i = 2; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--jobs=", 0) == 0) {
+            char* end = nullptr;
+            const long n = std::strtol(arg.c_str() + 7, &end, 10);
+            if (n <= 0 || *end != '\0') {
+                std::cerr << "Error: Invalid job count: " << arg << std::endl;
+                return 1;
+            }
+            options.jobs = static_cast<unsigned>(n);
+        } else if (arg == "--force") {
+            options.force = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown " << argv[1] << " option: " << arg << std::endl;
+            return 1;
+        } else {
+            patterns.push_back(arg);
+        }
+    }
+    if (patterns.empty()) {
+        std::cerr << "Error: Missing input file\n"
+                  << "Usage: " << argv[0] << " " << argv[1] << " [--jobs=N] [--force] <file.js|glob>..." << std::endl;
         return 1;
     }
-
-    std::cout << "Compiled: " << inputPath.string() << " -> " << outputPath.string()
-              << " (" << result.bytecode.size() << " bytes)" << std::endl;
-    return 0;
+    return cmdBuild(patterns, options);
 }
 
-static int cmdEmbed(const fs::path& qbcPath) {
+static int cmdEmbed(const fs::path& qbcPath, Embed::Compression compression) {
     if (!fs::exists(qbcPath)) {
         std::cerr << "Error: File not found: " << qbcPath << std::endl;
         return 1;
@@ -82,7 +181,7 @@ static int cmdEmbed(const fs::path& qbcPath) {
     outputPath.replace_extension(".exe");
 #endif
 
-    if (!Embed::createEmbeddedExecutable(bytecode, outputPath)) {
+    if (!Embed::createEmbeddedExecutable(bytecode, outputPath, compression)) {
         std::cerr << "Error: Cannot create embedded executable: " << outputPath << std::endl;
         return 1;
     }
@@ -93,14 +192,14 @@ static int cmdEmbed(const fs::path& qbcPath) {
     return 0;
 }
 
-static int cmdRun(const fs::path& inputPath, std::vector<std::string> scriptArgv) {
+static int cmdRun(const fs::path& inputPath, std::vector<std::string> scriptArgv, const qianjs::RunOptions& options = {}) {
     if (!fs::exists(inputPath)) {
         std::cerr << "Error: File not found: " << inputPath << std::endl;
         return 1;
     }
     if (scriptArgv.empty())
         scriptArgv.push_back(inputPath.string());
-    return qianjs::runScriptFile(inputPath, std::move(scriptArgv));
+    return qianjs::runScriptFile(inputPath, std::move(scriptArgv), options);
 }
 
 static int cmdRunBundled(int argc, char* argv[]) {
@@ -145,35 +244,72 @@ int qianjs_cli_run(int argc, char* argv[]) {
         return 0;
     }
 
-    if (cmd == "build") {
-        if (argc < 3) {
-            std::cerr << "Error: Missing input file\n"
-                      << "Usage: " << argv[0] << " build <file.js>" << std::endl;
-            return 1;
-        }
-        return cmdBuild(argv[2]);
-    }
+    if (cmd == "build" || cmd == "snapshot")
+        return parseBuild(argc, argv, cmd == "snapshot");
 
     if (cmd == "embed") {
-        if (argc < 3) {
+        Embed::Compression compression = Embed::Compression::None;
+        int first = 2;
+        for (; first < argc && argv[first][0] == '-' && argv[first][1] == '-'; first++) {
+            const std::string opt = argv[first];
+            if (opt == "--compress") {
+                compression = Embed::Compression::Lz4;
+            } else {
+                std::cerr << "Error: Unknown embed option: " << opt << std::endl;
+                return 1;
+            }
+        }
+        if (first >= argc) {
             std::cerr << "Error: Missing input file\n"
-                      << "Usage: " << argv[0] << " embed <file.qbc>" << std::endl;
+                      << "Usage: " << argv[0] << " embed [--compress] <file.qbc>" << std::endl;
             return 1;
         }
-        return cmdEmbed(argv[2]);
+        return cmdEmbed(argv[first], compression);
     }
 
     if (cmd == "run") {
-        if (argc < 3) {
+        qianjs::RunOptions options;
+        if (const char* dir = std::getenv("QIANJS_CACHE_DIR"); dir && *dir)
+            options.cacheDir = fs::path(dir);
+        if (const char* out = std::getenv("QIANJS_LOOP_STATS"); out && *out)
+            options.loopStatsOut = fs::path(std::string(out) == "1" ? "-" : out);
+        int first = 2;
+        for (; first < argc && argv[first][0] == '-' && argv[first][1] == '-'; first++) {
+            const std::string opt = argv[first];
+            if (opt == "--cache") {
+                options.cacheDir = qianjs::compile_cache::defaultCacheDir();
+            } else if (opt == "--prof") {
+                options.profileOut = fs::path("qianjs-" + std::to_string(currentPid()) + ".folded");
+            } else if (opt.rfind("--prof=", 0) == 0 && opt.size() > 7) {
+                options.profileOut = fs::path(opt.substr(7));
+            } else if (opt.rfind("--prof-interval=", 0) == 0) {
+                char* end = nullptr;
+                const long long us = std::strtoll(opt.c_str() + 16, &end, 10);
+                if (us <= 0 || *end != '\0') {
+                    std::cerr << "Error: Invalid sampling interval: " << opt << std::endl;
+                    return 1;
+                }
+                options.profileInterval = std::chrono::microseconds(us);
+            } else if (opt == "--loop-stats") {
+                options.loopStatsOut = fs::path("-");
+            } else if (opt.rfind("--loop-stats=", 0) == 0 && opt.size() > 13) {
+                options.loopStatsOut = fs::path(opt.substr(13));
+            } else {
+                std::cerr << "Error: Unknown run option: " << opt << std::endl;
+                return 1;
+            }
+        }
+        if (first >= argc) {
             std::cerr << "Error: Missing input file\n"
-                      << "Usage: " << argv[0] << " run <file.js|file.qbc> [args...]" << std::endl;
+                      << "Usage: " << argv[0] << " run [--cache] [--prof[=file]] <file.js|file.qbc> [args...]"
+                      << std::endl;
             return 1;
         }
         std::vector<std::string> scriptArgv;
-        scriptArgv.reserve(static_cast<size_t>(argc - 2));
-        for (int i = 2; i < argc; i++)
+        scriptArgv.reserve(static_cast<size_t>(argc - first));
+        for (int i = first; i < argc; i++)
             scriptArgv.emplace_back(argv[i]);
-        return cmdRun(argv[2], std::move(scriptArgv));
+        return cmdRun(argv[first], std::move(scriptArgv), options);
     }
 
     std::cerr << "Error: Unknown command: " << cmd << std::endl;
@@ -0,0 +1,847 @@
+#include "native/child_process/child_process_module.h"
+
+#include "native/child_process/subprocess.h"
+
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/output/std_output.h"
+#include "runtime/profiler/sampling_profiler.h"
+#include "runtime/runtime_context.h"
+
+#include <js_engine.h>
+#include <js_module.h>
+#include <js_types.h>
+
+#include <uv.h>
+
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using qianjs::child_process::SpawnOptions;
+using qianjs::child_process::StdioMode;
+using qianjs::child_process::Subprocess;
+
+/** Output queued for one child above this goes to JS at once instead of waiting for the deferred batch. */
+constexpr size_t kMaxBatchBytes = 1024 * 1024;
+/** Default `exec` limit on stdout + stderr. */
+constexpr size_t kDefaultMaxBuffer = 64 * 1024 * 1024;
+
+struct SignalName {
+    int number;
+    const char* name;
+};
+
+const SignalName kSignals[] = {
+    {SIGTERM, "SIGTERM"}, {SIGKILL, "SIGKILL"}, {SIGINT, "SIGINT"}, {SIGHUP, "SIGHUP"},
+    {SIGABRT, "SIGABRT"}, {SIGSEGV, "SIGSEGV"}, {SIGFPE, "SIGFPE"}, {SIGILL, "SIGILL"},
+#ifdef SIGQUIT
+    {SIGQUIT, "SIGQUIT"},
+#endif
+#ifdef SIGPIPE
+    {SIGPIPE, "SIGPIPE"},
+#endif
+#ifdef SIGUSR1
+    {SIGUSR1, "SIGUSR1"}, {SIGUSR2, "SIGUSR2"},
+#endif
+#ifdef SIGALRM
+    {SIGALRM, "SIGALRM"},
+#endif
+};
+
+std::string signal_name(int signum) {
+    for (const SignalName& s : kSignals) {
+        if (s.number == signum)
+            return s.name;
+    }
+    return "SIG" + std::to_string(signum);
+}
+
+std::string uv_message(int status) {
+    return std::string(uv_err_name(status)) + ": " + uv_strerror(status);
+}
+
+/** `SIGTERM` for undefined, else a signal number or one of the names above; false with an exception set. */
+bool parse_signal(JSContext* c, JSValue v, int& out) {
+    if (JS_IsUndefined(v)) {
+        out = SIGTERM;
+        return true;
+    }
+    if (!JS_IsString(v)) {
+        int32_t n = 0;
+        if (JS_ToInt32(c, &n, v) < 0)
+            return false;
+        out = n;
+        return true;
+    }
+    const char* s = JS_ToCString(c, v);
+    if (!s)
+        return false;
+    bool found = false;
+    for (const SignalName& sig : kSignals) {
+        if (std::strcmp(sig.name, s) == 0) {
+            out = sig.number;
+            found = true;
+        }
+    }
+    if (!found)
+        JS_ThrowTypeError(c, "kill: unknown signal '%s'", s);
+    JS_FreeCString(c, s);
+    return found;
+}
+
+/** String without NUL bytes (argv, env and paths are C strings); false with an exception set. */
+bool c_string_arg(JSContext* c, JSValue v, std::string& out, const char* fn, const char* what) {
+    size_t len = 0;
+    const char* s = JS_ToCStringLen(c, &len, v);
+    if (!s)
+        return false;
+    out.assign(s, len);
+    JS_FreeCString(c, s);
+    if (out.find('\0') != std::string::npos) {
+        JS_ThrowTypeError(c, "%s: %s must not contain NUL bytes", fn, what);
+        return false;
+    }
+    return true;
+}
+
+/** Copies a string, ArrayBuffer or TypedArray into `out`; false (no exception) for other values. */
+bool copy_js_bytes(JSContext* c, JSValue v, std::string& out) {
+    if (JS_IsString(v)) {
+        size_t len = 0;
+        const char* s = JS_ToCStringLen(c, &len, v);
+        if (!s)
+            return false;
+        out.assign(s, len);
+        JS_FreeCString(c, s);
+        return true;
+    }
+    size_t size = 0;
+    if (uint8_t* raw = JS_GetArrayBuffer(c, &size, v)) {
+        out.assign(reinterpret_cast<const char*>(raw), size);
+        return true;
+    }
+    JS_FreeValue(c, JS_GetException(c));
+    size_t boff = 0, blen = 0, bpe = 0;
+    JSValue buf = JS_GetTypedArrayBuffer(c, v, &boff, &blen, &bpe);
+    if (JS_IsException(buf)) {
+        JS_FreeValue(c, JS_GetException(c));
+        return false;
+    }
+    size_t ablen = 0;
+    uint8_t* base = JS_GetArrayBuffer(c, &ablen, buf);
+    JS_FreeValue(c, buf);
+    if (!base || boff > ablen || blen > ablen - boff) {
+        JS_FreeValue(c, JS_GetException(c));
+        return false;
+    }
+    out.assign(reinterpret_cast<const char*>(base + boff), blen);
+    return true;
+}
+
+/** The string itself becomes the ArrayBuffer's storage. */
+JSValue take_buffer(JSContext* c, std::string&& bytes) {
+    if (bytes.empty())
+        return JS_NewArrayBufferCopy(c, nullptr, 0);
+    auto* owned = new std::string(std::move(bytes));
+    JSValue ab = JS_NewArrayBuffer(c, reinterpret_cast<uint8_t*>(owned->data()), owned->size(),
+        [](JSRuntime*, void* opaque, void*) { delete static_cast<std::string*>(opaque); }, owned, 0);
+    if (JS_IsException(ab))
+        delete owned;
+    return ab;
+}
+
+/** `'pipe' | 'inherit' | 'ignore'` at `key` of `opts`, left as is when absent; false with an exception set. */
+bool stdio_option(JSContext* c, JSValue opts, const char* key, StdioMode& out, const char* fn) {
+    JSValue v = JS_GetPropertyStr(c, opts, key);
+    if (JS_IsException(v))
+        return false;
+    if (JS_IsUndefined(v))
+        return true;
+    const char* s = JS_ToCString(c, v);
+    JS_FreeValue(c, v);
+    if (!s)
+        return false;
+    bool ok = true;
+    if (std::strcmp(s, "pipe") == 0)
+        out = StdioMode::Pipe;
+    else if (std::strcmp(s, "inherit") == 0)
+        out = StdioMode::Inherit;
+    else if (std::strcmp(s, "ignore") == 0)
+        out = StdioMode::Ignore;
+    else
+        ok = false;
+    if (!ok)
+        JS_ThrowTypeError(c, "%s: %s must be 'pipe', 'inherit' or 'ignore'", fn, key);
+    JS_FreeCString(c, s);
+    return ok;
+}
+
+struct EarlyWrite {
+    std::string data;
+    qjs::JSEngine::PromiseHandle ph{};
+};
+
+/** One `spawn` / `exec`, from the call (possibly queued behind a limiter) until its exit is reported. */
+struct Child {
+    SpawnOptions options;
+    int64_t limiter = 0;
+    Subprocess* proc = nullptr;
+    bool started = false;
+    qianjs::event_loop::OpTimer op;
+
+    /** `spawn`: output callbacks for fd 1 and 2 and the bytes waiting for the next deferred batch. */
+    JSValue on_output[3] = {JS_UNDEFINED, JS_UNDEFINED, JS_UNDEFINED};
+    std::string pending[3];
+    bool flush_scheduled = false;
+    std::vector<qjs::JSEngine::PromiseHandle> waiters;
+    /** Stdin writes and `closeStdin` made while the child waits for a limiter slot. */
+    std::vector<EarlyWrite> early_writes;
+    bool early_close = false;
+
+    /** `exec`: the result promise, collected output and its cap. */
+    bool collect = false;
+    qjs::JSEngine::PromiseHandle exec{};
+    std::string output[3];
+    size_t max_buffer = kDefaultMaxBuffer;
+    bool overflowed = false;
+    std::string input;
+    bool has_input = false;
+};
+
+/** Exit of a `spawn` child nobody has waited for yet. */
+struct Finished {
+    int64_t exit_status = 0;
+    int signal = 0;
+    int error = 0;
+};
+
+/** FIFO of children waiting for one of `max` slots. */
+struct Limiter {
+    int max = 1;
+    int running = 0;
+    std::deque<int64_t> queue;
+};
+
+/**
+ * Per-engine children on the engine's loop, addressed from JS by numeric id like timers. Each child is one pending
+ * operation (kind `spawn`) from the call until its exit is settled, including time spent queued behind a limiter, so
+ * the host waits for every child before exiting.
+ *
+ * Output is not delivered per read: chunks arriving in one loop turn are concatenated per stream and handed to JS in
+ * one deferred callback (at once above `kMaxBatchBytes`), and all of it precedes the exit.
+ */
+class ChildState final : public qianjs::child_process::SubprocessListener {
+public:
+    explicit ChildState(qjs::JSEngine& engine)
+        : engine_(engine),
+          rt_(JS_GetRuntime(engine.ctx())),
+          loop_(qianjs::event_loop::EventLoop::of(engine)),
+          alive_(std::make_shared<bool>(true)) {}
+
+    /** Engine teardown with children still running: detach them, drop callbacks, promises and op counts. */
+    ~ChildState() override {
+        *alive_ = false;
+        for (auto& [id, ch] : children_) {
+            if (ch.proc)
+                ch.proc->detach();
+            for (JSValue fn : ch.on_output)
+                JS_FreeValueRT(rt_, fn);
+            for (qjs::JSEngine::PromiseHandle ph : ch.waiters)
+                engine_.freePromise(ph);
+            for (EarlyWrite& w : ch.early_writes)
+                engine_.freePromise(w.ph);
+            if (ch.exec.ptr)
+                engine_.freePromise(ch.exec);
+            loop_.end_operation(ch.op);
+        }
+        for (auto& [token, ph] : writes_)
+            engine_.freePromise(ph);
+    }
+
+    /** A child's default environment: the engine's `process.env` as `NAME=value`, unless that is still `environ`. */
+    void inheritEnvironment(SpawnOptions& options) {
+        qianjs::RuntimeContext* runtime = engine_.host<qianjs::RuntimeContext>();
+        if (!runtime || runtime->env.inherited())
+            return;
+        const auto& entries = runtime->env.entries();
+        options.replace_env = true;
+        options.env.reserve(entries.size());
+        for (const auto& [name, value] : entries)
+            options.env.push_back(name + "=" + value);
+    }
+
+    bool hasLimiter(int64_t id) const { return limiters_.count(id) != 0; }
+
+    int64_t createLimiter(int max) {
+        const int64_t id = next_id_++;
+        limiters_[id].max = max;
+        return id;
+    }
+
+    int64_t spawn(Child&& child) {
+        const int64_t id = next_id_++;
+        Child& ch = children_.emplace(id, std::move(child)).first->second;
+        ch.op = loop_.begin_operation(qianjs::event_loop::OpKind::Spawn);
+        if (ch.limiter) {
+            limiters_.at(ch.limiter).queue.push_back(id);
+            pump(ch.limiter);
+        } else {
+            start(id);
+        }
+        return id;
+    }
+
+    /** Result promise of an `exec`; the child settles it from `complete`. */
+    JSValue exec(JSContext* c, Child&& child) {
+        child.exec = engine_.createPromise();
+        const JSValue promise = qjs::JSConv<qjs::RawJSValue>::to(c, engine_.promiseValue(child.exec));
+        if (child.exec.ptr)
+            spawn(std::move(child));
+        return promise;
+    }
+
+    /** Exit of a `spawn` child; one already reported is settled at once and forgotten. */
+    JSValue wait(JSContext* c, int64_t id) {
+        auto it = children_.find(id);
+        auto fit = finished_.find(id);
+        if ((it == children_.end() || it->second.collect) && fit == finished_.end())
+            return JS_ThrowTypeError(c, "wait: unknown child %lld", static_cast<long long>(id));
+
+        qjs::JSEngine::PromiseHandle ph = engine_.createPromise();
+        const JSValue promise = qjs::JSConv<qjs::RawJSValue>::to(c, engine_.promiseValue(ph));
+        if (!ph.ptr)
+            return promise;
+        if (it != children_.end()) {
+            it->second.waiters.push_back(ph);
+            return promise;
+        }
+        settle_wait(ph, fit->second);
+        finished_.erase(fit);
+        return promise;
+    }
+
+    JSValue write(JSContext* c, int64_t id, JSValue data) {
+        Child* ch = find(id);
+        if (!ch || ch->collect)
+            return JS_ThrowTypeError(c, "write: unknown child %lld", static_cast<long long>(id));
+        if (ch->options.stdio[0] != StdioMode::Pipe)
+            return JS_ThrowTypeError(c, "write: stdin is not a pipe (spawn with stdin: 'pipe')");
+        std::string bytes;
+        if (!copy_js_bytes(c, data, bytes))
+            return JS_ThrowTypeError(c, "write: data must be string, ArrayBuffer, or TypedArray");
+
+        qjs::JSEngine::PromiseHandle ph = engine_.createPromise();
+        const JSValue promise = qjs::JSConv<qjs::RawJSValue>::to(c, engine_.promiseValue(ph));
+        if (!ph.ptr)
+            return promise;
+        if (!ch->started)
+            ch->early_writes.push_back(EarlyWrite{std::move(bytes), ph});
+        else
+            write_stdin(*ch, bytes, ph);
+        return promise;
+    }
+
+    void closeStdin(int64_t id) {
+        Child* ch = find(id);
+        if (!ch)
+            return;
+        if (ch->proc)
+            ch->proc->closeStdin();
+        else
+            ch->early_close = true;
+    }
+
+    /** False for unknown or already exited children; a child still queued is cancelled (`wait` rejects). */
+    bool kill(int64_t id, int signum) {
+        Child* ch = find(id);
+        if (!ch)
+            return false;
+        if (ch->proc)
+            return ch->proc->kill(signum) == 0;
+        if (ch->started)
+            return false;
+        std::deque<int64_t>& queue = limiters_.at(ch->limiter).queue;
+        for (auto it = queue.begin(); it != queue.end(); ++it) {
+            if (*it == id) {
+                queue.erase(it);
+                break;
+            }
+        }
+        complete(id, 0, 0, UV_ECANCELED);
+        return true;
+    }
+
+    int pid(int64_t id) {
+        Child* ch = find(id);
+        return ch && ch->proc ? ch->proc->pid() : 0;
+    }
+
+    void onOutput(Subprocess& proc, int fd, const char* data, size_t len) override {
+        Child* ch = find(proc.id());
+        if (!ch)
+            return;
+        if (ch->collect) {
+            if (ch->overflowed)
+                return;
+            if (ch->output[1].size() + ch->output[2].size() + len > ch->max_buffer) {
+                ch->overflowed = true;
+                proc.kill(SIGKILL);
+                return;
+            }
+            ch->output[fd].append(data, len);
+            return;
+        }
+        if (!JS_IsFunction(engine_.ctx(), ch->on_output[fd]))
+            return;
+        ch->pending[fd].append(data, len);
+        if (ch->pending[1].size() + ch->pending[2].size() >= kMaxBatchBytes) {
+            flush_output(proc.id());
+            return;
+        }
+        if (ch->flush_scheduled)
+            return;
+        ch->flush_scheduled = true;
+        std::shared_ptr<bool> alive = alive_;
+        const int64_t id = proc.id();
+        loop_.defer([this, alive, id](qjs::JSEngine&) {
+            if (*alive)
+                flush_output(id);
+        });
+    }
+
+    void onExit(Subprocess& proc, int64_t exit_status, int signal) override {
+        const int64_t id = proc.id();
+        flush_output(id);
+        if (Child* ch = find(id)) {
+            ch->proc = nullptr;
+            complete(id, exit_status, signal, 0);
+        }
+    }
+
+private:
+    Child* find(int64_t id) {
+        auto it = children_.find(id);
+        return it == children_.end() ? nullptr : &it->second;
+    }
+
+    void pump(int64_t limiter_id) {
+        Limiter& l = limiters_.at(limiter_id);
+        while (l.running < l.max && !l.queue.empty()) {
+            const int64_t id = l.queue.front();
+            l.queue.pop_front();
+            start(id);
+        }
+    }
+
+    void start(int64_t id) {
+        Child& ch = children_.at(id);
+        int err = 0;
+        Subprocess* proc = Subprocess::spawn(loop_.uv_loop(), ch.options, this, id, &err);
+        if (!proc) {
+            complete(id, 0, 0, err);
+            return;
+        }
+        ch.proc = proc;
+        ch.started = true;
+        if (ch.limiter)
+            limiters_.at(ch.limiter).running++;
+
+        if (ch.has_input) {
+            proc->write(ch.input.data(), ch.input.size(), [](int) {});
+            ch.input.clear();
+            proc->closeStdin();
+            return;
+        }
+        std::vector<EarlyWrite> early = std::move(ch.early_writes);
+        ch.early_writes.clear();
+        for (EarlyWrite& w : early)
+            write_stdin(ch, w.data, w.ph);
+        if (ch.early_close)
+            proc->closeStdin();
+    }
+
+    void write_stdin(Child& ch, const std::string& bytes, qjs::JSEngine::PromiseHandle ph) {
+        const int64_t token = next_id_++;
+        writes_[token] = ph;
+        std::shared_ptr<bool> alive = alive_;
+        ch.proc->write(bytes.data(), bytes.size(), [this, alive, token, ph](int status) {
+            if (!*alive)
+                return;
+            writes_.erase(token);
+            if (status < 0)
+                engine_.rejectPromise(ph, "write: " + uv_message(status), uv_err_name(status));
+            else
+                engine_.resolvePromiseVoid(ph);
+            engine_.freePromise(ph);
+        });
+    }
+
+    /** Hands each stream's batched output to its callback (stdout first). */
+    void flush_output(int64_t id) {
+        JSContext* c = engine_.ctx();
+        for (int fd = 1; fd <= 2; fd++) {
+            Child* ch = find(id);
+            if (!ch)
+                return;
+            ch->flush_scheduled = false;
+            if (ch->pending[fd].empty())
+                continue;
+            JSValue chunk = take_buffer(c, std::move(ch->pending[fd]));
+            ch->pending[fd].clear();
+            JSValue fn = JS_DupValue(c, ch->on_output[fd]);
+            const qianjs::profiler::TaskFrame task("child_process");
+            JSValue ret = JS_Call(c, fn, JS_UNDEFINED, 1, &chunk);
+            JS_FreeValue(c, fn);
+            JS_FreeValue(c, chunk);
+            if (JS_IsException(ret))
+                print_exception(c, "child_process output callback");
+            else
+                JS_FreeValue(c, ret);
+        }
+    }
+
+    static void print_exception(JSContext* c, const char* what) {
+        JSValue exc = JS_GetException(c);
+        const char* msg = JS_ToCString(c, exc);
+        if (msg) {
+            qianjs::output::report(std::string(what) + " exception: " + msg + "\n");
+            JS_FreeCString(c, msg);
+        } else {
+            qianjs::output::report(std::string(what) + " exception\n");
+        }
+        JS_FreeValue(c, exc);
+    }
+
+    JSValue exit_object(JSContext* c, int64_t exit_status, int signal) {
+        JSValue o = JS_NewObject(c);
+        JS_SetPropertyStr(c, o, "code", signal ? JS_NULL : JS_NewInt64(c, exit_status));
+        if (signal) {
+            const std::string name = signal_name(signal);
+            JS_SetPropertyStr(c, o, "signal", JS_NewStringLen(c, name.data(), name.size()));
+        } else {
+            JS_SetPropertyStr(c, o, "signal", JS_NULL);
+        }
+        return o;
+    }
+
+    void settle_wait(qjs::JSEngine::PromiseHandle ph, const Finished& f) {
+        if (f.error)
+            engine_.rejectPromise(ph, "spawn: " + uv_message(f.error), uv_err_name(f.error));
+        else
+            engine_.resolvePromiseJSValue(ph, exit_object(engine_.ctx(), f.exit_status, f.signal));
+        engine_.freePromise(ph);
+    }
+
+    /** Settles everything waiting on the child, frees its slot and ends its operation. */
+    void complete(int64_t id, int64_t exit_status, int signal, int error) {
+        auto it = children_.find(id);
+        Child ch = std::move(it->second);
+        children_.erase(it);
+        JSContext* c = engine_.ctx();
+
+        if (ch.collect) {
+            if (ch.overflowed) {
+                engine_.rejectPromise(ch.exec, "exec: output exceeded maxBuffer", "ENOBUFS");
+            } else if (error) {
+                engine_.rejectPromise(ch.exec, "exec: " + uv_message(error), uv_err_name(error));
+            } else {
+                JSValue o = exit_object(c, exit_status, signal);
+                JS_SetPropertyStr(c, o, "stdout", take_buffer(c, std::move(ch.output[1])));
+                JS_SetPropertyStr(c, o, "stderr", take_buffer(c, std::move(ch.output[2])));
+                engine_.resolvePromiseJSValue(ch.exec, o);
+            }
+            engine_.freePromise(ch.exec);
+        } else {
+            const Finished f{exit_status, signal, error};
+            if (ch.waiters.empty())
+                finished_[id] = f;
+            for (qjs::JSEngine::PromiseHandle ph : ch.waiters)
+                settle_wait(ph, f);
+        }
+        for (EarlyWrite& w : ch.early_writes) {
+            const int status = error ? error : UV_EPIPE;
+            engine_.rejectPromise(w.ph, "write: " + uv_message(status), uv_err_name(status));
+            engine_.freePromise(w.ph);
+        }
+        for (JSValue& fn : ch.on_output)
+            JS_FreeValue(c, fn);
+
+        loop_.end_operation(ch.op);
+        if (ch.started && ch.limiter) {
+            limiters_.at(ch.limiter).running--;
+            pump(ch.limiter);
+        }
+    }
+
+    qjs::JSEngine& engine_;
+    JSRuntime* rt_;
+    qianjs::event_loop::EventLoop& loop_;
+    std::shared_ptr<bool> alive_;
+    std::unordered_map<int64_t, Child> children_;
+    /** Stdin writes handed to a running child, settled by their callback or freed with the state. */
+    std::unordered_map<int64_t, qjs::JSEngine::PromiseHandle> writes_;
+    std::unordered_map<int64_t, Finished> finished_;
+    std::unordered_map<int64_t, Limiter> limiters_;
+    int64_t next_id_ = 1;
+};
+
+/**
+ * `(file, args?, opts?)` into `out`: argv, `cwd`, `env`, stdio modes and `limiter`; for `spawn` also the output
+ * callbacks, for `exec` `input` and `maxBuffer`. False with an exception set.
+ */
+bool parse_spawn_args(JSContext* c, int argc, JSValue* argv, ChildState& state, Child& out, bool exec,
+                      const char* fn) {
+    if (!c_string_arg(c, argv[0], out.options.file, fn, "file"))
+        return false;
+    if (out.options.file.empty()) {
+        JS_ThrowTypeError(c, "%s: file must not be empty", fn);
+        return false;
+    }
+
+    const JSValue args = argc > 1 ? argv[1] : JS_UNDEFINED;
+    if (!JS_IsUndefined(args) && !JS_IsNull(args)) {
+        if (JS_IsArray(c, args) <= 0) {
+            JS_ThrowTypeError(c, "%s: args must be an array of strings", fn);
+            return false;
+        }
+        JSValue len_v = JS_GetPropertyStr(c, args, "length");
+        uint32_t n = 0;
+        const int lr = JS_ToUint32(c, &n, len_v);
+        JS_FreeValue(c, len_v);
+        if (lr < 0)
+            return false;
+        out.options.args.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            JSValue item = JS_GetPropertyUint32(c, args, i);
+            const bool ok = c_string_arg(c, item, out.options.args[i], fn, "args");
+            JS_FreeValue(c, item);
+            if (!ok)
+                return false;
+        }
+    }
+
+    StdioMode* stdio = out.options.stdio;
+    stdio[0] = StdioMode::Ignore;
+    stdio[1] = exec ? StdioMode::Pipe : StdioMode::Inherit;
+    stdio[2] = exec ? StdioMode::Pipe : StdioMode::Inherit;
+    const JSValue opts = argc > 2 ? argv[2] : JS_UNDEFINED;
+    if (JS_IsUndefined(opts)) {
+        state.inheritEnvironment(out.options);
+        return true;
+    }
+    if (!JS_IsObject(opts)) {
+        JS_ThrowTypeError(c, "%s: options must be an object", fn);
+        return false;
+    }
+
+    JSValue cwd = JS_GetPropertyStr(c, opts, "cwd");
+    if (JS_IsException(cwd))
+        return false;
+    if (!JS_IsUndefined(cwd)) {
+        const bool ok = c_string_arg(c, cwd, out.options.cwd, fn, "cwd");
+        JS_FreeValue(c, cwd);
+        if (!ok)
+            return false;
+    }
+
+    JSValue env = JS_GetPropertyStr(c, opts, "env");
+    if (JS_IsException(env))
+        return false;
+    if (!JS_IsUndefined(env)) {
+        if (!JS_IsObject(env)) {
+            JS_FreeValue(c, env);
+            JS_ThrowTypeError(c, "%s: env must be an object", fn);
+            return false;
+        }
+        JSPropertyEnum* props = nullptr;
+        uint32_t count = 0;
+        if (JS_GetOwnPropertyNames(c, &props, &count, env, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+            JS_FreeValue(c, env);
+            return false;
+        }
+        out.options.replace_env = true;
+        bool ok = true;
+        for (uint32_t i = 0; i < count; i++) {
+            if (ok) {
+                const char* name = JS_AtomToCString(c, props[i].atom);
+                JSValue v = JS_GetProperty(c, env, props[i].atom);
+                std::string value;
+                ok = name && !JS_IsException(v) && c_string_arg(c, v, value, fn, "env");
+                if (ok)
+                    out.options.env.push_back(std::string(name) + "=" + value);
+                if (name)
+                    JS_FreeCString(c, name);
+                JS_FreeValue(c, v);
+            }
+            JS_FreeAtom(c, props[i].atom);
+        }
+        js_free(c, props);
+        JS_FreeValue(c, env);
+        if (!ok)
+            return false;
+    } else {
+        state.inheritEnvironment(out.options);
+    }
+
+    if (!stdio_option(c, opts, "stdin", stdio[0], fn))
+        return false;
+
+    JSValue limiter = JS_GetPropertyStr(c, opts, "limiter");
+    if (JS_IsException(limiter))
+        return false;
+    if (!JS_IsUndefined(limiter)) {
+        const int r = JS_ToInt64(c, &out.limiter, limiter);
+        JS_FreeValue(c, limiter);
+        if (r < 0)
+            return false;
+        if (!state.hasLimiter(out.limiter)) {
+            JS_ThrowTypeError(c, "%s: unknown limiter %lld", fn, static_cast<long long>(out.limiter));
+            return false;
+        }
+    }
+
+    if (exec) {
+        JSValue input = JS_GetPropertyStr(c, opts, "input");
+        if (JS_IsException(input))
+            return false;
+        if (!JS_IsUndefined(input)) {
+            const bool ok = copy_js_bytes(c, input, out.input);
+            JS_FreeValue(c, input);
+            if (!ok) {
+                JS_ThrowTypeError(c, "%s: input must be string, ArrayBuffer, or TypedArray", fn);
+                return false;
+            }
+            out.has_input = true;
+            stdio[0] = StdioMode::Pipe;
+        }
+        JSValue max = JS_GetPropertyStr(c, opts, "maxBuffer");
+        if (JS_IsException(max))
+            return false;
+        if (!JS_IsUndefined(max)) {
+            int64_t n = 0;
+            const int r = JS_ToInt64(c, &n, max);
+            JS_FreeValue(c, max);
+            if (r < 0)
+                return false;
+            if (n < 0) {
+                JS_ThrowRangeError(c, "%s: maxBuffer must not be negative", fn);
+                return false;
+            }
+            out.max_buffer = static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    const char* callbacks[3] = {nullptr, "onStdout", "onStderr"};
+    const char* modes[3] = {nullptr, "stdout", "stderr"};
+    for (int fd = 1; fd <= 2; fd++) {
+        JSValue cb = JS_GetPropertyStr(c, opts, callbacks[fd]);
+        if (JS_IsException(cb))
+            return false;
+        if (!JS_IsUndefined(cb)) {
+            if (!JS_IsFunction(c, cb)) {
+                JS_FreeValue(c, cb);
+                JS_ThrowTypeError(c, "%s: %s must be a function", fn, callbacks[fd]);
+                return false;
+            }
+            out.on_output[fd] = cb;
+            stdio[fd] = StdioMode::Pipe;
+        }
+        if (!stdio_option(c, opts, modes[fd], stdio[fd], fn))
+            return false;
+    }
+    return true;
+}
+
+void free_callbacks(JSContext* c, Child& child) {
+    for (JSValue& fn : child.on_output) {
+        JS_FreeValue(c, fn);
+        fn = JS_UNDEFINED;
+    }
+}
+
+} // namespace
+
+const char* ChildProcessPlugin::name() const {
+    return "child_process";
+}
+
+void ChildProcessPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
+    qianjs::event_loop::EventLoop::of(engine).ensure_started();
+#ifdef SIGPIPE
+    // A child closing its stdin must fail the write with EPIPE, not kill the host.
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    auto state = std::make_shared<ChildState>(engine);
+    auto& m = root.module("child_process");
+
+    m.funcDynamic("spawn", 1, 3, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("child_process");
+        Child child;
+        if (!parse_spawn_args(c, argc, argv, *state, child, false, "spawn")) {
+            free_callbacks(c, child);
+            return JS_EXCEPTION;
+        }
+        return JS_NewInt64(c, state->spawn(std::move(child)));
+    });
+
+    m.funcDynamic("exec", 1, 3, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("child_process");
+        Child child;
+        child.collect = true;
+        if (!parse_spawn_args(c, argc, argv, *state, child, true, "exec"))
+            return JS_EXCEPTION;
+        return state->exec(c, std::move(child));
+    });
+
+    m.funcDynamic("wait", 1, 1, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        return state->wait(c, id);
+    });
+
+    m.funcDynamic("write", 2, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("child_process");
+        (void)argc;
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        return state->write(c, id, argv[1]);
+    });
+
+    m.func("closeStdin", [state](int64_t id) { state->closeStdin(id); });
+    m.func("pid", [state](int64_t id) { return state->pid(id); });
+
+    m.funcDynamic("kill", 1, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        int signum = 0;
+        if (!parse_signal(c, argc > 1 ? argv[1] : JS_UNDEFINED, signum))
+            return JS_EXCEPTION;
+        return JS_NewBool(c, state->kill(id, signum));
+    });
+
+    m.funcDynamic("createLimiter", 0, 1, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        int32_t max = static_cast<int32_t>(std::thread::hardware_concurrency());
+        if (argc > 0 && !JS_IsUndefined(argv[0]) && JS_ToInt32(c, &max, argv[0]) < 0)
+            return JS_EXCEPTION;
+        if (max < 1) {
+            if (argc > 0 && !JS_IsUndefined(argv[0]))
+                return JS_ThrowRangeError(c, "createLimiter: max must be at least 1");
+            max = 1;
+        }
+        return JS_NewInt64(c, state->createLimiter(max));
+    });
+}
@@ -0,0 +1,222 @@
+#include "native/child_process/subprocess.h"
+
+#include <utility>
+
+namespace qianjs::child_process {
+
+Subprocess* Subprocess::spawn(uv_loop_t* loop, const SpawnOptions& options, SubprocessListener* listener, int64_t id,
+                              int* err) {
+    auto* self = new Subprocess(listener, id);
+
+    uv_stdio_container_t stdio[3];
+    for (int i = 0; i < 3; i++) {
+        switch (options.stdio[i]) {
+        case StdioMode::Ignore:
+            stdio[i].flags = UV_IGNORE;
+            break;
+        case StdioMode::Inherit:
+            stdio[i].flags = UV_INHERIT_FD;
+            stdio[i].data.fd = i;
+            break;
+        case StdioMode::Pipe: {
+            Pipe& p = self->pipes_[i];
+            uv_pipe_init(loop, &p.handle, 0);
+            p.handle.data = &p;
+            p.owner = self;
+            p.fd = i;
+            p.open = true;
+            self->open_handles_++;
+            // Flags are from the child's point of view: it reads stdin and writes stdout / stderr.
+            stdio[i].flags =
+                static_cast<uv_stdio_flags>(UV_CREATE_PIPE | (i == 0 ? UV_READABLE_PIPE : UV_WRITABLE_PIPE));
+            stdio[i].data.stream = reinterpret_cast<uv_stream_t*>(&p.handle);
+            break;
+        }
+        }
+    }
+
+    // libuv copies argv and env before `uv_spawn` returns; the strings are only borrowed.
+    std::vector<char*> argv;
+    argv.reserve(options.args.size() + 2);
+    argv.push_back(const_cast<char*>(options.file.c_str()));
+    for (const std::string& a : options.args)
+        argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    std::vector<char*> envp;
+    if (options.replace_env) {
+        envp.reserve(options.env.size() + 1);
+        for (const std::string& e : options.env)
+            envp.push_back(const_cast<char*>(e.c_str()));
+        envp.push_back(nullptr);
+    }
+
+    uv_process_options_t po{};
+    po.exit_cb = [](uv_process_t* h, int64_t exit_status, int term_signal) {
+        auto* s = static_cast<Subprocess*>(h->data);
+        s->exited_ = true;
+        s->exit_status_ = exit_status;
+        s->term_signal_ = term_signal;
+        s->maybe_finish();
+    };
+    po.file = options.file.c_str();
+    po.args = argv.data();
+    po.env = options.replace_env ? envp.data() : nullptr;
+    po.cwd = options.cwd.empty() ? nullptr : options.cwd.c_str();
+    po.flags = UV_PROCESS_WINDOWS_HIDE;
+    po.stdio_count = 3;
+    po.stdio = stdio;
+
+    self->process_.data = self;
+    self->open_handles_++;
+    const int r = uv_spawn(loop, &self->process_, &po);
+    if (r < 0) {
+        // The handle is initialized even when the spawn fails and must be closed like any other.
+        *err = r;
+        self->listener_ = nullptr;
+        self->finished_ = true;
+        self->close_all();
+        return nullptr;
+    }
+
+    for (int i = 1; i < 3; i++) {
+        if (!self->pipes_[i].open)
+            continue;
+        uv_read_start(
+            reinterpret_cast<uv_stream_t*>(&self->pipes_[i].handle),
+            [](uv_handle_t* h, size_t, uv_buf_t* buf) {
+                Subprocess* s = static_cast<Pipe*>(h->data)->owner;
+                *buf = uv_buf_init(s->read_buf_, sizeof(s->read_buf_));
+            },
+            [](uv_stream_t* stream, ssize_t n, const uv_buf_t*) {
+                auto* pipe = static_cast<Pipe*>(stream->data);
+                Subprocess* s = pipe->owner;
+                if (n > 0) {
+                    if (s->listener_)
+                        s->listener_->onOutput(*s, pipe->fd, s->read_buf_, static_cast<size_t>(n));
+                } else if (n < 0) {
+                    s->on_pipe_end(*pipe);
+                }
+            });
+    }
+    return self;
+}
+
+void Subprocess::write(const char* data, size_t len, WriteDone done) {
+    if (!pipes_[0].open || stdin_closing_) {
+        done(UV_ENOTCONN);
+        return;
+    }
+    stdin_queue_.push_back(PendingWrite{std::string(data, len), std::move(done)});
+    if (!stdin_writing_)
+        flush_stdin();
+}
+
+void Subprocess::flush_stdin() {
+    const uv_write_cb on_written = [](uv_write_t* req, int status) {
+        auto* s = static_cast<Subprocess*>(req->data);
+        s->stdin_writing_ = false;
+        WriteDone done = std::move(s->stdin_queue_.front().done);
+        s->stdin_queue_.pop_front();
+        done(status);
+        s->flush_stdin();
+    };
+
+    auto* stream = reinterpret_cast<uv_stream_t*>(&pipes_[0].handle);
+    while (!stdin_queue_.empty() && !stdin_writing_ && pipes_[0].open) {
+        PendingWrite& w = stdin_queue_.front();
+        uv_buf_t buf = uv_buf_init(w.data.data(), static_cast<unsigned>(w.data.size()));
+        int status = uv_try_write(stream, &buf, 1);
+        if (status == UV_EAGAIN)
+            status = 0;
+        if (status >= 0 && static_cast<size_t>(status) < w.data.size()) {
+            // Only the part the pipe did not take is handed to `uv_write`.
+            w.data.erase(0, static_cast<size_t>(status));
+            buf = uv_buf_init(w.data.data(), static_cast<unsigned>(w.data.size()));
+            write_req_.data = this;
+            status = uv_write(&write_req_, stream, &buf, 1, on_written);
+            if (status == 0) {
+                stdin_writing_ = true;
+                return;
+            }
+        } else if (status > 0) {
+            status = 0;
+        }
+        WriteDone done = std::move(w.done);
+        stdin_queue_.pop_front();
+        done(status);
+    }
+    // Closed under a queued write (the child exited, or `detach`): the in-flight one was cancelled, fail the rest.
+    while (!pipes_[0].open && !stdin_writing_ && !stdin_queue_.empty()) {
+        WriteDone done = std::move(stdin_queue_.front().done);
+        stdin_queue_.pop_front();
+        done(UV_EPIPE);
+    }
+
+    if (stdin_closing_ && stdin_queue_.empty() && !stdin_writing_ && pipes_[0].open) {
+        shutdown_req_.data = this;
+        const int r = uv_shutdown(&shutdown_req_, stream, [](uv_shutdown_t* req, int) {
+            auto* s = static_cast<Subprocess*>(req->data);
+            s->close_pipe(s->pipes_[0]);
+        });
+        if (r < 0)
+            close_pipe(pipes_[0]);
+    }
+}
+
+void Subprocess::closeStdin() {
+    if (stdin_closing_ || !pipes_[0].open)
+        return;
+    stdin_closing_ = true;
+    if (!stdin_writing_)
+        flush_stdin();
+}
+
+int Subprocess::kill(int signum) {
+    if (exited_)
+        return UV_ESRCH;
+    return uv_process_kill(&process_, signum);
+}
+
+void Subprocess::detach() {
+    listener_ = nullptr;
+    finished_ = true;
+    close_all();
+}
+
+void Subprocess::on_pipe_end(Pipe& pipe) {
+    uv_read_stop(reinterpret_cast<uv_stream_t*>(&pipe.handle));
+    close_pipe(pipe);
+    maybe_finish();
+}
+
+void Subprocess::maybe_finish() {
+    if (finished_ || !exited_ || pipes_[1].open || pipes_[2].open)
+        return;
+    finished_ = true;
+    if (listener_)
+        listener_->onExit(*this, exit_status_, term_signal_);
+    close_all();
+}
+
+void Subprocess::close_all() {
+    for (Pipe& p : pipes_)
+        close_pipe(p);
+    auto* h = reinterpret_cast<uv_handle_t*>(&process_);
+    if (!uv_is_closing(h))
+        uv_close(h, [](uv_handle_t* handle) { static_cast<Subprocess*>(handle->data)->handle_closed(); });
+}
+
+void Subprocess::close_pipe(Pipe& pipe) {
+    if (!pipe.open)
+        return;
+    pipe.open = false;
+    uv_close(reinterpret_cast<uv_handle_t*>(&pipe.handle),
+             [](uv_handle_t* h) { static_cast<Pipe*>(h->data)->owner->handle_closed(); });
+}
+
+void Subprocess::handle_closed() {
+    if (--open_handles_ == 0)
+        delete this;
+}
+
+} // namespace qianjs::child_process
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <uv.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace qianjs::child_process {
+
+class Subprocess;
+
+enum class StdioMode { Ignore, Inherit, Pipe };
+
+struct SpawnOptions {
+    std::string file;
+    /** argv[1..]; argv[0] is `file`. */
+    std::vector<std::string> args;
+    /** Empty: the parent's working directory. */
+    std::string cwd;
+    /** `NAME=value` entries replacing the environment when `replace_env` is set. */
+    bool replace_env = false;
+    std::vector<std::string> env;
+    StdioMode stdio[3] = {StdioMode::Ignore, StdioMode::Inherit, StdioMode::Inherit};
+};
+
+/** What a `Subprocess` reports to its owner; every call is on the loop (JS) thread. */
+class SubprocessListener {
+public:
+    virtual ~SubprocessListener() = default;
+
+    /** `len` bytes from the child's stdout (`fd == 1`) or stderr (`fd == 2`), valid only during the call. */
+    virtual void onOutput(Subprocess& proc, int fd, const char* data, size_t len) = 0;
+    /**
+     * The child exited and every output pipe reached EOF, so no `onOutput` follows. `signal` is 0 unless the child
+     * was killed by one. The subprocess closes its handles and deletes itself right after this returns.
+     */
+    virtual void onExit(Subprocess& proc, int64_t exit_status, int signal) = 0;
+};
+
+/**
+ * One child on a raw `uv_process_t` with raw `uv_pipe_t` stdio (like `console_sink`): each of stdin, stdout and stderr
+ * is independently ignored, inherited or piped, which `uvw::process_handle::stdio` cannot express (it orders inherited
+ * descriptors before piped streams). Stdin writes go through `uv_try_write` first and queue only the remainder.
+ *
+ * Heap-allocated and self-deleting after `onExit`. Owners that go away first call `detach()`: the handles close
+ * and the child itself keeps running, as when the parent exits.
+ */
+class Subprocess {
+public:
+    /** Started child, or nullptr with `*err` set to the `uv_spawn` error (ENOENT, EACCES, ...). */
+    static Subprocess* spawn(uv_loop_t* loop, const SpawnOptions& options, SubprocessListener* listener, int64_t id,
+                             int* err);
+
+    Subprocess(const Subprocess&) = delete;
+    Subprocess& operator=(const Subprocess&) = delete;
+
+    int64_t id() const { return id_; }
+    int pid() const { return process_.pid; }
+
+    using WriteDone = std::function<void(int status)>;
+    /**
+     * Copies `data` to the child's stdin and calls `done` (on the loop thread, possibly before returning) once the
+     * kernel took it; `status` is 0 or a uv error (EPIPE when the child closed its stdin). UV_ENOTCONN without a stdin
+     * pipe or after `closeStdin`.
+     */
+    void write(const char* data, size_t len, WriteDone done);
+    /** Closes stdin after queued writes, so the child sees EOF. Idempotent. */
+    void closeStdin();
+
+    /** 0 or a uv error (ESRCH once the child is gone). */
+    int kill(int signum);
+
+    /** Stops reporting, closes the handles and deletes itself once they are closed; the child is not killed. */
+    void detach();
+
+private:
+    struct Pipe {
+        uv_pipe_t handle{};
+        Subprocess* owner = nullptr;
+        int fd = 0;
+        bool open = false;
+    };
+    struct PendingWrite {
+        std::string data;
+        WriteDone done;
+    };
+
+    Subprocess(SubprocessListener* listener, int64_t id) : listener_(listener), id_(id) {}
+
+    void flush_stdin();
+    void on_pipe_end(Pipe& pipe);
+    void maybe_finish();
+    void close_all();
+    void close_pipe(Pipe& pipe);
+    void handle_closed();
+
+    SubprocessListener* listener_;
+    int64_t id_;
+    uv_process_t process_{};
+    Pipe pipes_[3];
+    /** Handles still open, counting the process; the object is deleted when this reaches 0. */
+    int open_handles_ = 0;
+    bool exited_ = false;
+    int64_t exit_status_ = 0;
+    int term_signal_ = 0;
+    bool finished_ = false;
+
+    std::deque<PendingWrite> stdin_queue_;
+    bool stdin_writing_ = false;
+    bool stdin_closing_ = false;
+    uv_write_t write_req_{};
+    uv_shutdown_t shutdown_req_{};
+    /** One read buffer per subprocess; stdout and stderr reads never overlap on the loop thread. */
+    char read_buf_[64 * 1024];
+};
+
+} // namespace qianjs::child_process
@@ -1,32 +1,184 @@
 #include "native/console/console_module.h"
 
+#include "native/console/console_sink.h"
+
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/profiler/sampling_profiler.h"
+#include "runtime/runtime_context.h"
+
+#include <js_engine.h>
 #include <js_module.h>
 #include <quickjs.h>
 
-#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <memory>
 #include <string>
 
 namespace {
 
-/** Pretty line: `ToString` each argument, space-separated, newline. */
-JSValue write_line(std::ostream& os, JSContext* c, int argc, JSValue* argv) {
-    std::string out;
-    out.reserve(static_cast<size_t>(argc) * 8u);
+using qianjs::LogFormat;
+using qianjs::LogLevel;
+using qianjs::RuntimeContext;
+using qianjs::console::ConsoleSink;
+
+void append_json_escaped(std::string& out, const char* p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        const unsigned char ch = static_cast<unsigned char>(p[i]);
+        switch (ch) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (ch < 0x20) {
+                char esc[8];
+                std::snprintf(esc, sizeof(esc), "\\u%04x", ch);
+                out += esc;
+            } else {
+                out.push_back(static_cast<char>(ch));
+            }
+        }
+    }
+}
+
+/** Appends the string `str` (consumed) raw or JSON-escaped; false with a pending exception. */
+bool append_js_string(std::string& out, JSContext* c, JSValue str, bool escape) {
+    size_t len = 0;
+    const char* p = JS_ToCStringLen(c, &len, str);
+    JS_FreeValue(c, str);
+    if (!p)
+        return false;
+    if (escape)
+        append_json_escaped(out, p, len);
+    else
+        out.append(p, len);
+    JS_FreeCString(c, p);
+    return true;
+}
+
+/** `ToString` of `v` appended to `out`; false with a pending exception. */
+bool append_string(std::string& out, JSContext* c, JSValueConst v, bool escape = false) {
+    JSValue str = JS_ToString(c, v);
+    if (JS_IsException(str))
+        return false;
+    return append_js_string(out, c, str, escape);
+}
+
+/** Formats into `out`; false with a pending exception. */
+bool format_line(std::string& out, JSContext* c, int argc, JSValue* argv) {
     for (int i = 0; i < argc; i++) {
         if (i > 0)
             out.push_back(' ');
-        JSValue str = JS_ToString(c, argv[i]);
-        if (JS_IsException(str))
-            return JS_EXCEPTION;
-        size_t len = 0;
-        const char* p = JS_ToCStringLen(c, &len, str);
-        JS_FreeValue(c, str);
-        if (!p)
-            return JS_EXCEPTION;
-        out.append(p, len);
-        JS_FreeCString(c, p);
+        if (!append_string(out, c, argv[i]))
+            return false;
+    }
+    out.push_back('\n');
+    return true;
+}
+
+/** Serialized into `data` rather than joined into `msg`; errors stringify to `{}`, so they stay in `msg`. */
+bool is_json_data(JSContext* c, JSValueConst v) {
+    return JS_IsObject(v) && !JS_IsFunction(c, v) && !JS_IsError(c, v);
+}
+
+/**
+ * NDJSON record `{"time":<epoch ms>,"level":"…","msg":"…","data":[…]}`. Strings, primitives and errors are joined into
+ * `msg` as in text mode; other objects go through `JSON.stringify` into `data` (omitted when empty), in argument
+ * order. An object without a JSON form (a cycle, a throwing `toJSON`) is recorded as its `ToString` string instead.
+ */
+bool format_json(std::string& out, JSContext* c, LogLevel level, int argc, JSValue* argv) {
+    using namespace std::chrono;
+    const long long now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    out += "{\"time\":";
+    out += std::to_string(now);
+    out += ",\"level\":\"";
+    out += qianjs::logLevelName(level);
+    out += "\",\"msg\":\"";
+
+    bool first = true;
+    int objects = 0;
+    for (int i = 0; i < argc; i++) {
+        if (is_json_data(c, argv[i])) {
+            objects++;
+            continue;
+        }
+        if (!first)
+            out.push_back(' ');
+        first = false;
+        if (!append_string(out, c, argv[i], true))
+            return false;
     }
-    os << out << '\n';
+    out.push_back('"');
+
+    if (objects > 0) {
+        out += ",\"data\":[";
+        first = true;
+        for (int i = 0; i < argc; i++) {
+            if (!is_json_data(c, argv[i]))
+                continue;
+            if (!first)
+                out.push_back(',');
+            first = false;
+            JSValue json = JS_JSONStringify(c, argv[i], JS_UNDEFINED, JS_UNDEFINED);
+            if (JS_IsException(json)) {
+                JS_FreeValue(c, JS_GetException(c));
+                out.push_back('"');
+                if (!append_string(out, c, argv[i], true))
+                    return false;
+                out.push_back('"');
+            } else if (!JS_IsString(json)) {
+                JS_FreeValue(c, json); // `toJSON` returned undefined
+                out += "null";
+            } else if (!append_js_string(out, c, json, false)) {
+                return false;
+            }
+        }
+        out.push_back(']');
+    }
+    out += "}\n";
+    return true;
+}
+
+/**
+ * One console call. The level check comes first, so a filtered call costs a compare and never converts its arguments
+ * (no `toString`/`toJSON` side effects). Text lines are `ToString` of each argument, space-separated; `LogFormat::Json`
+ * writes one NDJSON record. Formatting goes into a reused per-thread buffer; a `toString` that logs re-enters here and
+ * formats into its own local string instead. Either way the sink receives one append per call.
+ */
+JSValue write_line(ConsoleSink& sink, const RuntimeContext* runtime, LogLevel level, JSContext* c, int argc,
+                   JSValue* argv) {
+    if (runtime && level < runtime->log_level)
+        return JS_UNDEFINED;
+    const bool json = runtime && runtime->log_format == LogFormat::Json;
+    const qianjs::profiler::NativeFrame frame("console");
+
+    thread_local std::string scratch;
+    thread_local bool busy = false;
+
+    std::string nested;
+    std::string& line = busy ? nested : scratch;
+    const bool outer = !busy;
+    busy = true;
+    line.clear();
+    const bool ok = json ? format_json(line, c, level, argc, argv) : format_line(line, c, argc, argv);
+    if (outer)
+        busy = false;
+    if (!ok)
+        return JS_EXCEPTION;
+    sink.buffer().append(line);
+    sink.commit();
     return JS_UNDEFINED;
 }
 
@@ -36,22 +188,26 @@ const char* ConsolePlugin::name() const {
     return "console";
 }
 
-void ConsolePlugin::install(qjs::JSEngine&, qjs::JSModule& root) {
+void ConsolePlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
+    qianjs::event_loop::EventLoop& loop = qianjs::event_loop::EventLoop::of(engine);
+    const RuntimeContext* runtime = engine.host<RuntimeContext>();
+    auto out = std::make_shared<ConsoleSink>(1, loop);
+    auto err = std::make_shared<ConsoleSink>(2, loop);
     auto& c = root.module("console");
 
-    c.funcDynamic("log", 0, 32, [](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
-        return write_line(std::cout, ctx, argc, argv);
+    c.funcDynamic("log", 0, 32, [out, runtime](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
+        return write_line(*out, runtime, LogLevel::Info, ctx, argc, argv);
     });
-    c.funcDynamic("info", 0, 32, [](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
-        return write_line(std::cout, ctx, argc, argv);
+    c.funcDynamic("info", 0, 32, [out, runtime](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
+        return write_line(*out, runtime, LogLevel::Info, ctx, argc, argv);
     });
-    c.funcDynamic("debug", 0, 32, [](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
-        return write_line(std::cout, ctx, argc, argv);
+    c.funcDynamic("debug", 0, 32, [out, runtime](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
+        return write_line(*out, runtime, LogLevel::Debug, ctx, argc, argv);
     });
-    c.funcDynamic("warn", 0, 32, [](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
-        return write_line(std::cerr, ctx, argc, argv);
+    c.funcDynamic("warn", 0, 32, [err, runtime](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
+        return write_line(*err, runtime, LogLevel::Warn, ctx, argc, argv);
     });
-    c.funcDynamic("error", 0, 32, [](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
-        return write_line(std::cerr, ctx, argc, argv);
+    c.funcDynamic("error", 0, 32, [err, runtime](JSContext* ctx, int argc, JSValue* argv) -> JSValue {
+        return write_line(*err, runtime, LogLevel::Error, ctx, argc, argv);
     });
 }
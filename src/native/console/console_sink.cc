@@ -0,0 +1,61 @@
+#include "native/console/console_sink.h"
+
+#include <chrono>
+#include <utility>
+
+namespace qianjs::console {
+
+namespace {
+
+uint64_t now_ms() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+ConsoleSink::ConsoleSink(int fd, event_loop::EventLoop& loop) : fd_(fd), loop_(loop) {
+    output::addBatcher(loop_, this);
+}
+
+ConsoleSink::~ConsoleSink() {
+    output::removeBatcher(loop_, this);
+    flush();
+    output::flush(fd_);
+}
+
+void ConsoleSink::flush() {
+    if (pending_.empty())
+        return;
+    pending_since_ms_ = 0;
+    // Synchronous; only takes measurable time when the writer thread is `kMaxQueuedBytes` behind.
+    const event_loop::OpTimer op = loop_.begin_operation(event_loop::OpKind::ConsoleWrite);
+    output::write(fd_, std::move(pending_));
+    pending_.clear();
+    loop_.end_operation(op);
+}
+
+void ConsoleSink::commit() {
+    if (pending_.size() >= kFlushBytes) {
+        flush();
+        return;
+    }
+    const uint64_t now = now_ms();
+    if (pending_since_ms_ == 0) {
+        pending_since_ms_ = now;
+    } else if (now - pending_since_ms_ >= kFlushDelayMs) {
+        flush();
+        return;
+    }
+    if (!flush_scheduled_) {
+        flush_scheduled_ = true;
+        loop_.defer([weak = weak_from_this()](qjs::JSEngine&) {
+            if (auto sink = weak.lock()) {
+                sink->flush_scheduled_ = false;
+                sink->flush();
+            }
+        });
+    }
+}
+
+} // namespace qianjs::console
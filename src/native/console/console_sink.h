@@ -0,0 +1,49 @@
+#pragma once
+
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/output/std_output.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace qianjs::console {
+
+/**
+ * Batched writer for one standard stream (fd 1 or 2), bound to the engine's loop. Lines are appended to a pending
+ * buffer and handed to `output::write` in one piece per batch: once per JS turn (a deferred task on the loop), as
+ * soon as `kFlushBytes` accumulate or the oldest pending line is `kFlushDelayMs` old, and at teardown. The shared
+ * writer thread does the blocking `write`, so a slow reader does not stall the JS thread until a lot is queued.
+ */
+class ConsoleSink : public std::enable_shared_from_this<ConsoleSink>, public output::Batcher {
+public:
+    static constexpr size_t kFlushBytes = 64 * 1024;
+    static constexpr uint64_t kFlushDelayMs = 10;
+
+    ConsoleSink(int fd, event_loop::EventLoop& loop);
+
+    /** Hands over what is still pending and waits until it has been written. */
+    ~ConsoleSink();
+
+    ConsoleSink(const ConsoleSink&) = delete;
+    ConsoleSink& operator=(const ConsoleSink&) = delete;
+
+    /** Append target for one line; call `commit()` after appending (including the trailing newline). */
+    std::string& buffer() { return pending_; }
+
+    /** Schedules or triggers a flush for what `buffer()` received since the last call. */
+    void commit();
+
+    /** Hands everything pending to the writer thread. */
+    void flush() override;
+
+private:
+    int fd_;
+    event_loop::EventLoop& loop_;
+    std::string pending_;
+    uint64_t pending_since_ms_ = 0;
+    bool flush_scheduled_ = false;
+};
+
+} // namespace qianjs::console
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "runtime/plugins/lazy_plugins.h"
+
 #include <js_plugin.h>
 #include <qianjs_default_plugins.g.h>
 
@@ -8,3 +10,13 @@ inline qjs::PluginRegistry defaultPlugins() {
     qianjs_populate_default_plugins(r);
     return r;
 }
+
+/** The same plugins for `qianjs::plugins::LazyPlugins`: each installed when its module is first imported. */
+inline const qianjs::plugins::LazyRegistry& lazyDefaultPlugins() {
+    static const qianjs::plugins::LazyRegistry registry = [] {
+        qianjs::plugins::LazyRegistry r;
+        qianjs_populate_lazy_plugins(r);
+        return r;
+    }();
+    return registry;
+}
@@ -0,0 +1,352 @@
+#include "native/fs/fs_batch.h"
+
+#include "native/fs/fs_js_io.h"
+#include "native/fs/fs_stat_js.h"
+
+#include "runtime/event_loop/event_loop.h"
+
+#include <js_types.h>
+
+#include <uv.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using BatchOp = FsBatchOp;
+
+bool parse_op(const char* s, BatchOp& out) {
+    const std::string op = s;
+    if (op == "stat")
+        out = BatchOp::Stat;
+    else if (op == "lstat")
+        out = BatchOp::Lstat;
+    else if (op == "readdir")
+        out = BatchOp::Readdir;
+    else if (op == "mkdir")
+        out = BatchOp::Mkdir;
+    else if (op == "unlink")
+        out = BatchOp::Unlink;
+    else if (op == "rmdir")
+        out = BatchOp::Rmdir;
+    else
+        return false;
+    return true;
+}
+
+/** Outcome of one op; `stat` / `names` are only filled for the ops that produce them. */
+struct BatchSlot {
+    BatchOp op = BatchOp::Stat;
+    int32_t err = 0;
+    std::string path;
+    uv_stat_t st{};
+    std::vector<std::string> names;
+};
+
+struct BatchCtx;
+
+/** One in-flight request; lanes are reused, so a batch allocates `concurrency` requests rather than one per op. */
+struct BatchLane {
+    uv_fs_t req{};
+    BatchCtx* batch = nullptr;
+    size_t slot = 0;
+};
+
+struct BatchCtx {
+    qjs::JSEngine::PromiseHandle ph{};
+    std::vector<BatchSlot> slots;
+    std::unique_ptr<BatchLane[]> lanes;
+    size_t lane_count = 0;
+    size_t next = 0;
+    size_t done = 0;
+    bool null_on_error = false;
+    /** `statManyInto` target; results are packed into it instead of building an array. */
+    JSValue pack_into = JS_UNDEFINED;
+    qianjs::event_loop::OpTimer op;
+};
+
+void lane_start(BatchLane* lane);
+
+/** JS thread, `statManyInto`: pack every entry (NaN for failures) and resolve with the failure count. */
+void batch_settle_packed(qjs::JSEngine& e, BatchCtx* ctx) {
+    JSContext* c = e.ctx();
+    double* out = nullptr;
+    size_t count = 0;
+    if (!fs_js_float64_view(c, ctx->pack_into, &out, &count) || count < ctx->slots.size() * kFsStatFieldCount) {
+        e.rejectPromise(ctx->ph, "statManyInto: target was detached or shrunk");
+    } else {
+        int64_t failed = 0;
+        for (size_t i = 0; i < ctx->slots.size(); i++) {
+            const BatchSlot& s = ctx->slots[i];
+            if (s.err < 0) {
+                fs_stat_pack_missing(out + i * kFsStatFieldCount);
+                failed++;
+            } else {
+                fs_stat_pack(s.st, out + i * kFsStatFieldCount);
+            }
+        }
+        e.resolvePromiseJSValue(ctx->ph, JS_NewInt64(c, failed));
+    }
+    e.freePromise(ctx->ph);
+    JS_FreeValue(c, ctx->pack_into);
+    delete ctx;
+}
+
+/** JS thread: build the result array once for the whole batch. */
+void batch_settle(qjs::JSEngine& e, BatchCtx* ctx) {
+    if (!JS_IsUndefined(ctx->pack_into)) {
+        batch_settle_packed(e, ctx);
+        return;
+    }
+    JSContext* c = e.ctx();
+    JSValue arr = JS_NewArray(c);
+    if (JS_IsException(arr)) {
+        e.rejectPromise(ctx->ph, "failed to allocate array");
+        e.freePromise(ctx->ph);
+        delete ctx;
+        return;
+    }
+    for (uint32_t i = 0; i < ctx->slots.size(); i++) {
+        BatchSlot& s = ctx->slots[i];
+        JSValue v = JS_UNDEFINED;
+        if (s.err < 0) {
+            if (ctx->null_on_error) {
+                v = JS_NULL;
+            } else {
+                v = JS_NewError(c);
+                const std::string msg = std::string(uv_err_name(s.err)) + ": " + uv_strerror(s.err) + ", " + s.path;
+                JS_SetPropertyStr(c, v, "message", JS_NewString(c, msg.c_str()));
+                JS_SetPropertyStr(c, v, "code", JS_NewString(c, uv_err_name(s.err)));
+            }
+        } else if (s.op == BatchOp::Stat || s.op == BatchOp::Lstat) {
+            v = fs_stat_to_js(c, s.st);
+        } else if (s.op == BatchOp::Readdir) {
+            v = JS_NewArray(c);
+            for (uint32_t j = 0; j < s.names.size() && !JS_IsException(v); j++)
+                JS_SetPropertyUint32(c, v, j, JS_NewStringLen(c, s.names[j].data(), s.names[j].size()));
+        }
+        if (JS_IsException(v) || JS_SetPropertyUint32(c, arr, i, v) < 0) {
+            JS_FreeValue(c, arr);
+            e.rejectPromise(ctx->ph, "failed to build batch result");
+            e.freePromise(ctx->ph);
+            delete ctx;
+            return;
+        }
+    }
+    e.resolvePromiseJSValue(ctx->ph, arr);
+    e.freePromise(ctx->ph);
+    delete ctx;
+}
+
+void batch_finish_slot(BatchLane* lane) {
+    BatchCtx* ctx = lane->batch;
+    ctx->done++;
+    if (ctx->next < ctx->slots.size()) {
+        lane_start(lane);
+        return;
+    }
+    if (ctx->done == ctx->slots.size()) {
+        qianjs::event_loop::end_operation(ctx->op);
+        qianjs::event_loop::defer([ctx](qjs::JSEngine& e) { batch_settle(e, ctx); });
+    }
+}
+
+void lane_on_done(uv_fs_t* req) {
+    auto* lane = static_cast<BatchLane*>(req->data);
+    BatchSlot& s = lane->batch->slots[lane->slot];
+    if (req->result < 0) {
+        s.err = static_cast<int32_t>(req->result);
+    } else if (s.op == BatchOp::Stat || s.op == BatchOp::Lstat) {
+        s.st = req->statbuf;
+    } else if (s.op == BatchOp::Readdir) {
+        uv_dirent_t ent;
+        while (uv_fs_scandir_next(req, &ent) != UV_EOF)
+            s.names.emplace_back(ent.name);
+    }
+    uv_fs_req_cleanup(req);
+    batch_finish_slot(lane);
+}
+
+void lane_start(BatchLane* lane) {
+    BatchCtx* ctx = lane->batch;
+    for (;;) {
+        lane->slot = ctx->next++;
+        BatchSlot& s = ctx->slots[lane->slot];
+        uv_loop_t* loop = qianjs::event_loop::uv::loop();
+        const char* p = s.path.c_str();
+        int r = 0;
+        switch (s.op) {
+        case BatchOp::Stat:
+            r = uv_fs_stat(loop, &lane->req, p, lane_on_done);
+            break;
+        case BatchOp::Lstat:
+            r = uv_fs_lstat(loop, &lane->req, p, lane_on_done);
+            break;
+        case BatchOp::Readdir:
+            r = uv_fs_scandir(loop, &lane->req, p, 0, lane_on_done);
+            break;
+        case BatchOp::Mkdir:
+            r = uv_fs_mkdir(loop, &lane->req, p, 0777, lane_on_done);
+            break;
+        case BatchOp::Unlink:
+            r = uv_fs_unlink(loop, &lane->req, p, lane_on_done);
+            break;
+        case BatchOp::Rmdir:
+            r = uv_fs_rmdir(loop, &lane->req, p, lane_on_done);
+            break;
+        }
+        if (r >= 0)
+            return;
+        /** Submission failed synchronously: record it and move the lane on without waiting for a callback. */
+        s.err = r;
+        ctx->done++;
+        if (ctx->next >= ctx->slots.size()) {
+            if (ctx->done == ctx->slots.size()) {
+                qianjs::event_loop::end_operation(ctx->op);
+                qianjs::event_loop::defer([ctx](qjs::JSEngine& e) { batch_settle(e, ctx); });
+            }
+            return;
+        }
+    }
+}
+
+bool read_array_length(JSContext* c, JSValue arr, uint32_t& out, const char* what) {
+    if (!JS_IsArray(c, arr)) {
+        JS_ThrowTypeError(c, "%s must be an array", what);
+        return false;
+    }
+    JSValue len = JS_GetPropertyStr(c, arr, "length");
+    const int r = JS_ToUint32(c, &out, len);
+    JS_FreeValue(c, len);
+    return r == 0;
+}
+
+bool read_path(JSContext* c, JSValue v, std::string& out) {
+    bool ok = false;
+    out = qjs::JSConv<std::string>::from(c, v, ok);
+    return ok;
+}
+
+} // namespace
+
+bool fsBatchConcurrency(JSContext* c, int argc, JSValue* argv, int index, size_t& out) {
+    out = kFsBatchDefaultConcurrency;
+    if (argc <= index || JS_IsUndefined(argv[index]))
+        return true;
+    JSValue v = JS_GetPropertyStr(c, argv[index], "concurrency");
+    if (JS_IsException(v))
+        return false;
+    if (JS_IsUndefined(v))
+        return true;
+    int64_t n = 0;
+    const int r = JS_ToInt64(c, &n, v);
+    JS_FreeValue(c, v);
+    if (r)
+        return false;
+    if (n < 1 || n > 4096) {
+        JS_ThrowRangeError(c, "concurrency must be between 1 and 4096");
+        return false;
+    }
+    out = static_cast<size_t>(n);
+    return true;
+}
+
+bool fsParseBatchOps(JSContext* c, JSValue ops, std::vector<FsBatchItem>& out) {
+    uint32_t n = 0;
+    if (!read_array_length(c, ops, n, "batch: ops"))
+        return false;
+    out.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        JSValue item = JS_GetPropertyUint32(c, ops, i);
+        JSValue opv = JS_GetPropertyStr(c, item, "op");
+        JSValue pathv = JS_GetPropertyStr(c, item, "path");
+        JS_FreeValue(c, item);
+        const char* op = JS_ToCString(c, opv);
+        const bool op_ok = op && parse_op(op, out[i].op);
+        if (op)
+            JS_FreeCString(c, op);
+        JS_FreeValue(c, opv);
+        if (!op_ok) {
+            JS_FreeValue(c, pathv);
+            JS_ThrowTypeError(c, "batch: ops[%u].op must be stat, lstat, readdir, mkdir, unlink, or rmdir", i);
+            return false;
+        }
+        const bool path_ok = read_path(c, pathv, out[i].path);
+        JS_FreeValue(c, pathv);
+        if (!path_ok)
+            return false;
+    }
+    return true;
+}
+
+bool fsParseStatPaths(JSContext* c, JSValue paths, std::vector<FsBatchItem>& out) {
+    uint32_t n = 0;
+    if (!read_array_length(c, paths, n, "statMany: paths"))
+        return false;
+    out.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        JSValue pathv = JS_GetPropertyUint32(c, paths, i);
+        const bool ok = read_path(c, pathv, out[i].path);
+        JS_FreeValue(c, pathv);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+namespace {
+
+qjs::RawJSValue batch_start(qjs::JSEngine& engine, std::vector<FsBatchItem> items, size_t concurrency, BatchCtx* ctx) {
+    qjs::JSEngine::PromiseHandle ph = ctx->ph;
+    ctx->slots.resize(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        ctx->slots[i].op = items[i].op;
+        ctx->slots[i].path = std::move(items[i].path);
+    }
+
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Batch);
+    if (ctx->slots.empty()) {
+        qianjs::event_loop::end_operation(ctx->op);
+        qianjs::event_loop::defer([ctx](qjs::JSEngine& e) { batch_settle(e, ctx); });
+        return engine.promiseValue(ph);
+    }
+
+    ctx->lane_count = concurrency < ctx->slots.size() ? concurrency : ctx->slots.size();
+    ctx->lanes.reset(new BatchLane[ctx->lane_count]);
+    for (size_t i = 0; i < ctx->lane_count && ctx->next < ctx->slots.size(); i++) {
+        BatchLane* lane = &ctx->lanes[i];
+        lane->batch = ctx;
+        lane->req.data = lane;
+        lane_start(lane);
+    }
+    return engine.promiseValue(ph);
+}
+
+} // namespace
+
+qjs::RawJSValue fsBatchAsync(qjs::JSEngine& engine, std::vector<FsBatchItem> items, size_t concurrency, bool nullOnError) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
+
+    auto* ctx = new BatchCtx();
+    ctx->ph = ph;
+    ctx->null_on_error = nullOnError;
+    return batch_start(engine, std::move(items), concurrency, ctx);
+}
+
+qjs::RawJSValue fsStatManyIntoAsync(qjs::JSEngine& engine, std::vector<FsBatchItem> items, size_t concurrency,
+    JSValue target) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
+
+    auto* ctx = new BatchCtx();
+    ctx->ph = ph;
+    ctx->pack_into = JS_DupValue(engine.ctx(), target);
+    return batch_start(engine, std::move(items), concurrency, ctx);
+}
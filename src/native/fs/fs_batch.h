@@ -0,0 +1,44 @@
+#pragma once
+
+#include <js_engine.h>
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Default number of requests a batch keeps in flight on the libuv threadpool. */
+constexpr size_t kFsBatchDefaultConcurrency = 32;
+
+enum class FsBatchOp : uint8_t { Stat, Lstat, Readdir, Mkdir, Unlink, Rmdir };
+
+struct FsBatchItem {
+    FsBatchOp op = FsBatchOp::Stat;
+    std::string path;
+};
+
+/** `[{ op, path }, ...]` with `op` one of `stat`, `lstat`, `readdir`, `mkdir`, `unlink`, `rmdir`; false with an exception set. */
+bool fsParseBatchOps(JSContext* c, JSValue ops, std::vector<FsBatchItem>& out);
+
+/** `[path, ...]` as a batch of `stat`; false with an exception set. */
+bool fsParseStatPaths(JSContext* c, JSValue paths, std::vector<FsBatchItem>& out);
+
+/** Reads `argv[index].concurrency` (1..4096, default `kFsBatchDefaultConcurrency`); false with an exception set. */
+bool fsBatchConcurrency(JSContext* c, int argc, JSValue* argv, int index, size_t& out);
+
+/**
+ * Runs `items` on the threadpool with at most `concurrency` requests in flight; one promise, one `begin/end_operation`
+ * pair and one deferred settle for the whole batch. Resolves with an array in input order holding each result
+ * (stat object / name array / `undefined`); failed entries become `null` when `nullOnError`, else an `Error` with `code`.
+ */
+qjs::RawJSValue fsBatchAsync(qjs::JSEngine& engine, std::vector<FsBatchItem> items, size_t concurrency, bool nullOnError);
+
+/**
+ * `statManyInto`: the same threadpool batch of `stat` items, packed into `target` (a `Float64Array` holding at least
+ * `items.size() * kFsStatFieldCount` values, held until settled) with every field NaN for failed entries. Resolves
+ * with the number of failed entries; no per-entry JS values are created.
+ */
+qjs::RawJSValue fsStatManyIntoAsync(qjs::JSEngine& engine, std::vector<FsBatchItem> items, size_t concurrency,
+    JSValue target);
@@ -1,38 +1,124 @@
 #pragma once
 
+#include "runtime/buffer_pins.h"
+
 #include <quickjs.h>
 
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <string>
 
-/** Read JS string, ArrayBuffer, or TypedArray view into raw bytes (for writeFile). */
-inline bool fs_read_js_bytes(JSContext* c, JSValue v, std::vector<uint8_t>& out) {
-    if (JS_IsString(v)) {
-        size_t plen = 0;
-        const char* p = JS_ToCStringLen(c, &plen, v);
-        if (!p)
-            return false;
-        out.assign(reinterpret_cast<const uint8_t*>(p), reinterpret_cast<const uint8_t*>(p) + plen);
-        JS_FreeCString(c, p);
-        return true;
-    }
+/**
+ * Upper bound for one `uv_fs_read` / `uv_fs_write` length (`uv_buf_t::len` is `unsigned` on some platforms): whole-file
+ * I/O is split at this size, `fs.read` / `fs.write` transfer at most this much and resolve the short count.
+ */
+constexpr size_t kFsMaxIoRequest = size_t{1} << 30;
 
+/**
+ * Backing bytes of an ArrayBuffer or TypedArray view (no copy); false for other values. `base`, when given, receives
+ * the start of the whole ArrayBuffer (what `BufferPins` keys on).
+ */
+inline bool fs_js_buffer_view(JSContext* c, JSValue v, uint8_t** data, size_t* len, uint8_t** base = nullptr) {
     size_t sz = 0;
     uint8_t* raw = JS_GetArrayBuffer(c, &sz, v);
     if (raw) {
-        out.assign(raw, raw + sz);
+        *data = raw;
+        *len = sz;
+        if (base)
+            *base = raw;
         return true;
     }
+    JS_FreeValue(c, JS_GetException(c));
+
+    size_t boff = 0, blen = 0, bpe = 0;
+    JSValue buf = JS_GetTypedArrayBuffer(c, v, &boff, &blen, &bpe);
+    if (JS_IsException(buf)) {
+        JS_FreeValue(c, JS_GetException(c));
+        return false;
+    }
+    size_t ablen = 0;
+    uint8_t* start = JS_GetArrayBuffer(c, &ablen, buf);
+    JS_FreeValue(c, buf);
+    if (!start || boff + blen > ablen || boff > ablen)
+        return false;
+    *data = start + boff;
+    *len = blen;
+    if (base)
+        *base = start;
+    return true;
+}
 
+/**
+ * Element storage of a typed array with 8-byte elements (meant for `Float64Array`; `BigInt64Array` has the same width
+ * and is not told apart); false for anything else. The pointer is only valid until JS runs again.
+ */
+inline bool fs_js_float64_view(JSContext* c, JSValue v, double** data, size_t* count) {
     size_t boff = 0, blen = 0, bpe = 0;
     JSValue buf = JS_GetTypedArrayBuffer(c, v, &boff, &blen, &bpe);
-    if (JS_IsException(buf))
+    if (JS_IsException(buf)) {
+        JS_FreeValue(c, JS_GetException(c));
         return false;
+    }
     size_t ablen = 0;
     uint8_t* base = JS_GetArrayBuffer(c, &ablen, buf);
     JS_FreeValue(c, buf);
-    if (!base || boff + blen > ablen || boff > ablen)
+    if (!base) {
+        JS_FreeValue(c, JS_GetException(c));
         return false;
-    out.assign(base + boff, base + boff + blen);
+    }
+    if (bpe != sizeof(double) || boff > ablen || blen > ablen - boff)
+        return false;
+    *data = reinterpret_cast<double*>(base + boff);
+    *count = blen / sizeof(double);
     return true;
 }
+
+/**
+ * Source bytes for an async write: ArrayBuffer / TypedArray memory is used in place, `pinned` holds a reference and
+ * the storage is registered with `BufferPins` (so it cannot be transferred away) until the request settles; strings
+ * are encoded once into `owned`. Release with `fs_release_bytes_ref` on the JS thread.
+ */
+struct FsBytesRef {
+    JSValue pinned = JS_UNDEFINED;
+    const uint8_t* base = nullptr;
+    const uint8_t* view = nullptr;
+    size_t view_len = 0;
+    std::string owned;
+
+    const uint8_t* data() const { return view ? view : reinterpret_cast<const uint8_t*>(owned.data()); }
+    size_t size() const { return view ? view_len : owned.size(); }
+};
+
+inline bool fs_js_bytes_ref(JSContext* c, JSValue v, FsBytesRef& out) {
+    if (JS_IsString(v)) {
+        size_t plen = 0;
+        const char* p = JS_ToCStringLen(c, &plen, v);
+        if (!p)
+            return false;
+        out.owned.assign(p, plen);
+        JS_FreeCString(c, p);
+        return true;
+    }
+
+    uint8_t* data = nullptr;
+    size_t len = 0;
+    uint8_t* base = nullptr;
+    if (!fs_js_buffer_view(c, v, &data, &len, &base))
+        return false;
+    out.pinned = JS_DupValue(c, v);
+    out.base = base;
+    qianjs::BufferPins::pin(base);
+    out.view = data;
+    out.view_len = len;
+    return true;
+}
+
+inline void fs_release_bytes_ref(JSContext* c, FsBytesRef& ref) {
+    qianjs::BufferPins::unpin(ref.base);
+    JS_FreeValue(c, ref.pinned);
+    ref.pinned = JS_UNDEFINED;
+    ref.base = nullptr;
+    ref.view = nullptr;
+    ref.view_len = 0;
+    ref.owned.clear();
+}
@@ -0,0 +1,189 @@
+#include "native/fs/fs_mmap.h"
+
+#include "runtime/profiler/sampling_profiler.h"
+
+#include <js_types.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+
+void unmap_view(JSRuntime*, void*, void* ptr) {
+    UnmapViewOfFile(ptr);
+}
+
+JSValue throw_last_error(JSContext* c, const char* what, const std::string& path) {
+    return JS_ThrowTypeError(c, "mmap: %s failed for %s (error %lu)", what, path.c_str(), GetLastError());
+}
+
+#else
+
+/** `opaque` carries the mapping length. */
+void unmap_view(JSRuntime*, void* opaque, void* ptr) {
+    munmap(ptr, static_cast<size_t>(reinterpret_cast<uintptr_t>(opaque)));
+}
+
+JSValue throw_errno(JSContext* c, const char* what, const std::string& path, int err) {
+    return JS_ThrowTypeError(c, "mmap: %s failed for %s: %s", what, path.c_str(), std::strerror(err));
+}
+
+int posix_advice(FsMmapAdvice advice) {
+    switch (advice) {
+    case FsMmapAdvice::Sequential:
+        return POSIX_MADV_SEQUENTIAL;
+    case FsMmapAdvice::Random:
+        return POSIX_MADV_RANDOM;
+    case FsMmapAdvice::WillNeed:
+        return POSIX_MADV_WILLNEED;
+    case FsMmapAdvice::Normal:
+        break;
+    }
+    return POSIX_MADV_NORMAL;
+}
+
+#endif
+
+} // namespace
+
+bool fsParseMmapAdvice(const std::string& s, FsMmapAdvice& out) {
+    if (s == "normal")
+        out = FsMmapAdvice::Normal;
+    else if (s == "sequential")
+        out = FsMmapAdvice::Sequential;
+    else if (s == "random")
+        out = FsMmapAdvice::Random;
+    else if (s == "willneed")
+        out = FsMmapAdvice::WillNeed;
+    else
+        return false;
+    return true;
+}
+
+#ifdef _WIN32
+
+JSValue fsMmapFile(JSContext* c, const std::string& path, FsMmapAdvice advice) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, advice == FsMmapAdvice::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN
+                       : advice == FsMmapAdvice::Random   ? FILE_FLAG_RANDOM_ACCESS
+                                                          : FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return throw_last_error(c, "open", path);
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return throw_last_error(c, "stat", path);
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return JS_NewArrayBufferCopy(c, nullptr, 0);
+    }
+    if (static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        return JS_ThrowRangeError(c, "mmap: %s is too large to map", path.c_str());
+    }
+
+    /** The view keeps the section alive, so both handles can be closed right away. */
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return throw_last_error(c, "CreateFileMapping", path);
+    void* base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!base)
+        return throw_last_error(c, "MapViewOfFile", path);
+
+    const size_t len = static_cast<size_t>(size.QuadPart);
+    if (advice == FsMmapAdvice::WillNeed) {
+        WIN32_MEMORY_RANGE_ENTRY range{base, len};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+
+    JSValue ab = JS_NewArrayBuffer(c, static_cast<uint8_t*>(base), len, unmap_view, nullptr, 0);
+    if (JS_IsException(ab))
+        UnmapViewOfFile(base);
+    return ab;
+}
+
+#else
+
+JSValue fsMmapFile(JSContext* c, const std::string& path, FsMmapAdvice advice) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return throw_errno(c, "open", path, errno);
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        return throw_errno(c, "stat", path, err);
+    }
+    if (S_ISDIR(st.st_mode)) {
+        ::close(fd);
+        return JS_ThrowTypeError(c, "mmap: EISDIR: illegal operation on a directory");
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        return JS_NewArrayBufferCopy(c, nullptr, 0);
+    }
+    if (static_cast<uint64_t>(st.st_size) > SIZE_MAX) {
+        ::close(fd);
+        return JS_ThrowRangeError(c, "mmap: %s is too large to map", path.c_str());
+    }
+
+    /**
+     * `MAP_PRIVATE` + `PROT_WRITE`: ArrayBuffers are writable from JS, and a read-only mapping would fault the process
+     * on the first store. Stores copy the touched page instead and never reach the file.
+     */
+    const size_t len = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    const int map_err = errno;
+    ::close(fd);
+    if (base == MAP_FAILED)
+        return throw_errno(c, "mmap", path, map_err);
+
+    if (advice != FsMmapAdvice::Normal)
+        posix_madvise(base, len, posix_advice(advice));
+
+    JSValue ab = JS_NewArrayBuffer(c, static_cast<uint8_t*>(base), len, unmap_view,
+        reinterpret_cast<void*>(static_cast<uintptr_t>(len)), 0);
+    if (JS_IsException(ab))
+        munmap(base, len);
+    return ab;
+}
+
+#endif
+
+JSValue fsMmapBinding(JSContext* c, int argc, JSValue* argv) {
+    const qianjs::profiler::NativeFrame frame("fs");
+    bool ok = false;
+    std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
+    if (!ok)
+        return JS_EXCEPTION;
+    FsMmapAdvice advice = FsMmapAdvice::Normal;
+    if (argc > 1 && !JS_IsUndefined(argv[1])) {
+        std::string hint = qjs::JSConv<std::string>::from(c, argv[1], ok);
+        if (!ok)
+            return JS_EXCEPTION;
+        if (!fsParseMmapAdvice(hint, advice))
+            return JS_ThrowTypeError(c, "mmap: advice must be one of normal, sequential, random, willneed");
+    }
+    return fsMmapFile(c, path, advice);
+}
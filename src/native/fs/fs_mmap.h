@@ -0,0 +1,22 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <string>
+
+/** `madvise` hint for `fs.mmap`; `Normal` leaves the kernel default. */
+enum class FsMmapAdvice { Normal, Sequential, Random, WillNeed };
+
+/** Parses `normal` / `sequential` / `random` / `willneed`; false for anything else. */
+bool fsParseMmapAdvice(const std::string& s, FsMmapAdvice& out);
+
+/**
+ * ArrayBuffer backed by a private (copy-on-write) mapping of the whole file; the ArrayBuffer finalizer unmaps it.
+ * Pages are faulted in on access and shared with the page cache until written; a JS store copies the page into
+ * private memory and never reaches the file. Truncating the file while it is mapped makes later access past the new
+ * end raise `SIGBUS`. Throws on failure.
+ */
+JSValue fsMmapFile(JSContext* c, const std::string& path, FsMmapAdvice advice);
+
+/** `mmap(path, advice?)` binding shared by `fs` and `fs.sync` (mapping is synchronous either way). */
+JSValue fsMmapBinding(JSContext* c, int argc, JSValue* argv);
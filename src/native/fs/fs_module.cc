@@ -1,13 +1,23 @@
 #include "native/fs/fs_module.h"
 
+#include "native/fs/fs_batch.h"
 #include "native/fs/fs_js_io.h"
+#include "native/fs/fs_mmap.h"
+#include "native/fs/fs_path.h"
+#include "native/fs/fs_stat_js.h"
+#include "native/fs/fs_stream.h"
 #include "native/fs/fs_sync.h"
 #include "native/fs/fs_uv.h"
+#include "native/fs/fs_walk.h"
+#include "native/fs/fs_watch.h"
+
+#include "runtime/profiler/sampling_profiler.h"
 
 #include <js_engine.h>
 #include <js_module.h>
 #include <js_types.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -20,97 +30,249 @@ void FsPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
     auto& m = root.module("fs");
 
     m.funcDynamic("readFile", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "readFile"))
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsReadFileAsync(*eng, std::move(path), false);
+        qjs::RawJSValue r = fsReadFileAsync(*eng, path, false);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("readFileBytes", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "readFileBytes"))
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsReadFileAsync(*eng, std::move(path), true);
+        qjs::RawJSValue r = fsReadFileAsync(*eng, path, true);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("writeFile", 2, 2, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "writeFile"))
             return JS_EXCEPTION;
-        std::vector<uint8_t> bytes;
-        if (!fs_read_js_bytes(c, argv[1], bytes))
+        FsBytesRef data;
+        if (!fs_js_bytes_ref(c, argv[1], data))
             return JS_ThrowTypeError(c, "writeFile: data must be string, ArrayBuffer, or TypedArray");
-        qjs::RawJSValue r = fsWriteFileAsync(*eng, std::move(path), std::move(bytes));
+        qjs::RawJSValue r = fsWriteFileAsync(*eng, path, std::move(data));
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("mkdir", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "mkdir"))
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsMkdirAsync(*eng, std::move(path), false);
+        qjs::RawJSValue r = fsMkdirAsync(*eng, path, false);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("mkdirRecursive", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "mkdirRecursive"))
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsMkdirAsync(*eng, std::move(path), true);
+        qjs::RawJSValue r = fsMkdirAsync(*eng, path, true);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("readdir", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "readdir"))
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsReaddirAsync(*eng, std::move(path));
+        qjs::RawJSValue r = fsReaddirAsync(*eng, path);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("stat", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "stat"))
+            return JS_EXCEPTION;
+        qjs::RawJSValue r = fsStatAsync(*eng, path);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("statInto", 2, 2, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        (void)argc;
+        FsPath path;
+        if (!path.from(c, argv[0], "statInto"))
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsStatAsync(*eng, std::move(path));
+        double* out = nullptr;
+        size_t count = 0;
+        if (!fs_js_float64_view(c, argv[1], &out, &count))
+            return JS_ThrowTypeError(c, "statInto: target must be a Float64Array");
+        if (count < kFsStatFieldCount)
+            return JS_ThrowRangeError(c, "statInto: target needs at least %d elements", int(kFsStatFieldCount));
+        qjs::RawJSValue r = fsStatIntoAsync(*eng, path, argv[1]);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("unlink", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "unlink"))
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsUnlinkAsync(*eng, std::move(path));
+        qjs::RawJSValue r = fsUnlinkAsync(*eng, path);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
     m.funcDynamic("rmdir", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        (void)argc;
+        FsPath path;
+        if (!path.from(c, argv[0], "rmdir"))
+            return JS_EXCEPTION;
+        qjs::RawJSValue r = fsRmdirAsync(*eng, path);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("open", 1, 2, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        FsPath path;
+        if (!path.from(c, argv[0], "open"))
+            return JS_EXCEPTION;
+        std::string flags = "r";
+        if (argc > 1 && !JS_IsUndefined(argv[1])) {
+            bool ok = false;
+            flags = qjs::JSConv<std::string>::from(c, argv[1], ok);
+            if (!ok)
+                return JS_EXCEPTION;
+        }
+        const int uvFlags = fsParseOpenFlags(flags);
+        if (uvFlags < 0)
+            return JS_ThrowTypeError(c, "open: flags must be one of r, r+, w, w+, a, a+");
+        qjs::RawJSValue r = fsOpenAsync(*eng, path, uvFlags);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("close", 1, 1, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
+        int32_t fd = 0;
+        if (JS_ToInt32(c, &fd, argv[0]))
+            return JS_EXCEPTION;
+        qjs::RawJSValue r = fsCloseAsync(*eng, fd);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("read", 2, 3, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        int32_t fd = 0;
+        if (JS_ToInt32(c, &fd, argv[0]))
+            return JS_EXCEPTION;
+        uint8_t* data = nullptr;
+        size_t len = 0;
+        if (!fs_js_buffer_view(c, argv[1], &data, &len))
+            return JS_ThrowTypeError(c, "read: buffer must be ArrayBuffer or TypedArray");
+        int64_t position = -1;
+        if (argc > 2 && !JS_IsUndefined(argv[2]) && JS_ToInt64(c, &position, argv[2]))
+            return JS_EXCEPTION;
+        qjs::RawJSValue r = fsReadIntoAsync(*eng, fd, argv[1], len, position);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("write", 2, 3, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        int32_t fd = 0;
+        if (JS_ToInt32(c, &fd, argv[0]))
+            return JS_EXCEPTION;
+        FsBytesRef src;
+        if (!fs_js_bytes_ref(c, argv[1], src))
+            return JS_ThrowTypeError(c, "write: data must be string, ArrayBuffer, or TypedArray");
+        int64_t position = -1;
+        if (argc > 2 && !JS_IsUndefined(argv[2]) && JS_ToInt64(c, &position, argv[2])) {
+            fs_release_bytes_ref(c, src);
+            return JS_EXCEPTION;
+        }
+        qjs::RawJSValue r = fsWriteFromAsync(*eng, fd, std::move(src), position);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("readChunks", 2, 3, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        FsPath path;
+        if (!path.from(c, argv[0], "close"))
+            return JS_EXCEPTION;
+        if (!JS_IsFunction(c, argv[1]))
+            return JS_ThrowTypeError(c, "readChunks: onChunk must be a function");
+        size_t chunkSize = kFsDefaultChunkSize;
+        if (argc > 2 && !JS_IsUndefined(argv[2])) {
+            int64_t n = 0;
+            if (JS_ToInt64(c, &n, argv[2]))
+                return JS_EXCEPTION;
+            if (n <= 0 || n > INT32_MAX)
+                return JS_ThrowRangeError(c, "readChunks: chunkSize must be in (0, 2^31)");
+            chunkSize = static_cast<size_t>(n);
+        }
+        qjs::RawJSValue r = fsReadChunksAsync(*eng, path, argv[1], chunkSize);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("batch", 1, 2, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        std::vector<FsBatchItem> items;
+        size_t concurrency = 0;
+        if (!fsParseBatchOps(c, argv[0], items) || !fsBatchConcurrency(c, argc, argv, 1, concurrency))
+            return JS_EXCEPTION;
+        qjs::RawJSValue r = fsBatchAsync(*eng, std::move(items), concurrency, false);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("statMany", 1, 2, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        std::vector<FsBatchItem> items;
+        size_t concurrency = 0;
+        if (!fsParseStatPaths(c, argv[0], items) || !fsBatchConcurrency(c, argc, argv, 1, concurrency))
+            return JS_EXCEPTION;
+        qjs::RawJSValue r = fsBatchAsync(*eng, std::move(items), concurrency, true);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("statManyInto", 2, 3, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        std::vector<FsBatchItem> items;
+        size_t concurrency = 0;
+        if (!fsParseStatPaths(c, argv[0], items) || !fsBatchConcurrency(c, argc, argv, 2, concurrency))
+            return JS_EXCEPTION;
+        double* out = nullptr;
+        size_t count = 0;
+        if (!fs_js_float64_view(c, argv[1], &out, &count))
+            return JS_ThrowTypeError(c, "statManyInto: target must be a Float64Array");
+        if (count / kFsStatFieldCount < items.size())
+            return JS_ThrowRangeError(c, "statManyInto: target needs %d elements per path", int(kFsStatFieldCount));
+        qjs::RawJSValue r = fsStatManyIntoAsync(*eng, std::move(items), concurrency, argv[1]);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+
+    m.funcDynamic("walk", 2, 3, [eng](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
+        std::string root = qjs::JSConv<std::string>::from(c, argv[0], ok);
         if (!ok)
             return JS_EXCEPTION;
-        qjs::RawJSValue r = fsRmdirAsync(*eng, std::move(path));
+        if (!JS_IsFunction(c, argv[1]))
+            return JS_ThrowTypeError(c, "walk: onBatch must be a function");
+        FsWalkOptions options;
+        if (!fsParseWalkOptions(c, argc, argv, 2, options))
+            return JS_EXCEPTION;
+        qjs::RawJSValue r = fsWalkAsync(*eng, std::move(root), argv[1], options);
         return qjs::JSConv<qjs::RawJSValue>::to(c, r);
     });
 
+    m.funcDynamic("mmap", 1, 2, fsMmapBinding);
+
+    install_fs_watch(engine, m);
     install_fs_sync(m.module("sync"));
 }
@@ -1,3 +1,4 @@
+#include "native/fs/fs_js_io.h"
 #include "native/fs/fs_stat_js.h"
 #include "native/fs/fs_uv.h"
 
@@ -5,6 +6,7 @@
 
 #include "runtime/event_loop/event_loop.h"
 
+#include <uv.h>
 #include <uvw.hpp>
 
 #include <cstdint>
@@ -58,7 +60,7 @@ void schedule_resolve_stat(qjs::JSEngine::PromiseHandle ph, const uv_stat_t& st)
 
 } // namespace
 
-qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, std::string path) {
+qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, const FsPath& path) {
     qjs::JSEngine::PromiseHandle ph = engine.createPromise();
     if (!ph.ptr)
         return engine.promiseValue(ph);
@@ -67,6 +69,7 @@ qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, std::string path) {
         qjs::JSEngine::PromiseHandle ph{};
         std::shared_ptr<uvw::fs_req> req_keep;
         std::vector<std::string> names;
+        qianjs::event_loop::OpTimer op;
     };
     auto ctx = std::make_shared<Ctx>();
     ctx->ph = ph;
@@ -77,7 +80,7 @@ qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, std::string path) {
     auto req = ctx->req_keep;
 
     req->on<uvw::error_event>([ctx](const uvw::error_event& e, auto&) {
-        qianjs::event_loop::end_operation();
+        qianjs::event_loop::end_operation(ctx->op);
         reject(ctx->ph, e.what());
         qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
     });
@@ -98,7 +101,7 @@ qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, std::string path) {
             }
             break;
         case ft::CLOSEDIR:
-            qianjs::event_loop::end_operation();
+            qianjs::event_loop::end_operation(ctx->op);
             schedule_resolve_string_array(ctx->ph, std::move(ctx->names));
             qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
             break;
@@ -107,89 +110,145 @@ qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, std::string path) {
         }
     });
 
-    qianjs::event_loop::begin_operation();
-    req->opendir(path);
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Readdir);
+    req->opendir(path.str());
     return engine.promiseValue(ph);
 }
 
-qjs::RawJSValue fsStatAsync(qjs::JSEngine& engine, std::string path) {
-    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
-    if (!ph.ptr)
-        return engine.promiseValue(ph);
+namespace {
 
-    struct Ctx {
-        qjs::JSEngine::PromiseHandle ph{};
-        std::shared_ptr<uvw::fs_req> req_keep;
-    };
-    auto ctx = std::make_shared<Ctx>();
+/** One-shot path request on raw `uv_fs_*`: the request and its promise in one allocation, no uvw handle. */
+struct PathReqCtx {
+    uv_fs_t req{};
+    qjs::JSEngine::PromiseHandle ph{};
+    qianjs::event_loop::OpTimer op;
+};
+
+PathReqCtx* new_path_req(qjs::JSEngine::PromiseHandle ph, qianjs::event_loop::OpKind kind) {
+    auto* ctx = new PathReqCtx();
     ctx->ph = ph;
-    auto loop = qianjs::event_loop::uv::uvw_loop();
-    auto req = loop->resource<uvw::fs_req>();
-    ctx->req_keep = req;
+    ctx->req.data = ctx;
+    ctx->op = qianjs::event_loop::begin_operation(kind);
+    return ctx;
+}
 
-    using ft = uvw::fs_req::fs_type;
+void reject_uv(qjs::JSEngine::PromiseHandle ph, ssize_t r) {
+    reject(ph, std::string(uv_err_name(static_cast<int>(r))) + ": " + uv_strerror(static_cast<int>(r)),
+        uv_err_name(static_cast<int>(r)));
+}
 
-    req->on<uvw::error_event>([ctx](const uvw::error_event& e, auto&) {
-        qianjs::event_loop::end_operation();
-        reject(ctx->ph, e.what());
-        qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
-    });
+/** Loop thread: settle from `req->result` (stat result or void), then free the context. */
+void settle_path_req(uv_fs_t* req, bool as_stat) {
+    auto* ctx = static_cast<PathReqCtx*>(req->data);
+    const ssize_t r = req->result;
+    qianjs::event_loop::end_operation(ctx->op);
+    if (r < 0)
+        reject_uv(ctx->ph, r);
+    else if (as_stat)
+        schedule_resolve_stat(ctx->ph, req->statbuf);
+    else
+        resolve_void(ctx->ph);
+    uv_fs_req_cleanup(req);
+    delete ctx;
+}
 
-    req->on<uvw::fs_event>([ctx](const uvw::fs_event& ev, uvw::fs_req&) {
-        if (ev.type == ft::STAT || ev.type == ft::LSTAT) {
-            qianjs::event_loop::end_operation();
-            schedule_resolve_stat(ctx->ph, ev.stat);
-            qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
+/** `start` failed synchronously: nothing is queued, so settle here. */
+qjs::RawJSValue fail_path_req(qjs::JSEngine& engine, PathReqCtx* ctx, int r) {
+    qjs::RawJSValue pv = engine.promiseValue(ctx->ph);
+    qianjs::event_loop::end_operation(ctx->op);
+    reject_uv(ctx->ph, r);
+    delete ctx;
+    return pv;
+}
+
+/** `statInto`: the result stays in `req.statbuf` until it is packed on the JS thread, so only `ctx` is captured. */
+struct StatIntoCtx {
+    uv_fs_t req{};
+    qjs::JSEngine::PromiseHandle ph{};
+    JSValue target = JS_UNDEFINED;
+    qianjs::event_loop::OpTimer op;
+};
+
+void settle_stat_into(StatIntoCtx* ctx) {
+    qianjs::event_loop::end_operation(ctx->op);
+    qianjs::event_loop::defer([ctx](qjs::JSEngine& e) {
+        JSContext* c = e.ctx();
+        const int r = static_cast<int>(ctx->req.result);
+        double* out = nullptr;
+        size_t count = 0;
+        if (r < 0) {
+            e.rejectPromise(ctx->ph, std::string(uv_err_name(r)) + ": " + uv_strerror(r), uv_err_name(r));
+        } else if (!fs_js_float64_view(c, ctx->target, &out, &count) || count < kFsStatFieldCount) {
+            e.rejectPromise(ctx->ph, "statInto: target was detached or shrunk");
+        } else {
+            fs_stat_pack(ctx->req.statbuf, out);
+            e.resolvePromiseVoid(ctx->ph);
         }
+        e.freePromise(ctx->ph);
+        JS_FreeValue(c, ctx->target);
+        delete ctx;
     });
+}
+
+} // namespace
+
+qjs::RawJSValue fsStatAsync(qjs::JSEngine& engine, const FsPath& path) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
 
-    qianjs::event_loop::begin_operation();
-    req->stat(path);
+    PathReqCtx* ctx = new_path_req(ph, qianjs::event_loop::OpKind::Stat);
+    const int r = uv_fs_stat(qianjs::event_loop::uv::loop(), &ctx->req, path.c_str(),
+        [](uv_fs_t* req) { settle_path_req(req, true); });
+    if (r < 0)
+        return fail_path_req(engine, ctx, r);
     return engine.promiseValue(ph);
 }
 
-static qjs::RawJSValue fs_one_path_void(qjs::JSEngine& engine, std::string path,
-    void (*start)(uvw::fs_req&, const std::string&), uvw::fs_req::fs_type doneType) {
+qjs::RawJSValue fsStatIntoAsync(qjs::JSEngine& engine, const FsPath& path, JSValue target) {
     qjs::JSEngine::PromiseHandle ph = engine.createPromise();
     if (!ph.ptr)
         return engine.promiseValue(ph);
 
-    struct Ctx {
-        qjs::JSEngine::PromiseHandle ph{};
-        std::shared_ptr<uvw::fs_req> req_keep;
-    };
-    auto ctx = std::make_shared<Ctx>();
+    auto* ctx = new StatIntoCtx();
     ctx->ph = ph;
-    auto loop = qianjs::event_loop::uv::uvw_loop();
-    auto req = loop->resource<uvw::fs_req>();
-    ctx->req_keep = req;
-
-    req->on<uvw::error_event>([ctx](const uvw::error_event& e, auto&) {
-        qianjs::event_loop::end_operation();
-        reject(ctx->ph, e.what());
-        qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
+    ctx->req.data = ctx;
+    ctx->target = JS_DupValue(engine.ctx(), target);
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Stat);
+    const int r = uv_fs_stat(qianjs::event_loop::uv::loop(), &ctx->req, path.c_str(), [](uv_fs_t* req) {
+        auto* ctx = static_cast<StatIntoCtx*>(req->data);
+        uv_fs_req_cleanup(req);
+        settle_stat_into(ctx);
     });
+    if (r < 0) {
+        ctx->req.result = r;
+        settle_stat_into(ctx);
+    }
+    return engine.promiseValue(ph);
+}
 
-    req->on<uvw::fs_event>([ctx, doneType](const uvw::fs_event& ev, uvw::fs_req&) {
-        if (ev.type == doneType) {
-            qianjs::event_loop::end_operation();
-            resolve_void(ctx->ph);
-            qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
-        }
-    });
+qjs::RawJSValue fsUnlinkAsync(qjs::JSEngine& engine, const FsPath& path) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
 
-    qianjs::event_loop::begin_operation();
-    start(*req, path);
+    PathReqCtx* ctx = new_path_req(ph, qianjs::event_loop::OpKind::Unlink);
+    const int r = uv_fs_unlink(qianjs::event_loop::uv::loop(), &ctx->req, path.c_str(),
+        [](uv_fs_t* req) { settle_path_req(req, false); });
+    if (r < 0)
+        return fail_path_req(engine, ctx, r);
     return engine.promiseValue(ph);
 }
 
-qjs::RawJSValue fsUnlinkAsync(qjs::JSEngine& engine, std::string path) {
-    return fs_one_path_void(
-        engine, std::move(path), [](uvw::fs_req& r, const std::string& p) { r.unlink(p); }, uvw::fs_req::fs_type::UNLINK);
-}
+qjs::RawJSValue fsRmdirAsync(qjs::JSEngine& engine, const FsPath& path) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
 
-qjs::RawJSValue fsRmdirAsync(qjs::JSEngine& engine, std::string path) {
-    return fs_one_path_void(
-        engine, std::move(path), [](uvw::fs_req& r, const std::string& p) { r.rmdir(p); }, uvw::fs_req::fs_type::RMDIR);
+    PathReqCtx* ctx = new_path_req(ph, qianjs::event_loop::OpKind::Rmdir);
+    const int r = uv_fs_rmdir(qianjs::event_loop::uv::loop(), &ctx->req, path.c_str(),
+        [](uv_fs_t* req) { settle_path_req(req, false); });
+    if (r < 0)
+        return fail_path_req(engine, ctx, r);
+    return engine.promiseValue(ph);
 }
-
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * Path argument taken with one `JS_ToCStringLen` into inline storage (heap only past `kInline` bytes), so bindings
+ * hand libuv a NUL-terminated path without building a `std::string` per call. Async `uv_fs_*` requests copy the path
+ * when started, so an `FsPath` only has to outlive the call that starts them.
+ */
+class FsPath {
+public:
+    static constexpr size_t kInline = 256;
+
+    FsPath() { inline_[0] = '\0'; }
+    /** From C++ (benchmarks, hosts); `s` must not contain NUL bytes. */
+    explicit FsPath(std::string_view s) { assign(s.data(), s.size()); }
+    FsPath(const FsPath&) = delete;
+    FsPath& operator=(const FsPath&) = delete;
+
+    /** False with an exception pending when `v` does not convert or contains a NUL byte; `fn` prefixes the message. */
+    bool from(JSContext* c, JSValue v, const char* fn) {
+        size_t len = 0;
+        const char* s = JS_ToCStringLen(c, &len, v);
+        if (!s)
+            return false;
+        if (std::memchr(s, '\0', len)) {
+            JS_FreeCString(c, s);
+            JS_ThrowTypeError(c, "%s: path must not contain NUL bytes", fn);
+            return false;
+        }
+        assign(s, len);
+        JS_FreeCString(c, s);
+        return true;
+    }
+
+    const char* c_str() const { return heap_ ? heap_.get() : inline_; }
+    size_t size() const { return len_; }
+    std::string_view view() const { return {c_str(), len_}; }
+    /** Owning copy, for APIs that keep the path beyond the call (uvw requests, walk queues). */
+    std::string str() const { return std::string(c_str(), len_); }
+
+private:
+    void assign(const char* s, size_t len) {
+        char* dst = inline_;
+        if (len >= kInline) {
+            heap_.reset(new char[len + 1]);
+            dst = heap_.get();
+        }
+        std::memcpy(dst, s, len);
+        dst[len] = '\0';
+        len_ = len;
+    }
+
+    char inline_[kInline];
+    std::unique_ptr<char[]> heap_;
+    size_t len_ = 0;
+};
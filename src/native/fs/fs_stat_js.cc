@@ -1,5 +1,6 @@
 #include "native/fs/fs_stat_js.h"
 
+#include <cmath>
 #include <cstdint>
 
 #include <sys/stat.h>
@@ -81,3 +82,17 @@ JSValue fs_stat_to_js(JSContext* c, const uv_stat_t& st) {
 
     return o;
 }
+
+void fs_stat_pack(const uv_stat_t& st, double* out) {
+    out[kFsStatSize] = static_cast<double>(st.st_size);
+    out[kFsStatMtimeMs] = static_cast<double>(timespec_to_ms(st.st_mtim));
+    out[kFsStatMode] = static_cast<double>(st.st_mode);
+    out[kFsStatIno] = static_cast<double>(st.st_ino);
+    out[kFsStatDev] = static_cast<double>(st.st_dev);
+    out[kFsStatCtimeMs] = static_cast<double>(timespec_to_ms(st.st_ctim));
+}
+
+void fs_stat_pack_missing(double* out) {
+    for (size_t i = 0; i < kFsStatFieldCount; i++)
+        out[i] = NAN;
+}
@@ -3,5 +3,24 @@
 #include <quickjs.h>
 #include <uv.h>
 
+#include <cstddef>
+
 /** Plain object shaped like Node `fs.Stats` (fields only, no methods). */
 JSValue fs_stat_to_js(JSContext* c, const uv_stat_t& st);
+
+/** `statInto` layout: one `double` per field at these indices, `kFsStatFieldCount` per entry. */
+enum FsStatField : size_t {
+    kFsStatSize,
+    kFsStatMtimeMs,
+    kFsStatMode,
+    kFsStatIno,
+    kFsStatDev,
+    kFsStatCtimeMs,
+    kFsStatFieldCount,
+};
+
+/** Writes `kFsStatFieldCount` doubles to `out`; no JS values are created. */
+void fs_stat_pack(const uv_stat_t& st, double* out);
+
+/** Every field NaN: the `statManyInto` marker for an entry that failed. */
+void fs_stat_pack_missing(double* out);
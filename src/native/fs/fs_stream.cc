@@ -0,0 +1,399 @@
+#include "native/fs/fs_stream.h"
+
+#include "native/fs/fs_async_schedule.h"
+
+#include "runtime/event_loop/event_loop.h"
+
+#include <uv.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace {
+
+using qianjs::fs::schedule::reject;
+using qianjs::fs::schedule::resolve_void;
+
+#ifdef _WIN32
+constexpr int kCreateMode = _S_IREAD | _S_IWRITE;
+#else
+constexpr int kCreateMode = 0644;
+#endif
+
+/**
+ * Free list of `kFsDefaultChunkSize` blocks for `readChunks`. Blocks leave the pool as ArrayBuffer storage and come back
+ * from the ArrayBuffer finalizer, which runs on the engine's (JS) thread — hence thread-local, no locking.
+ */
+class ChunkPool {
+public:
+    static constexpr size_t kMaxBlocks = 16;
+
+    ~ChunkPool() {
+        for (uint8_t* b : free_)
+            std::free(b);
+    }
+
+    uint8_t* acquire(size_t size) {
+        if (size == kFsDefaultChunkSize && !free_.empty()) {
+            uint8_t* b = free_.back();
+            free_.pop_back();
+            return b;
+        }
+        return static_cast<uint8_t*>(std::malloc(size));
+    }
+
+    void release(uint8_t* block, size_t size) {
+        if (size == kFsDefaultChunkSize && free_.size() < kMaxBlocks)
+            free_.push_back(block);
+        else
+            std::free(block);
+    }
+
+private:
+    std::vector<uint8_t*> free_;
+};
+
+thread_local ChunkPool t_chunk_pool;
+
+/** `JSFreeArrayBufferDataFunc`; `opaque` carries the block capacity (the ArrayBuffer may be shorter). */
+void release_chunk(JSRuntime*, void* opaque, void* ptr) {
+    t_chunk_pool.release(static_cast<uint8_t*>(ptr), reinterpret_cast<uintptr_t>(opaque));
+}
+
+std::string uv_message(ssize_t r) {
+    return std::string(uv_err_name(static_cast<int>(r))) + ": " + uv_strerror(static_cast<int>(r));
+}
+
+void reject_uv(qjs::JSEngine::PromiseHandle ph, ssize_t r) {
+    reject(ph, uv_message(r), uv_err_name(static_cast<int>(r)));
+}
+
+void resolve_number(qjs::JSEngine::PromiseHandle ph, int64_t n) {
+    qianjs::event_loop::defer([ph, n](qjs::JSEngine& e) {
+        e.resolvePromiseJSValue(ph, JS_NewInt64(e.ctx(), n));
+        e.freePromise(ph);
+    });
+}
+
+/** One-shot fd request: the `uv_fs_t` lives here until the deferred settle drops the pinned buffer and frees it. */
+struct FdReqCtx {
+    uv_fs_t req{};
+    qjs::JSEngine::PromiseHandle ph{};
+    /** `read` target; the kernel fills `block`, which is copied into it on the JS thread. */
+    JSValue pinned = JS_UNDEFINED;
+    uint8_t* block = nullptr;
+    size_t block_len = 0;
+    FsBytesRef src;
+    qianjs::event_loop::OpTimer op;
+};
+
+void settle_fd_req(uv_fs_t* req, bool as_void) {
+    auto* ctx = static_cast<FdReqCtx*>(req->data);
+    const ssize_t r = req->result;
+    uv_fs_req_cleanup(req);
+    qianjs::event_loop::end_operation(ctx->op);
+
+    if (r < 0)
+        reject_uv(ctx->ph, r);
+    else if (as_void)
+        resolve_void(ctx->ph);
+    else
+        resolve_number(ctx->ph, static_cast<int64_t>(r));
+
+    qianjs::event_loop::defer([ctx](qjs::JSEngine& e) {
+        JS_FreeValue(e.ctx(), ctx->pinned);
+        fs_release_bytes_ref(e.ctx(), ctx->src);
+        delete ctx;
+    });
+}
+
+FdReqCtx* new_fd_req(qjs::JSEngine::PromiseHandle ph) {
+    auto* ctx = new FdReqCtx();
+    ctx->ph = ph;
+    ctx->req.data = ctx;
+    return ctx;
+}
+
+/** Synchronous uv failure (bad fd, …): callback will not run, so settle here. */
+void fail_started(FdReqCtx* ctx, qjs::JSEngine& engine, int r) {
+    qianjs::event_loop::end_operation(ctx->op);
+    reject_uv(ctx->ph, r);
+    JS_FreeValue(engine.ctx(), ctx->pinned);
+    if (ctx->block)
+        t_chunk_pool.release(ctx->block, ctx->block_len);
+    fs_release_bytes_ref(engine.ctx(), ctx->src);
+    delete ctx;
+}
+
+/**
+ * JS thread: copy what was read into the target as it is *now*. The target may have been detached (transferred to a
+ * worker) or shrunk while the read was in flight; the kernel only ever wrote into our own block.
+ */
+void settle_read_into(uv_fs_t* req) {
+    auto* ctx = static_cast<FdReqCtx*>(req->data);
+    const ssize_t r = req->result;
+    uv_fs_req_cleanup(req);
+    qianjs::event_loop::end_operation(ctx->op);
+
+    qianjs::event_loop::defer([ctx, r](qjs::JSEngine& e) {
+        JSContext* c = e.ctx();
+        uint8_t* data = nullptr;
+        size_t len = 0;
+        if (r < 0) {
+            e.rejectPromise(ctx->ph, uv_message(r), uv_err_name(static_cast<int>(r)));
+        } else if (!fs_js_buffer_view(c, ctx->pinned, &data, &len)) {
+            e.rejectPromise(ctx->ph, "read: buffer was detached before the read completed");
+        } else {
+            const size_t n = std::min(static_cast<size_t>(r), len);
+            if (n > 0)
+                std::memcpy(data, ctx->block, n);
+            e.resolvePromiseJSValue(ctx->ph, JS_NewInt64(c, static_cast<int64_t>(n)));
+        }
+        e.freePromise(ctx->ph);
+        JS_FreeValue(c, ctx->pinned);
+        t_chunk_pool.release(ctx->block, ctx->block_len);
+        delete ctx;
+    });
+}
+
+struct ChunkStreamCtx {
+    uv_fs_t req{};
+    qjs::JSEngine::PromiseHandle ph{};
+    JSValue on_chunk = JS_UNDEFINED;
+    uv_file fd = -1;
+    size_t chunk_size = kFsDefaultChunkSize;
+    int64_t offset = 0;
+    uint8_t* block = nullptr;
+    std::string error;
+    std::string error_code;
+    qianjs::event_loop::OpTimer op;
+};
+
+void chunk_stream_read(ChunkStreamCtx* ctx);
+void chunk_stream_close(ChunkStreamCtx* ctx);
+
+void chunk_stream_finish(ChunkStreamCtx* ctx) {
+    qianjs::event_loop::end_operation(ctx->op);
+    qianjs::event_loop::defer([ctx](qjs::JSEngine& e) {
+        if (ctx->error.empty())
+            e.resolvePromiseJSValue(ctx->ph, JS_NewInt64(e.ctx(), ctx->offset));
+        else
+            e.rejectPromise(ctx->ph, ctx->error, ctx->error_code);
+        e.freePromise(ctx->ph);
+        JS_FreeValue(e.ctx(), ctx->on_chunk);
+        delete ctx;
+    });
+}
+
+void chunk_stream_fail(ChunkStreamCtx* ctx, ssize_t r) {
+    ctx->error = uv_message(r);
+    ctx->error_code = uv_err_name(static_cast<int>(r));
+}
+
+void chunk_stream_on_close(uv_fs_t* req) {
+    auto* ctx = static_cast<ChunkStreamCtx*>(req->data);
+    if (req->result < 0 && ctx->error.empty())
+        chunk_stream_fail(ctx, req->result);
+    uv_fs_req_cleanup(req);
+    chunk_stream_finish(ctx);
+}
+
+void chunk_stream_close(ChunkStreamCtx* ctx) {
+    const int r = uv_fs_close(qianjs::event_loop::uv::loop(), &ctx->req, ctx->fd, chunk_stream_on_close);
+    if (r < 0) {
+        if (ctx->error.empty())
+            chunk_stream_fail(ctx, r);
+        chunk_stream_finish(ctx);
+    }
+}
+
+/** JS thread: hand the filled block to `onChunk`, then schedule the next read. */
+void chunk_stream_deliver(qjs::JSEngine& e, ChunkStreamCtx* ctx, size_t n) {
+    JSContext* c = e.ctx();
+    uint8_t* block = ctx->block;
+    ctx->block = nullptr;
+    JSValue ab = JS_NewArrayBuffer(c, block, n, release_chunk, reinterpret_cast<void*>(static_cast<uintptr_t>(ctx->chunk_size)), 0);
+    if (JS_IsException(ab)) {
+        t_chunk_pool.release(block, ctx->chunk_size);
+        ctx->error = "failed to allocate chunk";
+        chunk_stream_close(ctx);
+        return;
+    }
+
+    JSValue args[2] = {ab, JS_NewInt64(c, ctx->offset)};
+    JSValue ret = JS_Call(c, ctx->on_chunk, JS_UNDEFINED, 2, args);
+    JS_FreeValue(c, args[0]);
+    JS_FreeValue(c, args[1]);
+    if (JS_IsException(ret)) {
+        JSValue exc = JS_GetException(c);
+        const char* msg = JS_ToCString(c, exc);
+        ctx->error = msg ? msg : "readChunks: callback threw";
+        if (msg)
+            JS_FreeCString(c, msg);
+        JS_FreeValue(c, exc);
+        chunk_stream_close(ctx);
+        return;
+    }
+    JS_FreeValue(c, ret);
+
+    ctx->offset += static_cast<int64_t>(n);
+    chunk_stream_read(ctx);
+}
+
+void chunk_stream_on_read(uv_fs_t* req) {
+    auto* ctx = static_cast<ChunkStreamCtx*>(req->data);
+    const ssize_t r = req->result;
+    uv_fs_req_cleanup(req);
+
+    if (r <= 0) {
+        t_chunk_pool.release(ctx->block, ctx->chunk_size);
+        ctx->block = nullptr;
+        if (r < 0)
+            chunk_stream_fail(ctx, r);
+        chunk_stream_close(ctx);
+        return;
+    }
+    qianjs::event_loop::defer([ctx, n = static_cast<size_t>(r)](qjs::JSEngine& e) { chunk_stream_deliver(e, ctx, n); });
+}
+
+void chunk_stream_read(ChunkStreamCtx* ctx) {
+    ctx->block = t_chunk_pool.acquire(ctx->chunk_size);
+    if (!ctx->block) {
+        ctx->error = "out of memory";
+        chunk_stream_close(ctx);
+        return;
+    }
+    uv_buf_t buf = uv_buf_init(reinterpret_cast<char*>(ctx->block), static_cast<unsigned>(ctx->chunk_size));
+    const int r = uv_fs_read(qianjs::event_loop::uv::loop(), &ctx->req, ctx->fd, &buf, 1, ctx->offset, chunk_stream_on_read);
+    if (r < 0) {
+        t_chunk_pool.release(ctx->block, ctx->chunk_size);
+        ctx->block = nullptr;
+        chunk_stream_fail(ctx, r);
+        chunk_stream_close(ctx);
+    }
+}
+
+void chunk_stream_on_open(uv_fs_t* req) {
+    auto* ctx = static_cast<ChunkStreamCtx*>(req->data);
+    const ssize_t r = req->result;
+    uv_fs_req_cleanup(req);
+    if (r < 0) {
+        chunk_stream_fail(ctx, r);
+        chunk_stream_finish(ctx);
+        return;
+    }
+    ctx->fd = static_cast<uv_file>(r);
+    chunk_stream_read(ctx);
+}
+
+} // namespace
+
+int fsParseOpenFlags(const std::string& flags) {
+    if (flags == "r")
+        return UV_FS_O_RDONLY;
+    if (flags == "r+")
+        return UV_FS_O_RDWR;
+    if (flags == "w")
+        return UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC;
+    if (flags == "w+")
+        return UV_FS_O_RDWR | UV_FS_O_CREAT | UV_FS_O_TRUNC;
+    if (flags == "a")
+        return UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_APPEND;
+    if (flags == "a+")
+        return UV_FS_O_RDWR | UV_FS_O_CREAT | UV_FS_O_APPEND;
+    return -1;
+}
+
+qjs::RawJSValue fsOpenAsync(qjs::JSEngine& engine, const FsPath& path, int flags) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
+
+    FdReqCtx* ctx = new_fd_req(ph);
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Open);
+    const int r = uv_fs_open(qianjs::event_loop::uv::loop(), &ctx->req, path.c_str(), flags, kCreateMode,
+        [](uv_fs_t* req) { settle_fd_req(req, false); });
+    if (r < 0)
+        fail_started(ctx, engine, r);
+    return engine.promiseValue(ph);
+}
+
+qjs::RawJSValue fsCloseAsync(qjs::JSEngine& engine, int fd) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
+
+    FdReqCtx* ctx = new_fd_req(ph);
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Close);
+    const int r = uv_fs_close(qianjs::event_loop::uv::loop(), &ctx->req, fd, [](uv_fs_t* req) { settle_fd_req(req, true); });
+    if (r < 0)
+        fail_started(ctx, engine, r);
+    return engine.promiseValue(ph);
+}
+
+qjs::RawJSValue fsReadIntoAsync(qjs::JSEngine& engine, int fd, JSValue target, size_t len, int64_t position) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
+
+    FdReqCtx* ctx = new_fd_req(ph);
+    ctx->block_len = std::min(len, kFsMaxIoRequest);
+    ctx->block = t_chunk_pool.acquire(ctx->block_len ? ctx->block_len : 1);
+    if (!ctx->block) {
+        delete ctx;
+        reject(ph, "out of memory");
+        return engine.promiseValue(ph);
+    }
+    ctx->pinned = JS_DupValue(engine.ctx(), target);
+    uv_buf_t buf = uv_buf_init(reinterpret_cast<char*>(ctx->block), static_cast<unsigned>(ctx->block_len));
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Read);
+    const int r = uv_fs_read(qianjs::event_loop::uv::loop(), &ctx->req, fd, &buf, 1, position, settle_read_into);
+    if (r < 0)
+        fail_started(ctx, engine, r);
+    return engine.promiseValue(ph);
+}
+
+qjs::RawJSValue fsWriteFromAsync(qjs::JSEngine& engine, int fd, FsBytesRef src, int64_t position) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr) {
+        fs_release_bytes_ref(engine.ctx(), src);
+        return engine.promiseValue(ph);
+    }
+
+    FdReqCtx* ctx = new_fd_req(ph);
+    ctx->src = std::move(src);
+    uv_buf_t buf = uv_buf_init(const_cast<char*>(reinterpret_cast<const char*>(ctx->src.data())),
+        static_cast<unsigned>(std::min(ctx->src.size(), kFsMaxIoRequest)));
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Write);
+    const int r = uv_fs_write(qianjs::event_loop::uv::loop(), &ctx->req, fd, &buf, 1, position,
+        [](uv_fs_t* req) { settle_fd_req(req, false); });
+    if (r < 0)
+        fail_started(ctx, engine, r);
+    return engine.promiseValue(ph);
+}
+
+qjs::RawJSValue fsReadChunksAsync(qjs::JSEngine& engine, const FsPath& path, JSValue onChunk, size_t chunkSize) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr)
+        return engine.promiseValue(ph);
+
+    auto* ctx = new ChunkStreamCtx();
+    ctx->ph = ph;
+    ctx->req.data = ctx;
+    ctx->on_chunk = JS_DupValue(engine.ctx(), onChunk);
+    ctx->chunk_size = chunkSize;
+
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::ReadChunks);
+    const int r = uv_fs_open(qianjs::event_loop::uv::loop(), &ctx->req, path.c_str(), UV_FS_O_RDONLY, 0, chunk_stream_on_open);
+    if (r < 0) {
+        chunk_stream_fail(ctx, r);
+        chunk_stream_finish(ctx);
+    }
+    return engine.promiseValue(ph);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "native/fs/fs_js_io.h"
+#include "native/fs/fs_path.h"
+
+#include <js_engine.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** `fs.open` flag strings (`r`, `r+`, `w`, `w+`, `a`, `a+`) to `UV_FS_O_*`; returns -1 for anything else. */
+int fsParseOpenFlags(const std::string& flags);
+
+qjs::RawJSValue fsOpenAsync(qjs::JSEngine& engine, const FsPath& path, int flags);
+
+qjs::RawJSValue fsCloseAsync(qjs::JSEngine& engine, int fd);
+
+/**
+ * Reads up to `min(len, kFsMaxIoRequest)` bytes into a native block, then copies them into `target` (ArrayBuffer /
+ * TypedArray of `len` bytes) on the JS thread; resolves with the count copied. Rejects if `target` was detached in
+ * the meantime, so transferring it while the read is pending cannot free memory the threadpool writes into.
+ */
+qjs::RawJSValue fsReadIntoAsync(qjs::JSEngine& engine, int fd, JSValue target, size_t len, int64_t position);
+
+/** Writes up to `kFsMaxIoRequest` bytes of `src` (pinned until settled); resolves with the count written. */
+qjs::RawJSValue fsWriteFromAsync(qjs::JSEngine& engine, int fd, FsBytesRef src, int64_t position);
+
+/**
+ * Reads `path` sequentially in `chunkSize` blocks and calls `onChunk(ArrayBuffer, offset)` for each on the JS thread.
+ * Chunks are pooled buffers adopted by the ArrayBuffer (no copy); the next read starts after `onChunk` returns, so at
+ * most one block is in flight. Resolves with the total number of bytes read.
+ */
+qjs::RawJSValue fsReadChunksAsync(qjs::JSEngine& engine, const FsPath& path, JSValue onChunk, size_t chunkSize);
+
+constexpr size_t kFsDefaultChunkSize = 64 * 1024;
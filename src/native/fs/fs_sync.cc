@@ -1,9 +1,12 @@
 #include "native/fs/fs_sync.h"
 
 #include "native/fs/fs_js_io.h"
+#include "native/fs/fs_mmap.h"
+#include "native/fs/fs_path.h"
 #include "native/fs/fs_stat_js.h"
 
 #include "runtime/event_loop/event_loop.h"
+#include "runtime/profiler/sampling_profiler.h"
 
 #include <js_module.h>
 #include <js_types.h>
@@ -55,6 +58,7 @@ JSValue throw_err(JSContext* c, const char* prefix, const std::error_code& ec) {
 
 void install_fs_sync(qjs::JSModule& sync) {
     sync.funcDynamic("readFile", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         std::string pathStr = qjs::JSConv<std::string>::from(c, argv[0], ok);
@@ -68,6 +72,7 @@ void install_fs_sync(qjs::JSModule& sync) {
     });
 
     sync.funcDynamic("readFileBytes", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         std::string pathStr = qjs::JSConv<std::string>::from(c, argv[0], ok);
@@ -81,25 +86,30 @@ void install_fs_sync(qjs::JSModule& sync) {
     });
 
     sync.funcDynamic("writeFile", 2, 2, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
         if (!ok)
             return JS_EXCEPTION;
-        std::vector<uint8_t> bytes;
-        if (!fs_read_js_bytes(c, argv[1], bytes))
+        FsBytesRef bytes;
+        if (!fs_js_bytes_ref(c, argv[1], bytes))
             return JS_ThrowTypeError(c, "writeFile: data must be string, ArrayBuffer, or TypedArray");
         std::ofstream out(path, std::ios::binary | std::ios::trunc);
-        if (!out)
-            return JS_ThrowTypeError(c, "writeFile: cannot open file for write");
-        if (!bytes.empty())
+        if (out && bytes.size())
             out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
-        if (!out)
+        const bool opened = out.is_open();
+        const bool written = static_cast<bool>(out);
+        fs_release_bytes_ref(c, bytes);
+        if (!opened)
+            return JS_ThrowTypeError(c, "writeFile: cannot open file for write");
+        if (!written)
             return JS_ThrowTypeError(c, "writeFile: write failed");
         return JS_UNDEFINED;
     });
 
     sync.funcDynamic("mkdir", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         const std::string pathStr = qjs::JSConv<std::string>::from(c, argv[0], ok);
@@ -113,6 +123,7 @@ void install_fs_sync(qjs::JSModule& sync) {
     });
 
     sync.funcDynamic("mkdirRecursive", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         const std::string pathStr = qjs::JSConv<std::string>::from(c, argv[0], ok);
@@ -126,6 +137,7 @@ void install_fs_sync(qjs::JSModule& sync) {
     });
 
     sync.funcDynamic("readdir", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         const std::string pathStr = qjs::JSConv<std::string>::from(c, argv[0], ok);
@@ -158,10 +170,10 @@ void install_fs_sync(qjs::JSModule& sync) {
     });
 
     sync.funcDynamic("stat", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
-        bool ok = false;
-        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
-        if (!ok)
+        FsPath path;
+        if (!path.from(c, argv[0], "stat"))
             return JS_EXCEPTION;
         uv_fs_t req;
         uv_loop_t* lp = qianjs::event_loop::uv::loop();
@@ -176,7 +188,33 @@ void install_fs_sync(qjs::JSModule& sync) {
         return o;
     });
 
+    sync.funcDynamic("statInto", 2, 2, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        (void)argc;
+        FsPath path;
+        if (!path.from(c, argv[0], "statInto"))
+            return JS_EXCEPTION;
+        double* out = nullptr;
+        size_t count = 0;
+        if (!fs_js_float64_view(c, argv[1], &out, &count))
+            return JS_ThrowTypeError(c, "statInto: target must be a Float64Array");
+        if (count < kFsStatFieldCount)
+            return JS_ThrowRangeError(c, "statInto: target needs at least %d elements", int(kFsStatFieldCount));
+        uv_fs_t req;
+        const int r = uv_fs_stat(qianjs::event_loop::uv::loop(), &req, path.c_str(), nullptr);
+        if (r >= 0)
+            fs_stat_pack(req.statbuf, out);
+        uv_fs_req_cleanup(&req);
+        // A missing entry is the common answer for watchers and build checks: report it without an exception.
+        if (r == UV_ENOENT || r == UV_ENOTDIR)
+            return JS_NewBool(c, false);
+        if (r < 0)
+            return JS_ThrowTypeError(c, "statInto: %s: %s", uv_err_name(r), uv_strerror(r));
+        return JS_NewBool(c, true);
+    });
+
     sync.funcDynamic("unlink", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         const std::string pathStr = qjs::JSConv<std::string>::from(c, argv[0], ok);
@@ -195,6 +233,7 @@ void install_fs_sync(qjs::JSModule& sync) {
     });
 
     sync.funcDynamic("rmdir", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
         (void)argc;
         bool ok = false;
         const std::string pathStr = qjs::JSConv<std::string>::from(c, argv[0], ok);
@@ -213,4 +252,6 @@ void install_fs_sync(qjs::JSModule& sync) {
             return throw_err(c, "rmdir: ", ec);
         return JS_UNDEFINED;
     });
+
+    sync.funcDynamic("mmap", 1, 2, fsMmapBinding);
 }
@@ -1,28 +1,25 @@
 #include "native/fs/fs_uv.h"
 
 #include "native/fs/fs_async_schedule.h"
+#include "native/fs/fs_js_io.h"
 
 #include "runtime/event_loop/event_loop.h"
 
 #include <uvw.hpp>
 
-#include <climits>
+#include <algorithm>
 #include <cstdint>
-#include <cstring>
+#include <cstdlib>
 #include <filesystem>
 #include <memory>
 #include <string>
 #include <utility>
-#include <vector>
 
 #include <sys/stat.h>
 
 namespace {
 
-using file_flags = uvw::file_req::file_open_flags;
 using qianjs::fs::schedule::reject;
-using qianjs::fs::schedule::resolve_bytes;
-using qianjs::fs::schedule::resolve_string;
 using qianjs::fs::schedule::resolve_void;
 
 static bool stat_is_dir(const uv_stat_t& st) {
@@ -33,204 +30,301 @@ static bool stat_is_dir(const uv_stat_t& st) {
 #endif
 }
 
-struct FsReadCtx {
+#ifdef _WIN32
+constexpr int kCreateMode = _S_IREAD | _S_IWRITE;
+#else
+constexpr int kCreateMode = 0644;
+#endif
+
+/**
+ * Whole-file transfer on raw `uv_fs_*` so the kernel reads into / writes from the final memory: reads fill a `malloc`
+ * block that becomes the ArrayBuffer storage, writes go straight from the pinned source buffer.
+ */
+struct FsFileCtx {
+    uv_fs_t req{};
     qjs::JSEngine::PromiseHandle ph{};
-    std::string buffer;
-    std::string fail_on_close;
-    std::shared_ptr<uvw::file_req> req_keep;
+    uv_file fd = -1;
+    uint8_t* data = nullptr;
+    size_t cap = 0;
+    size_t len = 0;
     bool as_buffer = false;
+    bool writing = false;
+    qianjs::event_loop::OpTimer op;
+    FsBytesRef src;
+    std::string error;
+    std::string error_code;
 };
 
-void defer_release_read_req(const std::shared_ptr<FsReadCtx>& ctx) {
-    qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
+void file_set_error(FsFileCtx* ctx, ssize_t r) {
+    if (!ctx->error.empty())
+        return;
+    ctx->error = std::string(uv_err_name(static_cast<int>(r))) + ": " + uv_strerror(static_cast<int>(r));
+    ctx->error_code = uv_err_name(static_cast<int>(r));
 }
 
-void read_done_fail(const std::shared_ptr<FsReadCtx>& ctx, std::string msg) {
-    qianjs::event_loop::end_operation();
-    reject(ctx->ph, std::move(msg));
-    defer_release_read_req(ctx);
+void free_file_data(JSRuntime*, void*, void* ptr) {
+    std::free(ptr);
 }
 
-void read_resolve_ok(const std::shared_ptr<FsReadCtx>& ctx) {
-    qianjs::event_loop::end_operation();
-    if (ctx->as_buffer)
-        resolve_bytes(ctx->ph, std::move(ctx->buffer));
-    else
-        resolve_string(ctx->ph, std::move(ctx->buffer));
-    defer_release_read_req(ctx);
+/** JS thread: resolve with the adopted block (bytes) or a decoded string, or reject; then drop the context. */
+void file_settle(FsFileCtx* ctx) {
+    qianjs::event_loop::end_operation(ctx->op);
+    qianjs::event_loop::defer([ctx](qjs::JSEngine& e) {
+        JSContext* c = e.ctx();
+        if (!ctx->error.empty()) {
+            e.rejectPromise(ctx->ph, ctx->error, ctx->error_code);
+        } else if (ctx->writing) {
+            e.resolvePromiseVoid(ctx->ph);
+        } else {
+            JSValue v = ctx->as_buffer ? JS_NewArrayBuffer(c, ctx->data, ctx->len, free_file_data, nullptr, 0)
+                                       : JS_NewStringLen(c, reinterpret_cast<const char*>(ctx->data), ctx->len);
+            if (ctx->as_buffer && !JS_IsException(v))
+                ctx->data = nullptr;
+            if (JS_IsException(v))
+                e.rejectPromise(ctx->ph, "failed to allocate result");
+            else
+                e.resolvePromiseJSValue(ctx->ph, v);
+        }
+        e.freePromise(ctx->ph);
+        std::free(ctx->data);
+        fs_release_bytes_ref(c, ctx->src);
+        delete ctx;
+    });
 }
 
-struct FsWriteCtx {
-    qjs::JSEngine::PromiseHandle ph{};
-    std::vector<uint8_t> data;
-    std::shared_ptr<uvw::file_req> req_keep;
-};
+void file_on_close(uv_fs_t* req) {
+    auto* ctx = static_cast<FsFileCtx*>(req->data);
+    if (req->result < 0)
+        file_set_error(ctx, req->result);
+    uv_fs_req_cleanup(req);
+    file_settle(ctx);
+}
 
-void defer_release_write_req(const std::shared_ptr<FsWriteCtx>& ctx) {
-    qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
+void file_close(FsFileCtx* ctx) {
+    const int r = uv_fs_close(qianjs::event_loop::uv::loop(), &ctx->req, ctx->fd, file_on_close);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_settle(ctx);
+    }
 }
 
-void write_done_fail(const std::shared_ptr<FsWriteCtx>& ctx, std::string msg) {
-    qianjs::event_loop::end_operation();
-    reject(ctx->ph, std::move(msg));
-    defer_release_write_req(ctx);
+void file_read_next(FsFileCtx* ctx);
+
+void file_on_read(uv_fs_t* req) {
+    auto* ctx = static_cast<FsFileCtx*>(req->data);
+    const ssize_t r = req->result;
+    uv_fs_req_cleanup(req);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_close(ctx);
+        return;
+    }
+    if (r == 0) {
+        file_close(ctx);
+        return;
+    }
+    ctx->len += static_cast<size_t>(r);
+    file_read_next(ctx);
 }
 
-} // namespace
+/** `cap` starts at `st_size + 1`, so the EOF probe lands in the spare byte; only files that grew pay a `realloc`. */
+void file_read_next(FsFileCtx* ctx) {
+    if (ctx->len == ctx->cap) {
+        const size_t grown = ctx->cap < 32768 ? 65536 : ctx->cap * 2;
+        auto* p = static_cast<uint8_t*>(std::realloc(ctx->data, grown));
+        if (!p) {
+            ctx->error = "out of memory";
+            file_close(ctx);
+            return;
+        }
+        ctx->data = p;
+        ctx->cap = grown;
+    }
+    const size_t want = std::min(ctx->cap - ctx->len, kFsMaxIoRequest);
+    uv_buf_t buf = uv_buf_init(reinterpret_cast<char*>(ctx->data + ctx->len), static_cast<unsigned>(want));
+    const int r = uv_fs_read(qianjs::event_loop::uv::loop(), &ctx->req, ctx->fd, &buf, 1,
+        static_cast<int64_t>(ctx->len), file_on_read);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_close(ctx);
+    }
+}
 
-qjs::RawJSValue fsReadFileAsync(qjs::JSEngine& engine, std::string path, bool asBuffer) {
-    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
-    if (!ph.ptr)
-        return engine.promiseValue(ph);
+void file_on_fstat(uv_fs_t* req) {
+    auto* ctx = static_cast<FsFileCtx*>(req->data);
+    const ssize_t r = req->result;
+    const uv_stat_t st = req->statbuf;
+    uv_fs_req_cleanup(req);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_close(ctx);
+        return;
+    }
+    if (stat_is_dir(st)) {
+        ctx->error = "EISDIR: illegal operation on a directory";
+        ctx->error_code = "EISDIR";
+        file_close(ctx);
+        return;
+    }
+    if (st.st_size >= static_cast<uint64_t>(SIZE_MAX)) {
+        ctx->error = "file too large";
+        file_close(ctx);
+        return;
+    }
+    ctx->cap = static_cast<size_t>(st.st_size) + 1;
+    ctx->data = static_cast<uint8_t*>(std::malloc(ctx->cap));
+    if (!ctx->data) {
+        ctx->cap = 0;
+        ctx->error = "out of memory";
+        file_close(ctx);
+        return;
+    }
+    file_read_next(ctx);
+}
 
-    auto ctx = std::make_shared<FsReadCtx>();
-    ctx->ph = ph;
-    ctx->as_buffer = asBuffer;
-    auto loop = qianjs::event_loop::uv::uvw_loop();
-    auto req = loop->resource<uvw::file_req>();
-    ctx->req_keep = req;
+void file_write_next(FsFileCtx* ctx);
 
-    using ft = uvw::file_req::fs_type;
-    const file_flags openFlags = file_flags::RDONLY;
+void file_on_write(uv_fs_t* req) {
+    auto* ctx = static_cast<FsFileCtx*>(req->data);
+    const ssize_t r = req->result;
+    uv_fs_req_cleanup(req);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_close(ctx);
+        return;
+    }
+    ctx->len += static_cast<size_t>(r);
+    if (ctx->len >= ctx->src.size())
+        file_close(ctx);
+    else
+        file_write_next(ctx);
+}
 
-    req->on<uvw::error_event>([ctx](const uvw::error_event& e, auto&) {
-        read_done_fail(ctx, e.what());
-    });
+/** Short writes resume at `len`; nothing is copied out of `src`. */
+void file_write_next(FsFileCtx* ctx) {
+    const size_t want = std::min(ctx->src.size() - ctx->len, kFsMaxIoRequest);
+    uv_buf_t buf = uv_buf_init(const_cast<char*>(reinterpret_cast<const char*>(ctx->src.data() + ctx->len)),
+        static_cast<unsigned>(want));
+    const int r = uv_fs_write(qianjs::event_loop::uv::loop(), &ctx->req, ctx->fd, &buf, 1,
+        static_cast<int64_t>(ctx->len), file_on_write);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_close(ctx);
+    }
+}
 
-    req->on<uvw::fs_event>([ctx](const uvw::fs_event& ev, uvw::file_req& r) {
-        switch (ev.type) {
-        case ft::OPEN:
-            r.stat();
-            break;
-        case ft::FSTAT: {
-            const uint64_t sz64 = static_cast<uint64_t>(ev.stat.st_size);
-            if (stat_is_dir(ev.stat)) {
-                ctx->fail_on_close = "EISDIR: illegal operation on a directory";
-                r.close();
-                break;
-            }
-            if (sz64 == 0) {
-                ctx->buffer.clear();
-                r.close();
-                break;
-            }
-            if (sz64 > static_cast<uint64_t>(SIZE_MAX)) {
-                read_done_fail(ctx, "file too large");
-                break;
-            }
-            const std::size_t sz = static_cast<std::size_t>(sz64);
-            if (sz > static_cast<std::size_t>(UINT_MAX)) {
-                read_done_fail(ctx, "file too large for single read");
-                break;
-            }
-            r.read(0, static_cast<unsigned>(sz));
-            break;
-        }
-        case ft::READ:
-            if (ev.result > 0 && ev.read.data)
-                ctx->buffer.assign(ev.read.data.get(), ev.read.data.get() + ev.result);
-            else
-                ctx->buffer.clear();
-            r.close();
-            break;
-        case ft::CLOSE:
-            if (!ctx->fail_on_close.empty()) {
-                auto m = std::move(ctx->fail_on_close);
-                read_done_fail(ctx, std::move(m));
-            } else {
-                read_resolve_ok(ctx);
-            }
-            break;
-        default:
-            break;
-        }
-    });
+void file_on_open(uv_fs_t* req) {
+    auto* ctx = static_cast<FsFileCtx*>(req->data);
+    const ssize_t r = req->result;
+    uv_fs_req_cleanup(req);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_settle(ctx);
+        return;
+    }
+    ctx->fd = static_cast<uv_file>(r);
+    if (ctx->writing) {
+        if (ctx->src.size() == 0)
+            file_close(ctx);
+        else
+            file_write_next(ctx);
+        return;
+    }
+    const int sr = uv_fs_fstat(qianjs::event_loop::uv::loop(), &ctx->req, ctx->fd, file_on_fstat);
+    if (sr < 0) {
+        file_set_error(ctx, sr);
+        file_close(ctx);
+    }
+}
 
-    qianjs::event_loop::begin_operation();
-    req->open(path, openFlags, 0);
-    return engine.promiseValue(ph);
+qjs::RawJSValue file_start(qjs::JSEngine& engine, FsFileCtx* ctx, const char* path, int flags) {
+    qjs::RawJSValue pv = engine.promiseValue(ctx->ph);
+    ctx->req.data = ctx;
+    ctx->op = qianjs::event_loop::begin_operation(ctx->writing ? qianjs::event_loop::OpKind::WriteFile
+                                                                : qianjs::event_loop::OpKind::ReadFile);
+    const int r = uv_fs_open(qianjs::event_loop::uv::loop(), &ctx->req, path, flags, kCreateMode, file_on_open);
+    if (r < 0) {
+        file_set_error(ctx, r);
+        file_settle(ctx);
+    }
+    return pv;
 }
 
-static qjs::RawJSValue write_file_impl(qjs::JSEngine& engine, std::string path, std::vector<uint8_t> data, file_flags flags,
-    int mode) {
+} // namespace
+
+qjs::RawJSValue fsReadFileAsync(qjs::JSEngine& engine, const FsPath& path, bool asBuffer) {
     qjs::JSEngine::PromiseHandle ph = engine.createPromise();
     if (!ph.ptr)
         return engine.promiseValue(ph);
 
-    auto ctx = std::make_shared<FsWriteCtx>();
+    auto* ctx = new FsFileCtx();
     ctx->ph = ph;
-    ctx->data = std::move(data);
-    auto loop = qianjs::event_loop::uv::uvw_loop();
-    auto req = loop->resource<uvw::file_req>();
-    ctx->req_keep = req;
-
-    using ft = uvw::file_req::fs_type;
-
-    req->on<uvw::error_event>([ctx](const uvw::error_event& e, auto&) {
-        write_done_fail(ctx, e.what());
-    });
-
-    req->on<uvw::fs_event>([ctx](const uvw::fs_event& ev, uvw::file_req& r) {
-        switch (ev.type) {
-        case ft::OPEN: {
-            const unsigned len = static_cast<unsigned>(ctx->data.size());
-            if (len == 0) {
-                auto buf = std::make_unique<char[]>(1);
-                r.write(std::move(buf), 0, 0);
-            } else {
-                auto buf = std::make_unique<char[]>(ctx->data.size());
-                std::memcpy(buf.get(), ctx->data.data(), ctx->data.size());
-                r.write(std::move(buf), len, 0);
-            }
-            break;
-        }
-        case ft::WRITE:
-            r.close();
-            break;
-        case ft::CLOSE:
-            qianjs::event_loop::end_operation();
-            resolve_void(ctx->ph);
-            defer_release_write_req(ctx);
-            break;
-        default:
-            break;
-        }
-    });
-
-    qianjs::event_loop::begin_operation();
-    req->open(path, flags, mode);
-    return engine.promiseValue(ph);
+    ctx->as_buffer = asBuffer;
+    return file_start(engine, ctx, path.c_str(), UV_FS_O_RDONLY);
 }
 
-qjs::RawJSValue fsWriteFileAsync(qjs::JSEngine& engine, std::string path, std::vector<uint8_t> data) {
-    const file_flags flags = file_flags::WRONLY | file_flags::CREAT | file_flags::TRUNC;
-#ifdef _WIN32
-    const int mode = _S_IREAD | _S_IWRITE;
-#else
-    const int mode = 0644;
-#endif
-    return write_file_impl(engine, std::move(path), std::move(data), flags, mode);
+qjs::RawJSValue fsWriteFileAsync(qjs::JSEngine& engine, const FsPath& path, FsBytesRef data) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr) {
+        fs_release_bytes_ref(engine.ctx(), data);
+        return engine.promiseValue(ph);
+    }
+
+    auto* ctx = new FsFileCtx();
+    ctx->ph = ph;
+    ctx->writing = true;
+    ctx->src = std::move(data);
+    return file_start(engine, ctx, path.c_str(), UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC);
 }
 
-qjs::RawJSValue fsMkdirAsync(qjs::JSEngine& engine, std::string path, bool recursive) {
+qjs::RawJSValue fsMkdirAsync(qjs::JSEngine& engine, const FsPath& path, bool recursive) {
     qjs::JSEngine::PromiseHandle ph = engine.createPromise();
     if (!ph.ptr)
         return engine.promiseValue(ph);
 
     if (recursive) {
-        std::error_code ec;
-        std::filesystem::create_directories(std::filesystem::path(path), ec);
-        if (ec) {
-            reject(ph, ec.message());
-            return engine.promiseValue(ph);
+        /** `create_directories` stats and creates each missing level; run it on the threadpool, not the JS thread. */
+        struct MkdirWork {
+            uv_work_t work{};
+            qjs::JSEngine::PromiseHandle ph{};
+            std::string path;
+            std::error_code ec;
+            qianjs::event_loop::OpTimer op;
+        };
+        auto* w = new MkdirWork();
+        w->ph = ph;
+        w->path = path.str();
+        w->work.data = w;
+        w->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Mkdir);
+        const int r = uv_queue_work(
+            qianjs::event_loop::uv::loop(), &w->work,
+            [](uv_work_t* req) {
+                auto* w = static_cast<MkdirWork*>(req->data);
+                std::filesystem::create_directories(std::filesystem::path(w->path), w->ec);
+            },
+            [](uv_work_t* req, int status) {
+                auto* w = static_cast<MkdirWork*>(req->data);
+                qianjs::event_loop::end_operation(w->op);
+                if (status < 0)
+                    reject(w->ph, uv_strerror(status), uv_err_name(status));
+                else if (w->ec)
+                    reject(w->ph, w->ec.message());
+                else
+                    resolve_void(w->ph);
+                delete w;
+            });
+        if (r < 0) {
+            qianjs::event_loop::end_operation(w->op);
+            reject(ph, uv_strerror(r), uv_err_name(r));
+            delete w;
         }
-        resolve_void(ph);
         return engine.promiseValue(ph);
     }
 
     struct MkdirAsyncCtx {
         qjs::JSEngine::PromiseHandle ph{};
         std::shared_ptr<uvw::fs_req> req_keep;
+        qianjs::event_loop::OpTimer op;
     };
     auto ctx = std::make_shared<MkdirAsyncCtx>();
     ctx->ph = ph;
@@ -241,20 +335,20 @@ qjs::RawJSValue fsMkdirAsync(qjs::JSEngine& engine, std::string path, bool recur
     using ft = uvw::fs_req::fs_type;
 
     req->on<uvw::error_event>([ctx](const uvw::error_event& e, auto&) {
-        qianjs::event_loop::end_operation();
+        qianjs::event_loop::end_operation(ctx->op);
         reject(ctx->ph, e.what());
         qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
     });
 
     req->on<uvw::fs_event>([ctx](const uvw::fs_event& ev, uvw::fs_req&) {
         if (ev.type == ft::MKDIR) {
-            qianjs::event_loop::end_operation();
+            qianjs::event_loop::end_operation(ctx->op);
             resolve_void(ctx->ph);
             qianjs::event_loop::defer([ctx](qjs::JSEngine&) { ctx->req_keep.reset(); });
         }
     });
 
-    qianjs::event_loop::begin_operation();
-    req->mkdir(path, 0777);
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Mkdir);
+    req->mkdir(path.str(), 0777);
     return engine.promiseValue(ph);
 }
@@ -1,20 +1,24 @@
 #pragma once
 
+#include "native/fs/fs_js_io.h"
+#include "native/fs/fs_path.h"
+
 #include <js_engine.h>
 
-#include <string>
-#include <vector>
+qjs::RawJSValue fsReadFileAsync(qjs::JSEngine& engine, const FsPath& path, bool asBuffer);
 
-qjs::RawJSValue fsReadFileAsync(qjs::JSEngine& engine, std::string path, bool asBuffer);
+/** `data` is written in place (not copied) and released on the JS thread once the request settles. */
+qjs::RawJSValue fsWriteFileAsync(qjs::JSEngine& engine, const FsPath& path, FsBytesRef data);
 
-qjs::RawJSValue fsWriteFileAsync(qjs::JSEngine& engine, std::string path, std::vector<uint8_t> data);
+qjs::RawJSValue fsMkdirAsync(qjs::JSEngine& engine, const FsPath& path, bool recursive);
 
-qjs::RawJSValue fsMkdirAsync(qjs::JSEngine& engine, std::string path, bool recursive);
+qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, const FsPath& path);
 
-qjs::RawJSValue fsReaddirAsync(qjs::JSEngine& engine, std::string path);
+qjs::RawJSValue fsStatAsync(qjs::JSEngine& engine, const FsPath& path);
 
-qjs::RawJSValue fsStatAsync(qjs::JSEngine& engine, std::string path);
+/** Packs the result into `target` (`Float64Array`, at least `kFsStatFieldCount` long, held until settled). */
+qjs::RawJSValue fsStatIntoAsync(qjs::JSEngine& engine, const FsPath& path, JSValue target);
 
-qjs::RawJSValue fsUnlinkAsync(qjs::JSEngine& engine, std::string path);
+qjs::RawJSValue fsUnlinkAsync(qjs::JSEngine& engine, const FsPath& path);
 
-qjs::RawJSValue fsRmdirAsync(qjs::JSEngine& engine, std::string path);
+qjs::RawJSValue fsRmdirAsync(qjs::JSEngine& engine, const FsPath& path);
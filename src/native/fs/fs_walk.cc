@@ -0,0 +1,342 @@
+#include "native/fs/fs_walk.h"
+
+#include "runtime/event_loop/event_loop.h"
+
+#include <uv.h>
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace {
+
+/** Upper bound on entries per `onBatch` call, so one huge directory does not build one huge array. */
+constexpr size_t kWalkBatchEntries = 1024;
+
+const char* dirent_type_name(uv_dirent_type_t t) {
+    switch (t) {
+    case UV_DIRENT_FILE:
+        return "file";
+    case UV_DIRENT_DIR:
+        return "dir";
+    case UV_DIRENT_LINK:
+        return "symlink";
+    case UV_DIRENT_FIFO:
+        return "fifo";
+    case UV_DIRENT_SOCKET:
+        return "socket";
+    case UV_DIRENT_CHAR:
+        return "char";
+    case UV_DIRENT_BLOCK:
+        return "block";
+    default:
+        return "unknown";
+    }
+}
+
+uv_dirent_type_t type_from_mode(uint64_t mode) {
+#ifdef _WIN32
+    if ((mode & _S_IFMT) == _S_IFDIR)
+        return UV_DIRENT_DIR;
+    if ((mode & _S_IFMT) == _S_IFREG)
+        return UV_DIRENT_FILE;
+#else
+    if (S_ISDIR(mode))
+        return UV_DIRENT_DIR;
+    if (S_ISREG(mode))
+        return UV_DIRENT_FILE;
+    if (S_ISLNK(mode))
+        return UV_DIRENT_LINK;
+    if (S_ISFIFO(mode))
+        return UV_DIRENT_FIFO;
+    if (S_ISSOCK(mode))
+        return UV_DIRENT_SOCKET;
+    if (S_ISCHR(mode))
+        return UV_DIRENT_CHAR;
+    if (S_ISBLK(mode))
+        return UV_DIRENT_BLOCK;
+#endif
+    return UV_DIRENT_UNKNOWN;
+}
+
+std::string join_path(const std::string& dir, const char* name) {
+    std::string out = dir;
+    if (!out.empty() && out.back() != '/'
+#ifdef _WIN32
+        && out.back() != '\\'
+#endif
+    )
+        out += '/';
+    out += name;
+    return out;
+}
+
+struct WalkEntry {
+    std::string path;
+    uv_dirent_type_t type = UV_DIRENT_UNKNOWN;
+};
+
+struct WalkCtx;
+
+/** One directory scan; runs the blocking scandir (and unknown-type lstats) on a threadpool thread. */
+struct DirScan {
+    uv_work_t work{};
+    WalkCtx* walk = nullptr;
+    std::string dir;
+    int64_t depth = 0;
+    int err = 0;
+    std::vector<WalkEntry> entries;
+};
+
+struct WalkCtx {
+    qjs::JSEngine::PromiseHandle ph{};
+    JSValue on_batch = JS_UNDEFINED;
+    FsWalkOptions opts;
+    std::deque<DirScan*> queued;
+    std::vector<DirScan*> ready;
+    size_t in_flight = 0;
+    bool deliver_scheduled = false;
+    int64_t delivered = 0;
+    std::string error;
+    std::string error_code;
+    qianjs::event_loop::OpTimer op;
+};
+
+void walk_pump(WalkCtx* ctx);
+
+void scan_work(uv_work_t* w) {
+    auto* scan = static_cast<DirScan*>(w->data);
+    uv_fs_t req;
+    const int r = uv_fs_scandir(nullptr, &req, scan->dir.c_str(), 0, nullptr);
+    if (r < 0) {
+        scan->err = r;
+        uv_fs_req_cleanup(&req);
+        return;
+    }
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF)
+        scan->entries.push_back({join_path(scan->dir, ent.name), ent.type});
+    uv_fs_req_cleanup(&req);
+
+    for (WalkEntry& e : scan->entries) {
+        if (e.type != UV_DIRENT_UNKNOWN)
+            continue;
+        uv_fs_t st;
+        if (uv_fs_lstat(nullptr, &st, e.path.c_str(), nullptr) == 0)
+            e.type = type_from_mode(st.statbuf.st_mode);
+        uv_fs_req_cleanup(&st);
+    }
+}
+
+void walk_finish(qjs::JSEngine& e, WalkCtx* ctx) {
+    if (ctx->error.empty())
+        e.resolvePromiseJSValue(ctx->ph, JS_NewInt64(e.ctx(), ctx->delivered));
+    else
+        e.rejectPromise(ctx->ph, ctx->error, ctx->error_code);
+    e.freePromise(ctx->ph);
+    JS_FreeValue(e.ctx(), ctx->on_batch);
+    JS_FreeValue(e.ctx(), ctx->opts.filter);
+    delete ctx;
+}
+
+/** Records the first JS exception as the walk's rejection; queued scans are dropped, running ones drain. */
+void walk_abort(JSContext* c, WalkCtx* ctx) {
+    JSValue exc = JS_GetException(c);
+    const char* msg = JS_ToCString(c, exc);
+    ctx->error = msg ? msg : "walk: callback threw";
+    if (msg)
+        JS_FreeCString(c, msg);
+    JS_FreeValue(c, exc);
+    for (DirScan* s : ctx->queued)
+        delete s;
+    ctx->queued.clear();
+}
+
+bool flush_batch(JSContext* c, WalkCtx* ctx, JSValue& batch, uint32_t& n) {
+    if (n == 0)
+        return true;
+    JSValue ret = JS_Call(c, ctx->on_batch, JS_UNDEFINED, 1, &batch);
+    JS_FreeValue(c, batch);
+    batch = JS_UNDEFINED;
+    ctx->delivered += n;
+    n = 0;
+    if (JS_IsException(ret))
+        return false;
+    JS_FreeValue(c, ret);
+    return true;
+}
+
+/** JS thread: filter finished scans, hand entries to `onBatch`, and queue subdirectories still within `maxDepth`. */
+void walk_deliver(qjs::JSEngine& e, WalkCtx* ctx) {
+    JSContext* c = e.ctx();
+    ctx->deliver_scheduled = false;
+    std::vector<DirScan*> ready;
+    ready.swap(ctx->ready);
+
+    JSValue batch = JS_UNDEFINED;
+    uint32_t n = 0;
+    for (DirScan* scan : ready) {
+        if (!ctx->error.empty()) {
+            delete scan;
+            continue;
+        }
+        if (scan->err < 0) {
+            /** Only the root is fatal; subdirectories removed or unreadable mid-walk are skipped. */
+            if (scan->depth == 0) {
+                ctx->error = std::string(uv_err_name(scan->err)) + ": " + uv_strerror(scan->err) + ", scandir '" +
+                    scan->dir + "'";
+                ctx->error_code = uv_err_name(scan->err);
+            }
+            delete scan;
+            continue;
+        }
+        const int64_t depth = scan->depth + 1;
+        for (WalkEntry& ent : scan->entries) {
+            const char* type = dirent_type_name(ent.type);
+            if (!JS_IsUndefined(ctx->opts.filter)) {
+                JSValue args[2] = {JS_NewStringLen(c, ent.path.data(), ent.path.size()), JS_NewString(c, type)};
+                JSValue keep = JS_Call(c, ctx->opts.filter, JS_UNDEFINED, 2, args);
+                JS_FreeValue(c, args[0]);
+                JS_FreeValue(c, args[1]);
+                if (JS_IsException(keep)) {
+                    walk_abort(c, ctx);
+                    break;
+                }
+                const bool kept = JS_ToBool(c, keep);
+                JS_FreeValue(c, keep);
+                if (!kept)
+                    continue;
+            }
+            if (JS_IsUndefined(batch))
+                batch = JS_NewArray(c);
+            JSValue o = JS_NewObject(c);
+            JS_SetPropertyStr(c, o, "path", JS_NewStringLen(c, ent.path.data(), ent.path.size()));
+            JS_SetPropertyStr(c, o, "type", JS_NewString(c, type));
+            JS_SetPropertyUint32(c, batch, n++, o);
+            if (n == kWalkBatchEntries && !flush_batch(c, ctx, batch, n)) {
+                walk_abort(c, ctx);
+                break;
+            }
+            if (ent.type == UV_DIRENT_DIR && depth < ctx->opts.max_depth) {
+                auto* sub = new DirScan();
+                sub->walk = ctx;
+                sub->dir = std::move(ent.path);
+                sub->depth = depth;
+                ctx->queued.push_back(sub);
+            }
+        }
+        delete scan;
+    }
+    if (ctx->error.empty() && !flush_batch(c, ctx, batch, n))
+        walk_abort(c, ctx);
+    JS_FreeValue(c, batch);
+    walk_pump(ctx);
+}
+
+void scan_done(uv_work_t* w, int status) {
+    auto* scan = static_cast<DirScan*>(w->data);
+    WalkCtx* ctx = scan->walk;
+    if (status < 0 && scan->err == 0)
+        scan->err = status;
+    ctx->in_flight--;
+    ctx->ready.push_back(scan);
+    if (!ctx->deliver_scheduled) {
+        ctx->deliver_scheduled = true;
+        qianjs::event_loop::defer([ctx](qjs::JSEngine& e) { walk_deliver(e, ctx); });
+    }
+}
+
+/** Keeps up to `concurrency` scans running; settles once nothing is queued, running, or awaiting delivery. */
+void walk_pump(WalkCtx* ctx) {
+    while (ctx->in_flight < ctx->opts.concurrency && !ctx->queued.empty()) {
+        DirScan* scan = ctx->queued.front();
+        ctx->queued.pop_front();
+        scan->work.data = scan;
+        const int r = uv_queue_work(qianjs::event_loop::uv::loop(), &scan->work, scan_work, scan_done);
+        if (r < 0) {
+            if (scan->depth == 0 && ctx->error.empty()) {
+                ctx->error = std::string(uv_err_name(r)) + ": " + uv_strerror(r);
+                ctx->error_code = uv_err_name(r);
+            }
+            delete scan;
+            continue;
+        }
+        ctx->in_flight++;
+    }
+    if (ctx->in_flight == 0 && ctx->queued.empty() && !ctx->deliver_scheduled) {
+        qianjs::event_loop::end_operation(ctx->op);
+        qianjs::event_loop::defer([ctx](qjs::JSEngine& e) { walk_finish(e, ctx); });
+    }
+}
+
+} // namespace
+
+bool fsParseWalkOptions(JSContext* c, int argc, JSValue* argv, int index, FsWalkOptions& out) {
+    if (argc <= index || JS_IsUndefined(argv[index]))
+        return true;
+    JSValue o = argv[index];
+
+    JSValue v = JS_GetPropertyStr(c, o, "maxDepth");
+    if (!JS_IsUndefined(v)) {
+        double d = 0;
+        const int r = JS_ToFloat64(c, &d, v);
+        JS_FreeValue(c, v);
+        if (r)
+            return false;
+        if (!(d >= 1)) {
+            JS_ThrowRangeError(c, "walk: maxDepth must be >= 1");
+            return false;
+        }
+        out.max_depth = d >= 9.2e18 ? INT64_MAX : static_cast<int64_t>(d);
+    }
+
+    v = JS_GetPropertyStr(c, o, "concurrency");
+    if (!JS_IsUndefined(v)) {
+        int64_t n = 0;
+        const int r = JS_ToInt64(c, &n, v);
+        JS_FreeValue(c, v);
+        if (r)
+            return false;
+        if (n < 1 || n > 256) {
+            JS_ThrowRangeError(c, "walk: concurrency must be between 1 and 256");
+            return false;
+        }
+        out.concurrency = static_cast<size_t>(n);
+    }
+
+    v = JS_GetPropertyStr(c, o, "filter");
+    if (!JS_IsUndefined(v)) {
+        if (!JS_IsFunction(c, v)) {
+            JS_FreeValue(c, v);
+            JS_ThrowTypeError(c, "walk: filter must be a function");
+            return false;
+        }
+        out.filter = v;
+    }
+    return true;
+}
+
+qjs::RawJSValue fsWalkAsync(qjs::JSEngine& engine, std::string root, JSValue onBatch, FsWalkOptions options) {
+    qjs::JSEngine::PromiseHandle ph = engine.createPromise();
+    if (!ph.ptr) {
+        JS_FreeValue(engine.ctx(), options.filter);
+        return engine.promiseValue(ph);
+    }
+
+    auto* ctx = new WalkCtx();
+    ctx->ph = ph;
+    ctx->on_batch = JS_DupValue(engine.ctx(), onBatch);
+    ctx->opts = options;
+
+    auto* scan = new DirScan();
+    scan->walk = ctx;
+    scan->dir = std::move(root);
+    ctx->queued.push_back(scan);
+
+    ctx->op = qianjs::event_loop::begin_operation(qianjs::event_loop::OpKind::Walk);
+    walk_pump(ctx);
+    return engine.promiseValue(ph);
+}
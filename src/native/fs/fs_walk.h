@@ -0,0 +1,27 @@
+#pragma once
+
+#include <js_engine.h>
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <cstdint>
+
+struct FsWalkOptions {
+    /** Deepest level reported; root's children are depth 1. */
+    int64_t max_depth = INT64_MAX;
+    /** Directories scanned concurrently on the threadpool. */
+    size_t concurrency = 8;
+    /** Optional `filter(path, type)`; `false` drops the entry and, for directories, its subtree. */
+    JSValue filter = JS_UNDEFINED;
+};
+
+/** Reads `{ maxDepth, concurrency, filter }` from `argv[index]`; false with an exception set. */
+bool fsParseWalkOptions(JSContext* c, int argc, JSValue* argv, int index, FsWalkOptions& out);
+
+/**
+ * Walks `root` breadth-first with one `uv_fs_scandir` work item per directory, typing entries from the dirent (no
+ * per-entry stat; `lstat` only when the filesystem reports `unknown`). Symlinks are reported, not followed. Entries
+ * reach JS as arrays of `{ path, type }` passed to `onBatch`; resolves with the number of entries delivered.
+ */
+qjs::RawJSValue fsWalkAsync(qjs::JSEngine& engine, std::string root, JSValue onBatch, FsWalkOptions options);
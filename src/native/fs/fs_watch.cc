@@ -0,0 +1,361 @@
+#include "native/fs/fs_watch.h"
+
+#include "native/fs/fs_path.h"
+
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/output/std_output.h"
+#include "runtime/profiler/sampling_profiler.h"
+
+#include <js_engine.h>
+#include <js_module.h>
+
+#include <uv.h>
+#include <uvw.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+namespace stdfs = std::filesystem;
+
+constexpr int64_t kDefaultDebounceMs = 10;
+constexpr int64_t kMaxDebounceMs = 60000;
+
+#if defined(__APPLE__) || defined(_WIN32)
+/** FSEvents and ReadDirectoryChangesW watch a tree with one handle. */
+constexpr bool kNativeRecursive = true;
+#else
+/** inotify watches one directory per handle; recursion is emulated with a handle per subdirectory. */
+constexpr bool kNativeRecursive = false;
+#endif
+
+/** One `fs.watch` call: its handles (keyed by directory), paths changed since the last flush, and the flush timer. */
+struct Watcher {
+    std::string root;
+    bool root_is_dir = false;
+    bool recursive = false;
+    uint64_t debounce_ms = 0;
+    JSValue callback = JS_UNDEFINED;
+    std::unordered_map<std::string, std::shared_ptr<uvw::fs_event_handle>> handles;
+    std::shared_ptr<uvw::timer_handle> flush;
+    bool armed = false;
+    /** Path → `UV_RENAME | UV_CHANGE` bits, plus first-seen order so batches follow event order. */
+    std::unordered_map<std::string, int> pending;
+    std::vector<std::string> order;
+    /** Emulated recursion: paths renamed in this window, rescanned once on the threadpool when it is flushed. */
+    std::vector<std::string> renamed;
+};
+
+std::string join_path(const std::string& dir, const char* name) {
+    std::string out = dir;
+    if (!out.empty() && out.back() != '/' && out.back() != '\\')
+        out += '/';
+    out += name;
+    return out;
+}
+
+/** Every directory below `dir`; symlinks are not followed, unreadable subtrees are skipped. */
+void list_subdirs(const std::string& dir, std::vector<std::string>& out) {
+    std::error_code ec;
+    stdfs::recursive_directory_iterator it(dir, stdfs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != stdfs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_directory(ec) && !it->is_symlink(ec))
+            out.push_back(it->path().string());
+    }
+}
+
+/** `path` itself or anything below it. */
+bool within(const std::string& path, const std::string& dir) {
+    return path.compare(0, dir.size(), dir) == 0 &&
+        (path.size() == dir.size() || path[dir.size()] == '/' || path[dir.size()] == '\\');
+}
+
+void close_handles(Watcher& w) {
+    for (auto& [dir, h] : w.handles) {
+        h->stop();
+        h->close();
+    }
+    w.handles.clear();
+    w.flush->stop();
+    w.flush->close();
+}
+
+/** Per-engine watcher table bound to the engine's loop, shaped like the timers table. */
+class WatchState {
+public:
+    explicit WatchState(qjs::JSEngine& engine)
+        : engine_(engine),
+          rt_(JS_GetRuntime(engine.ctx())),
+          loop_(qianjs::event_loop::EventLoop::of(engine)),
+          alive_(std::make_shared<bool>(true)) {}
+
+    /** Engine teardown with watchers still open: close their handles, drop the callbacks and op counts. */
+    ~WatchState() {
+        *alive_ = false;
+        for (auto& [id, w] : watchers_) {
+            close_handles(*w);
+            JS_FreeValueRT(rt_, w->callback);
+            loop_.end_operation();
+        }
+    }
+
+    /** New watcher id, or `JS_EXCEPTION` with a TypeError when the path cannot be watched. */
+    JSValue watch(JSContext* c, std::string path, JSValue fn, bool recursive, uint64_t debounce_ms) {
+        const int64_t id = next_id_;
+        auto w = std::make_unique<Watcher>();
+        w->root = std::move(path);
+        std::error_code ec;
+        w->root_is_dir = stdfs::is_directory(w->root, ec);
+        w->recursive = recursive && w->root_is_dir;
+        w->debounce_ms = debounce_ms;
+
+        const int r = add_dir(id, *w, w->root);
+        if (r < 0)
+            return JS_ThrowTypeError(c, "watch: %s: %s", uv_err_name(r), uv_strerror(r));
+        if (w->recursive && !kNativeRecursive) {
+            std::vector<std::string> subdirs;
+            list_subdirs(w->root, subdirs);
+            for (const std::string& dir : subdirs)
+                add_dir(id, *w, dir);
+        }
+
+        w->flush = loop_.uvw_loop()->resource<uvw::timer_handle>();
+        w->flush->on<uvw::timer_event>([this, id](const uvw::timer_event&, uvw::timer_handle&) { flush(id); });
+        w->callback = JS_DupValue(c, fn);
+
+        watchers_.emplace(id, std::move(w));
+        next_id_++;
+        loop_.begin_operation();
+        return JS_NewInt64(c, id);
+    }
+
+    void unwatch(int64_t id) {
+        auto it = watchers_.find(id);
+        if (it == watchers_.end())
+            return;
+        close_handles(*it->second);
+        JS_FreeValue(engine_.ctx(), it->second->callback);
+        watchers_.erase(it);
+        loop_.end_operation();
+    }
+
+private:
+    /** Threadpool rescan of the paths one flush saw renamed; settles on the loop thread unless the state is gone. */
+    struct Rescan {
+        uv_work_t work{};
+        std::shared_ptr<bool> alive;
+        WatchState* state = nullptr;
+        int64_t id = 0;
+        std::vector<std::string> paths;
+        /** Per path: the path and every directory below it, or empty when it is no longer a directory. */
+        std::vector<std::vector<std::string>> dirs;
+    };
+
+    int add_dir(int64_t id, Watcher& w, const std::string& dir) {
+        if (w.handles.count(dir))
+            return 0;
+        auto h = loop_.uvw_loop()->resource<uvw::fs_event_handle>();
+        h->on<uvw::fs_event_event>([this, id, dir](const uvw::fs_event_event& ev, uvw::fs_event_handle&) {
+            on_event(id, dir, ev.filename, static_cast<int>(ev.flags));
+        });
+        const int r = w.recursive && kNativeRecursive ? h->start(dir, uvw::fs_event_handle::event_flags::RECURSIVE)
+                                                       : h->start(dir);
+        if (r < 0) {
+            h->close();
+            return r;
+        }
+        w.handles.emplace(dir, std::move(h));
+        return 0;
+    }
+
+    void on_event(int64_t id, const std::string& dir, const char* filename, int flags) {
+        auto it = watchers_.find(id);
+        if (it == watchers_.end())
+            return;
+        Watcher& w = *it->second;
+
+        const std::string path = !w.root_is_dir || !filename || !*filename ? dir : join_path(dir, filename);
+        const int bits = flags & (UV_RENAME | UV_CHANGE);
+        auto [entry, inserted] = w.pending.try_emplace(path, 0);
+        if (inserted)
+            w.order.push_back(path);
+        // A rename is a create, a delete or a move; the emulated tree follows it when the window is flushed.
+        if (w.recursive && !kNativeRecursive && (bits & UV_RENAME) && !(entry->second & UV_RENAME))
+            w.renamed.push_back(path);
+        entry->second |= bits;
+
+        if (!w.armed) {
+            w.armed = true;
+            w.flush->start(uvw::timer_handle::time{w.debounce_ms}, uvw::timer_handle::time{0});
+        }
+    }
+
+    void flush(int64_t id) {
+        auto it = watchers_.find(id);
+        if (it == watchers_.end())
+            return;
+        Watcher& w = *it->second;
+        w.armed = false;
+        if (!w.renamed.empty())
+            rescan(id, w);
+        if (w.order.empty())
+            return;
+
+        JSContext* c = engine_.ctx();
+        JSValue batch = JS_NewArray(c);
+        uint32_t n = 0;
+        for (const std::string& path : w.order) {
+            // A path both renamed and changed in one window is reported once, as the rename.
+            const char* type = (w.pending[path] & UV_RENAME) ? "rename" : "change";
+            JSValue o = JS_NewObject(c);
+            JS_SetPropertyStr(c, o, "path", JS_NewStringLen(c, path.data(), path.size()));
+            JS_SetPropertyStr(c, o, "type", JS_NewString(c, type));
+            JS_SetPropertyUint32(c, batch, n++, o);
+        }
+        w.order.clear();
+        w.pending.clear();
+
+        // The callback may `unwatch` itself; keep the function alive and do not touch `w` after the call.
+        JSValue fn = JS_DupValue(c, w.callback);
+        const qianjs::profiler::TaskFrame task("fs");
+        JSValue ret = JS_Call(c, fn, JS_UNDEFINED, 1, &batch);
+        if (JS_IsException(ret)) {
+            JSValue exc = JS_GetException(c);
+            const char* msg = JS_ToCString(c, exc);
+            if (msg) {
+                qianjs::output::report(std::string("fs.watch callback exception: ") + msg + "\n");
+                JS_FreeCString(c, msg);
+            } else {
+                qianjs::output::report("fs.watch callback exception\n");
+            }
+            JS_FreeValue(c, exc);
+        } else {
+            JS_FreeValue(c, ret);
+        }
+        JS_FreeValue(c, batch);
+        JS_FreeValue(c, fn);
+    }
+
+    /** Stats only the renamed paths and walks only their subtrees, off the JS thread; see `apply_rescan`. */
+    void rescan(int64_t id, Watcher& w) {
+        auto* job = new Rescan();
+        job->alive = alive_;
+        job->state = this;
+        job->id = id;
+        job->paths.swap(w.renamed);
+        job->work.data = job;
+        loop_.begin_operation();
+        const int r = uv_queue_work(
+            loop_.uv_loop(), &job->work,
+            [](uv_work_t* req) {
+                auto* job = static_cast<Rescan*>(req->data);
+                job->dirs.resize(job->paths.size());
+                for (size_t i = 0; i < job->paths.size(); i++) {
+                    std::error_code ec;
+                    if (!stdfs::is_directory(stdfs::symlink_status(job->paths[i], ec)))
+                        continue;
+                    job->dirs[i].push_back(job->paths[i]);
+                    list_subdirs(job->paths[i], job->dirs[i]);
+                }
+            },
+            [](uv_work_t* req, int status) {
+                auto* job = static_cast<Rescan*>(req->data);
+                if (*job->alive) {
+                    job->state->loop_.end_operation();
+                    if (status == 0)
+                        job->state->apply_rescan(*job);
+                }
+                delete job;
+            });
+        if (r < 0) {
+            loop_.end_operation();
+            delete job;
+        }
+    }
+
+    /** Watch directories that appeared under the renamed paths and close handles of those that went away. */
+    void apply_rescan(const Rescan& job) {
+        auto it = watchers_.find(job.id);
+        if (it == watchers_.end())
+            return;
+        Watcher& w = *it->second;
+        for (size_t i = 0; i < job.paths.size(); i++) {
+            if (!job.dirs[i].empty()) {
+                for (const std::string& dir : job.dirs[i])
+                    add_dir(job.id, w, dir);
+                continue;
+            }
+            for (auto h = w.handles.begin(); h != w.handles.end();) {
+                if (h->first != w.root && within(h->first, job.paths[i])) {
+                    h->second->stop();
+                    h->second->close();
+                    h = w.handles.erase(h);
+                } else {
+                    ++h;
+                }
+            }
+        }
+    }
+
+    qjs::JSEngine& engine_;
+    JSRuntime* rt_;
+    qianjs::event_loop::EventLoop& loop_;
+    std::shared_ptr<bool> alive_;
+    std::unordered_map<int64_t, std::unique_ptr<Watcher>> watchers_;
+    int64_t next_id_ = 1;
+};
+
+/** Reads `{ recursive, debounceMs }` from `opts` (undefined allowed); false with an exception set. */
+bool parse_watch_options(JSContext* c, JSValue opts, bool& recursive, int64_t& debounce_ms) {
+    if (JS_IsUndefined(opts))
+        return true;
+    JSValue v = JS_GetPropertyStr(c, opts, "recursive");
+    if (JS_IsException(v))
+        return false;
+    recursive = JS_ToBool(c, v) > 0;
+    JS_FreeValue(c, v);
+
+    v = JS_GetPropertyStr(c, opts, "debounceMs");
+    if (JS_IsException(v))
+        return false;
+    if (!JS_IsUndefined(v)) {
+        const int r = JS_ToInt64(c, &debounce_ms, v);
+        JS_FreeValue(c, v);
+        if (r < 0)
+            return false;
+        if (debounce_ms < 0 || debounce_ms > kMaxDebounceMs) {
+            JS_ThrowRangeError(c, "watch: debounceMs must be between 0 and %lld", (long long)kMaxDebounceMs);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void install_fs_watch(qjs::JSEngine& engine, qjs::JSModule& fs) {
+    qianjs::event_loop::EventLoop::of(engine).ensure_started();
+    auto state = std::make_shared<WatchState>(engine);
+
+    fs.funcDynamic("watch", 2, 3, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("fs");
+        FsPath path;
+        if (!path.from(c, argv[0], "watch"))
+            return JS_EXCEPTION;
+        if (!JS_IsFunction(c, argv[1]))
+            return JS_ThrowTypeError(c, "watch: onChange must be a function");
+        bool recursive = false;
+        int64_t debounce_ms = kDefaultDebounceMs;
+        if (!parse_watch_options(c, argc > 2 ? argv[2] : JS_UNDEFINED, recursive, debounce_ms))
+            return JS_EXCEPTION;
+        return state->watch(c, path.str(), argv[1], recursive, static_cast<uint64_t>(debounce_ms));
+    });
+
+    fs.func("unwatch", [state](int64_t id) { state->unwatch(id); });
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace qjs {
+class JSEngine;
+class JSModule;
+}
+
+/**
+ * `fs.watch(path, onChange, { recursive, debounceMs })` and `fs.unwatch(id)` on the engine's loop: one
+ * `uvw::fs_event_handle` per watched directory, events coalesced by path and delivered as one array of
+ * `{ path, type }` per debounce window. Each live watcher is a pending operation on the loop.
+ */
+void install_fs_watch(qjs::JSEngine& engine, qjs::JSModule& fs);
@@ -0,0 +1,733 @@
+#include "native/http/http_module.h"
+
+#include "native/http/http_parser.h"
+#include "native/net/net_js_io.h"
+#include "native/net/net_stream.h"
+
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/profiler/sampling_profiler.h"
+
+#include <js_engine.h>
+#include <js_module.h>
+#include <js_types.h>
+
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using qianjs::http::HttpLimits;
+using qianjs::http::HttpMessage;
+using qianjs::http::HttpParser;
+using qianjs::net::TcpServer;
+using qianjs::net::TcpStream;
+
+const char* reason_phrase(int status) {
+    switch (status) {
+    case 100: return "Continue";
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 303: return "See Other";
+    case 304: return "Not Modified";
+    case 307: return "Temporary Redirect";
+    case 308: return "Permanent Redirect";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Unknown";
+    }
+}
+
+bool bodiless_status(int status) {
+    return status < 200 || status == 204 || status == 304;
+}
+
+/** The body string itself becomes the ArrayBuffer's storage. */
+JSValue take_body(JSContext* c, std::string&& body) {
+    if (body.empty())
+        return JS_NewArrayBufferCopy(c, nullptr, 0);
+    auto* owned = new std::string(std::move(body));
+    JSValue ab = JS_NewArrayBuffer(c, reinterpret_cast<uint8_t*>(owned->data()), owned->size(),
+        [](JSRuntime*, void* opaque, void*) { delete static_cast<std::string*>(opaque); }, owned, 0);
+    if (JS_IsException(ab))
+        delete owned;
+    return ab;
+}
+
+/** Lowercased names as keys; repeated fields joined with `", "`. */
+JSValue headers_object(JSContext* c, const HttpMessage& msg) {
+    std::vector<std::pair<const std::string*, std::string>> merged;
+    for (const auto& [name, value] : msg.headers) {
+        auto it = merged.begin();
+        while (it != merged.end() && *it->first != name)
+            ++it;
+        if (it == merged.end())
+            merged.emplace_back(&name, value);
+        else
+            it->second += ", " + value;
+    }
+    JSValue o = JS_NewObject(c);
+    for (const auto& [name, value] : merged)
+        JS_SetPropertyStr(c, o, name->c_str(), JS_NewStringLen(c, value.data(), value.size()));
+    return o;
+}
+
+bool value_has_close(std::string value) {
+    for (char& ch : value)
+        ch = (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+    return value.find("close") != std::string::npos;
+}
+
+/** Header fields the layer writes itself; values from JS for these are dropped (or read, for `connection`). */
+struct ManagedHeaders {
+    bool host = false;
+    bool close = false;
+};
+
+/**
+ * Appends `name: value\r\n` for each own property of `headers` (undefined allowed). Names must be tokens and values
+ * free of CR, LF and NUL, so a handler cannot split the response. False with an exception set.
+ */
+bool append_headers(JSContext* c, JSValue headers, std::string& out, ManagedHeaders& managed, const char* fn) {
+    if (JS_IsUndefined(headers) || JS_IsNull(headers))
+        return true;
+    JSPropertyEnum* props = nullptr;
+    uint32_t count = 0;
+    if (JS_GetOwnPropertyNames(c, &props, &count, headers, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0)
+        return false;
+
+    bool ok = true;
+    for (uint32_t i = 0; i < count; i++) {
+        if (ok) {
+            const char* name = JS_AtomToCString(c, props[i].atom);
+            JSValue v = JS_GetProperty(c, headers, props[i].atom);
+            const char* value = JS_IsException(v) ? nullptr : JS_ToCString(c, v);
+            if (!name || !value) {
+                ok = false;
+            } else {
+                std::string lname(name);
+                for (char& ch : lname)
+                    ch = (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+                const std::string val(value);
+                bool valid = !lname.empty() && val.find_first_of(std::string("\r\n\0", 3)) == std::string::npos;
+                for (char ch : lname) {
+                    if (ch <= 0x20 || ch >= 0x7f || ch == ':')
+                        valid = false;
+                }
+                if (!valid) {
+                    JS_ThrowTypeError(c, "%s: invalid header '%s'", fn, name);
+                    ok = false;
+                } else if (lname == "connection") {
+                    managed.close = managed.close || value_has_close(val);
+                } else if (lname != "content-length" && lname != "transfer-encoding") {
+                    managed.host = managed.host || lname == "host";
+                    out.append(name).append(": ").append(val).append("\r\n");
+                }
+            }
+            if (value)
+                JS_FreeCString(c, value);
+            if (name)
+                JS_FreeCString(c, name);
+            JS_FreeValue(c, v);
+        }
+        JS_FreeAtom(c, props[i].atom);
+    }
+    js_free(c, props);
+    return ok;
+}
+
+/** Optional string property `key` of `obj`; false with an exception set. */
+bool string_option(JSContext* c, JSValue obj, const char* key, std::string& out) {
+    JSValue v = JS_GetPropertyStr(c, obj, key);
+    if (JS_IsException(v))
+        return false;
+    if (JS_IsUndefined(v))
+        return true;
+    const char* s = JS_ToCString(c, v);
+    JS_FreeValue(c, v);
+    if (!s)
+        return false;
+    out = s;
+    JS_FreeCString(c, s);
+    return true;
+}
+
+/** Optional non-negative integer property `key` of `obj`; false with an exception set. */
+bool size_option(JSContext* c, JSValue obj, const char* key, size_t& out) {
+    JSValue v = JS_GetPropertyStr(c, obj, key);
+    if (JS_IsException(v))
+        return false;
+    if (JS_IsUndefined(v))
+        return true;
+    int64_t n = 0;
+    const int r = JS_ToInt64(c, &n, v);
+    JS_FreeValue(c, v);
+    if (r < 0)
+        return false;
+    if (n < 0) {
+        JS_ThrowRangeError(c, "%s must not be negative", key);
+        return false;
+    }
+    out = static_cast<size_t>(n);
+    return true;
+}
+
+struct Server {
+    TcpServer* server = nullptr;
+    JSValue on_request = JS_UNDEFINED;
+    HttpLimits limits;
+};
+
+/** One accepted connection; handles one request at a time, so responses leave in request order. */
+struct Connection {
+    Connection(int64_t conn_id, TcpStream* s, int64_t server, const HttpLimits& limits)
+        : id(conn_id), stream(s), server_id(server), parser(HttpParser::Kind::Request, limits) {}
+
+    int64_t id;
+    TcpStream* stream;
+    int64_t server_id;
+    HttpParser parser;
+    /** Bytes that arrived while a request was being handled (pipelining), parsed once it has been answered. */
+    std::string input;
+    /** Response id while the current request waits for `respond`. */
+    int64_t response = 0;
+    bool head_request = false;
+    bool keep_alive = true;
+    int version_minor = 1;
+    /** Answered with more than the high-water mark still queued; reading resumes on drain. */
+    bool waiting_drain = false;
+};
+
+/** One `request()`; a fresh connection per request, closed once the response is complete. */
+struct Client {
+    Client() : parser(HttpParser::Kind::Response) {}
+
+    TcpStream* stream = nullptr;
+    HttpParser parser;
+    qjs::JSEngine::PromiseHandle ph{};
+    std::string request;
+};
+
+/**
+ * Per-engine HTTP/1.1 servers and client requests on `net`'s `TcpStream`. Requests are parsed natively and reach JS
+ * as `(req, res)`; `respond(res, ...)` writes status line, headers and body as one `writev` through `uv_try_write`.
+ * A connection stops reading while its request is unanswered or while more than the high-water mark is queued, so
+ * a client pipelining faster than the handler answers is throttled by TCP instead of buffered here.
+ */
+class HttpState final : public qianjs::net::StreamListener {
+public:
+    explicit HttpState(qjs::JSEngine& engine)
+        : engine_(engine),
+          rt_(JS_GetRuntime(engine.ctx())),
+          loop_(qianjs::event_loop::EventLoop::of(engine)),
+          alive_(std::make_shared<bool>(true)) {}
+
+    /** Engine teardown with servers or requests still open: close the handles, drop handlers, promises, op counts. */
+    ~HttpState() override {
+        *alive_ = false;
+        for (auto& [id, conn] : connections_) {
+            conn->stream->setListener(nullptr, 0);
+            conn->stream->close();
+            loop_.end_operation();
+        }
+        for (auto& [id, client] : clients_) {
+            if (client->stream) {
+                client->stream->setListener(nullptr, 0);
+                client->stream->close();
+            }
+            if (client->ph.ptr)
+                engine_.freePromise(client->ph);
+            loop_.end_operation();
+        }
+        for (auto& [id, s] : servers_) {
+            s.server->close();
+            JS_FreeValueRT(rt_, s.on_request);
+            loop_.end_operation();
+        }
+    }
+
+    JSValue listen(JSContext* c, JSValue on_request, const qianjs::net::ListenOptions& options,
+                   const HttpLimits& limits) {
+        const int64_t id = next_id_++;
+        int err = 0;
+        TcpServer* server = TcpServer::listen(loop_.uv_loop(), options.host, options.port, options.backlog,
+            [this, id](TcpStream* stream) { accept(id, stream); }, &err);
+        if (!server)
+            return JS_ThrowTypeError(c, "createServer: %s", qianjs::net::uvMessage(err).c_str());
+        servers_[id] = Server{server, JS_DupValue(c, on_request), limits};
+        loop_.begin_operation();
+        return JS_NewInt64(c, id);
+    }
+
+    int serverPort(int64_t id) const {
+        auto it = servers_.find(id);
+        return it == servers_.end() ? 0 : it->second.server->port();
+    }
+
+    /** Stops accepting; idle keep-alive connections close now, busy ones after their current response. */
+    void closeServer(int64_t id) {
+        auto it = servers_.find(id);
+        if (it == servers_.end())
+            return;
+        it->second.server->close();
+        JS_FreeValue(engine_.ctx(), it->second.on_request);
+        servers_.erase(it);
+        loop_.end_operation();
+        for (auto& [cid, conn] : connections_) {
+            if (conn->server_id != id)
+                continue;
+            conn->keep_alive = false;
+            if (!conn->response && !conn->waiting_drain)
+                conn->stream->close();
+        }
+    }
+
+    JSValue respond(JSContext* c, int64_t res, int status, JSValue headers, JSValue body) {
+        auto rit = responses_.find(res);
+        if (rit == responses_.end())
+            return JS_ThrowTypeError(c, "respond: unknown or already answered response %lld",
+                static_cast<long long>(res));
+        if (status < 100 || status > 999)
+            return JS_ThrowRangeError(c, "respond: status must be between 100 and 999");
+
+        std::string head;
+        head.reserve(256);
+        head.append("HTTP/1.1 ").append(std::to_string(status)).append(" ");
+        head.append(reason_phrase(status)).append("\r\n");
+        ManagedHeaders managed;
+        if (!append_headers(c, headers, head, managed, "respond"))
+            return JS_EXCEPTION;
+        qianjs::net::JsBytes bytes(c);
+        if (!JS_IsUndefined(body) && !bytes.from(body))
+            return JS_ThrowTypeError(c, "respond: body must be string, ArrayBuffer, or TypedArray");
+
+        Connection& conn = *connections_.at(rit->second);
+        responses_.erase(rit);
+        conn.response = 0;
+        if (managed.close)
+            conn.keep_alive = false;
+
+        const bool bodiless = bodiless_status(status);
+        if (!bodiless)
+            head.append("content-length: ").append(std::to_string(bytes.size())).append("\r\n");
+        if (!conn.keep_alive)
+            head.append("connection: close\r\n");
+        else if (conn.version_minor == 0)
+            head.append("connection: keep-alive\r\n");
+        head.append("\r\n");
+
+        uv_buf_t bufs[2] = {
+            uv_buf_init(head.data(), static_cast<unsigned>(head.size())),
+            uv_buf_init(const_cast<char*>(bytes.data()), static_cast<unsigned>(bytes.size())),
+        };
+        const bool with_body = !bodiless && !conn.head_request && bytes.size() > 0;
+        // A failed write means the peer is gone; the stream is already closing and there is nobody to tell.
+        conn.stream->write(bufs, with_body ? 2 : 1);
+        after_response(conn);
+        return JS_UNDEFINED;
+    }
+
+    qjs::RawJSValue request(const std::string& host, int port, const std::string& method,
+                            const std::string& path, std::string header_block, bool has_host,
+                            const char* body, size_t body_len) {
+        qjs::JSEngine::PromiseHandle ph = engine_.createPromise();
+        if (!ph.ptr)
+            return engine_.promiseValue(ph);
+        const qjs::RawJSValue promise = engine_.promiseValue(ph);
+
+        const int64_t id = next_id_++;
+        auto client = std::make_unique<Client>();
+        client->ph = ph;
+        client->parser.expectNoBody(method == "HEAD");
+        std::string& out = client->request;
+        out.reserve(128 + header_block.size() + body_len);
+        out.append(method).append(" ").append(path).append(" HTTP/1.1\r\n");
+        if (!has_host)
+            out.append("host: ").append(host).append(":").append(std::to_string(port)).append("\r\n");
+        out.append(header_block);
+        if (body_len > 0 || method == "POST" || method == "PUT" || method == "PATCH")
+            out.append("content-length: ").append(std::to_string(body_len)).append("\r\n");
+        out.append("connection: close\r\n\r\n");
+        out.append(body, body_len);
+        clients_[id] = std::move(client);
+        loop_.begin_operation();
+
+        std::shared_ptr<bool> alive = alive_;
+        qianjs::net::connectTcp(loop_.uv_loop(), host, port, [this, alive, id](TcpStream* stream, int status) {
+            if (!*alive) {
+                if (stream)
+                    stream->close();
+                return;
+            }
+            auto it = clients_.find(id);
+            if (it == clients_.end()) {
+                if (stream)
+                    stream->close();
+                return;
+            }
+            if (!stream) {
+                finish_client(id, qianjs::net::uvMessage(status), uv_err_name(status));
+                return;
+            }
+            Client& cl = *it->second;
+            cl.stream = stream;
+            stream->setListener(this, id);
+            const uv_buf_t buf = uv_buf_init(cl.request.data(), static_cast<unsigned>(cl.request.size()));
+            const int r = stream->write(&buf, 1);
+            cl.request.clear();
+            if (r == 0)
+                start_reading(stream);
+        });
+        return promise;
+    }
+
+    void onRead(TcpStream& stream, char* data, size_t len) override {
+        if (Connection* conn = connection(stream.id())) {
+            if (stream.ended())
+                return;
+            if (conn->response || conn->waiting_drain || !conn->input.empty()) {
+                conn->input.append(data, len);
+                stream.stopReading();
+                return;
+            }
+            process(*conn, data, len);
+            return;
+        }
+        auto it = clients_.find(stream.id());
+        if (it == clients_.end() || !it->second->ph.ptr)
+            return;
+        Client& cl = *it->second;
+        cl.parser.feed(data, len);
+        if (cl.parser.status() == HttpParser::Status::Done)
+            resolve_client(stream.id());
+        else if (cl.parser.status() == HttpParser::Status::Error)
+            finish_client(stream.id(), "EPROTO: malformed HTTP response", "EPROTO");
+    }
+
+    void onEnd(TcpStream& stream, int status) override {
+        if (Connection* conn = connection(stream.id())) {
+            conn->keep_alive = false;
+            if (status == UV_EOF && !conn->response && !conn->waiting_drain && conn->input.empty())
+                stream.end();
+            return;
+        }
+        auto it = clients_.find(stream.id());
+        if (it == clients_.end() || !it->second->ph.ptr)
+            return;
+        if (status != UV_EOF)
+            finish_client(stream.id(), qianjs::net::uvMessage(status), uv_err_name(status));
+        else if (it->second->parser.finish() == HttpParser::Status::Done)
+            resolve_client(stream.id());
+        else
+            finish_client(stream.id(), "ECONNRESET: socket hang up", "ECONNRESET");
+    }
+
+    void onDrain(TcpStream& stream) override {
+        Connection* conn = connection(stream.id());
+        if (!conn || !conn->waiting_drain)
+            return;
+        conn->waiting_drain = false;
+        resume(*conn);
+    }
+
+    void onClose(TcpStream& stream) override {
+        auto cit = connections_.find(stream.id());
+        if (cit != connections_.end()) {
+            if (cit->second->response)
+                responses_.erase(cit->second->response);
+            connections_.erase(cit);
+            loop_.end_operation();
+            return;
+        }
+        auto it = clients_.find(stream.id());
+        if (it == clients_.end())
+            return;
+        it->second->stream = nullptr;
+        if (it->second->ph.ptr) {
+            engine_.rejectPromise(it->second->ph, "ECONNRESET: socket hang up", "ECONNRESET");
+            engine_.freePromise(it->second->ph);
+        }
+        clients_.erase(it);
+        loop_.end_operation();
+    }
+
+private:
+    Connection* connection(int64_t id) {
+        auto it = connections_.find(id);
+        return it == connections_.end() ? nullptr : it->second.get();
+    }
+
+    void accept(int64_t server_id, TcpStream* stream) {
+        auto sit = servers_.find(server_id);
+        if (sit == servers_.end()) {
+            stream->close();
+            return;
+        }
+        const int64_t id = next_id_++;
+        auto conn = std::make_unique<Connection>(id, stream, server_id, sit->second.limits);
+        stream->setListener(this, id);
+        connections_[id] = std::move(conn);
+        loop_.begin_operation();
+        start_reading(stream);
+    }
+
+    static void start_reading(TcpStream* stream) {
+        if (stream->startReading() < 0)
+            stream->close();
+    }
+
+    /** Parses `data` until a request completes (dispatched; the rest is kept in `input`) or the input is malformed. */
+    void process(Connection& conn, const char* data, size_t len) {
+        size_t off = 0;
+        while (off < len) {
+            off += conn.parser.feed(data + off, len - off);
+            const HttpParser::Status st = conn.parser.status();
+            if (st == HttpParser::Status::Error) {
+                reply_error(conn, conn.parser.errorStatus(), conn.parser.errorReason());
+                return;
+            }
+            if (st == HttpParser::Status::Done) {
+                conn.input.assign(data + off, len - off);
+                dispatch(conn);
+                return;
+            }
+        }
+    }
+
+    void dispatch(Connection& conn) {
+        auto sit = servers_.find(conn.server_id);
+        if (sit == servers_.end()) {
+            reply_error(conn, 503, "Service Unavailable");
+            return;
+        }
+        HttpMessage& msg = conn.parser.message();
+        conn.keep_alive = conn.keep_alive && msg.keep_alive && !conn.stream->peerEnded();
+        conn.head_request = msg.method == "HEAD";
+        conn.version_minor = msg.version_minor;
+        const int64_t res = next_id_++;
+        conn.response = res;
+        responses_[res] = conn.id;
+        conn.stream->stopReading();
+
+        JSContext* c = engine_.ctx();
+        JSValue req = JS_NewObject(c);
+        JS_SetPropertyStr(c, req, "method", JS_NewStringLen(c, msg.method.data(), msg.method.size()));
+        JS_SetPropertyStr(c, req, "url", JS_NewStringLen(c, msg.target.data(), msg.target.size()));
+        JS_SetPropertyStr(c, req, "headers", headers_object(c, msg));
+        JS_SetPropertyStr(c, req, "body", take_body(c, std::move(msg.body)));
+        JS_SetPropertyStr(c, req, "keepAlive", JS_NewBool(c, conn.keep_alive));
+        conn.parser.reset();
+
+        const qianjs::profiler::TaskFrame task("http");
+        JSValue fn = JS_DupValue(c, sit->second.on_request);
+        JSValue args[2] = {req, JS_NewInt64(c, res)};
+        JSValue ret = JS_Call(c, fn, JS_UNDEFINED, 2, args);
+        JS_FreeValue(c, fn);
+        JS_FreeValue(c, args[0]);
+        if (!JS_IsException(ret)) {
+            JS_FreeValue(c, ret);
+            return;
+        }
+        qianjs::net::printPendingException(c, "http request handler");
+        if (responses_.count(res))
+            respond(c, res, 500, JS_UNDEFINED, JS_UNDEFINED);
+    }
+
+    void after_response(Connection& conn) {
+        if (!conn.keep_alive) {
+            conn.stream->end();
+            return;
+        }
+        if (conn.stream->aboveHighWater()) {
+            conn.waiting_drain = true;
+            return;
+        }
+        resume(conn);
+    }
+
+    /** Next request: parse what is buffered on the next loop turn (no recursion through handlers), else read. */
+    void resume(Connection& conn) {
+        if (conn.input.empty()) {
+            start_reading(conn.stream);
+            return;
+        }
+        std::shared_ptr<bool> alive = alive_;
+        const int64_t id = conn.id;
+        loop_.defer([this, alive, id](qjs::JSEngine&) {
+            if (!*alive)
+                return;
+            Connection* c = connection(id);
+            if (!c || c->response || c->stream->closing())
+                return;
+            const std::string input = std::move(c->input);
+            c->input.clear();
+            process(*c, input.data(), input.size());
+            c = connection(id);
+            if (c && !c->response && c->input.empty() && !c->stream->ended())
+                c->stream->startReading();
+        });
+    }
+
+    void reply_error(Connection& conn, int status, const char* reason) {
+        const std::string head = "HTTP/1.1 " + std::to_string(status) + " " + reason +
+            "\r\ncontent-length: 0\r\nconnection: close\r\n\r\n";
+        const uv_buf_t buf = uv_buf_init(const_cast<char*>(head.data()), static_cast<unsigned>(head.size()));
+        conn.keep_alive = false;
+        conn.input.clear();
+        conn.stream->write(&buf, 1);
+        conn.stream->end();
+    }
+
+    void resolve_client(int64_t id) {
+        Client& cl = *clients_.at(id);
+        JSContext* c = engine_.ctx();
+        HttpMessage& msg = cl.parser.message();
+        JSValue res = JS_NewObject(c);
+        JS_SetPropertyStr(c, res, "status", JS_NewInt32(c, msg.status));
+        JS_SetPropertyStr(c, res, "headers", headers_object(c, msg));
+        JS_SetPropertyStr(c, res, "body", take_body(c, std::move(msg.body)));
+        engine_.resolvePromiseJSValue(cl.ph, res);
+        engine_.freePromise(cl.ph);
+        cl.ph = {};
+        cl.stream->close();
+    }
+
+    /** Rejects the request and closes its connection (or forgets it when it never connected). */
+    void finish_client(int64_t id, const std::string& message, const std::string& code) {
+        auto it = clients_.find(id);
+        Client& cl = *it->second;
+        engine_.rejectPromise(cl.ph, message, code);
+        engine_.freePromise(cl.ph);
+        cl.ph = {};
+        if (cl.stream) {
+            cl.stream->close();
+            return;
+        }
+        clients_.erase(it);
+        loop_.end_operation();
+    }
+
+    qjs::JSEngine& engine_;
+    JSRuntime* rt_;
+    qianjs::event_loop::EventLoop& loop_;
+    std::shared_ptr<bool> alive_;
+    std::unordered_map<int64_t, Server> servers_;
+    std::unordered_map<int64_t, std::unique_ptr<Connection>> connections_;
+    /** Response id → connection id. */
+    std::unordered_map<int64_t, int64_t> responses_;
+    std::unordered_map<int64_t, std::unique_ptr<Client>> clients_;
+    int64_t next_id_ = 1;
+};
+
+} // namespace
+
+const char* HttpPlugin::name() const {
+    return "http";
+}
+
+void HttpPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
+    qianjs::event_loop::EventLoop::of(engine).ensure_started();
+#ifdef SIGPIPE
+    // A client resetting the connection must fail the write with EPIPE, not kill the host.
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    auto state = std::make_shared<HttpState>(engine);
+    auto& m = root.module("http");
+
+    m.funcDynamic("createServer", 1, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("http");
+        if (!JS_IsFunction(c, argv[0]))
+            return JS_ThrowTypeError(c, "createServer: onRequest must be a function");
+        const JSValue opts = argc > 1 ? argv[1] : JS_UNDEFINED;
+        qianjs::net::ListenOptions options;
+        if (!qianjs::net::parseListenOptions(c, opts, options, "createServer"))
+            return JS_EXCEPTION;
+        HttpLimits limits;
+        if (!JS_IsUndefined(opts) &&
+            (!size_option(c, opts, "maxHeaderSize", limits.max_header_bytes) ||
+             !size_option(c, opts, "maxBodySize", limits.max_body_bytes)))
+            return JS_EXCEPTION;
+        return state->listen(c, argv[0], options, limits);
+    });
+    m.func("serverPort", [state](int64_t id) { return state->serverPort(id); });
+    m.func("closeServer", [state](int64_t id) { state->closeServer(id); });
+
+    m.funcDynamic("respond", 2, 4, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("http");
+        int64_t res = 0;
+        int32_t status = 0;
+        if (JS_ToInt64(c, &res, argv[0]) < 0 || JS_ToInt32(c, &status, argv[1]) < 0)
+            return JS_EXCEPTION;
+        return state->respond(c, res, status, argc > 2 ? argv[2] : JS_UNDEFINED, argc > 3 ? argv[3] : JS_UNDEFINED);
+    });
+
+    m.funcDynamic("request", 1, 1, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("http");
+        (void)argc;
+        const JSValue opts = argv[0];
+        if (!JS_IsObject(opts))
+            return JS_ThrowTypeError(c, "request: options must be an object");
+        std::string host = "127.0.0.1";
+        std::string method = "GET";
+        std::string path = "/";
+        size_t port = 80;
+        if (!string_option(c, opts, "host", host) || !string_option(c, opts, "method", method) ||
+            !string_option(c, opts, "path", path) || !size_option(c, opts, "port", port))
+            return JS_EXCEPTION;
+        if (port == 0 || port > 65535)
+            return JS_ThrowRangeError(c, "request: port must be between 1 and 65535");
+        bool valid = !method.empty() && !path.empty() && path.find_first_of(" \r\n") == std::string::npos;
+        for (char ch : method)
+            valid = valid && ch > 0x20 && ch < 0x7f;
+        if (!valid)
+            return JS_ThrowTypeError(c, "request: invalid method or path");
+
+        std::string header_block;
+        ManagedHeaders managed;
+        JSValue headers = JS_GetPropertyStr(c, opts, "headers");
+        if (JS_IsException(headers))
+            return JS_EXCEPTION;
+        const bool ok = append_headers(c, headers, header_block, managed, "request");
+        JS_FreeValue(c, headers);
+        if (!ok)
+            return JS_EXCEPTION;
+
+        JSValue body = JS_GetPropertyStr(c, opts, "body");
+        if (JS_IsException(body))
+            return JS_EXCEPTION;
+        qianjs::net::JsBytes bytes(c);
+        if (!JS_IsUndefined(body) && !bytes.from(body)) {
+            JS_FreeValue(c, body);
+            return JS_ThrowTypeError(c, "request: body must be string, ArrayBuffer, or TypedArray");
+        }
+        const qjs::RawJSValue r = state->request(host, static_cast<int>(port), method, path,
+            std::move(header_block), managed.host, bytes.data(), bytes.size());
+        JS_FreeValue(c, body);
+        return qjs::JSConv<qjs::RawJSValue>::to(c, r);
+    });
+}
@@ -0,0 +1,410 @@
+#include "native/http/http_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace qianjs::http {
+
+namespace {
+
+/** Longest chunk-size line (size, extensions) accepted. */
+constexpr size_t kMaxChunkLine = 1024;
+
+/** RFC 9110 `tchar`. */
+bool is_tchar(unsigned char ch) {
+    if ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'))
+        return true;
+    return std::strchr("!#$%&'*+-.^_`|~", ch) != nullptr && ch != '\0';
+}
+
+bool is_token(const std::string& s) {
+    return !s.empty() &&
+        std::all_of(s.begin(), s.end(), [](char ch) { return is_tchar(static_cast<unsigned char>(ch)); });
+}
+
+std::string lower(std::string s) {
+    for (char& ch : s) {
+        if (ch >= 'A' && ch <= 'Z')
+            ch = static_cast<char>(ch - 'A' + 'a');
+    }
+    return s;
+}
+
+std::string trim(const std::string& s) {
+    size_t b = 0;
+    size_t e = s.size();
+    while (b < e && (s[b] == ' ' || s[b] == '\t'))
+        b++;
+    while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t'))
+        e--;
+    return s.substr(b, e - b);
+}
+
+/** Comma-separated list element equal to `token`, case-insensitively. */
+bool has_token(const std::string& value, const char* token) {
+    const std::string v = lower(value);
+    size_t start = 0;
+    while (start <= v.size()) {
+        size_t comma = v.find(',', start);
+        if (comma == std::string::npos)
+            comma = v.size();
+        if (trim(v.substr(start, comma - start)) == token)
+            return true;
+        start = comma + 1;
+    }
+    return false;
+}
+
+/** Last element of a comma-separated list, lowercased. */
+std::string last_token(const std::string& value) {
+    const size_t comma = value.rfind(',');
+    return lower(trim(comma == std::string::npos ? value : value.substr(comma + 1)));
+}
+
+bool parse_decimal(const std::string& s, uint64_t& out) {
+    if (s.empty() || s.size() > 19)
+        return false;
+    uint64_t v = 0;
+    for (char ch : s) {
+        if (ch < '0' || ch > '9')
+            return false;
+        v = v * 10 + static_cast<uint64_t>(ch - '0');
+    }
+    out = v;
+    return true;
+}
+
+int hex_digit(char ch) {
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+bool parse_version(const std::string& s, int& minor) {
+    if (s == "HTTP/1.1") {
+        minor = 1;
+        return true;
+    }
+    if (s == "HTTP/1.0") {
+        minor = 0;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+HttpParser::Status HttpParser::status() const {
+    if (state_ == State::Done)
+        return Status::Done;
+    if (state_ == State::Error)
+        return Status::Error;
+    return Status::NeedMore;
+}
+
+void HttpParser::reset() {
+    state_ = State::Head;
+    message_ = HttpMessage();
+    head_.clear();
+    line_.clear();
+    remaining_ = 0;
+    trailer_bytes_ = 0;
+    no_body_ = false;
+    error_status_ = 0;
+    error_reason_ = "";
+}
+
+bool HttpParser::fail(int status, const char* reason) {
+    state_ = State::Error;
+    error_status_ = status;
+    error_reason_ = reason;
+    return false;
+}
+
+size_t HttpParser::feed(const char* data, size_t len) {
+    size_t used = 0;
+    while (used < len && state_ != State::Done && state_ != State::Error) {
+        const char* p = data + used;
+        const size_t n = len - used;
+        switch (state_) {
+        case State::Head:
+            used += feed_head(p, n);
+            break;
+
+        case State::Body:
+        case State::ChunkData: {
+            const size_t take = static_cast<size_t>(std::min<uint64_t>(remaining_, n));
+            message_.body.append(p, take);
+            remaining_ -= take;
+            used += take;
+            if (remaining_ == 0)
+                state_ = state_ == State::Body ? State::Done : State::ChunkDataEnd;
+            break;
+        }
+
+        case State::BodyToEof:
+            if (message_.body.size() + n > limits_.max_body_bytes) {
+                fail(413, "Payload Too Large");
+                break;
+            }
+            message_.body.append(p, n);
+            used += n;
+            break;
+
+        case State::ChunkSize: {
+            bool complete = false;
+            used += take_line(p, n, complete);
+            if (state_ == State::Error || !complete)
+                break;
+            uint64_t size = 0;
+            size_t i = 0;
+            for (; i < line_.size() && hex_digit(line_[i]) >= 0; i++) {
+                if (size > (UINT64_MAX >> 4)) {
+                    fail(400, "Bad Request");
+                    break;
+                }
+                size = (size << 4) | static_cast<uint64_t>(hex_digit(line_[i]));
+            }
+            if (state_ == State::Error)
+                break;
+            // Digits, then optional whitespace and `;extensions`, which are ignored.
+            const std::string rest = trim(line_.substr(i));
+            if (i == 0 || (!rest.empty() && rest[0] != ';')) {
+                fail(400, "Bad Request");
+                break;
+            }
+            line_.clear();
+            if (size > limits_.max_body_bytes - message_.body.size()) {
+                fail(413, "Payload Too Large");
+                break;
+            }
+            remaining_ = size;
+            state_ = size == 0 ? State::Trailers : State::ChunkData;
+            break;
+        }
+
+        case State::ChunkDataEnd: {
+            bool complete = false;
+            used += take_line(p, n, complete);
+            if (state_ == State::Error || !complete)
+                break;
+            if (!line_.empty()) {
+                fail(400, "Bad Request");
+                break;
+            }
+            state_ = State::ChunkSize;
+            break;
+        }
+
+        case State::Trailers: {
+            bool complete = false;
+            const size_t take = take_line(p, n, complete);
+            used += take;
+            trailer_bytes_ += take;
+            if (trailer_bytes_ > limits_.max_header_bytes) {
+                fail(431, "Request Header Fields Too Large");
+                break;
+            }
+            if (state_ == State::Error || !complete)
+                break;
+            // Trailer fields are read and dropped; the empty line ends the message.
+            const bool last = line_.empty();
+            line_.clear();
+            if (last)
+                state_ = State::Done;
+            break;
+        }
+
+        case State::Done:
+        case State::Error:
+            break;
+        }
+    }
+    return used;
+}
+
+HttpParser::Status HttpParser::finish() {
+    if (state_ == State::BodyToEof)
+        state_ = State::Done;
+    else if (state_ != State::Done && state_ != State::Error && !(state_ == State::Head && head_.empty()))
+        fail(400, "Bad Request");
+    return status();
+}
+
+size_t HttpParser::take_line(const char* data, size_t len, bool& complete) {
+    const char* lf = static_cast<const char*>(std::memchr(data, '\n', len));
+    const size_t take = lf ? static_cast<size_t>(lf - data) + 1 : len;
+    line_.append(data, take);
+    if (line_.size() > kMaxChunkLine && state_ != State::Trailers) {
+        fail(400, "Bad Request");
+        return take;
+    }
+    complete = lf != nullptr;
+    if (!complete)
+        return take;
+    if (line_.size() < 2 || line_[line_.size() - 2] != '\r') {
+        fail(400, "Bad Request");
+        return take;
+    }
+    line_.resize(line_.size() - 2);
+    return take;
+}
+
+size_t HttpParser::feed_head(const char* data, size_t len) {
+    size_t skipped = 0;
+    // A client may send stray CRLFs between pipelined requests (RFC 9112 §2.2).
+    if (head_.empty()) {
+        while (skipped < len && (data[skipped] == '\r' || data[skipped] == '\n'))
+            skipped++;
+        if (skipped == len)
+            return len;
+    }
+
+    const size_t before = head_.size();
+    const size_t search_from = before >= 3 ? before - 3 : 0;
+    head_.append(data + skipped, len - skipped);
+    const size_t end = head_.find("\r\n\r\n", search_from);
+    if (end == std::string::npos) {
+        if (head_.size() > limits_.max_header_bytes)
+            fail(431, "Request Header Fields Too Large");
+        return len;
+    }
+    if (end + 4 > limits_.max_header_bytes) {
+        fail(431, "Request Header Fields Too Large");
+        return len;
+    }
+
+    const size_t used = skipped + (end + 4 - before);
+    head_.resize(end + 2);
+    parse_head();
+    return used;
+}
+
+bool HttpParser::parse_start_line(const std::string& line) {
+    const size_t sp1 = line.find(' ');
+    const size_t sp2 = sp1 == std::string::npos ? std::string::npos : line.find(' ', sp1 + 1);
+
+    if (kind_ == Kind::Request) {
+        if (sp2 == std::string::npos || line.find(' ', sp2 + 1) != std::string::npos)
+            return fail(400, "Bad Request");
+        message_.method = line.substr(0, sp1);
+        message_.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        if (!is_token(message_.method) || message_.target.empty())
+            return fail(400, "Bad Request");
+        for (char ch : message_.target) {
+            if (static_cast<unsigned char>(ch) <= 0x20 || ch == 0x7f)
+                return fail(400, "Bad Request");
+        }
+        if (!parse_version(line.substr(sp2 + 1), message_.version_minor))
+            return fail(505, "HTTP Version Not Supported");
+        return true;
+    }
+
+    if (sp1 == std::string::npos || !parse_version(line.substr(0, sp1), message_.version_minor))
+        return fail(400, "Bad Request");
+    const std::string code = line.substr(sp1 + 1, sp2 == std::string::npos ? std::string::npos : sp2 - sp1 - 1);
+    uint64_t status = 0;
+    if (code.size() != 3 || !parse_decimal(code, status) || status < 100)
+        return fail(400, "Bad Request");
+    message_.status = static_cast<int>(status);
+    message_.reason = sp2 == std::string::npos ? std::string() : line.substr(sp2 + 1);
+    return true;
+}
+
+bool HttpParser::parse_head() {
+    size_t pos = head_.find("\r\n");
+    if (!parse_start_line(head_.substr(0, pos)))
+        return false;
+
+    bool has_length = false;
+    uint64_t length = 0;
+    std::string transfer_encoding;
+    bool has_te = false;
+    message_.keep_alive = message_.version_minor >= 1;
+
+    pos += 2;
+    while (pos < head_.size()) {
+        const size_t eol = head_.find("\r\n", pos);
+        const std::string line = head_.substr(pos, eol - pos);
+        pos = eol + 2;
+        if (line[0] == ' ' || line[0] == '\t')
+            return fail(400, "Bad Request");
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos || !is_token(line.substr(0, colon)))
+            return fail(400, "Bad Request");
+        std::string name = lower(line.substr(0, colon));
+        std::string value = trim(line.substr(colon + 1));
+        if (value.find('\0') != std::string::npos || value.find('\r') != std::string::npos ||
+            value.find('\n') != std::string::npos)
+            return fail(400, "Bad Request");
+
+        if (name == "content-length") {
+            uint64_t n = 0;
+            if (!parse_decimal(value, n) || (has_length && n != length))
+                return fail(400, "Bad Request");
+            has_length = true;
+            length = n;
+        } else if (name == "transfer-encoding") {
+            transfer_encoding = has_te ? transfer_encoding + ", " + value : value;
+            has_te = true;
+        } else if (name == "connection") {
+            if (has_token(value, "close"))
+                message_.keep_alive = false;
+            else if (has_token(value, "keep-alive"))
+                message_.keep_alive = true;
+        }
+        message_.headers.emplace_back(std::move(name), std::move(value));
+    }
+
+    if (kind_ == Kind::Response && message_.status < 200 && message_.status != 101) {
+        // Interim response (100 Continue, 103 Early Hints): skip it and wait for the final one.
+        const bool no_body = no_body_;
+        reset();
+        no_body_ = no_body;
+        return true;
+    }
+
+    const bool chunked = has_te && last_token(transfer_encoding) == "chunked";
+    if (kind_ == Kind::Request && has_te && has_length)
+        return fail(400, "Bad Request");
+    if (kind_ == Kind::Request && has_te && !chunked)
+        return fail(501, "Not Implemented");
+    return begin_body(chunked, has_length && !has_te, length);
+}
+
+bool HttpParser::begin_body(bool chunked, bool has_length, uint64_t length) {
+    head_.clear();
+    const bool bodiless = kind_ == Kind::Response &&
+        (no_body_ || message_.status == 101 || message_.status == 204 || message_.status == 304);
+    if (bodiless) {
+        state_ = State::Done;
+        return true;
+    }
+    if (chunked) {
+        state_ = State::ChunkSize;
+        return true;
+    }
+    if (has_length) {
+        if (length > limits_.max_body_bytes)
+            return fail(413, "Payload Too Large");
+        remaining_ = length;
+        state_ = length == 0 ? State::Done : State::Body;
+        if (length > 0)
+            message_.body.reserve(static_cast<size_t>(length));
+        return true;
+    }
+    if (kind_ == Kind::Request) {
+        state_ = State::Done;
+        return true;
+    }
+    // A response delimited by the connection closing cannot be followed by another on it.
+    message_.keep_alive = false;
+    state_ = State::BodyToEof;
+    return true;
+}
+
+} // namespace qianjs::http
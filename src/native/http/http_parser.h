@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace qianjs::http {
+
+/** One parsed request or response. */
+struct HttpMessage {
+    /** Requests only. */
+    std::string method;
+    std::string target;
+    /** Responses only. */
+    int status = 0;
+    std::string reason;
+
+    int version_minor = 1;
+    /** Names lowercased, values trimmed, in arrival order (repeats kept). */
+    std::vector<std::pair<std::string, std::string>> headers;
+    /** Decoded body (chunked framing removed). */
+    std::string body;
+    /** HTTP/1.1 unless `Connection: close`; HTTP/1.0 only with `Connection: keep-alive`. */
+    bool keep_alive = true;
+};
+
+struct HttpLimits {
+    /** Request/status line plus headers (431 when exceeded). */
+    size_t max_header_bytes = 16 * 1024;
+    /** Decoded body (413 when exceeded). */
+    size_t max_body_bytes = 8 * 1024 * 1024;
+};
+
+/**
+ * Incremental HTTP/1.1 parser for one connection, in the spirit of llhttp: bytes are fed as they arrive, in any split,
+ * and the parser keeps only the unfinished head and the body being assembled. Content-Length and chunked bodies are
+ * decoded; responses without either run to EOF (`finish`). Requests carrying both Content-Length and
+ * Transfer-Encoding, folded headers and malformed lengths are rejected rather than guessed at (request smuggling).
+ */
+class HttpParser {
+public:
+    enum class Kind { Request, Response };
+    enum class Status { NeedMore, Done, Error };
+
+    explicit HttpParser(Kind kind, HttpLimits limits = {}) : kind_(kind), limits_(limits) {}
+
+    /**
+     * Consumes from `data` and returns how many bytes were used: all of them unless a message completed (`Done`;
+     * the rest belongs to the next message) or the input is malformed (`Error`).
+     */
+    size_t feed(const char* data, size_t len);
+    /** The peer closed the connection: completes a body that runs to EOF, fails a truncated message. */
+    Status finish();
+
+    Status status() const;
+    HttpMessage& message() { return message_; }
+
+    /** HTTP status to answer a malformed request with (400, 413, 431, 501, 505) and its reason phrase. */
+    int errorStatus() const { return error_status_; }
+    const char* errorReason() const { return error_reason_; }
+
+    /** Responses to HEAD carry headers only; set before the response arrives. */
+    void expectNoBody(bool no_body) { no_body_ = no_body; }
+
+    /** Starts over for the next message on the same connection. */
+    void reset();
+
+private:
+    enum class State { Head, Body, ChunkSize, ChunkData, ChunkDataEnd, Trailers, BodyToEof, Done, Error };
+
+    size_t feed_head(const char* data, size_t len);
+    bool parse_head();
+    bool parse_start_line(const std::string& line);
+    bool begin_body(bool chunked, bool has_length, uint64_t length);
+    /** Accumulates one CRLF-terminated line into `line_`; returns bytes used and sets `complete`. */
+    size_t take_line(const char* data, size_t len, bool& complete);
+    bool fail(int status, const char* reason);
+
+    Kind kind_;
+    HttpLimits limits_;
+    State state_ = State::Head;
+    HttpMessage message_;
+    std::string head_;
+    std::string line_;
+    uint64_t remaining_ = 0;
+    size_t trailer_bytes_ = 0;
+    bool no_body_ = false;
+    int error_status_ = 0;
+    const char* error_reason_ = "";
+};
+
+} // namespace qianjs::http
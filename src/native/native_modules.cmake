@@ -1,11 +1,18 @@
 # Builtin native plugins: QIANJS_MODULE_* options, plugin spec list, glue header generation.
 # Included from project root CMakeLists.txt before add_subdirectory(src/native).
 
+# Optional trailing EAGER: install with the engine instead of on first import (plugins with side effects beyond their
+# module). The module specifier is SUBDIR.
 function(qianjs_native_register_module SUBDIR PLUGIN_CLASS HEADER_UNDER_SRC)
     string(TOUPPER "${SUBDIR}" _up)
     set(_opt "QIANJS_MODULE_${_up}")
     option(${_opt} "QianJS native module (${SUBDIR})" ON)
-    set_property(GLOBAL APPEND PROPERTY QIANJS_PLUGIN_SPECS "${_up}|${PLUGIN_CLASS}|${HEADER_UNDER_SRC}")
+    set(_eager "false")
+    if("EAGER" IN_LIST ARGN)
+        set(_eager "true")
+    endif()
+    set_property(GLOBAL APPEND PROPERTY QIANJS_PLUGIN_SPECS
+        "${_up}|${PLUGIN_CLASS}|${HEADER_UNDER_SRC}|${SUBDIR}|${_eager}")
 endfunction()
 
 function(qianjs_write_native_glue out_dir)
@@ -17,36 +24,55 @@ function(qianjs_write_native_glue out_dir)
     set(_defs "#pragma once\n/* Generated by CMake — do not edit. */\n\n")
     set(_glue "#pragma once\n/* Generated by CMake — do not edit. */\n#include <qianjs_modules.h>\n#include <js_plugin.h>\n\n")
     set(_fn "\ninline void qianjs_populate_default_plugins(qjs::PluginRegistry& r) {\n")
+    set(_lazy "\n/* `r.add(module, install, eager)`; see qianjs::plugins::LazyRegistry. */\n")
+    string(APPEND _lazy "template <class Registry>\ninline void qianjs_populate_lazy_plugins(Registry& r) {\n")
+    set(_mask 0)
+    set(_bit 0)
 
     foreach(spec ${_specs})
         string(REPLACE "|" ";" _p ${spec})
         list(LENGTH _p _len)
-        if(NOT _len EQUAL 3)
-            message(FATAL_ERROR "Invalid QIANJS_PLUGIN_SPECS entry (expected MACRO|Class|header): ${spec}")
+        if(NOT _len EQUAL 5)
+            message(FATAL_ERROR "Invalid QIANJS_PLUGIN_SPECS entry (expected MACRO|Class|header|module|eager): ${spec}")
         endif()
         list(GET _p 0 _macro)
         list(GET _p 1 _class)
         list(GET _p 2 _hdr)
+        list(GET _p 3 _module)
+        list(GET _p 4 _eager)
 
         if(QIANJS_MODULE_${_macro})
             string(APPEND _defs "#define QIANJS_MODULE_${_macro} 1\n")
+            math(EXPR _mask "${_mask} | (1 << ${_bit})" OUTPUT_FORMAT HEXADECIMAL)
         else()
             string(APPEND _defs "#define QIANJS_MODULE_${_macro} 0\n")
         endif()
 
         string(APPEND _glue "#if QIANJS_MODULE_${_macro}\n#include \"${_hdr}\"\n#endif\n")
         string(APPEND _fn "#if QIANJS_MODULE_${_macro}\n  r.emplace<${_class}>();\n#endif\n")
+        string(APPEND _lazy "#if QIANJS_MODULE_${_macro}\n  r.add(\"${_module}\", [](qjs::JSEngine& e, qjs::JSModule& m) { ${_class}().install(e, m); }, ${_eager});\n#endif\n")
+        math(EXPR _bit "${_bit} + 1")
     endforeach()
 
+    # Part of the compile-cache fingerprint: bytecode cached by a build with another module set is not reused.
+    string(APPEND _defs "\n/* Bit i is set when the i-th registered module is enabled. */\n")
+    string(APPEND _defs "#define QIANJS_MODULE_MASK ${_mask}ull\n")
+
     string(APPEND _fn "}\n")
+    string(APPEND _lazy "}\n")
 
     file(WRITE "${out_dir}/qianjs_modules.h" "${_defs}")
-    file(WRITE "${out_dir}/qianjs_default_plugins.g.h" "${_glue}${_fn}")
+    file(WRITE "${out_dir}/qianjs_default_plugins.g.h" "${_glue}${_fn}${_lazy}")
 endfunction()
 
 set_property(GLOBAL PROPERTY QIANJS_PLUGIN_SPECS "")
 
+qianjs_native_register_module(child_process ChildProcessPlugin native/child_process/child_process_module.h)
 qianjs_native_register_module(console ConsolePlugin native/console/console_module.h)
 qianjs_native_register_module(fs FsPlugin native/fs/fs_module.h)
+qianjs_native_register_module(http HttpPlugin native/http/http_module.h)
+qianjs_native_register_module(net NetPlugin native/net/net_module.h)
 qianjs_native_register_module(process ProcessPlugin native/process/process_module.h)
 qianjs_native_register_module(timers TimersPlugin native/timers/timers_module.h)
+# Eager: a worker's script must be attached to its parent (port, terminate interrupt) before it runs.
+qianjs_native_register_module(worker WorkerPlugin native/worker/worker_module.h EAGER)
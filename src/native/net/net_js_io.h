@@ -0,0 +1,130 @@
+#pragma once
+
+#include "runtime/output/std_output.h"
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace qianjs::net {
+
+/**
+ * Bytes of a string, ArrayBuffer or TypedArray, borrowed for one synchronous call: buffer memory is used in place,
+ * strings through `JS_ToCStringLen` (UTF-8, released by the destructor). Valid until JS runs again.
+ */
+class JsBytes {
+public:
+    explicit JsBytes(JSContext* c) : ctx_(c) {}
+    ~JsBytes() {
+        if (cstr_)
+            JS_FreeCString(ctx_, cstr_);
+    }
+    JsBytes(const JsBytes&) = delete;
+    JsBytes& operator=(const JsBytes&) = delete;
+
+    /** False (nothing pending) for other value types and detached buffers. */
+    bool from(JSValue v) {
+        if (JS_IsString(v)) {
+            cstr_ = JS_ToCStringLen(ctx_, &len_, v);
+            data_ = cstr_;
+            return cstr_ != nullptr;
+        }
+        size_t sz = 0;
+        if (uint8_t* raw = JS_GetArrayBuffer(ctx_, &sz, v)) {
+            data_ = reinterpret_cast<const char*>(raw);
+            len_ = sz;
+            return true;
+        }
+        JS_FreeValue(ctx_, JS_GetException(ctx_));
+
+        size_t boff = 0, blen = 0, bpe = 0;
+        JSValue buf = JS_GetTypedArrayBuffer(ctx_, v, &boff, &blen, &bpe);
+        if (JS_IsException(buf)) {
+            JS_FreeValue(ctx_, JS_GetException(ctx_));
+            return false;
+        }
+        size_t ablen = 0;
+        uint8_t* base = JS_GetArrayBuffer(ctx_, &ablen, buf);
+        JS_FreeValue(ctx_, buf);
+        if (!base || boff > ablen || blen > ablen - boff) {
+            JS_FreeValue(ctx_, JS_GetException(ctx_));
+            return false;
+        }
+        data_ = reinterpret_cast<const char*>(base + boff);
+        len_ = blen;
+        return true;
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return len_; }
+
+private:
+    JSContext* ctx_;
+    const char* cstr_ = nullptr;
+    const char* data_ = nullptr;
+    size_t len_ = 0;
+};
+
+/** Takes the pending exception and prints it as `<what> exception: <message>`, like the timers callbacks. */
+inline void printPendingException(JSContext* c, const char* what) {
+    JSValue exc = JS_GetException(c);
+    const char* msg = JS_ToCString(c, exc);
+    if (msg) {
+        qianjs::output::report(std::string(what) + " exception: " + msg + "\n");
+        JS_FreeCString(c, msg);
+    } else {
+        qianjs::output::report(std::string(what) + " exception\n");
+    }
+    JS_FreeValue(c, exc);
+}
+
+/** `{ host, port, backlog }` for `createServer` in `net` and `http`. */
+struct ListenOptions {
+    std::string host = "127.0.0.1";
+    int port = 0;
+    int backlog = 511;
+};
+
+/** Reads `ListenOptions` from `v` (undefined allowed); false with an exception set. `fn` prefixes messages. */
+inline bool parseListenOptions(JSContext* c, JSValue v, ListenOptions& out, const char* fn) {
+    if (JS_IsUndefined(v))
+        return true;
+    JSValue host = JS_GetPropertyStr(c, v, "host");
+    if (JS_IsException(host))
+        return false;
+    if (!JS_IsUndefined(host)) {
+        const char* s = JS_ToCString(c, host);
+        JS_FreeValue(c, host);
+        if (!s)
+            return false;
+        out.host = s;
+        JS_FreeCString(c, s);
+    }
+
+    const char* keys[2] = {"port", "backlog"};
+    int* fields[2] = {&out.port, &out.backlog};
+    for (int i = 0; i < 2; i++) {
+        JSValue n = JS_GetPropertyStr(c, v, keys[i]);
+        if (JS_IsException(n))
+            return false;
+        if (JS_IsUndefined(n))
+            continue;
+        int32_t value = 0;
+        const int r = JS_ToInt32(c, &value, n);
+        JS_FreeValue(c, n);
+        if (r < 0)
+            return false;
+        *fields[i] = value;
+    }
+    if (out.port < 0 || out.port > 65535) {
+        JS_ThrowRangeError(c, "%s: port must be between 0 and 65535", fn);
+        return false;
+    }
+    if (out.backlog < 1)
+        out.backlog = 1;
+    return true;
+}
+
+} // namespace qianjs::net
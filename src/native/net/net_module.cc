@@ -0,0 +1,458 @@
+#include "native/net/net_module.h"
+
+#include "native/net/net_js_io.h"
+#include "native/net/net_read_pool.h"
+#include "native/net/net_stream.h"
+
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/profiler/sampling_profiler.h"
+
+#include <js_engine.h>
+#include <js_module.h>
+#include <js_types.h>
+
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using qianjs::net::TcpServer;
+using qianjs::net::TcpStream;
+
+struct Server {
+    TcpServer* server = nullptr;
+    JSValue on_connection = JS_UNDEFINED;
+};
+
+struct Socket {
+    TcpStream* stream = nullptr;
+    /** Set while a `read` is pending. */
+    JSValue on_data = JS_UNDEFINED;
+    qjs::JSEngine::PromiseHandle read{};
+    int64_t bytes_read = 0;
+    std::vector<qjs::JSEngine::PromiseHandle> drains;
+};
+
+/**
+ * Per-engine sockets and servers on the engine's loop, addressed from JS by numeric id (like timers). Every open
+ * server, open socket and pending connect is one pending operation, so the host keeps running until they are closed.
+ * Callbacks run on the JS thread straight from libuv's.
+ */
+class NetState final : public qianjs::net::StreamListener {
+public:
+    explicit NetState(qjs::JSEngine& engine)
+        : engine_(engine),
+          rt_(JS_GetRuntime(engine.ctx())),
+          loop_(qianjs::event_loop::EventLoop::of(engine)),
+          alive_(std::make_shared<bool>(true)) {}
+
+    /** Engine teardown with sockets still open: close the handles, drop the callbacks, promises and op counts. */
+    ~NetState() override {
+        *alive_ = false;
+        for (auto& [id, s] : sockets_) {
+            s.stream->setListener(nullptr, 0);
+            s.stream->close();
+            JS_FreeValueRT(rt_, s.on_data);
+            if (s.read.ptr)
+                engine_.freePromise(s.read);
+            for (qjs::JSEngine::PromiseHandle ph : s.drains)
+                engine_.freePromise(ph);
+            loop_.end_operation();
+        }
+        for (auto& [id, s] : servers_) {
+            s.server->close();
+            JS_FreeValueRT(rt_, s.on_connection);
+            loop_.end_operation();
+        }
+        for (auto& [id, ph] : connects_) {
+            engine_.freePromise(ph);
+            loop_.end_operation();
+        }
+    }
+
+    JSValue listen(JSContext* c, JSValue on_connection, const qianjs::net::ListenOptions& options) {
+        const int64_t id = next_id_++;
+        int err = 0;
+        TcpServer* server = TcpServer::listen(loop_.uv_loop(), options.host, options.port, options.backlog,
+            [this, id](TcpStream* stream) { accept(id, stream); }, &err);
+        if (!server)
+            return JS_ThrowTypeError(c, "createServer: %s", qianjs::net::uvMessage(err).c_str());
+        servers_[id] = Server{server, JS_DupValue(c, on_connection)};
+        loop_.begin_operation();
+        return JS_NewInt64(c, id);
+    }
+
+    int serverPort(int64_t id) const {
+        auto it = servers_.find(id);
+        return it == servers_.end() ? 0 : it->second.server->port();
+    }
+
+    void closeServer(int64_t id) {
+        auto it = servers_.find(id);
+        if (it == servers_.end())
+            return;
+        it->second.server->close();
+        JS_FreeValue(engine_.ctx(), it->second.on_connection);
+        servers_.erase(it);
+        loop_.end_operation();
+    }
+
+    qjs::RawJSValue connect(const std::string& host, int port) {
+        qjs::JSEngine::PromiseHandle ph = engine_.createPromise();
+        if (!ph.ptr)
+            return engine_.promiseValue(ph);
+        const qjs::RawJSValue promise = engine_.promiseValue(ph);
+
+        const int64_t connect_id = next_id_++;
+        connects_[connect_id] = ph;
+        loop_.begin_operation();
+        std::shared_ptr<bool> alive = alive_;
+        const auto done = [this, alive, connect_id, ph](TcpStream* stream, int status) {
+            if (!*alive) {
+                if (stream)
+                    stream->close();
+                return;
+            }
+            connects_.erase(connect_id);
+            loop_.end_operation();
+            if (!stream) {
+                engine_.rejectPromise(ph, qianjs::net::uvMessage(status), uv_err_name(status));
+            } else {
+                const int64_t id = adopt(stream);
+                engine_.resolvePromiseJSValue(ph, JS_NewInt64(engine_.ctx(), id));
+            }
+            engine_.freePromise(ph);
+        };
+        qianjs::net::connectTcp(loop_.uv_loop(), host, port, done);
+        return promise;
+    }
+
+    JSValue read(JSContext* c, int64_t id, JSValue on_data) {
+        Socket* s = find(id);
+        if (!s)
+            return JS_ThrowTypeError(c, "read: unknown socket %lld", static_cast<long long>(id));
+        if (s->read.ptr)
+            return JS_ThrowTypeError(c, "read: socket is already being read");
+
+        qjs::JSEngine::PromiseHandle ph = engine_.createPromise();
+        if (!ph.ptr)
+            return qjs::JSConv<qjs::RawJSValue>::to(c, engine_.promiseValue(ph));
+        const JSValue promise = qjs::JSConv<qjs::RawJSValue>::to(c, engine_.promiseValue(ph));
+        if (s->stream->peerEnded()) {
+            engine_.resolvePromiseJSValue(ph, JS_NewInt64(c, 0));
+            engine_.freePromise(ph);
+            return promise;
+        }
+        s->read = ph;
+        s->bytes_read = 0;
+        s->on_data = JS_DupValue(c, on_data);
+        const int r = s->stream->startReading();
+        if (r < 0)
+            settle_read(*s, r);
+        return promise;
+    }
+
+    void pause(int64_t id) {
+        if (Socket* s = find(id))
+            s->stream->stopReading();
+    }
+
+    void resume(int64_t id) {
+        Socket* s = find(id);
+        if (s && s->read.ptr)
+            s->stream->startReading();
+    }
+
+    /** Bytes still queued after the write (0: all handed to the kernel), or JS_EXCEPTION. */
+    JSValue write(JSContext* c, int64_t id, JSValue data) {
+        Socket* s = find(id);
+        if (!s)
+            return JS_ThrowTypeError(c, "write: unknown socket %lld", static_cast<long long>(id));
+
+        int r = 0;
+        if (JS_IsArray(c, data) > 0) {
+            JSValue len_v = JS_GetPropertyStr(c, data, "length");
+            uint32_t n = 0;
+            const int lr = JS_ToUint32(c, &n, len_v);
+            JS_FreeValue(c, len_v);
+            if (lr < 0)
+                return JS_EXCEPTION;
+            // Chunks are borrowed until the call returns; one `writev` covers them all.
+            std::vector<std::unique_ptr<qianjs::net::JsBytes>> chunks;
+            std::vector<uv_buf_t> bufs;
+            chunks.reserve(n);
+            bufs.reserve(n);
+            for (uint32_t i = 0; i < n; i++) {
+                JSValue item = JS_GetPropertyUint32(c, data, i);
+                chunks.push_back(std::make_unique<qianjs::net::JsBytes>(c));
+                const bool ok = chunks.back()->from(item);
+                JS_FreeValue(c, item);
+                if (!ok)
+                    return JS_ThrowTypeError(c, "write: data[%u] must be string, ArrayBuffer, or TypedArray", i);
+                bufs.push_back(uv_buf_init(const_cast<char*>(chunks.back()->data()),
+                    static_cast<unsigned>(chunks.back()->size())));
+            }
+            r = s->stream->write(bufs.data(), static_cast<unsigned>(bufs.size()));
+        } else {
+            qianjs::net::JsBytes bytes(c);
+            if (!bytes.from(data))
+                return JS_ThrowTypeError(c, "write: data must be string, ArrayBuffer, TypedArray, or an array of them");
+            const uv_buf_t buf = uv_buf_init(const_cast<char*>(bytes.data()), static_cast<unsigned>(bytes.size()));
+            r = s->stream->write(&buf, 1);
+        }
+        if (r < 0)
+            return JS_ThrowTypeError(c, "write: %s", qianjs::net::uvMessage(r).c_str());
+        return JS_NewInt64(c, static_cast<int64_t>(s->stream->queuedBytes()));
+    }
+
+    qjs::RawJSValue drain(int64_t id) {
+        qjs::JSEngine::PromiseHandle ph = engine_.createPromise();
+        if (!ph.ptr)
+            return engine_.promiseValue(ph);
+        const qjs::RawJSValue promise = engine_.promiseValue(ph);
+        Socket* s = find(id);
+        if (!s || s->stream->queuedBytes() == 0) {
+            engine_.resolvePromiseVoid(ph);
+            engine_.freePromise(ph);
+        } else {
+            s->drains.push_back(ph);
+        }
+        return promise;
+    }
+
+    void end(int64_t id) {
+        if (Socket* s = find(id))
+            s->stream->end();
+    }
+
+    void close(int64_t id) {
+        if (Socket* s = find(id))
+            s->stream->close();
+    }
+
+    std::string remoteAddress(int64_t id) {
+        Socket* s = find(id);
+        return s ? s->stream->remoteAddress() : std::string();
+    }
+
+    void onRead(TcpStream& stream, char* data, size_t len) override {
+        Socket* s = find(stream.id());
+        if (!s || !s->read.ptr)
+            return;
+        JSContext* c = engine_.ctx();
+        JSValue ab = len >= qianjs::net::kZeroCopyMinRead
+            ? qianjs::net::readBlockToArrayBuffer(c, stream.takeReadBlock(), len)
+            : JS_NewArrayBufferCopy(c, reinterpret_cast<const uint8_t*>(data), len);
+        if (JS_IsException(ab)) {
+            JS_FreeValue(c, JS_GetException(c));
+            stream.close();
+            return;
+        }
+        s->bytes_read += static_cast<int64_t>(len);
+
+        const qianjs::profiler::TaskFrame task("net");
+        JSValue fn = JS_DupValue(c, s->on_data);
+        JSValue ret = JS_Call(c, fn, JS_UNDEFINED, 1, &ab);
+        JS_FreeValue(c, fn);
+        JS_FreeValue(c, ab);
+        if (!JS_IsException(ret)) {
+            JS_FreeValue(c, ret);
+            return;
+        }
+        // Like `readChunks`: a throwing callback rejects the read and ends the stream.
+        JSValue exc = JS_GetException(c);
+        const char* msg = JS_ToCString(c, exc);
+        s = find(stream.id());
+        if (s && s->read.ptr) {
+            engine_.rejectPromise(s->read, msg ? msg : "read: callback threw");
+            engine_.freePromise(s->read);
+            s->read = {};
+            JS_FreeValue(c, s->on_data);
+            s->on_data = JS_UNDEFINED;
+        }
+        if (msg)
+            JS_FreeCString(c, msg);
+        JS_FreeValue(c, exc);
+        stream.close();
+    }
+
+    void onEnd(TcpStream& stream, int status) override {
+        Socket* s = find(stream.id());
+        if (!s)
+            return;
+        settle_read(*s, status == UV_EOF ? 0 : status);
+        if (status == UV_EOF) {
+            // No half-open sockets: once the peer is done, finish our side after queued writes.
+            stream.end();
+        } else {
+            settle_drains(*s, status);
+        }
+    }
+
+    void onDrain(TcpStream& stream) override {
+        if (Socket* s = find(stream.id()))
+            settle_drains(*s, 0);
+    }
+
+    void onClose(TcpStream& stream) override {
+        auto it = sockets_.find(stream.id());
+        if (it == sockets_.end())
+            return;
+        settle_read(it->second, 0);
+        settle_drains(it->second, 0);
+        sockets_.erase(it);
+        loop_.end_operation();
+    }
+
+private:
+    Socket* find(int64_t id) {
+        auto it = sockets_.find(id);
+        return it == sockets_.end() || it->second.stream->closing() ? nullptr : &it->second;
+    }
+
+    int64_t adopt(TcpStream* stream) {
+        const int64_t id = next_id_++;
+        stream->setListener(this, id);
+        sockets_[id].stream = stream;
+        loop_.begin_operation();
+        return id;
+    }
+
+    void accept(int64_t server_id, TcpStream* stream) {
+        auto it = servers_.find(server_id);
+        if (it == servers_.end()) {
+            stream->close();
+            return;
+        }
+        const int64_t id = adopt(stream);
+        JSContext* c = engine_.ctx();
+        const qianjs::profiler::TaskFrame task("net");
+        JSValue fn = JS_DupValue(c, it->second.on_connection);
+        JSValue arg = JS_NewInt64(c, id);
+        JSValue ret = JS_Call(c, fn, JS_UNDEFINED, 1, &arg);
+        JS_FreeValue(c, fn);
+        if (JS_IsException(ret))
+            qianjs::net::printPendingException(c, "net connection callback");
+        else
+            JS_FreeValue(c, ret);
+    }
+
+    /** Resolves a pending read with the bytes delivered (`status == 0`) or rejects it with the uv error. */
+    void settle_read(Socket& s, int status) {
+        if (!s.read.ptr)
+            return;
+        if (status < 0)
+            engine_.rejectPromise(s.read, qianjs::net::uvMessage(status), uv_err_name(status));
+        else
+            engine_.resolvePromiseJSValue(s.read, JS_NewInt64(engine_.ctx(), s.bytes_read));
+        engine_.freePromise(s.read);
+        s.read = {};
+        JS_FreeValue(engine_.ctx(), s.on_data);
+        s.on_data = JS_UNDEFINED;
+    }
+
+    void settle_drains(Socket& s, int status) {
+        std::vector<qjs::JSEngine::PromiseHandle> drains = std::move(s.drains);
+        s.drains.clear();
+        for (qjs::JSEngine::PromiseHandle ph : drains) {
+            if (status < 0)
+                engine_.rejectPromise(ph, qianjs::net::uvMessage(status), uv_err_name(status));
+            else
+                engine_.resolvePromiseVoid(ph);
+            engine_.freePromise(ph);
+        }
+    }
+
+    qjs::JSEngine& engine_;
+    JSRuntime* rt_;
+    qianjs::event_loop::EventLoop& loop_;
+    std::shared_ptr<bool> alive_;
+    std::unordered_map<int64_t, Server> servers_;
+    std::unordered_map<int64_t, Socket> sockets_;
+    /** Connects in flight, settled by their callback or freed with the state. */
+    std::unordered_map<int64_t, qjs::JSEngine::PromiseHandle> connects_;
+    int64_t next_id_ = 1;
+};
+
+} // namespace
+
+const char* NetPlugin::name() const {
+    return "net";
+}
+
+void NetPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
+    qianjs::event_loop::EventLoop::of(engine).ensure_started();
+#ifdef SIGPIPE
+    // A peer resetting the connection must fail the write with EPIPE, not kill the host.
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    auto state = std::make_shared<NetState>(engine);
+    auto& m = root.module("net");
+
+    m.funcDynamic("createServer", 1, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("net");
+        if (!JS_IsFunction(c, argv[0]))
+            return JS_ThrowTypeError(c, "createServer: onConnection must be a function");
+        qianjs::net::ListenOptions options;
+        if (!qianjs::net::parseListenOptions(c, argc > 1 ? argv[1] : JS_UNDEFINED, options, "createServer"))
+            return JS_EXCEPTION;
+        return state->listen(c, argv[0], options);
+    });
+    m.func("serverPort", [state](int64_t id) { return state->serverPort(id); });
+    m.func("closeServer", [state](int64_t id) { state->closeServer(id); });
+
+    m.funcDynamic("connect", 2, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("net");
+        (void)argc;
+        bool ok = false;
+        const std::string host = qjs::JSConv<std::string>::from(c, argv[0], ok);
+        if (!ok)
+            return JS_EXCEPTION;
+        int32_t port = 0;
+        if (JS_ToInt32(c, &port, argv[1]) < 0)
+            return JS_EXCEPTION;
+        if (port <= 0 || port > 65535)
+            return JS_ThrowRangeError(c, "connect: port must be between 1 and 65535");
+        return qjs::JSConv<qjs::RawJSValue>::to(c, state->connect(host, port));
+    });
+
+    m.funcDynamic("read", 2, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("net");
+        (void)argc;
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        if (!JS_IsFunction(c, argv[1]))
+            return JS_ThrowTypeError(c, "read: onData must be a function");
+        return state->read(c, id, argv[1]);
+    });
+
+    m.funcDynamic("write", 2, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("net");
+        (void)argc;
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        return state->write(c, id, argv[1]);
+    });
+
+    m.funcDynamic("drain", 1, 1, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        const qianjs::profiler::NativeFrame frame("net");
+        (void)argc;
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        return qjs::JSConv<qjs::RawJSValue>::to(c, state->drain(id));
+    });
+
+    m.func("pause", [state](int64_t id) { state->pause(id); });
+    m.func("resume", [state](int64_t id) { state->resume(id); });
+    m.func("end", [state](int64_t id) { state->end(id); });
+    m.func("close", [state](int64_t id) { state->close(id); });
+    m.func("remoteAddress", [state](int64_t id) { return state->remoteAddress(id); });
+}
@@ -0,0 +1,64 @@
+#include "native/net/net_read_pool.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace qianjs::net {
+
+namespace {
+
+class ReadPool {
+public:
+    static constexpr size_t kMaxBlocks = 32;
+
+    ~ReadPool() {
+        for (char* b : free_)
+            std::free(b);
+    }
+
+    char* acquire() {
+        if (!free_.empty()) {
+            char* b = free_.back();
+            free_.pop_back();
+            return b;
+        }
+        return static_cast<char*>(std::malloc(kReadBlockSize));
+    }
+
+    void release(char* block) {
+        if (free_.size() < kMaxBlocks)
+            free_.push_back(block);
+        else
+            std::free(block);
+    }
+
+private:
+    std::vector<char*> free_;
+};
+
+thread_local ReadPool t_read_pool;
+
+void release_block(JSRuntime*, void*, void* ptr) {
+    t_read_pool.release(static_cast<char*>(ptr));
+}
+
+} // namespace
+
+char* acquireReadBlock() {
+    return t_read_pool.acquire();
+}
+
+void releaseReadBlock(char* block) {
+    if (block)
+        t_read_pool.release(block);
+}
+
+JSValue readBlockToArrayBuffer(JSContext* c, char* block, size_t len) {
+    JSValue ab = JS_NewArrayBuffer(c, reinterpret_cast<uint8_t*>(block), len, release_block, nullptr, 0);
+    if (JS_IsException(ab))
+        t_read_pool.release(block);
+    return ab;
+}
+
+} // namespace qianjs::net
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <cstddef>
+
+namespace qianjs::net {
+
+/** Capacity of one pooled socket read block (what libuv suggests for stream reads). */
+constexpr size_t kReadBlockSize = 64 * 1024;
+
+/**
+ * Reads at least this long leave the pool as ArrayBuffer storage (no copy); shorter ones are copied into a fresh
+ * ArrayBuffer so a small chunk kept alive by JS does not pin a whole block.
+ */
+constexpr size_t kZeroCopyMinRead = 16 * 1024;
+
+/**
+ * Thread-local free list of `kReadBlockSize` blocks: a stream holds one block across reads, and hands it over only
+ * when a read is given to JS without copying. The ArrayBuffer finalizer runs on the engine's (JS) thread, which is
+ * also the loop thread, so no locking.
+ */
+char* acquireReadBlock();
+void releaseReadBlock(char* block);
+
+/** The first `len` bytes of `block` as an ArrayBuffer that owns it; on failure the block is released. */
+JSValue readBlockToArrayBuffer(JSContext* c, char* block, size_t len);
+
+} // namespace qianjs::net
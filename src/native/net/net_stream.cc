@@ -0,0 +1,382 @@
+#include "native/net/net_stream.h"
+
+#include "native/net/net_read_pool.h"
+
+#include <cstring>
+#include <utility>
+
+namespace qianjs::net {
+
+namespace {
+
+/** Queued bytes are appended to the last chunk until it reaches this size. */
+constexpr size_t kQueueChunk = 64 * 1024;
+
+/** `host` as a socket address: IPv4, IPv6 (brackets allowed) or `localhost`; UV_EINVAL for names needing DNS. */
+int numeric_address(const std::string& host, int port, sockaddr_storage* out) {
+    std::string h = host.empty() || host == "localhost" ? "127.0.0.1" : host;
+    if (h.size() > 2 && h.front() == '[' && h.back() == ']')
+        h = h.substr(1, h.size() - 2);
+    std::memset(out, 0, sizeof(*out));
+    if (uv_ip4_addr(h.c_str(), port, reinterpret_cast<sockaddr_in*>(out)) == 0)
+        return 0;
+    if (uv_ip6_addr(h.c_str(), port, reinterpret_cast<sockaddr_in6*>(out)) == 0)
+        return 0;
+    return UV_EINVAL;
+}
+
+std::string format_address(const sockaddr_storage& addr) {
+    char ip[64] = {0};
+    if (addr.ss_family == AF_INET) {
+        const auto* in = reinterpret_cast<const sockaddr_in*>(&addr);
+        uv_ip4_name(in, ip, sizeof(ip));
+        return std::string(ip) + ':' + std::to_string(ntohs(in->sin_port));
+    }
+    if (addr.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+        uv_ip6_name(in6, ip, sizeof(ip));
+        return '[' + std::string(ip) + "]:" + std::to_string(ntohs(in6->sin6_port));
+    }
+    return {};
+}
+
+/** State of one `connectTcp` call; deleted once `done` has run. */
+struct ConnectCtx {
+    uv_getaddrinfo_t resolve_req{};
+    uv_connect_t connect_req{};
+    uv_loop_t* loop = nullptr;
+    TcpStream* stream = nullptr;
+    ConnectFn done;
+};
+
+void connect_finish(ConnectCtx* ctx, int status) {
+    TcpStream* stream = ctx->stream;
+    if (status < 0 && stream) {
+        stream->close();
+        stream = nullptr;
+    }
+    ConnectFn done = std::move(ctx->done);
+    delete ctx;
+    done(stream, status);
+}
+
+void connect_to(ConnectCtx* ctx, const sockaddr* addr) {
+    int err = 0;
+    ctx->stream = TcpStream::create(ctx->loop, &err);
+    if (!ctx->stream) {
+        connect_finish(ctx, err);
+        return;
+    }
+    const int r = uv_tcp_connect(&ctx->connect_req, ctx->stream->tcp(), addr, [](uv_connect_t* req, int status) {
+        connect_finish(static_cast<ConnectCtx*>(req->data), status);
+    });
+    if (r < 0)
+        connect_finish(ctx, r);
+}
+
+} // namespace
+
+std::string uvMessage(int status) {
+    return std::string(uv_err_name(status)) + ": " + uv_strerror(status);
+}
+
+TcpStream* TcpStream::create(uv_loop_t* loop, int* err) {
+    auto* s = new TcpStream();
+    const int r = uv_tcp_init(loop, &s->tcp_);
+    if (r < 0) {
+        delete s;
+        *err = r;
+        return nullptr;
+    }
+    s->tcp_.data = s;
+    s->write_req_.data = s;
+    s->shutdown_req_.data = s;
+    // Responses are written whole; never hold a small tail back for Nagle.
+    uv_tcp_nodelay(&s->tcp_, 1);
+    return s;
+}
+
+TcpStream::~TcpStream() {
+    releaseReadBlock(block_);
+}
+
+int TcpStream::startReading() {
+    if (reading_ || closing_ || eof_)
+        return 0;
+    const int r = uv_read_start(stream(), on_alloc, on_read);
+    if (r == 0)
+        reading_ = true;
+    return r;
+}
+
+void TcpStream::stopReading() {
+    if (!reading_)
+        return;
+    uv_read_stop(stream());
+    reading_ = false;
+}
+
+char* TcpStream::takeReadBlock() {
+    char* b = block_;
+    block_ = nullptr;
+    return b;
+}
+
+int TcpStream::write(const uv_buf_t* bufs, unsigned count) {
+    if (closing_ || ending_)
+        return UV_EPIPE;
+    size_t total = 0;
+    for (unsigned i = 0; i < count; i++)
+        total += bufs[i].len;
+    if (total == 0)
+        return 0;
+
+    size_t done = 0;
+    if (!writing_ && queued_.empty()) {
+        const int r = uv_try_write(stream(), bufs, count);
+        if (r < 0 && r != UV_EAGAIN && r != UV_ENOSYS)
+            return r;
+        if (r > 0)
+            done = static_cast<size_t>(r);
+        if (done == total)
+            return 0;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        size_t len = bufs[i].len;
+        const char* p = bufs[i].base;
+        if (done >= len) {
+            done -= len;
+            continue;
+        }
+        p += done;
+        len -= done;
+        done = 0;
+        if (queued_.empty() || queued_.back().size() >= kQueueChunk)
+            queued_.emplace_back();
+        queued_.back().append(p, len);
+        queued_bytes_ += len;
+    }
+    if (!writing_)
+        flush();
+    return 0;
+}
+
+void TcpStream::flush() {
+    in_flight_.swap(queued_);
+    in_flight_bytes_ = queued_bytes_;
+    queued_bytes_ = 0;
+
+    std::vector<uv_buf_t> bufs;
+    bufs.reserve(in_flight_.size());
+    for (std::string& chunk : in_flight_)
+        bufs.push_back(uv_buf_init(chunk.data(), static_cast<unsigned>(chunk.size())));
+    const int r = uv_write(&write_req_, stream(), bufs.data(), static_cast<unsigned>(bufs.size()), on_write);
+    if (r < 0) {
+        in_flight_.clear();
+        in_flight_bytes_ = 0;
+        fail(r);
+        return;
+    }
+    writing_ = true;
+}
+
+void TcpStream::end() {
+    if (ending_ || closing_)
+        return;
+    ending_ = true;
+    if (!writing_)
+        shutdown_now();
+}
+
+void TcpStream::shutdown_now() {
+    const int r = uv_shutdown(&shutdown_req_, stream(), on_shutdown);
+    if (r < 0) {
+        close();
+        return;
+    }
+    // The stream closes on the peer's EOF, so keep reading even if the owner paused.
+    startReading();
+}
+
+void TcpStream::close() {
+    if (closing_)
+        return;
+    closing_ = true;
+    stopReading();
+    uv_close(reinterpret_cast<uv_handle_t*>(&tcp_), on_close);
+}
+
+void TcpStream::fail(int status) {
+    if (closing_)
+        return;
+    if (listener_)
+        listener_->onEnd(*this, status);
+    close();
+}
+
+std::string TcpStream::remoteAddress() const {
+    sockaddr_storage addr{};
+    int len = sizeof(addr);
+    if (uv_tcp_getpeername(&tcp_, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+        return {};
+    return format_address(addr);
+}
+
+void TcpStream::on_alloc(uv_handle_t* handle, size_t, uv_buf_t* buf) {
+    auto* s = static_cast<TcpStream*>(handle->data);
+    if (!s->block_)
+        s->block_ = acquireReadBlock();
+    buf->base = s->block_;
+    buf->len = s->block_ ? kReadBlockSize : 0;
+}
+
+void TcpStream::on_read(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf) {
+    auto* s = static_cast<TcpStream*>(handle->data);
+    if (nread > 0) {
+        if (s->listener_ && !s->closing_)
+            s->listener_->onRead(*s, buf->base, static_cast<size_t>(nread));
+        return;
+    }
+    if (nread == 0)
+        return;
+    if (nread != UV_EOF) {
+        s->fail(static_cast<int>(nread));
+        return;
+    }
+    s->eof_ = true;
+    s->stopReading();
+    if (s->listener_)
+        s->listener_->onEnd(*s, UV_EOF);
+    if (s->shut_ || !s->listener_)
+        s->close();
+}
+
+void TcpStream::on_write(uv_write_t* req, int status) {
+    auto* s = static_cast<TcpStream*>(req->data);
+    s->writing_ = false;
+    s->in_flight_.clear();
+    s->in_flight_bytes_ = 0;
+    if (s->closing_)
+        return;
+    if (status < 0) {
+        s->fail(status);
+        return;
+    }
+    if (!s->queued_.empty()) {
+        s->flush();
+        return;
+    }
+    if (s->ending_)
+        s->shutdown_now();
+    if (s->listener_ && !s->closing_)
+        s->listener_->onDrain(*s);
+}
+
+void TcpStream::on_shutdown(uv_shutdown_t* req, int status) {
+    auto* s = static_cast<TcpStream*>(req->data);
+    if (s->closing_)
+        return;
+    s->shut_ = true;
+    if (status < 0 || s->eof_)
+        s->close();
+}
+
+void TcpStream::on_close(uv_handle_t* handle) {
+    auto* s = static_cast<TcpStream*>(handle->data);
+    if (s->listener_)
+        s->listener_->onClose(*s);
+    delete s;
+}
+
+TcpServer* TcpServer::listen(uv_loop_t* loop, const std::string& host, int port, int backlog, AcceptFn on_accept,
+                             int* err) {
+    auto* s = new TcpServer();
+    int r = uv_tcp_init(loop, &s->tcp_);
+    if (r < 0) {
+        delete s;
+        *err = r;
+        return nullptr;
+    }
+    s->tcp_.data = s;
+    s->on_accept_ = std::move(on_accept);
+
+    sockaddr_storage addr{};
+    r = numeric_address(host, port, &addr);
+    if (r == 0)
+        r = uv_tcp_bind(&s->tcp_, reinterpret_cast<const sockaddr*>(&addr), 0);
+    if (r == 0)
+        r = uv_listen(reinterpret_cast<uv_stream_t*>(&s->tcp_), backlog, on_connection);
+    if (r < 0) {
+        *err = r;
+        s->close();
+        return nullptr;
+    }
+    return s;
+}
+
+int TcpServer::port() const {
+    sockaddr_storage addr{};
+    int len = sizeof(addr);
+    if (uv_tcp_getsockname(&tcp_, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+        return 0;
+    if (addr.ss_family == AF_INET6)
+        return ntohs(reinterpret_cast<const sockaddr_in6*>(&addr)->sin6_port);
+    return ntohs(reinterpret_cast<const sockaddr_in*>(&addr)->sin_port);
+}
+
+void TcpServer::close() {
+    on_accept_ = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t*>(&tcp_), [](uv_handle_t* h) { delete static_cast<TcpServer*>(h->data); });
+}
+
+void TcpServer::on_connection(uv_stream_t* handle, int status) {
+    auto* s = static_cast<TcpServer*>(handle->data);
+    if (status < 0)
+        return;
+    int err = 0;
+    TcpStream* conn = TcpStream::create(handle->loop, &err);
+    if (!conn)
+        return;
+    if (uv_accept(handle, conn->stream()) != 0 || !s->on_accept_) {
+        conn->close();
+        return;
+    }
+    s->on_accept_(conn);
+}
+
+void connectTcp(uv_loop_t* loop, const std::string& host, int port, ConnectFn done) {
+    auto* ctx = new ConnectCtx();
+    ctx->loop = loop;
+    ctx->done = std::move(done);
+    ctx->resolve_req.data = ctx;
+    ctx->connect_req.data = ctx;
+
+    sockaddr_storage addr{};
+    if (numeric_address(host, port, &addr) == 0) {
+        connect_to(ctx, reinterpret_cast<const sockaddr*>(&addr));
+        return;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    const std::string service = std::to_string(port);
+    const int r = uv_getaddrinfo(loop, &ctx->resolve_req,
+        [](uv_getaddrinfo_t* req, int status, addrinfo* res) {
+            auto* c = static_cast<ConnectCtx*>(req->data);
+            if (status < 0 || !res) {
+                if (res)
+                    uv_freeaddrinfo(res);
+                connect_finish(c, status < 0 ? status : UV_EINVAL);
+                return;
+            }
+            connect_to(c, res->ai_addr);
+            uv_freeaddrinfo(res);
+        },
+        host.c_str(), service.c_str(), &hints);
+    if (r < 0)
+        connect_finish(ctx, r);
+}
+
+} // namespace qianjs::net
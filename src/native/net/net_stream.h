@@ -0,0 +1,156 @@
+#pragma once
+
+#include <uv.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace qianjs::net {
+
+class TcpStream;
+
+/** What a `TcpStream` reports to its owner; every call is on the loop (JS) thread. */
+class StreamListener {
+public:
+    virtual ~StreamListener() = default;
+
+    /** `len` bytes at `data`, inside the stream's read block; `TcpStream::takeReadBlock` keeps them without a copy. */
+    virtual void onRead(TcpStream& stream, char* data, size_t len) = 0;
+    /** The peer finished sending (`status == UV_EOF`) or the stream failed; after a failure it is already closing. */
+    virtual void onEnd(TcpStream& stream, int status) = 0;
+    /** Queued writes were flushed to the kernel; `queuedBytes()` is 0. */
+    virtual void onDrain(TcpStream& stream) = 0;
+    /** The handle is closed; the stream is deleted right after this returns. */
+    virtual void onClose(TcpStream& stream) = 0;
+};
+
+/**
+ * A TCP connection on a raw `uv_tcp_t` (not `uvw::tcp_handle`, whose per-read `new char[]` cannot be pooled). Reads
+ * land in one pooled block (`net_read_pool.h`) that the stream keeps between reads. `write` goes straight to
+ * `uv_try_write` (one `writev` for all buffers) when nothing is queued, and copies only what the kernel did not take;
+ * while a `uv_write` is in flight further writes are appended and sent together as the next `writev`.
+ *
+ * Heap-allocated and self-deleting: `close()` (or a failure) closes the handle and the stream deletes itself after
+ * `onClose`. Owners that go away first call `setListener(nullptr, 0)` and then `close()`.
+ */
+class TcpStream {
+public:
+    /** Writes queued above this make `aboveHighWater()` true; producers should wait for `onDrain`. */
+    static constexpr size_t kHighWaterMark = 64 * 1024;
+
+    /** `uv_tcp_init` on `loop`; nullptr with `*err` set on failure. Accept or connect into `tcp()` next. */
+    static TcpStream* create(uv_loop_t* loop, int* err);
+
+    TcpStream(const TcpStream&) = delete;
+    TcpStream& operator=(const TcpStream&) = delete;
+
+    uv_tcp_t* tcp() { return &tcp_; }
+    uv_stream_t* stream() { return reinterpret_cast<uv_stream_t*>(&tcp_); }
+
+    void setListener(StreamListener* listener, int64_t id) {
+        listener_ = listener;
+        id_ = id;
+    }
+    int64_t id() const { return id_; }
+
+    /** Idempotent; 0 or a uv error. */
+    int startReading();
+    void stopReading();
+    bool reading() const { return reading_; }
+
+    /** Hands the current read block to the caller (who releases it); the next read gets a fresh one. */
+    char* takeReadBlock();
+
+    /** 0, or a uv error when the stream is closing, ended, or the kernel refused the write outright. */
+    int write(const uv_buf_t* bufs, unsigned count);
+    /** Bytes accepted by `write` and not handed to the kernel yet. */
+    size_t queuedBytes() const { return queued_bytes_ + in_flight_bytes_; }
+    bool aboveHighWater() const { return queuedBytes() >= kHighWaterMark; }
+
+    /** Half-close once queued writes are flushed; the stream closes when the peer has ended as well. */
+    void end();
+    /** Close now; queued writes are dropped. */
+    void close();
+    bool closing() const { return closing_; }
+    bool ended() const { return ending_; }
+    bool peerEnded() const { return eof_; }
+
+    /** `ip:port` of the peer, or empty. */
+    std::string remoteAddress() const;
+
+private:
+    TcpStream() = default;
+    ~TcpStream();
+
+    static void on_alloc(uv_handle_t* handle, size_t suggested, uv_buf_t* buf);
+    static void on_read(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf);
+    static void on_write(uv_write_t* req, int status);
+    static void on_shutdown(uv_shutdown_t* req, int status);
+    static void on_close(uv_handle_t* handle);
+
+    void flush();
+    void shutdown_now();
+    void fail(int status);
+
+    uv_tcp_t tcp_{};
+    uv_write_t write_req_{};
+    uv_shutdown_t shutdown_req_{};
+    StreamListener* listener_ = nullptr;
+    int64_t id_ = 0;
+    char* block_ = nullptr;
+    /** Accepted but not yet passed to libuv, coalesced into chunks. */
+    std::vector<std::string> queued_;
+    /** Owned by the `uv_write` in flight. */
+    std::vector<std::string> in_flight_;
+    size_t queued_bytes_ = 0;
+    size_t in_flight_bytes_ = 0;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool ending_ = false;
+    bool shut_ = false;
+    bool eof_ = false;
+    bool closing_ = false;
+};
+
+/** A listening `uv_tcp_t`; accepted connections reach `AcceptFn` with no listener set and not reading yet. */
+class TcpServer {
+public:
+    using AcceptFn = std::function<void(TcpStream* stream)>;
+
+    /** Binds `host:port` (numeric address or `localhost`; port 0 picks one) and listens; nullptr with `*err` set. */
+    static TcpServer* listen(uv_loop_t* loop, const std::string& host, int port, int backlog, AcceptFn on_accept,
+                             int* err);
+
+    TcpServer(const TcpServer&) = delete;
+    TcpServer& operator=(const TcpServer&) = delete;
+
+    /** The bound port (useful after listening on port 0). */
+    int port() const;
+    /** Stops accepting and closes the handle; the server deletes itself once libuv is done with it. */
+    void close();
+
+private:
+    TcpServer() = default;
+
+    static void on_connection(uv_stream_t* handle, int status);
+
+    uv_tcp_t tcp_{};
+    AcceptFn on_accept_;
+};
+
+using ConnectFn = std::function<void(TcpStream* stream, int status)>;
+
+/**
+ * Opens one outgoing connection: `host` is resolved with `uv_getaddrinfo` unless numeric, then connected. `done` gets
+ * the connected stream (status 0, no listener set) or nullptr and a uv error; it may run before this returns. Owners
+ * that can go away first capture an alive flag and close the stream they no longer want.
+ */
+void connectTcp(uv_loop_t* loop, const std::string& host, int port, ConnectFn done);
+
+/** `"<uv_err_name>: <uv_strerror>"`, the message format the fs module rejects with. */
+std::string uvMessage(int status);
+
+} // namespace qianjs::net
@@ -1,5 +1,6 @@
 #include "native/process/process_module.h"
 
+#include "runtime/event_loop/event_loop.h"
 #include "runtime/runtime_context.h"
 
 #include <js_engine.h>
@@ -7,7 +8,16 @@
 #include <js_types.h>
 #include <quickjs.h>
 
+#if QIANJS_HAVE_LIBUV
+#include <uv.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -40,6 +50,9 @@ static const char* platform_id() {
 #endif
 }
 
+/** Bumped by every `chdir`: the working directory is per process, the cached `cwd()` strings are per engine. */
+std::atomic<uint64_t> g_cwd_generation{1};
+
 static std::string current_working_directory() {
     std::error_code ec;
     fs_ns::path p = fs_ns::current_path(ec);
@@ -48,6 +61,172 @@ static std::string current_working_directory() {
     return p.string();
 }
 
+/** Monotonic nanoseconds (`uv_hrtime` when libuv is enabled). */
+static uint64_t hrtime_ns() {
+#if QIANJS_HAVE_LIBUV
+    return uv_hrtime();
+#else
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/** Resident set size in bytes; 0 where it cannot be determined. */
+static uint64_t resident_set_bytes() {
+#if QIANJS_HAVE_LIBUV
+    size_t rss = 0;
+    return uv_resident_set_memory(&rss) == 0 ? rss : 0;
+#elif defined(__linux__)
+    unsigned long long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    const bool ok = std::fscanf(f, "%llu %llu", &pages, &resident) == 2;
+    std::fclose(f);
+    return ok ? resident * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+JSValue memory_usage_to_js(JSContext* c) {
+    JSMemoryUsage u{};
+    JS_ComputeMemoryUsage(JS_GetRuntime(c), &u);
+
+    JSValue detail = JS_NewObject(c);
+    if (JS_IsException(detail))
+        return detail;
+    const std::pair<const char*, int64_t> fields[] = {
+        {"mallocSize", u.malloc_size},
+        {"mallocLimit", u.malloc_limit},
+        {"mallocCount", u.malloc_count},
+        {"memoryUsedSize", u.memory_used_size},
+        {"memoryUsedCount", u.memory_used_count},
+        {"atomCount", u.atom_count},
+        {"atomSize", u.atom_size},
+        {"strCount", u.str_count},
+        {"strSize", u.str_size},
+        {"objCount", u.obj_count},
+        {"objSize", u.obj_size},
+        {"propCount", u.prop_count},
+        {"propSize", u.prop_size},
+        {"shapeCount", u.shape_count},
+        {"shapeSize", u.shape_size},
+        {"jsFuncCount", u.js_func_count},
+        {"jsFuncSize", u.js_func_size},
+        {"jsFuncCodeSize", u.js_func_code_size},
+        {"cFuncCount", u.c_func_count},
+        {"arrayCount", u.array_count},
+        {"fastArrayCount", u.fast_array_count},
+        {"fastArrayElements", u.fast_array_elements},
+        {"binaryObjectCount", u.binary_object_count},
+        {"binaryObjectSize", u.binary_object_size},
+    };
+    for (const auto& [name, value] : fields) {
+        if (JS_SetPropertyStr(c, detail, name, JS_NewInt64(c, value)) < 0) {
+            JS_FreeValue(c, detail);
+            return JS_EXCEPTION;
+        }
+    }
+
+    JSValue obj = JS_NewObject(c);
+    if (JS_IsException(obj)) {
+        JS_FreeValue(c, detail);
+        return obj;
+    }
+    const std::pair<const char*, int64_t> summary[] = {
+        {"rss", static_cast<int64_t>(resident_set_bytes())},
+        {"heapTotal", u.malloc_size},
+        {"heapUsed", u.memory_used_size},
+        {"arrayBuffers", u.binary_object_size},
+    };
+    for (const auto& [name, value] : summary) {
+        if (JS_SetPropertyStr(c, obj, name, JS_NewInt64(c, value)) < 0) {
+            JS_FreeValue(c, detail);
+            JS_FreeValue(c, obj);
+            return JS_EXCEPTION;
+        }
+    }
+    if (JS_SetPropertyStr(c, obj, "quickjs", detail) < 0) {
+        JS_FreeValue(c, obj);
+        return JS_EXCEPTION;
+    }
+    return obj;
+}
+
+/** `{count, mean, p50, p90, p99, max}` of one histogram; times are converted from nanoseconds by `scale`. */
+JSValue histogram_to_js(JSContext* c, const qianjs::event_loop::Histogram& h, double scale) {
+    JSValue obj = JS_NewObject(c);
+    if (JS_IsException(obj))
+        return obj;
+    const std::pair<const char*, double> fields[] = {
+        {"count", static_cast<double>(h.count())},
+        {"mean", h.mean() * scale},
+        {"p50", static_cast<double>(h.percentile(0.5)) * scale},
+        {"p90", static_cast<double>(h.percentile(0.9)) * scale},
+        {"p99", static_cast<double>(h.percentile(0.99)) * scale},
+        {"max", static_cast<double>(h.max()) * scale},
+    };
+    for (const auto& [name, value] : fields) {
+        if (JS_SetPropertyStr(c, obj, name, JS_NewFloat64(c, value)) < 0) {
+            JS_FreeValue(c, obj);
+            return JS_EXCEPTION;
+        }
+    }
+    return obj;
+}
+
+/** `process.loopStats()`: counters always, histograms (milliseconds; `deferredDepth` in tasks) once enabled. */
+JSValue loop_stats_to_js(JSContext* c, const qianjs::event_loop::EventLoop& loop) {
+    using qianjs::event_loop::OpKind;
+    constexpr double kMs = 1e-6;
+    const qianjs::event_loop::LoopMetrics* m = loop.metrics();
+
+    JSValue obj = JS_NewObject(c);
+    if (JS_IsException(obj))
+        return obj;
+    if (JS_SetPropertyStr(c, obj, "enabled", JS_NewBool(c, m != nullptr)) < 0 ||
+        JS_SetPropertyStr(c, obj, "pendingOperations", JS_NewInt32(c, loop.pending_operations())) < 0 ||
+        JS_SetPropertyStr(c, obj, "deferredQueued", JS_NewInt64(c, static_cast<int64_t>(loop.deferred_count()))) < 0) {
+        JS_FreeValue(c, obj);
+        return JS_EXCEPTION;
+    }
+    if (!m)
+        return obj;
+
+    JSValue ops = JS_NewObject(c);
+    if (JS_IsException(ops) || JS_SetPropertyStr(c, obj, "ops", ops) < 0) {
+        JS_FreeValue(c, obj);
+        return JS_EXCEPTION;
+    }
+    for (size_t i = 0; i < static_cast<size_t>(OpKind::Count); i++) {
+        const auto kind = static_cast<OpKind>(i);
+        if (m->op(kind).count() == 0)
+            continue;
+        if (JS_SetPropertyStr(c, ops, opKindName(kind), histogram_to_js(c, m->op(kind), kMs)) < 0) {
+            JS_FreeValue(c, obj);
+            return JS_EXCEPTION;
+        }
+    }
+
+    const std::pair<const char*, const qianjs::event_loop::Histogram*> loops[] = {
+        {"deferredWait", &m->deferredWait},
+        {"turn", &m->turn},
+        {"microtasks", &m->microtasks},
+        {"timerLag", &m->timerLag},
+    };
+    for (const auto& [name, h] : loops) {
+        if (JS_SetPropertyStr(c, obj, name, histogram_to_js(c, *h, kMs)) < 0) {
+            JS_FreeValue(c, obj);
+            return JS_EXCEPTION;
+        }
+    }
+    if (JS_SetPropertyStr(c, obj, "deferredDepth", histogram_to_js(c, m->deferredDepth, 1.0)) < 0) {
+        JS_FreeValue(c, obj);
+        return JS_EXCEPTION;
+    }
+    return obj;
+}
 
 JSValue argv_to_js(JSContext* c, const std::vector<std::string>& argv) {
     JSValue arr = JS_NewArray(c);
@@ -63,7 +242,7 @@ JSValue argv_to_js(JSContext* c, const std::vector<std::string>& argv) {
     return arr;
 }
 
-JSValue env_to_js(JSContext* c, const std::vector<std::pair<std::string, std::string>>& env) {
+JSValue env_to_js(JSContext* c, const qianjs::Environment::Entries& env) {
     JSValue obj = JS_NewObject(c);
     if (JS_IsException(obj))
         return obj;
@@ -77,6 +256,85 @@ JSValue env_to_js(JSContext* c, const std::vector<std::pair<std::string, std::st
     return obj;
 }
 
+/**
+ * Per-engine JS views of `argv`, `env`, `cwd` and the fixed process facts: built on first call (`pid` / `platform` at
+ * install) and handed out again until the source changes (`RuntimeContext::run_id` for argv, `Environment::version`
+ * for env, `chdir` for cwd). Released with the bindings at teardown.
+ */
+class ProcessState {
+public:
+    ProcessState(JSContext* c, qianjs::RuntimeContext* runtime)
+        : rt_(JS_GetRuntime(c)), runtime_(runtime), pid_(current_pid()), platform_(JS_NewString(c, platform_id())) {}
+
+    ~ProcessState() {
+        JS_FreeValueRT(rt_, argv_);
+        JS_FreeValueRT(rt_, env_);
+        JS_FreeValueRT(rt_, cwd_);
+        JS_FreeValueRT(rt_, platform_);
+    }
+
+    ProcessState(const ProcessState&) = delete;
+    ProcessState& operator=(const ProcessState&) = delete;
+
+    JSValue argv(JSContext* c) {
+        if (!runtime_)
+            return JS_NewArray(c);
+        if (JS_IsUndefined(argv_) || argv_run_ != runtime_->run_id) {
+            JSValue arr = argv_to_js(c, runtime_->argv);
+            if (JS_IsException(arr))
+                return arr;
+            JS_FreeValue(c, argv_);
+            argv_ = arr;
+            argv_run_ = runtime_->run_id;
+        }
+        return JS_DupValue(c, argv_);
+    }
+
+    JSValue env(JSContext* c) {
+        if (!runtime_)
+            return JS_UNDEFINED;
+        if (JS_IsUndefined(env_) || env_version_ != runtime_->env.version()) {
+            JSValue obj = env_to_js(c, runtime_->env.entries());
+            if (JS_IsException(obj))
+                return obj;
+            JS_FreeValue(c, env_);
+            env_ = obj;
+            env_version_ = runtime_->env.version();
+        }
+        return JS_DupValue(c, env_);
+    }
+
+    int pid() const { return pid_; }
+
+    JSValue platform(JSContext* c) const { return JS_DupValue(c, platform_); }
+
+    JSValue cwd(JSContext* c) {
+        const uint64_t generation = g_cwd_generation.load(std::memory_order_acquire);
+        if (JS_IsUndefined(cwd_) || cwd_generation_ != generation) {
+            const std::string path = current_working_directory();
+            JSValue s = JS_NewStringLen(c, path.data(), path.size());
+            if (JS_IsException(s))
+                return s;
+            JS_FreeValue(c, cwd_);
+            cwd_ = s;
+            cwd_generation_ = generation;
+        }
+        return JS_DupValue(c, cwd_);
+    }
+
+private:
+    JSRuntime* rt_;
+    qianjs::RuntimeContext* runtime_;
+    JSValue argv_ = JS_UNDEFINED;
+    JSValue env_ = JS_UNDEFINED;
+    JSValue cwd_ = JS_UNDEFINED;
+    uint64_t argv_run_ = 0;
+    uint64_t env_version_ = 0;
+    uint64_t cwd_generation_ = 0;
+    int pid_;
+    JSValue platform_;
+};
+
 } // namespace
 
 const char* ProcessPlugin::name() const {
@@ -85,49 +343,154 @@ const char* ProcessPlugin::name() const {
 
 void ProcessPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
     qianjs::RuntimeContext* runtime = engine.host<qianjs::RuntimeContext>();
+    auto state = std::make_shared<ProcessState>(engine.ctx(), runtime);
     auto& m = root.module("process");
 
-    m.funcDynamic("pid", 0, 0, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+    m.funcDynamic("pid", 0, 0, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        return JS_NewInt32(c, state->pid());
+    });
+
+    m.funcDynamic("platform", 0, 0, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
         (void)argc;
         (void)argv;
-        return JS_NewInt32(c, current_pid());
+        return state->platform(c);
     });
 
-    m.funcDynamic("platform", 0, 0, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+    m.funcDynamic("cwd", 0, 0, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
         (void)argc;
         (void)argv;
-        return JS_NewString(c, platform_id());
+        return state->cwd(c);
+    });
+
+    m.funcDynamic("chdir", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        size_t len = 0;
+        const char* path = JS_ToCStringLen(c, &len, argv[0]);
+        if (!path)
+            return JS_EXCEPTION;
+        std::error_code ec;
+        fs_ns::current_path(fs_ns::path(std::string(path, len)), ec);
+        JS_FreeCString(c, path);
+        if (ec)
+            return JS_ThrowTypeError(c, "chdir: %s", ec.message().c_str());
+        g_cwd_generation.fetch_add(1, std::memory_order_release);
+        return JS_UNDEFINED;
     });
 
-    m.funcDynamic("cwd", 0, 0, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+    m.funcDynamic("hrtime", 0, 0, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
         (void)argc;
         (void)argv;
-        std::string path = current_working_directory();
-        return JS_NewString(c, path.c_str());
+        const uint64_t ns = hrtime_ns();
+        JSValue arr = JS_NewArray(c);
+        if (JS_IsException(arr))
+            return arr;
+        if (JS_SetPropertyUint32(c, arr, 0, JS_NewInt64(c, static_cast<int64_t>(ns / 1000000000u))) < 0 ||
+            JS_SetPropertyUint32(c, arr, 1, JS_NewInt64(c, static_cast<int64_t>(ns % 1000000000u))) < 0) {
+            JS_FreeValue(c, arr);
+            return JS_EXCEPTION;
+        }
+        return arr;
     });
 
-    m.funcDynamic("argv", 0, 0, [runtime](JSContext* c, int argc, JSValue* argv) -> JSValue {
+    m.funcDynamic("hrtimeBigint", 0, 0, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
         (void)argc;
         (void)argv;
-        if (!runtime)
-            return JS_NewArray(c);
-        return argv_to_js(c, runtime->argv);
+        return JS_NewBigUint64(c, hrtime_ns());
+    });
+
+    const uint64_t origin_ns = hrtime_ns();
+    m.funcDynamic("now", 0, 0, [origin_ns](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        return JS_NewFloat64(c, static_cast<double>(hrtime_ns() - origin_ns) / 1e6);
+    });
+
+    m.funcDynamic("memoryUsage", 0, 0, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        return memory_usage_to_js(c);
+    });
+
+    m.funcDynamic("gc", 0, 0, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        JS_RunGC(JS_GetRuntime(c));
+        return JS_UNDEFINED;
+    });
+
+    m.funcDynamic("setGCThreshold", 1, 1, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        int64_t bytes = 0;
+        if (JS_ToInt64(c, &bytes, argv[0]) < 0)
+            return JS_EXCEPTION;
+        // Negative: never trigger the cycle collector from allocation; refcounting still frees acyclic garbage.
+        JS_SetGCThreshold(JS_GetRuntime(c), bytes < 0 ? static_cast<size_t>(-1) : static_cast<size_t>(bytes));
+        return JS_UNDEFINED;
+    });
+
+    qianjs::event_loop::EventLoop* loop = &qianjs::event_loop::EventLoop::of(engine);
+    m.funcDynamic("loopStats", 0, 0, [loop](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        return loop_stats_to_js(c, *loop);
+    });
+
+    m.funcDynamic("enableLoopStats", 0, 0, [loop](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)c;
+        (void)argc;
+        (void)argv;
+        loop->enable_metrics();
+        return JS_UNDEFINED;
+    });
+
+    m.funcDynamic("resetLoopStats", 0, 0, [loop](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)c;
+        (void)argc;
+        (void)argv;
+        if (qianjs::event_loop::LoopMetrics* metrics = loop->metrics())
+            metrics->reset();
+        return JS_UNDEFINED;
     });
 
-    m.funcDynamic("env", 0, 1, [runtime](JSContext* c, int argc, JSValue* argv) -> JSValue {
+    m.funcDynamic("argv", 0, 0, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        return state->argv(c);
+    });
+
+    m.funcDynamic("env", 0, 1, [runtime, state](JSContext* c, int argc, JSValue* argv) -> JSValue {
         if (!runtime)
             return JS_UNDEFINED;
         if (argc == 0)
-            return env_to_js(c, runtime->env);
+            return state->env(c);
 
+        bool ok = false;
+        const std::string key = qjs::JSConv<std::string>::from(c, argv[0], ok);
+        if (!ok)
+            return JS_EXCEPTION;
+        const char* value = runtime->env.get(key);
+        return value ? JS_NewString(c, value) : JS_UNDEFINED;
+    });
+
+    m.funcDynamic("setEnv", 1, 2, [runtime](JSContext* c, int argc, JSValue* argv) -> JSValue {
         bool ok = false;
         std::string key = qjs::JSConv<std::string>::from(c, argv[0], ok);
         if (!ok)
             return JS_EXCEPTION;
-        for (const auto& kv : runtime->env) {
-            if (kv.first == key)
-                return JS_NewString(c, kv.second.c_str());
+        if (key.empty() || key.find('=') != std::string::npos)
+            return JS_ThrowTypeError(c, "setEnv: invalid variable name '%s'", key.c_str());
+        if (!runtime)
+            return JS_UNDEFINED;
+        if (argc < 2 || JS_IsUndefined(argv[1])) {
+            runtime->env.erase(key);
+            return JS_UNDEFINED;
         }
+        std::string value = qjs::JSConv<std::string>::from(c, argv[1], ok);
+        if (!ok)
+            return JS_EXCEPTION;
+        runtime->env.set(std::move(key), std::move(value));
         return JS_UNDEFINED;
     });
 
@@ -141,4 +504,46 @@ void ProcessPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
         if (runtime)
             runtime->exit_code = code;
     });
+
+    m.funcDynamic("logLevel", 0, 0, [runtime](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        return JS_NewString(c, qianjs::logLevelName(runtime ? runtime->log_level : qianjs::LogLevel::Debug));
+    });
+
+    m.funcDynamic("setLogLevel", 1, 1, [runtime](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        bool ok = false;
+        const std::string name = qjs::JSConv<std::string>::from(c, argv[0], ok);
+        if (!ok)
+            return JS_EXCEPTION;
+        qianjs::LogLevel level{};
+        if (!qianjs::parseLogLevel(name, level))
+            return JS_ThrowRangeError(c, "setLogLevel: expected debug, info, warn, error or silent, got '%s'",
+                                      name.c_str());
+        if (runtime)
+            runtime->log_level = level;
+        return JS_UNDEFINED;
+    });
+
+    m.funcDynamic("logFormat", 0, 0, [runtime](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        const bool json = runtime && runtime->log_format == qianjs::LogFormat::Json;
+        return JS_NewString(c, json ? "json" : "text");
+    });
+
+    m.funcDynamic("setLogFormat", 1, 1, [runtime](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        bool ok = false;
+        const std::string name = qjs::JSConv<std::string>::from(c, argv[0], ok);
+        if (!ok)
+            return JS_EXCEPTION;
+        qianjs::LogFormat format{};
+        if (!qianjs::parseLogFormat(name, format))
+            return JS_ThrowRangeError(c, "setLogFormat: expected text or json, got '%s'", name.c_str());
+        if (runtime)
+            runtime->log_format = format;
+        return JS_UNDEFINED;
+    });
 }
@@ -0,0 +1,146 @@
+#include "native/timers/timer_queue.h"
+
+#include "runtime/event_loop/event_loop.h"
+
+#include <uvw.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace qianjs::timers {
+
+namespace {
+
+using uv_ms = uvw::timer_handle::time;
+
+/** Rebuild the heap once at least this many cancelled entries linger and they outnumber live ones. */
+constexpr std::size_t kCompactMinStale = 64;
+
+} // namespace
+
+TimerQueue::TimerQueue(FireFn on_fire, event_loop::EventLoop& loop) : on_fire_(std::move(on_fire)), loop_(loop) {
+    handle_ = loop_.uvw_loop()->resource<uvw::timer_handle>();
+    handle_->on<uvw::timer_event>([this](const uvw::timer_event&, uvw::timer_handle&) { fire_due(); });
+}
+
+TimerQueue::~TimerQueue() {
+    handle_->stop();
+    handle_->close();
+}
+
+void TimerQueue::start(int64_t id, uint64_t delay_ms, uint64_t repeat_ms) {
+    uv_loop_t* lp = loop_.uv_loop();
+    uv_update_time(lp);
+    const uint64_t now = uv_now(lp);
+
+    auto [it, inserted] = active_.try_emplace(id, Slot{0, repeat_ms});
+    if (!inserted) {
+        it->second.repeat_ms = repeat_ms;
+        ++stale_;
+    }
+    push(id, now + delay_ms, it->second);
+    arm();
+}
+
+bool TimerQueue::cancel(int64_t id) {
+    if (active_.erase(id) == 0)
+        return false;
+
+    if (active_.empty()) {
+        heap_.clear();
+        stale_ = 0;
+        arm();
+        return true;
+    }
+
+    ++stale_;
+    if (stale_ >= kCompactMinStale && stale_ * 2 > heap_.size())
+        compact();
+    return true;
+}
+
+void TimerQueue::push(int64_t id, uint64_t due, Slot& slot) {
+    slot.seq = next_seq_++;
+    heap_.push_back(Entry{due, slot.seq, id});
+    std::push_heap(heap_.begin(), heap_.end(), later);
+}
+
+void TimerQueue::fire_due() {
+    armed_due_ = UINT64_MAX;
+    const uint64_t now = uv_now(loop_.uv_loop());
+    // Timers (re)scheduled by callbacks in this pass wait for the next one, so `setTimeout(f, 0)` chains cannot starve I/O.
+    const uint64_t seq_limit = next_seq_;
+
+    while (!heap_.empty()) {
+        const Entry top = heap_.front();
+        if (top.due > now || top.seq >= seq_limit)
+            break;
+        std::pop_heap(heap_.begin(), heap_.end(), later);
+        heap_.pop_back();
+
+        auto it = active_.find(top.id);
+        if (it == active_.end() || it->second.seq != top.seq) {
+            if (stale_ > 0)
+                --stale_;
+            continue;
+        }
+
+        if (event_loop::LoopMetrics* m = loop_.metrics()) {
+            // Same (millisecond) clock as `due`; refreshed so callbacks earlier in this pass count towards the lag.
+            uv_loop_t* lp = loop_.uv_loop();
+            uv_update_time(lp);
+            const uint64_t late = uv_now(lp) - top.due;
+            m->timerLag.record(late * 1000000);
+        }
+
+        const bool repeating = it->second.repeat_ms > 0;
+        if (repeating)
+            push(top.id, now + it->second.repeat_ms, it->second);
+        else
+            active_.erase(it);
+        on_fire_(top.id, repeating);
+    }
+
+    arm();
+}
+
+void TimerQueue::arm() {
+    while (!heap_.empty()) {
+        const Entry& top = heap_.front();
+        auto it = active_.find(top.id);
+        if (it != active_.end() && it->second.seq == top.seq)
+            break;
+        std::pop_heap(heap_.begin(), heap_.end(), later);
+        heap_.pop_back();
+        if (stale_ > 0)
+            --stale_;
+    }
+
+    if (heap_.empty()) {
+        if (armed_due_ != UINT64_MAX) {
+            handle_->stop();
+            armed_due_ = UINT64_MAX;
+        }
+        return;
+    }
+
+    const uint64_t due = heap_.front().due;
+    if (due == armed_due_)
+        return;
+    const uint64_t now = uv_now(loop_.uv_loop());
+    handle_->start(uv_ms{due > now ? due - now : 0}, uv_ms{0});
+    armed_due_ = due;
+}
+
+void TimerQueue::compact() {
+    heap_.erase(std::remove_if(heap_.begin(), heap_.end(),
+                    [this](const Entry& e) {
+                        auto it = active_.find(e.id);
+                        return it == active_.end() || it->second.seq != e.seq;
+                    }),
+        heap_.end());
+    std::make_heap(heap_.begin(), heap_.end(), later);
+    stale_ = 0;
+}
+
+} // namespace qianjs::timers
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "runtime/event_loop/event_loop.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace uvw {
+class timer_handle;
+}
+
+namespace qianjs::timers {
+
+/**
+ * Min-heap of deadlines driven by one `uvw::timer_handle` on the engine's loop (`EventLoop::uvw_loop()`).
+ * The handle is always armed for the earliest deadline; due timers fire from the loop callback, i.e. on the JS
+ * thread inside that loop's `tick()`. Not thread-safe: `start` / `cancel` must be called on the JS thread.
+ *
+ * Cancelled entries are dropped lazily when they reach the top of the heap (or by compaction when they dominate).
+ */
+class TimerQueue {
+public:
+    /** `id` as passed to `start`; `repeating` is false for one-shot timers (already removed when this runs). */
+    using FireFn = std::function<void(int64_t id, bool repeating)>;
+
+    explicit TimerQueue(FireFn on_fire, event_loop::EventLoop& loop = event_loop::EventLoop::current());
+    ~TimerQueue();
+
+    TimerQueue(const TimerQueue&) = delete;
+    TimerQueue& operator=(const TimerQueue&) = delete;
+
+    /** Schedule `id` after `delay_ms`; `repeat_ms > 0` re-arms it with that period. Re-using a live id replaces it. */
+    void start(int64_t id, uint64_t delay_ms, uint64_t repeat_ms);
+
+    /** Idempotent; returns false if `id` was not pending. */
+    bool cancel(int64_t id);
+
+    bool contains(int64_t id) const { return active_.count(id) != 0; }
+    std::size_t size() const { return active_.size(); }
+
+private:
+    struct Entry {
+        uint64_t due;
+        uint64_t seq;
+        int64_t id;
+    };
+
+    struct Slot {
+        uint64_t seq;
+        uint64_t repeat_ms;
+    };
+
+    static bool later(const Entry& a, const Entry& b) {
+        return a.due != b.due ? a.due > b.due : a.seq > b.seq;
+    }
+
+    void push(int64_t id, uint64_t due, Slot& slot);
+    void fire_due();
+    void arm();
+    void compact();
+
+    FireFn on_fire_;
+    event_loop::EventLoop& loop_;
+    std::shared_ptr<uvw::timer_handle> handle_;
+    std::vector<Entry> heap_;
+    std::unordered_map<int64_t, Slot> active_;
+    uint64_t next_seq_ = 0;
+    uint64_t armed_due_ = UINT64_MAX;
+    std::size_t stale_ = 0;
+};
+
+} // namespace qianjs::timers
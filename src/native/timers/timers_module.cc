@@ -1,130 +1,110 @@
 #include "native/timers/timers_module.h"
 
+#include "native/timers/timer_queue.h"
+
 #include "runtime/event_loop/event_loop.h"
+#include "runtime/output/std_output.h"
+#include "runtime/profiler/sampling_profiler.h"
 
 #include <js_engine.h>
 #include <js_module.h>
 
-#include <atomic>
-#include <chrono>
 #include <cstdint>
-#include <iostream>
 #include <memory>
-#include <mutex>
-#include <thread>
+#include <string>
 #include <unordered_map>
 
 namespace {
 
-struct TimerCtx {
-    int64_t id = 0;
-    int64_t delay_ms = 0;
-    bool repeat = false;
-    std::atomic<bool> cancelled{false};
+struct TimerRecord {
     JSValue callback = JS_UNDEFINED;
 };
 
-std::mutex g_timer_mu;
-std::unordered_map<int64_t, std::shared_ptr<TimerCtx>> g_timers;
-std::atomic<int64_t> g_next_timer_id{1};
-
-void clear_timer_impl(int64_t id) {
-    std::shared_ptr<TimerCtx> timer;
-    {
-        std::lock_guard<std::mutex> lock(g_timer_mu);
-        auto it = g_timers.find(id);
-        if (it == g_timers.end())
-            return;
-        timer = it->second;
-        g_timers.erase(it);
+/** Per-engine timer table bound to the engine's loop; every pending timer is one heap entry in `TimerQueue` (no thread, no uv handle). */
+class TimersState {
+public:
+    explicit TimersState(qjs::JSEngine& engine)
+        : engine_(engine),
+          rt_(JS_GetRuntime(engine.ctx())),
+          loop_(qianjs::event_loop::EventLoop::of(engine)),
+          queue_([this](int64_t id, bool repeating) { fire(id, repeating); }, loop_) {}
+
+    /** Engine teardown with timers still pending (e.g. a live interval): drop their callbacks and op counts. */
+    ~TimersState() {
+        for (auto& [id, record] : records_) {
+            JS_FreeValueRT(rt_, record.callback);
+            loop_.end_operation();
+        }
     }
 
-    if (timer->cancelled.exchange(true))
-        return;
-    qianjs::event_loop::end_operation();
-    qianjs::event_loop::defer([timer](qjs::JSEngine& e) {
-        JSContext* c = e.ctx();
-        JS_FreeValue(c, timer->callback);
-        timer->callback = JS_UNDEFINED;
-    });
-}
-
-void run_callback(qjs::JSEngine& engine, const std::shared_ptr<TimerCtx>& timer) {
-    if (timer->cancelled.load(std::memory_order_relaxed))
-        return;
-
-    JSContext* c = engine.ctx();
-    JSValue ret = JS_Call(c, timer->callback, JS_UNDEFINED, 0, nullptr);
-    if (JS_IsException(ret)) {
-        JSValue exc = JS_GetException(c);
-        const char* msg = JS_ToCString(c, exc);
-        if (msg) {
-            std::cerr << "timers callback exception: " << msg << '\n';
-            JS_FreeCString(c, msg);
-        } else {
-            std::cerr << "timers callback exception\n";
-        }
-        JS_FreeValue(c, exc);
-    } else {
-        JS_FreeValue(c, ret);
+    int64_t create(JSContext* c, JSValue fn, int64_t delay_ms, bool repeat) {
+        const int64_t id = next_id_++;
+        if (delay_ms < 0)
+            delay_ms = 0;
+        if (repeat && delay_ms == 0)
+            delay_ms = 1;
+
+        records_[id] = TimerRecord{JS_DupValue(c, fn)};
+        loop_.begin_operation();
+        const uint64_t delay = static_cast<uint64_t>(delay_ms);
+        queue_.start(id, delay, repeat ? delay : 0);
+        return id;
     }
 
-    if (!timer->repeat) {
-        if (timer->cancelled.exchange(true))
+    void clear(int64_t id) {
+        auto it = records_.find(id);
+        if (it == records_.end())
             return;
-        {
-            std::lock_guard<std::mutex> lock(g_timer_mu);
-            auto it = g_timers.find(timer->id);
-            if (it != g_timers.end() && it->second.get() == timer.get())
-                g_timers.erase(it);
-        }
-        JS_FreeValue(c, timer->callback);
-        timer->callback = JS_UNDEFINED;
-        qianjs::event_loop::end_operation();
+        queue_.cancel(id);
+        JS_FreeValue(engine_.ctx(), it->second.callback);
+        records_.erase(it);
+        loop_.end_operation();
     }
-}
-
-void launch_timer_thread(const std::shared_ptr<TimerCtx>& timer) {
-    std::thread([timer]() {
-        using namespace std::chrono_literals;
-        const auto delay = std::chrono::milliseconds(timer->delay_ms);
 
-        if (!timer->repeat) {
-            std::this_thread::sleep_for(delay);
-            if (timer->cancelled.load(std::memory_order_relaxed))
-                return;
-            qianjs::event_loop::defer([timer](qjs::JSEngine& e) { run_callback(e, timer); });
+private:
+    void fire(int64_t id, bool repeating) {
+        auto it = records_.find(id);
+        if (it == records_.end())
             return;
+
+        JSContext* c = engine_.ctx();
+        JSValue fn;
+        if (repeating) {
+            // The callback may `clearInterval` itself; keep the function alive for the duration of the call.
+            fn = JS_DupValue(c, it->second.callback);
+        } else {
+            fn = it->second.callback;
+            records_.erase(it);
         }
 
-        while (!timer->cancelled.load(std::memory_order_relaxed)) {
-            std::this_thread::sleep_for(delay);
-            if (timer->cancelled.load(std::memory_order_relaxed))
-                return;
-            qianjs::event_loop::defer([timer](qjs::JSEngine& e) { run_callback(e, timer); });
+        const qianjs::profiler::TaskFrame task("timers");
+        JSValue ret = JS_Call(c, fn, JS_UNDEFINED, 0, nullptr);
+        if (JS_IsException(ret)) {
+            JSValue exc = JS_GetException(c);
+            const char* msg = JS_ToCString(c, exc);
+            if (msg) {
+                qianjs::output::report(std::string("timers callback exception: ") + msg + "\n");
+                JS_FreeCString(c, msg);
+            } else {
+                qianjs::output::report("timers callback exception\n");
+            }
+            JS_FreeValue(c, exc);
+        } else {
+            JS_FreeValue(c, ret);
         }
-    }).detach();
-}
+        JS_FreeValue(c, fn);
 
-int64_t create_timer(JSContext* c, JSValue fn, int64_t delay_ms, bool repeat) {
-    auto timer = std::make_shared<TimerCtx>();
-    timer->id = g_next_timer_id.fetch_add(1, std::memory_order_relaxed);
-    if (delay_ms < 0)
-        delay_ms = 0;
-    if (repeat && delay_ms == 0)
-        delay_ms = 1;
-    timer->delay_ms = delay_ms;
-    timer->repeat = repeat;
-    timer->callback = JS_DupValue(c, fn);
-
-    {
-        std::lock_guard<std::mutex> lock(g_timer_mu);
-        g_timers[timer->id] = timer;
+        if (!repeating)
+            loop_.end_operation();
     }
-    qianjs::event_loop::begin_operation();
-    launch_timer_thread(timer);
-    return timer->id;
-}
+
+    qjs::JSEngine& engine_;
+    JSRuntime* rt_;
+    qianjs::event_loop::EventLoop& loop_;
+    qianjs::timers::TimerQueue queue_;
+    std::unordered_map<int64_t, TimerRecord> records_;
+    int64_t next_id_ = 1;
+};
 
 } // namespace
 
@@ -133,32 +113,32 @@ const char* TimersPlugin::name() const {
 }
 
 void TimersPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
-    (void)engine;
-    qianjs::event_loop::ensure_started();
+    qianjs::event_loop::EventLoop::of(engine).ensure_started();
+    auto state = std::make_shared<TimersState>(engine);
     auto& m = root.module("timers");
 
-    m.funcDynamic("setTimeout", 2, 2, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+    m.funcDynamic("setTimeout", 2, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
         (void)argc;
         if (!JS_IsFunction(c, argv[0]))
             return JS_ThrowTypeError(c, "setTimeout: callback must be function");
         int64_t delay = 0;
         if (JS_ToInt64(c, &delay, argv[1]) < 0)
             return JS_EXCEPTION;
-        const int64_t id = create_timer(c, argv[0], delay, false);
+        const int64_t id = state->create(c, argv[0], delay, false);
         return JS_NewInt64(c, id);
     });
 
-    m.funcDynamic("setInterval", 2, 2, [](JSContext* c, int argc, JSValue* argv) -> JSValue {
+    m.funcDynamic("setInterval", 2, 2, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
         (void)argc;
         if (!JS_IsFunction(c, argv[0]))
             return JS_ThrowTypeError(c, "setInterval: callback must be function");
         int64_t delay = 0;
         if (JS_ToInt64(c, &delay, argv[1]) < 0)
             return JS_EXCEPTION;
-        const int64_t id = create_timer(c, argv[0], delay, true);
+        const int64_t id = state->create(c, argv[0], delay, true);
         return JS_NewInt64(c, id);
     });
 
-    m.func("clearTimeout", [](int64_t id) { clear_timer_impl(id); });
-    m.func("clearInterval", [](int64_t id) { clear_timer_impl(id); });
+    m.func("clearTimeout", [state](int64_t id) { state->clear(id); });
+    m.func("clearInterval", [state](int64_t id) { state->clear(id); });
 }
@@ -0,0 +1,605 @@
+#include "native/worker/worker_module.h"
+
+#include "runtime/buffer_pins.h"
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/output/std_output.h"
+#include "runtime/runtime_context.h"
+#include "runtime/script_host.h"
+
+#include <js_engine.h>
+#include <js_module.h>
+#include <js_types.h>
+#include <quickjs.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using qianjs::event_loop::EventLoop;
+
+/*
+ * SharedArrayBuffer storage shared across runtimes: a refcounted malloc block. Every engine installs these hooks, so a
+ * SAB written with `JS_WRITE_OBJ_SAB` on one thread is read back on another as a view of the same memory.
+ */
+struct alignas(std::max_align_t) SabHeader {
+    std::atomic<int> refs;
+};
+
+void* sab_alloc(void*, size_t size) {
+    void* raw = std::malloc(sizeof(SabHeader) + size);
+    if (!raw)
+        return nullptr;
+    new (raw) SabHeader{{1}};
+    return static_cast<uint8_t*>(raw) + sizeof(SabHeader);
+}
+
+SabHeader* sab_header(void* ptr) {
+    return reinterpret_cast<SabHeader*>(static_cast<uint8_t*>(ptr) - sizeof(SabHeader));
+}
+
+void sab_free(void*, void* ptr) {
+    SabHeader* h = sab_header(ptr);
+    if (h->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        h->~SabHeader();
+        std::free(h);
+    }
+}
+
+void sab_dup(void*, void* ptr) {
+    sab_header(ptr)->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void free_transferred(JSRuntime*, void*, void* ptr) {
+    std::free(ptr);
+}
+
+/** One structured-clone message: the serialized value plus the out-of-band buffers it carries. */
+struct Message {
+    std::vector<uint8_t> data;
+    /** SABs referenced by `data`, each holding one reference until the receiver has read the value. */
+    std::vector<void*> sabs;
+    /**
+     * Transferred ArrayBuffer contents: `encode_message` copies each into a malloc block (QuickJS cannot hand over an
+     * ArrayBuffer's storage) and detaches the original; the receiver adopts the block without a second copy.
+     */
+    std::vector<std::pair<uint8_t*, size_t>> transfers;
+
+    Message() = default;
+    Message(Message&& o) noexcept
+        : data(std::move(o.data)), sabs(std::move(o.sabs)), transfers(std::move(o.transfers)) {
+        o.sabs.clear();
+        o.transfers.clear();
+    }
+    Message& operator=(Message&&) = delete;
+    Message(const Message&) = delete;
+    ~Message() {
+        release_sabs();
+        for (auto& t : transfers)
+            std::free(t.first);
+    }
+
+    void release_sabs() {
+        for (void* p : sabs)
+            sab_free(nullptr, p);
+        sabs.clear();
+    }
+};
+
+/** One direction of a worker channel; guarded by `WorkerLink::mutex`. */
+struct Mailbox {
+    std::deque<Message> queue;
+    /** Receiving thread's loop; null until it has one (a worker that is still starting) or after it is gone. */
+    EventLoop* loop = nullptr;
+    bool drain_scheduled = false;
+    bool closed = false;
+};
+
+class WorkersState;
+
+/** State shared by a parent and one worker thread. */
+struct WorkerLink {
+    int64_t id = 0;
+    std::string path;
+    /** Parent-side owner; set before the thread starts and never changed. */
+    std::weak_ptr<WorkersState> owner;
+    std::mutex mutex;
+    Mailbox to_child;
+    Mailbox to_parent;
+    bool exited = false;
+    int exit_code = 0;
+    /** Polled by the worker runtime's interrupt handler so a busy script stops promptly. */
+    std::atomic<bool> terminate{false};
+    std::thread thread;
+};
+
+/** Set on a worker thread before its engine installs plugins; tells `install` to expose the worker side. */
+thread_local std::shared_ptr<WorkerLink> t_link;
+
+void report_exception(JSContext* c, const char* what) {
+    JSValue exc = JS_GetException(c);
+    const char* msg = JS_ToCString(c, exc);
+    if (msg) {
+        qianjs::output::report(std::string("worker ") + what + " exception: " + msg + "\n");
+        JS_FreeCString(c, msg);
+    } else {
+        qianjs::output::report(std::string("worker ") + what + " exception\n");
+    }
+    JS_FreeValue(c, exc);
+}
+
+bool is_shared_array_buffer(JSContext* c, JSValueConst v) {
+    JSValue global = JS_GetGlobalObject(c);
+    JSValue ctor = JS_GetPropertyStr(c, global, "SharedArrayBuffer");
+    const int r = JS_IsObject(ctor) ? JS_IsInstanceOf(c, v, ctor) : 0;
+    JS_FreeValue(c, ctor);
+    JS_FreeValue(c, global);
+    return r > 0;
+}
+
+/**
+ * Serialize `value` into `out`; `transfer` (optional array of ArrayBuffers) is moved out of band and the sources are
+ * detached. Returns false with a pending exception.
+ */
+bool encode_message(JSContext* c, JSValueConst value, JSValueConst transfer, Message& out) {
+    std::vector<JSValue> buffers;
+    std::vector<std::pair<uint8_t*, size_t>> views;
+    const auto release = [&] {
+        for (JSValue v : buffers)
+            JS_FreeValue(c, v);
+    };
+
+    if (!JS_IsUndefined(transfer)) {
+        if (!JS_IsArray(c, transfer)) {
+            JS_ThrowTypeError(c, "worker: transfer must be an array of ArrayBuffer");
+            return false;
+        }
+        JSValue len_v = JS_GetPropertyStr(c, transfer, "length");
+        uint32_t len = 0;
+        const int r = JS_ToUint32(c, &len, len_v);
+        JS_FreeValue(c, len_v);
+        if (r < 0)
+            return false;
+        for (uint32_t i = 0; i < len; i++) {
+            JSValue b = JS_GetPropertyUint32(c, transfer, i);
+            size_t size = 0;
+            uint8_t* ptr = is_shared_array_buffer(c, b) ? nullptr : JS_GetArrayBuffer(c, &size, b);
+            if (!ptr) {
+                JS_FreeValue(c, b);
+                release();
+                JS_ThrowTypeError(c, "worker: transfer[%u] is not a transferable ArrayBuffer", i);
+                return false;
+            }
+            if (qianjs::BufferPins::pinned(ptr)) {
+                JS_FreeValue(c, b);
+                release();
+                JS_ThrowTypeError(c, "worker: transfer[%u] is in use by a pending fs write", i);
+                return false;
+            }
+            for (const auto& v : views) {
+                if (size > 0 && v.first == ptr) {
+                    JS_FreeValue(c, b);
+                    release();
+                    JS_ThrowTypeError(c, "worker: ArrayBuffer listed twice in transfer");
+                    return false;
+                }
+            }
+            buffers.push_back(b);
+            views.emplace_back(ptr, size);
+        }
+    }
+
+    size_t len = 0;
+    uint8_t** sab_tab = nullptr;
+    size_t sab_len = 0;
+    uint8_t* buf = JS_WriteObject2(c, &len, value, JS_WRITE_OBJ_SAB | JS_WRITE_OBJ_REFERENCE, &sab_tab, &sab_len);
+    if (!buf) {
+        release();
+        return false;
+    }
+    out.data.assign(buf, buf + len);
+    js_free(c, buf);
+    for (size_t i = 0; i < sab_len; i++) {
+        sab_dup(nullptr, sab_tab[i]);
+        out.sabs.push_back(sab_tab[i]);
+    }
+    js_free(c, sab_tab);
+
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const size_t size = views[i].second;
+        auto* block = static_cast<uint8_t*>(std::malloc(size ? size : 1));
+        if (!block) {
+            release();
+            JS_ThrowOutOfMemory(c);
+            return false;
+        }
+        std::memcpy(block, views[i].first, size);
+        out.transfers.emplace_back(block, size);
+        JS_DetachArrayBuffer(c, buffers[i]);
+    }
+    release();
+    return true;
+}
+
+/** Call `handler(value, buffers)` for one message; the message's SAB references and buffers are consumed. */
+void dispatch_message(JSContext* c, JSValueConst handler, Message& msg) {
+    JSValue value = JS_ReadObject(c, msg.data.data(), msg.data.size(), JS_READ_OBJ_SAB | JS_READ_OBJ_REFERENCE);
+    msg.release_sabs();
+    if (JS_IsException(value)) {
+        report_exception(c, "message decode");
+        return;
+    }
+    JSValue buffers = JS_NewArray(c);
+    for (uint32_t i = 0; i < msg.transfers.size(); i++) {
+        auto& t = msg.transfers[i];
+        JSValue ab = JS_NewArrayBuffer(c, t.first, t.second, free_transferred, nullptr, 0);
+        t.first = nullptr;
+        JS_SetPropertyUint32(c, buffers, i, ab);
+    }
+    msg.transfers.clear();
+
+    JSValue args[2] = {value, buffers};
+    JSValue ret = JS_Call(c, handler, JS_UNDEFINED, 2, args);
+    if (JS_IsException(ret))
+        report_exception(c, "onMessage");
+    else
+        JS_FreeValue(c, ret);
+    JS_FreeValue(c, value);
+    JS_FreeValue(c, buffers);
+}
+
+/** Caller holds `link.mutex`. Ensures one drain task is queued on `box.loop` (if it has one). */
+template <class F>
+void schedule_drain(Mailbox& box, F&& drain) {
+    if (box.loop && !box.drain_scheduled) {
+        box.drain_scheduled = true;
+        box.loop->defer(std::forward<F>(drain));
+    }
+}
+
+std::deque<Message> take_batch(WorkerLink& link, Mailbox& box) {
+    std::lock_guard<std::mutex> lock(link.mutex);
+    box.drain_scheduled = false;
+    return std::exchange(box.queue, {});
+}
+
+/** Worker-thread side of the link: the `onMessage` handler, which keeps the worker's loop alive until `close()`. */
+class WorkerPort {
+public:
+    WorkerPort(std::shared_ptr<WorkerLink> link, EventLoop& loop, JSRuntime* rt)
+        : link_(std::move(link)), loop_(&loop), rt_(rt) {}
+
+    /**
+     * Runs while the worker engine is torn down, before its loop is destroyed: detach the loop so the parent stops
+     * deferring onto it, and drop a handler still installed (e.g. after `terminate`) along with its op count.
+     */
+    ~WorkerPort() {
+        {
+            std::lock_guard<std::mutex> lock(link_->mutex);
+            link_->to_child.closed = true;
+            link_->to_child.loop = nullptr;
+        }
+        if (listening_) {
+            JS_FreeValueRT(rt_, handler_);
+            loop_->end_operation();
+        }
+    }
+
+    const std::shared_ptr<WorkerLink>& link() const { return link_; }
+
+    void listen(JSContext* c, JSValueConst fn) {
+        if (listening_)
+            JS_FreeValue(c, handler_);
+        else
+            loop_->begin_operation();
+        handler_ = JS_DupValue(c, fn);
+        listening_ = true;
+    }
+
+    void close(JSContext* c) {
+        if (!listening_)
+            return;
+        JS_FreeValue(c, handler_);
+        handler_ = JS_UNDEFINED;
+        listening_ = false;
+        loop_->end_operation();
+    }
+
+    void drain(JSContext* c) {
+        std::deque<Message> batch = take_batch(*link_, link_->to_child);
+        for (Message& msg : batch) {
+            if (!listening_)
+                break;
+            JSValue fn = JS_DupValue(c, handler_);
+            dispatch_message(c, fn, msg);
+            JS_FreeValue(c, fn);
+        }
+    }
+
+private:
+    std::shared_ptr<WorkerLink> link_;
+    EventLoop* loop_;
+    JSRuntime* rt_;
+    JSValue handler_ = JS_UNDEFINED;
+    bool listening_ = false;
+};
+
+thread_local std::weak_ptr<WorkerPort> t_port;
+
+void drain_child(qjs::JSEngine& engine) {
+    if (auto port = t_port.lock())
+        port->drain(engine.ctx());
+}
+
+/** Runs on the worker's own loop: drop the handler and make `drainAsyncWork` return. */
+void stop_child(qjs::JSEngine& engine) {
+    if (auto port = t_port.lock())
+        port->close(engine.ctx());
+    if (auto* runtime = engine.host<qianjs::RuntimeContext>())
+        runtime->exit_requested = true;
+}
+
+void request_terminate(WorkerLink& link) {
+    link.terminate.store(true, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(link.mutex);
+    if (link.to_child.loop && !link.to_child.closed)
+        link.to_child.loop->defer([](qjs::JSEngine& e) { stop_child(e); });
+}
+
+void drain_parent(qjs::JSEngine& engine, const std::shared_ptr<WorkerLink>& link);
+
+/** Parent side: workers spawned from this engine, each holding one pending op until its exit is delivered. */
+class WorkersState : public std::enable_shared_from_this<WorkersState> {
+public:
+    WorkersState(EventLoop& loop, JSRuntime* rt) : loop_(&loop), rt_(rt) {}
+
+    struct Record {
+        std::shared_ptr<WorkerLink> link;
+        JSValue on_message = JS_UNDEFINED;
+        JSValue on_exit = JS_UNDEFINED;
+    };
+
+    /** Stop and join workers still running when the engine goes away, then drop their callbacks. */
+    ~WorkersState() {
+        for (auto& kv : workers_) {
+            WorkerLink& link = *kv.second.link;
+            {
+                std::lock_guard<std::mutex> lock(link.mutex);
+                link.to_parent.closed = true;
+                link.to_parent.loop = nullptr;
+            }
+            request_terminate(link);
+            if (link.thread.joinable())
+                link.thread.join();
+            JS_FreeValueRT(rt_, kv.second.on_message);
+            JS_FreeValueRT(rt_, kv.second.on_exit);
+            loop_->end_operation();
+        }
+    }
+
+    int64_t spawn(JSContext* c, std::string path, JSValueConst on_message, JSValueConst on_exit) {
+        auto link = std::make_shared<WorkerLink>();
+        link->id = next_id_++;
+        link->path = std::move(path);
+        link->to_parent.loop = loop_;
+        link->owner = weak_from_this();
+
+        Record rec;
+        rec.link = link;
+        rec.on_message = JS_DupValue(c, on_message);
+        if (JS_IsFunction(c, on_exit))
+            rec.on_exit = JS_DupValue(c, on_exit);
+        workers_.emplace(link->id, std::move(rec));
+        loop_->begin_operation();
+
+        link->thread = std::thread([link] { run_worker(link); });
+        return link->id;
+    }
+
+    /** False when the worker has already exited (the message is dropped). */
+    bool post(int64_t id, Message msg) {
+        auto it = workers_.find(id);
+        if (it == workers_.end())
+            return false;
+        WorkerLink& link = *it->second.link;
+        std::lock_guard<std::mutex> lock(link.mutex);
+        if (link.to_child.closed)
+            return false;
+        link.to_child.queue.push_back(std::move(msg));
+        schedule_drain(link.to_child, [](qjs::JSEngine& e) { drain_child(e); });
+        return true;
+    }
+
+    void terminate(int64_t id) {
+        auto it = workers_.find(id);
+        if (it != workers_.end())
+            request_terminate(*it->second.link);
+    }
+
+    void drain(qjs::JSEngine& engine, const std::shared_ptr<WorkerLink>& link) {
+        JSContext* c = engine.ctx();
+        std::deque<Message> batch = take_batch(*link, link->to_parent);
+        for (Message& msg : batch) {
+            auto it = workers_.find(link->id);
+            if (it == workers_.end())
+                return;
+            JSValue fn = JS_DupValue(c, it->second.on_message);
+            dispatch_message(c, fn, msg);
+            JS_FreeValue(c, fn);
+        }
+
+        int code = 0;
+        {
+            std::lock_guard<std::mutex> lock(link->mutex);
+            if (!link->exited || !link->to_parent.queue.empty())
+                return;
+            code = link->exit_code;
+            link->to_parent.closed = true;
+            link->to_parent.loop = nullptr;
+        }
+        auto it = workers_.find(link->id);
+        if (it == workers_.end())
+            return;
+        Record rec = std::move(it->second);
+        workers_.erase(it);
+        if (rec.link->thread.joinable())
+            rec.link->thread.join();
+
+        if (!JS_IsUndefined(rec.on_exit)) {
+            JSValue arg = JS_NewInt32(c, code);
+            JSValue ret = JS_Call(c, rec.on_exit, JS_UNDEFINED, 1, &arg);
+            if (JS_IsException(ret))
+                report_exception(c, "onExit");
+            else
+                JS_FreeValue(c, ret);
+            JS_FreeValue(c, rec.on_exit);
+        }
+        JS_FreeValue(c, rec.on_message);
+        loop_->end_operation();
+    }
+
+private:
+    static void run_worker(const std::shared_ptr<WorkerLink>& link) {
+        t_link = link;
+        const int code = qianjs::runScriptFile(link->path, {link->path});
+        t_link.reset();
+
+        std::lock_guard<std::mutex> lock(link->mutex);
+        link->to_child.closed = true;
+        link->to_child.loop = nullptr;
+        link->to_child.queue.clear();
+        link->exited = true;
+        link->exit_code = code;
+        schedule_drain(link->to_parent, [link](qjs::JSEngine& e) { drain_parent(e, link); });
+    }
+
+    EventLoop* loop_;
+    JSRuntime* rt_;
+    std::unordered_map<int64_t, Record> workers_;
+    int64_t next_id_ = 1;
+};
+
+void drain_parent(qjs::JSEngine& engine, const std::shared_ptr<WorkerLink>& link) {
+    if (auto state = link->owner.lock())
+        state->drain(engine, link);
+}
+
+/** Worker side: attach this thread's loop to the link and deliver anything posted while the worker was starting. */
+std::shared_ptr<WorkerPort> attach_port(qjs::JSEngine& engine, const std::shared_ptr<WorkerLink>& link) {
+    EventLoop& loop = EventLoop::of(engine);
+    auto port = std::make_shared<WorkerPort>(link, loop, JS_GetRuntime(engine.ctx()));
+    t_port = port;
+    JS_SetInterruptHandler(
+        JS_GetRuntime(engine.ctx()),
+        [](JSRuntime*, void* opaque) -> int {
+            return static_cast<WorkerLink*>(opaque)->terminate.load(std::memory_order_relaxed) ? 1 : 0;
+        },
+        link.get());
+
+    std::lock_guard<std::mutex> lock(link->mutex);
+    link->to_child.loop = &loop;
+    if (!link->to_child.queue.empty())
+        schedule_drain(link->to_child, [](qjs::JSEngine& e) { drain_child(e); });
+    if (link->terminate.load(std::memory_order_relaxed)) {
+        if (auto* runtime = engine.host<qianjs::RuntimeContext>())
+            runtime->exit_requested = true;
+    }
+    return port;
+}
+
+} // namespace
+
+const char* WorkerPlugin::name() const {
+    return "worker";
+}
+
+void WorkerPlugin::install(qjs::JSEngine& engine, qjs::JSModule& root) {
+    static const JSSharedArrayBufferFunctions kSabFunctions = {sab_alloc, sab_free, sab_dup, nullptr};
+    JS_SetSharedArrayBufferFunctions(JS_GetRuntime(engine.ctx()), &kSabFunctions);
+
+    auto state = std::make_shared<WorkersState>(EventLoop::of(engine), JS_GetRuntime(engine.ctx()));
+    std::shared_ptr<WorkerPort> port = t_link ? attach_port(engine, t_link) : nullptr;
+    auto& m = root.module("worker");
+
+    m.funcDynamic("spawn", 2, 3, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        bool ok = false;
+        std::string path = qjs::JSConv<std::string>::from(c, argv[0], ok);
+        if (!ok)
+            return JS_EXCEPTION;
+        if (!JS_IsFunction(c, argv[1]))
+            return JS_ThrowTypeError(c, "worker.spawn: onMessage must be function");
+        JSValueConst on_exit = argc > 2 ? argv[2] : JS_UNDEFINED;
+        if (!JS_IsUndefined(on_exit) && !JS_IsFunction(c, on_exit))
+            return JS_ThrowTypeError(c, "worker.spawn: onExit must be function");
+        return JS_NewInt64(c, state->spawn(c, std::move(path), argv[1], on_exit));
+    });
+
+    m.funcDynamic("post", 2, 3, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        Message msg;
+        if (!encode_message(c, argv[1], argc > 2 ? argv[2] : JS_UNDEFINED, msg))
+            return JS_EXCEPTION;
+        return JS_NewBool(c, state->post(id, std::move(msg)));
+    });
+
+    m.funcDynamic("terminate", 1, 1, [state](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        int64_t id = 0;
+        if (JS_ToInt64(c, &id, argv[0]) < 0)
+            return JS_EXCEPTION;
+        state->terminate(id);
+        return JS_UNDEFINED;
+    });
+
+    m.funcDynamic("isWorker", 0, 0, [port](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        return JS_NewBool(c, port != nullptr);
+    });
+
+    m.funcDynamic("onMessage", 1, 1, [port](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        if (!port)
+            return JS_ThrowTypeError(c, "worker.onMessage: not running in a worker");
+        if (!JS_IsFunction(c, argv[0]))
+            return JS_ThrowTypeError(c, "worker.onMessage: handler must be function");
+        port->listen(c, argv[0]);
+        return JS_UNDEFINED;
+    });
+
+    m.funcDynamic("postMessage", 1, 2, [port](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        if (!port)
+            return JS_ThrowTypeError(c, "worker.postMessage: not running in a worker");
+        Message msg;
+        if (!encode_message(c, argv[0], argc > 1 ? argv[1] : JS_UNDEFINED, msg))
+            return JS_EXCEPTION;
+        WorkerLink& link = *port->link();
+        std::lock_guard<std::mutex> lock(link.mutex);
+        if (link.to_parent.closed)
+            return JS_NewBool(c, false);
+        link.to_parent.queue.push_back(std::move(msg));
+        schedule_drain(link.to_parent, [l = port->link()](qjs::JSEngine& e) { drain_parent(e, l); });
+        return JS_NewBool(c, true);
+    });
+
+    m.funcDynamic("close", 0, 0, [port](JSContext* c, int argc, JSValue* argv) -> JSValue {
+        (void)argc;
+        (void)argv;
+        if (port)
+            port->close(c);
+        return JS_UNDEFINED;
+    });
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+namespace qianjs {
+
+/**
+ * ArrayBuffer storage that native code reads outside the JS thread while a request is in flight (`fs.write` and
+ * `fs.writeFile` hand the caller's bytes straight to the libuv threadpool). Detaching such a buffer would free memory
+ * the threadpool is still using, so `worker.post` / `postMessage` refuse to transfer a pinned buffer. Keyed by the
+ * ArrayBuffer's data pointer; pins nest. Process-wide and never destroyed, since a request may settle on any engine
+ * thread while statics are torn down.
+ */
+class BufferPins {
+public:
+    static void pin(const void* base) {
+        if (!base)
+            return;
+        State& s = state();
+        const std::lock_guard<std::mutex> lock(s.mutex);
+        s.counts[base]++;
+    }
+
+    static void unpin(const void* base) {
+        if (!base)
+            return;
+        State& s = state();
+        const std::lock_guard<std::mutex> lock(s.mutex);
+        const auto it = s.counts.find(base);
+        if (it != s.counts.end() && --it->second == 0)
+            s.counts.erase(it);
+    }
+
+    static bool pinned(const void* base) {
+        State& s = state();
+        const std::lock_guard<std::mutex> lock(s.mutex);
+        return s.counts.count(base) != 0;
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::unordered_map<const void*, unsigned> counts;
+    };
+
+    static State& state() {
+        static State* const s = new State();
+        return *s;
+    }
+};
+
+} // namespace qianjs
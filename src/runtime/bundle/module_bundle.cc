@@ -0,0 +1,362 @@
+#include "runtime/bundle/module_bundle.h"
+
+#include "runtime/compile_cache/compile_cache.h"
+#include "runtime/plugins/lazy_plugins.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace qianjs::bundle {
+
+namespace {
+
+bool is_file_specifier(const char* name) {
+    return name[0] == '.' || name[0] == '/'
+#ifdef _WIN32
+        || (name[0] && name[1] == ':')
+#endif
+        ;
+}
+
+bool read_text(const std::filesystem::path& path, std::string& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        return false;
+    out.assign(std::istreambuf_iterator<char>(f), {});
+    return true;
+}
+
+std::string exception_message(JSContext* c) {
+    JSValue exc = JS_GetException(c);
+    const char* msg = JS_ToCString(c, exc);
+    std::string out = msg ? msg : "unknown error";
+    if (msg)
+        JS_FreeCString(c, msg);
+    JS_FreeValue(c, exc);
+    return out;
+}
+
+/** Build-time loader state: files are read relative to the entry's directory under their normalized names. */
+struct GraphBuild {
+    std::filesystem::path root;
+    std::vector<BuiltModule>* modules = nullptr;
+};
+
+int native_stub_init(JSContext*, JSModuleDef*) {
+    return 0;
+}
+
+JSModuleDef* compile_into(JSContext* c, GraphBuild& build, const std::string& name) {
+    std::string source;
+    if (!read_text(build.root / name, source)) {
+        JS_ThrowReferenceError(c, "could not load module '%s'", name.c_str());
+        return nullptr;
+    }
+    JSValue m = JS_Eval(c, source.c_str(), source.size(), name.c_str(), JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(m))
+        return nullptr;
+    size_t len = 0;
+    uint8_t* buf = JS_WriteObject(c, &len, m, JS_WRITE_OBJ_BYTECODE);
+    auto* def = static_cast<JSModuleDef*>(JS_VALUE_GET_PTR(m));
+    JS_FreeValue(c, m);
+    if (!buf) {
+        JS_ThrowOutOfMemory(c);
+        return nullptr;
+    }
+    build.modules->push_back(
+        {name, std::vector<uint8_t>(buf, buf + len), compile_cache::fnv1a(source.data(), source.size())});
+    js_free(c, buf);
+    return def;
+}
+
+JSModuleDef* graph_loader(JSContext* c, const char* name, void* opaque) {
+    auto* build = static_cast<GraphBuild*>(opaque);
+    /** Native modules only need to exist for resolution; their exports are checked when the bundle runs. */
+    if (!is_file_specifier(name) && !std::filesystem::exists(build->root / name))
+        return JS_NewCModule(c, name, native_stub_init);
+    return compile_into(c, *build, name);
+}
+
+struct SnapshotView {
+    std::vector<const char*> exports;
+    const uint8_t* state = nullptr;
+    size_t state_len = 0;
+};
+
+constexpr size_t kSnapshotHeaderSize = 16;
+
+bool is_snapshot(const uint8_t* data, size_t len) {
+    return len >= kSnapshotHeaderSize && std::memcmp(data, kSnapshotMagic, 8) == 0;
+}
+
+bool parse_snapshot(const uint8_t* data, size_t len, SnapshotView& out) {
+    uint32_t count = 0, names_size = 0;
+    std::memcpy(&count, data + 8, 4);
+    std::memcpy(&names_size, data + 12, 4);
+    if (names_size > len - kSnapshotHeaderSize)
+        return false;
+    const char* names = reinterpret_cast<const char*>(data + kSnapshotHeaderSize);
+    if (names_size > 0 && names[names_size - 1] != '\0')
+        return false;
+    out.exports.clear();
+    for (uint32_t pos = 0; pos < names_size; pos += static_cast<uint32_t>(std::strlen(names + pos)) + 1)
+        out.exports.push_back(names + pos);
+    const size_t state_offset = (kSnapshotHeaderSize + names_size + 7) & ~size_t{7};
+    if (out.exports.size() != count || state_offset > len)
+        return false;
+    out.state = data + state_offset;
+    out.state_len = len - state_offset;
+    return true;
+}
+
+/** Snapshot entries waiting for their module init; keyed by the native module created in `snapshot_module`. */
+thread_local std::unordered_map<JSModuleDef*, std::pair<const uint8_t*, size_t>> pending_snapshots;
+
+int snapshot_init(JSContext* c, JSModuleDef* m) {
+    const auto it = pending_snapshots.find(m);
+    if (it == pending_snapshots.end()) {
+        JS_ThrowReferenceError(c, "snapshot state missing");
+        return -1;
+    }
+    const auto [data, len] = it->second;
+    pending_snapshots.erase(it);
+
+    SnapshotView view;
+    parse_snapshot(data, len, view);
+    JSValue state = JS_ReadObject(c, view.state, view.state_len, 0);
+    if (JS_IsException(state))
+        return -1;
+    int rc = 0;
+    for (const char* name : view.exports) {
+        JSValue v = JS_GetPropertyStr(c, state, name);
+        if (JS_IsException(v) || JS_SetModuleExport(c, m, name, v) < 0) {
+            rc = -1;
+            break;
+        }
+    }
+    JS_FreeValue(c, state);
+    return rc;
+}
+
+JSModuleDef* snapshot_module(JSContext* c, const char* name, const uint8_t* data, size_t len) {
+    SnapshotView view;
+    if (!parse_snapshot(data, len, view)) {
+        JS_ThrowSyntaxError(c, "corrupt snapshot entry for module '%s'", name);
+        return nullptr;
+    }
+    JSModuleDef* m = JS_NewCModule(c, name, snapshot_init);
+    if (!m)
+        return nullptr;
+    for (const char* e : view.exports) {
+        if (JS_AddModuleExport(c, m, e) < 0)
+            return nullptr;
+    }
+    pending_snapshots[m] = {data, len};
+    return m;
+}
+
+JSModuleDef* bundle_loader(JSContext* c, const char* name, void* opaque) {
+    const auto* bundle = static_cast<const ModuleBundle*>(opaque);
+    size_t len = 0;
+    const uint8_t* code = bundle->find(name, &len);
+    JSValue m = JS_UNDEFINED;
+    if (code && is_snapshot(code, len)) {
+        return snapshot_module(c, name, code, len);
+    } else if (code) {
+        m = JS_ReadObject(c, code, len, JS_READ_OBJ_BYTECODE);
+    } else {
+        std::string source;
+        if (!read_text(name, source)) {
+            JS_ThrowReferenceError(c, "could not load module '%s'", name);
+            return nullptr;
+        }
+        m = JS_Eval(c, source.c_str(), source.size(), name, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    }
+    if (JS_IsException(m))
+        return nullptr;
+    auto* def = static_cast<JSModuleDef*>(JS_VALUE_GET_PTR(m));
+    JS_FreeValue(c, m);
+    return def;
+}
+
+} // namespace
+
+GraphCompiler::GraphCompiler() : rt_(JS_NewRuntime()) {}
+
+GraphCompiler::~GraphCompiler() {
+    if (rt_)
+        JS_FreeRuntime(rt_);
+}
+
+bool GraphCompiler::compile(const std::filesystem::path& entry, std::vector<BuiltModule>& modules, std::string& error) {
+    if (!rt_) {
+        error = "cannot create runtime";
+        return false;
+    }
+    JSContext* c = JS_NewContext(rt_);
+    if (!c) {
+        error = "cannot create context";
+        return false;
+    }
+
+    GraphBuild build;
+    build.root = entry.has_parent_path() ? entry.parent_path() : std::filesystem::path(".");
+    build.modules = &modules;
+    JS_SetModuleLoaderFunc(rt_, nullptr, graph_loader, &build);
+
+    bool ok = false;
+    if (JSModuleDef* m = compile_into(c, build, entry.filename().string())) {
+        /** Resolving loads every import through `graph_loader`, which appends each module as it is compiled. */
+        JSValue mv = JS_DupValue(c, JS_MKPTR(JS_TAG_MODULE, m));
+        ok = JS_ResolveModule(c, mv) == 0;
+        JS_FreeValue(c, mv);
+    }
+    if (!ok)
+        error = exception_message(c);
+
+    JS_FreeContext(c);
+    JS_SetModuleLoaderFunc(rt_, nullptr, nullptr, nullptr);
+    return ok;
+}
+
+bool compileModuleGraph(const std::filesystem::path& entry, std::vector<BuiltModule>& modules, std::string& error) {
+    return GraphCompiler().compile(entry, modules, error);
+}
+
+std::vector<uint8_t> writeBundle(std::vector<BuiltModule> modules) {
+    const std::string entry_name = modules.empty() ? std::string() : modules.front().name;
+    std::sort(modules.begin(), modules.end(), [](const BuiltModule& a, const BuiltModule& b) { return a.name < b.name; });
+
+    BundleHeader h{};
+    std::memcpy(h.magic, kBundleMagic, 8);
+    h.version = kBundleVersion;
+    h.count = static_cast<uint32_t>(modules.size());
+
+    std::string names;
+    std::vector<BundleIndexEntry> index(modules.size());
+    for (size_t i = 0; i < modules.size(); i++) {
+        index[i].name_offset = static_cast<uint32_t>(names.size());
+        index[i].name_length = static_cast<uint32_t>(modules[i].name.size());
+        names += modules[i].name;
+        if (modules[i].name == entry_name)
+            h.entry = static_cast<uint32_t>(i);
+    }
+    h.names_size = static_cast<uint32_t>(names.size());
+
+    size_t offset = sizeof(BundleHeader) + index.size() * sizeof(BundleIndexEntry) + names.size();
+    offset = (offset + 7) & ~size_t{7};
+    const size_t code_start = offset;
+    for (size_t i = 0; i < modules.size(); i++) {
+        index[i].offset = offset;
+        index[i].length = modules[i].bytecode.size();
+        offset += modules[i].bytecode.size();
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(offset);
+    const auto append = [&out](const void* p, size_t n) {
+        out.insert(out.end(), static_cast<const uint8_t*>(p), static_cast<const uint8_t*>(p) + n);
+    };
+    append(&h, sizeof(h));
+    append(index.data(), index.size() * sizeof(BundleIndexEntry));
+    append(names.data(), names.size());
+    out.resize(code_start, 0);
+    for (const BuiltModule& m : modules)
+        append(m.bytecode.data(), m.bytecode.size());
+    return out;
+}
+
+std::vector<uint8_t> writeSnapshotModule(const std::vector<std::string>& exports, const uint8_t* state, size_t len) {
+    std::string names;
+    for (const std::string& e : exports) {
+        names += e;
+        names.push_back('\0');
+    }
+    const auto count = static_cast<uint32_t>(exports.size());
+    const auto names_size = static_cast<uint32_t>(names.size());
+
+    std::vector<uint8_t> out(kSnapshotHeaderSize);
+    std::memcpy(out.data(), kSnapshotMagic, 8);
+    std::memcpy(out.data() + 8, &count, 4);
+    std::memcpy(out.data() + 12, &names_size, 4);
+    out.insert(out.end(), names.begin(), names.end());
+    out.resize((out.size() + 7) & ~size_t{7}, 0);
+    out.insert(out.end(), state, state + len);
+    return out;
+}
+
+bool ModuleBundle::isBundle(const uint8_t* data, size_t len) {
+    return len >= sizeof(BundleHeader) && std::memcmp(data, kBundleMagic, 8) == 0;
+}
+
+bool ModuleBundle::parse(const uint8_t* data, size_t len) {
+    if (!isBundle(data, len))
+        return false;
+    BundleHeader h;
+    std::memcpy(&h, data, sizeof(h));
+    if (h.version != kBundleVersion || h.count == 0 || h.entry >= h.count)
+        return false;
+    const uint64_t index_end = sizeof(BundleHeader) + uint64_t{h.count} * sizeof(BundleIndexEntry);
+    if (index_end + h.names_size > len)
+        return false;
+
+    const auto* index = reinterpret_cast<const BundleIndexEntry*>(data + sizeof(BundleHeader));
+    const char* names = reinterpret_cast<const char*>(data + index_end);
+    for (uint32_t i = 0; i < h.count; i++) {
+        const BundleIndexEntry& e = index[i];
+        if (uint64_t{e.name_offset} + e.name_length > h.names_size || e.offset > len || e.length > len - e.offset)
+            return false;
+        if (i > 0) {
+            const BundleIndexEntry& p = index[i - 1];
+            const std::string_view prev(names + p.name_offset, p.name_length);
+            if (!(prev < std::string_view(names + e.name_offset, e.name_length)))
+                return false;
+        }
+    }
+
+    data_ = data;
+    len_ = len;
+    count_ = h.count;
+    entry_ = h.entry;
+    index_ = index;
+    names_ = names;
+    return true;
+}
+
+std::string ModuleBundle::entryName() const {
+    return std::string(names_ + index_[entry_].name_offset, index_[entry_].name_length);
+}
+
+const uint8_t* ModuleBundle::entryBytecode(size_t* len) const {
+    *len = static_cast<size_t>(index_[entry_].length);
+    return data_ + index_[entry_].offset;
+}
+
+const uint8_t* ModuleBundle::find(const char* name, size_t* len) const {
+    const std::string_view key(name);
+    size_t lo = 0, hi = count_;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const std::string_view s(names_ + index_[mid].name_offset, index_[mid].name_length);
+        if (s < key) {
+            lo = mid + 1;
+        } else if (key < s) {
+            hi = mid;
+        } else {
+            *len = static_cast<size_t>(index_[mid].length);
+            return data_ + index_[mid].offset;
+        }
+    }
+    return nullptr;
+}
+
+void ModuleBundle::installModuleLoader(JSContext* c) const {
+    plugins::setModuleLoader(c, bundle_loader, const_cast<ModuleBundle*>(this));
+}
+
+} // namespace qianjs::bundle
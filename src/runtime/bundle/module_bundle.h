@@ -0,0 +1,117 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace qianjs::bundle {
+
+/**
+ * Multi-module bytecode bundle written by `qianjs build`:
+ *
+ *   [BundleHeader] [BundleIndexEntry × count, sorted by name] [names] [pad to 8] [module bytecode, contiguous]
+ *
+ * Offsets are from the start of the bundle, so it can live in a `.qbc` file or an executable footer unchanged.
+ * A single-module `.qbc` (raw `JS_WriteObject` output) has no header and is still accepted by the runners.
+ */
+struct BundleHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t entry;
+    uint32_t names_size;
+};
+
+struct BundleIndexEntry {
+    uint64_t offset;
+    uint64_t length;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+
+constexpr char kBundleMagic[8] = {'Q', 'J', 'S', 'B', 'N', 'D', 'L', '1'};
+constexpr uint32_t kBundleVersion = 1;
+
+/**
+ * A bundle entry may hold an evaluated module's exports instead of bytecode (written by `qianjs snapshot`):
+ *
+ *   [kSnapshotMagic] [u32 export count] [u32 names size] [NUL-terminated export names] [pad to 8]
+ *   [JS_WriteObject of { exportName: value, ... }]
+ *
+ * The loader turns it into a native module whose exports are read back on first import; the module's own code and
+ * any imports only it used are never run.
+ */
+constexpr char kSnapshotMagic[8] = {'Q', 'J', 'S', 'S', 'N', 'A', 'P', '1'};
+
+std::vector<uint8_t> writeSnapshotModule(const std::vector<std::string>& exports, const uint8_t* state, size_t len);
+
+struct BuiltModule {
+    std::string name;
+    std::vector<uint8_t> bytecode;
+    /** `compile_cache::fnv1a` of the source text that was compiled. */
+    uint64_t source_hash = 0;
+};
+
+/**
+ * Compiles `entry` and every relative / absolute import reachable from it in a scratch QuickJS runtime. Bare
+ * specifiers (`fs`, `console`, …) are native modules and are not bundled. Module names are relative to the entry's
+ * directory, which is what the default normalizer produces at run time. False with `error` set on failure.
+ */
+bool compileModuleGraph(const std::filesystem::path& entry, std::vector<BuiltModule>& modules, std::string& error);
+
+/**
+ * `compileModuleGraph` over many entries: one QuickJS runtime is kept for the compiler's lifetime and each entry gets
+ * a fresh context, since module names are interned per context and two entries may both have a `util.js`. Not
+ * thread-safe; use one per thread.
+ */
+class GraphCompiler {
+public:
+    GraphCompiler();
+    ~GraphCompiler();
+    GraphCompiler(const GraphCompiler&) = delete;
+    GraphCompiler& operator=(const GraphCompiler&) = delete;
+
+    bool compile(const std::filesystem::path& entry, std::vector<BuiltModule>& modules, std::string& error);
+
+private:
+    JSRuntime* rt_ = nullptr;
+};
+
+/** Serializes modules (the first is the entry) into the bundle layout above. */
+std::vector<uint8_t> writeBundle(std::vector<BuiltModule> modules);
+
+/** Read-only view over bundle bytes; the bytes must outlive the view and any context it is installed into. */
+class ModuleBundle {
+public:
+    static bool isBundle(const uint8_t* data, size_t len);
+
+    /** Validates header, index bounds and ordering; false for anything malformed. */
+    bool parse(const uint8_t* data, size_t len);
+
+    size_t size() const { return count_; }
+    std::string entryName() const;
+    const uint8_t* entryBytecode(size_t* len) const;
+
+    /** Bytecode for a normalized module name, or nullptr. Binary search over the sorted index; no allocation. */
+    const uint8_t* find(const char* name, size_t* len) const;
+
+    /**
+     * Module loader for `c`'s runtime: bundled names are read with `JS_ReadObject` on first import only (snapshot
+     * entries restore their exports instead); names not in the bundle fall back to compiling the file from disk.
+     */
+    void installModuleLoader(JSContext* c) const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t len_ = 0;
+    uint32_t count_ = 0;
+    uint32_t entry_ = 0;
+    const BundleIndexEntry* index_ = nullptr;
+    const char* names_ = nullptr;
+};
+
+} // namespace qianjs::bundle
@@ -0,0 +1,371 @@
+#include "runtime/bundle/parallel_build.h"
+
+#include "runtime/bundle/module_bundle.h"
+#include "runtime/compile_cache/compile_cache.h"
+#include "runtime/snapshot/snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace qianjs::bundle {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr const char* kManifestName = ".qianjs-build";
+constexpr const char* kManifestHeader = "qianjs-build 1";
+
+bool has_wildcard(std::string_view s) {
+    return s.find_first_of("*?") != std::string_view::npos;
+}
+
+/** One path segment against one pattern segment; wildcards never match a leading dot, as in the shell. */
+bool match_segment(std::string_view pat, std::string_view s) {
+    if (!s.empty() && s[0] == '.' && (pat.empty() || pat[0] != '.'))
+        return false;
+    size_t p = 0, i = 0, star = std::string_view::npos, resume = 0;
+    while (i < s.size()) {
+        if (p < pat.size() && (pat[p] == '?' || pat[p] == s[i])) {
+            p++;
+            i++;
+        } else if (p < pat.size() && pat[p] == '*') {
+            star = p++;
+            resume = i;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            i = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pat.size() && pat[p] == '*')
+        p++;
+    return p == pat.size();
+}
+
+bool match_path(const std::vector<std::string>& pat, size_t p, const std::vector<std::string>& segs, size_t i) {
+    if (p == pat.size())
+        return i == segs.size();
+    if (pat[p] == "**") {
+        for (size_t k = i; k <= segs.size(); k++) {
+            if (k > i && segs[k - 1][0] == '.')
+                return false;
+            if (match_path(pat, p + 1, segs, k))
+                return true;
+        }
+        return false;
+    }
+    return i < segs.size() && match_segment(pat[p], segs[i]) && match_path(pat, p + 1, segs, i + 1);
+}
+
+bool expand_pattern(const std::string& pattern, std::vector<fs::path>& out) {
+    fs::path base;
+    std::vector<std::string> pat;
+    for (const fs::path& part : fs::path(pattern)) {
+        const std::string s = part.string();
+        if (pat.empty() && !has_wildcard(s))
+            base /= part;
+        else if (!s.empty())
+            pat.push_back(s);
+    }
+    const bool recursive = std::find(pat.begin(), pat.end(), "**") != pat.end();
+    const bool dot_dirs = std::any_of(pat.begin(), pat.end(), [](const std::string& s) { return s[0] == '.'; });
+    const fs::path walk_root = base.empty() ? fs::path(".") : base;
+
+    std::vector<fs::path> matched;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(walk_root, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        std::error_code type_ec;
+        if (it->is_directory(type_ec)) {
+            /** Without `**` nothing deeper than the pattern can match; dot directories only match a dotted segment. */
+            const bool too_deep = !recursive && static_cast<size_t>(it.depth()) + 1 >= pat.size();
+            if (too_deep || (!dot_dirs && it->path().filename().string()[0] == '.'))
+                it.disable_recursion_pending();
+            continue;
+        }
+        const fs::path rel = it->path().lexically_relative(walk_root);
+        std::vector<std::string> segs;
+        for (const fs::path& part : rel)
+            segs.push_back(part.string());
+        if (match_path(pat, 0, segs, 0))
+            matched.push_back(base.empty() ? rel : base / rel);
+    }
+    std::sort(matched.begin(), matched.end());
+    out.insert(out.end(), matched.begin(), matched.end());
+    return !matched.empty();
+}
+
+/** Last recorded build of one output. */
+struct ManifestRecord {
+    uint64_t key = 0;
+    std::string entry;
+    std::vector<std::string> modules;
+};
+
+using Manifest = std::unordered_map<std::string, ManifestRecord>;
+
+/** `<output>\t<key>\t<entry>\t<module>...` per line; anything unreadable is treated as not built. */
+Manifest load_manifest(const fs::path& path) {
+    Manifest m;
+    std::ifstream f(path);
+    std::string line;
+    if (!std::getline(f, line) || line != kManifestHeader)
+        return m;
+    while (std::getline(f, line)) {
+        std::vector<std::string> fields;
+        std::istringstream in(line);
+        for (std::string field; std::getline(in, field, '\t');)
+            fields.push_back(std::move(field));
+        if (fields.size() < 4)
+            continue;
+        ManifestRecord r;
+        r.key = std::strtoull(fields[1].c_str(), nullptr, 16);
+        r.entry = std::move(fields[2]);
+        r.modules.assign(std::make_move_iterator(fields.begin() + 3), std::make_move_iterator(fields.end()));
+        m[fields[0]] = std::move(r);
+    }
+    return m;
+}
+
+/** Unique per thread and call, so concurrent builds into one directory never share a temp file. */
+fs::path temp_path_for(const fs::path& final_path) {
+    static std::atomic<uint64_t> counter{0};
+    fs::path tmp = final_path;
+    tmp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                                   (std::chrono::steady_clock::now().time_since_epoch().count() + counter++));
+    return tmp;
+}
+
+bool write_atomically(const fs::path& path, const void* data, size_t len) {
+    const fs::path tmp = temp_path_for(path);
+    std::error_code ec;
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f)
+            return false;
+        f.write(static_cast<const char*>(data), static_cast<std::streamsize>(len));
+        if (!f) {
+            f.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec)
+        fs::remove(tmp, ec);
+    return !ec;
+}
+
+void save_manifest(const fs::path& path, const Manifest& m) {
+    std::vector<const Manifest::value_type*> rows;
+    rows.reserve(m.size());
+    for (const auto& row : m)
+        rows.push_back(&row);
+    std::sort(rows.begin(), rows.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    std::string text = std::string(kManifestHeader) + "\n";
+    char key[20];
+    for (const auto* row : rows) {
+        std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(row->second.key));
+        text += row->first + "\t" + key + "\t" + row->second.entry;
+        for (const std::string& name : row->second.modules)
+            text += "\t" + name;
+        text += "\n";
+    }
+    write_atomically(path, text.data(), text.size());
+}
+
+/** Engine, build mode, entry and each module's name and source hash; any change means a rebuild. */
+uint64_t graph_key(bool snapshot, const std::string& entry, const std::vector<std::pair<std::string, uint64_t>>& mods) {
+    uint64_t key = compile_cache::fnv1a(snapshot ? "S" : "B", 1, compile_cache::engineFingerprint());
+    key = compile_cache::fnv1a(entry.data(), entry.size(), key);
+    for (const auto& [name, hash] : mods) {
+        key = compile_cache::fnv1a(name.data(), name.size() + 1, key);
+        key = compile_cache::fnv1a(&hash, sizeof(hash), key);
+    }
+    return key;
+}
+
+bool up_to_date(const ManifestRecord& r, const fs::path& input, const std::string& entry, const fs::path& output,
+    bool snapshot) {
+    std::error_code ec;
+    if (r.entry != entry || !fs::is_regular_file(output, ec))
+        return false;
+    const fs::path root = input.has_parent_path() ? input.parent_path() : fs::path(".");
+    std::vector<std::pair<std::string, uint64_t>> mods;
+    mods.reserve(r.modules.size());
+    for (const std::string& name : r.modules) {
+        std::ifstream f(root / name, std::ios::binary);
+        if (!f)
+            return false;
+        const std::string source(std::istreambuf_iterator<char>(f), {});
+        mods.emplace_back(name, compile_cache::fnv1a(source.data(), source.size()));
+    }
+    return graph_key(snapshot, entry, mods) == r.key;
+}
+
+/** Manifest identity of an entry: its absolute path, so `a.js` and `./a.js` are the same build. */
+std::string entry_id(const fs::path& input) {
+    std::error_code ec;
+    const fs::path abs = fs::absolute(input, ec);
+    return (ec ? input : abs).lexically_normal().generic_string();
+}
+
+} // namespace
+
+bool expandEntries(const std::vector<std::string>& patterns, std::vector<fs::path>& entries, std::string& error) {
+    std::unordered_set<std::string> seen;
+    std::vector<fs::path> expanded;
+    for (const std::string& pattern : patterns) {
+        expanded.clear();
+        if (!has_wildcard(pattern)) {
+            expanded.emplace_back(pattern);
+        } else if (!expand_pattern(pattern, expanded)) {
+            error = "No files match: " + pattern;
+            return false;
+        }
+        for (fs::path& p : expanded) {
+            if (seen.insert(p.lexically_normal().generic_string()).second)
+                entries.push_back(std::move(p));
+        }
+    }
+    return true;
+}
+
+std::vector<BuildResult> buildEntries(const std::vector<fs::path>& entries, const BuildOptions& options,
+    const std::function<void(const BuildResult&)>& onDone) {
+    std::vector<BuildResult> results(entries.size());
+    std::vector<bool> pending(entries.size(), true);
+    std::unordered_map<std::string, size_t> owners;
+    for (size_t i = 0; i < entries.size(); i++) {
+        BuildResult& r = results[i];
+        r.input = entries[i];
+        r.output = options.outDir / entries[i].stem();
+        r.output.replace_extension(".qbc");
+        const auto [it, fresh] = owners.emplace(r.output.filename().string(), i);
+        if (!fresh) {
+            r.error = "output " + r.output.string() + " is also written by " + entries[it->second].string();
+            pending[i] = false;
+        }
+    }
+
+    const fs::path manifest_path = options.outDir / kManifestName;
+    Manifest manifest = load_manifest(manifest_path);
+    std::vector<ManifestRecord> records(entries.size());
+
+    std::mutex report_mutex;
+    const auto report = [&](const BuildResult& r) {
+        if (!onDone)
+            return;
+        const std::lock_guard<std::mutex> lock(report_mutex);
+        onDone(r);
+    };
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!pending[i])
+            report(results[i]);
+    }
+
+    std::atomic<size_t> next{0};
+    const auto worker = [&] {
+        GraphCompiler compiler;
+        while (true) {
+            const size_t i = next++;
+            if (i >= entries.size())
+                break;
+            if (!pending[i])
+                continue;
+            BuildResult& r = results[i];
+            const auto started = std::chrono::steady_clock::now();
+            const auto finish = [&] {
+                r.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                                  started);
+                report(r);
+            };
+            ManifestRecord& record = records[i];
+            record.entry = entry_id(r.input);
+
+            std::error_code file_ec;
+            if (!fs::is_regular_file(r.input, file_ec)) {
+                r.error = "File not found: " + r.input.string();
+                finish();
+                continue;
+            }
+            /** Read-only here: the map is only updated after every worker has joined. */
+            const auto hit = manifest.find(r.output.filename().string());
+            if (!options.force && hit != manifest.end() &&
+                up_to_date(hit->second, r.input, record.entry, r.output, options.snapshot)) {
+                r.status = BuildStatus::UpToDate;
+                r.modules = hit->second.modules.size();
+                finish();
+                continue;
+            }
+
+            std::vector<BuiltModule> modules;
+            const bool built = options.snapshot ? snapshot::buildSnapshot(r.input, modules, r.snapshotted, r.error)
+                                                : compiler.compile(r.input, modules, r.error);
+            if (built) {
+                std::vector<std::pair<std::string, uint64_t>> mods;
+                mods.reserve(modules.size());
+                for (const BuiltModule& m : modules) {
+                    mods.emplace_back(m.name, m.source_hash);
+                    record.modules.push_back(m.name);
+                }
+                record.key = graph_key(options.snapshot, record.entry, mods);
+                r.modules = modules.size();
+                const std::vector<uint8_t> image = writeBundle(std::move(modules));
+                r.bytes = image.size();
+                std::error_code dir_ec;
+                fs::create_directories(options.outDir, dir_ec);
+                if (write_atomically(r.output, image.data(), image.size()))
+                    r.status = BuildStatus::Built;
+                else
+                    r.error = "Cannot write file: " + r.output.string();
+            }
+            finish();
+        }
+    };
+
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = static_cast<unsigned>(std::min<size_t>(jobs, entries.size()));
+    if (jobs <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(jobs);
+        for (unsigned t = 0; t < jobs; t++)
+            pool.emplace_back(worker);
+        for (std::thread& t : pool)
+            t.join();
+    }
+
+    /** Nothing is written for a build that changed nothing, e.g. one whose only entry does not exist. */
+    bool changed = false;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const std::string name = results[i].output.filename().string();
+        if (results[i].status == BuildStatus::Built) {
+            manifest[name] = std::move(records[i]);
+            changed = true;
+        } else if (results[i].status == BuildStatus::Failed && pending[i]) {
+            changed = manifest.erase(name) > 0 || changed;
+        }
+    }
+    if (changed)
+        save_manifest(manifest_path, manifest);
+    return results;
+}
+
+} // namespace qianjs::bundle
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace qianjs::bundle {
+
+/** Knobs for `buildEntries`. */
+struct BuildOptions {
+    std::filesystem::path outDir = "dist";
+    /** Worker threads; 0 means one per hardware thread. Never more than there are entries. */
+    unsigned jobs = 0;
+    /** `qianjs snapshot` instead of `qianjs build`. */
+    bool snapshot = false;
+    /** Rebuild even when the manifest says the output is current. */
+    bool force = false;
+};
+
+enum class BuildStatus { Built, UpToDate, Failed };
+
+struct BuildResult {
+    std::filesystem::path input;
+    std::filesystem::path output;
+    BuildStatus status = BuildStatus::Failed;
+    size_t modules = 0;
+    size_t snapshotted = 0;
+    size_t bytes = 0;
+    /** Wall time spent on this entry by its worker, including the up-to-date check. */
+    std::chrono::microseconds elapsed{0};
+    std::string error;
+};
+
+/**
+ * Expands command-line entries: plain paths are kept as given, patterns with `*`, `?` or `**` are matched against
+ * files under their longest literal directory prefix (`*` stays within one path segment, `**` spans any number) and
+ * sorted. False with `error` set when a pattern matches nothing.
+ */
+bool expandEntries(const std::vector<std::string>& patterns, std::vector<std::filesystem::path>& entries,
+    std::string& error);
+
+/**
+ * Builds every entry into `outDir/<stem>.qbc` on a pool of worker threads, each compiling with its own
+ * `GraphCompiler`. `outDir/.qianjs-build` records, per output, a hash of every module source in the entry's graph
+ * (plus the engine fingerprint and build mode); an entry whose sources still hash the same and whose output exists
+ * is skipped. Outputs and the manifest are written to a temporary file and renamed into place, so an interrupted
+ * build never leaves a torn `.qbc`. `onDone` is called once per entry as it finishes, serialized across workers.
+ * Results come back in entry order; an entry whose output name an earlier entry already claimed fails unbuilt.
+ */
+std::vector<BuildResult> buildEntries(const std::vector<std::filesystem::path>& entries, const BuildOptions& options,
+    const std::function<void(const BuildResult&)>& onDone = {});
+
+} // namespace qianjs::bundle
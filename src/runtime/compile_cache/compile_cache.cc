@@ -0,0 +1,202 @@
+#include "runtime/compile_cache/compile_cache.h"
+
+#include "runtime/embed.h"
+#include "runtime/plugins/lazy_plugins.h"
+
+#include <qianjs_modules.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace qianjs::compile_cache {
+
+namespace {
+
+/** Entry layout: header, module name, bytecode. The stored key and name guard against hash collisions. */
+struct EntryHeader {
+    char magic[8];
+    uint64_t key;
+    uint32_t name_len;
+    uint32_t bytecode_len;
+};
+
+constexpr char kEntryMagic[8] = {'Q', 'J', 'S', 'C', 'A', 'C', 'H', '1'};
+
+std::string read_text(const std::string& path, bool& ok) {
+    std::ifstream f(path, std::ios::binary);
+    ok = static_cast<bool>(f);
+    if (!ok)
+        return {};
+    return std::string(std::istreambuf_iterator<char>(f), {});
+}
+
+JSModuleDef* cached_module_loader(JSContext* c, const char* name, void* opaque) {
+    auto* cache = static_cast<CompileCache*>(opaque);
+    bool ok = false;
+    const std::string source = read_text(name, ok);
+    if (!ok) {
+        JS_ThrowReferenceError(c, "could not load module '%s'", name);
+        return nullptr;
+    }
+    const std::vector<uint8_t> bytecode = cache->moduleBytecode(c, name, source);
+    if (bytecode.empty())
+        return nullptr;
+    JSValue m = JS_ReadObject(c, bytecode.data(), bytecode.size(), JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(m))
+        return nullptr;
+    auto* def = static_cast<JSModuleDef*>(JS_VALUE_GET_PTR(m));
+    JS_FreeValue(c, m);
+    return def;
+}
+
+} // namespace
+
+uint64_t fnv1a(const void* data, size_t len, uint64_t seed) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t engineFingerprint() {
+    static const uint64_t fp = [] {
+        uint64_t parts[3] = {QIANJS_MODULE_MASK, 0, 0};
+        std::error_code ec;
+        const std::filesystem::path exe = Embed::getExecutablePath();
+        parts[1] = static_cast<uint64_t>(std::filesystem::file_size(exe, ec));
+        parts[2] = static_cast<uint64_t>(std::filesystem::last_write_time(exe, ec).time_since_epoch().count());
+        return fnv1a(parts, sizeof(parts));
+    }();
+    return fp;
+}
+
+std::filesystem::path defaultCacheDir() {
+    if (const char* d = std::getenv("QIANJS_CACHE_DIR"); d && *d)
+        return d;
+#ifdef _WIN32
+    if (const char* d = std::getenv("LOCALAPPDATA"); d && *d)
+        return std::filesystem::path(d) / "qianjs";
+#else
+    if (const char* d = std::getenv("XDG_CACHE_HOME"); d && *d)
+        return std::filesystem::path(d) / "qianjs";
+    if (const char* d = std::getenv("HOME"); d && *d)
+        return std::filesystem::path(d) / ".cache" / "qianjs";
+#endif
+    return std::filesystem::temp_directory_path() / "qianjs-cache";
+}
+
+CompileCache::CompileCache(std::filesystem::path dir) : dir_(std::move(dir)) {}
+
+std::filesystem::path CompileCache::entryPath(uint64_t key) const {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.qbc", static_cast<unsigned long long>(key));
+    return dir_ / name;
+}
+
+std::optional<std::vector<uint8_t>> CompileCache::load(uint64_t key, const std::string& name) const {
+    std::ifstream f(entryPath(key), std::ios::binary);
+    if (!f)
+        return std::nullopt;
+    EntryHeader h{};
+    if (!f.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, kEntryMagic, 8) != 0 || h.key != key ||
+        h.name_len != name.size())
+        return std::nullopt;
+    std::string stored(h.name_len, '\0');
+    if (!f.read(stored.data(), static_cast<std::streamsize>(stored.size())) || stored != name)
+        return std::nullopt;
+    std::vector<uint8_t> bytecode(h.bytecode_len);
+    if (!f.read(reinterpret_cast<char*>(bytecode.data()), static_cast<std::streamsize>(bytecode.size())))
+        return std::nullopt;
+    return bytecode;
+}
+
+/** Write to a unique temp file and rename, so concurrent runs never observe a torn entry. Failures are ignored. */
+void CompileCache::store(uint64_t key, const std::string& name, const uint8_t* data, size_t len) const {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    const std::filesystem::path final_path = entryPath(key);
+    std::filesystem::path tmp = final_path;
+    tmp += ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count() ^
+                                   static_cast<long long>(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f)
+            return;
+        EntryHeader h{};
+        std::memcpy(h.magic, kEntryMagic, 8);
+        h.key = key;
+        h.name_len = static_cast<uint32_t>(name.size());
+        h.bytecode_len = static_cast<uint32_t>(len);
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        f.write(name.data(), static_cast<std::streamsize>(name.size()));
+        f.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(len));
+        if (!f) {
+            f.close();
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, final_path, ec);
+    if (ec)
+        std::filesystem::remove(tmp, ec);
+}
+
+std::vector<uint8_t> CompileCache::moduleBytecode(JSContext* c, const std::string& name, const std::string& source) {
+    uint64_t key = fnv1a(source.data(), source.size(), engineFingerprint());
+    key = fnv1a(name.data(), name.size(), key);
+    if (auto hit = load(key, name)) {
+        hits_++;
+        return std::move(*hit);
+    }
+
+    misses_++;
+    /**
+     * Compile in a throwaway context of the same runtime: a compile-only module registers itself under `name`, and
+     * the caller's context must only ever see the instance it reads back from the bytecode.
+     */
+    JSContext* scratch = JS_NewContext(JS_GetRuntime(c));
+    if (!scratch) {
+        JS_ThrowOutOfMemory(c);
+        return {};
+    }
+    JSValue m = JS_Eval(scratch, source.c_str(), source.size(), name.c_str(), JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(m)) {
+        JSValue exc = JS_GetException(scratch);
+        const char* msg = JS_ToCString(scratch, exc);
+        JS_ThrowSyntaxError(c, "%s", msg ? msg : "compile error");
+        if (msg)
+            JS_FreeCString(scratch, msg);
+        JS_FreeValue(scratch, exc);
+        JS_FreeContext(scratch);
+        return {};
+    }
+    size_t len = 0;
+    uint8_t* buf = JS_WriteObject(scratch, &len, m, JS_WRITE_OBJ_BYTECODE);
+    JS_FreeValue(scratch, m);
+    if (!buf) {
+        JS_FreeContext(scratch);
+        JS_ThrowOutOfMemory(c);
+        return {};
+    }
+    std::vector<uint8_t> out(buf, buf + len);
+    js_free(scratch, buf);
+    JS_FreeContext(scratch);
+    if (len <= UINT32_MAX)
+        store(key, name, out.data(), out.size());
+    return out;
+}
+
+void CompileCache::installModuleLoader(JSContext* c) {
+    plugins::setModuleLoader(c, cached_module_loader, this);
+}
+
+} // namespace qianjs::compile_cache
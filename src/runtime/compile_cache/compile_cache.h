@@ -0,0 +1,52 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace qianjs::compile_cache {
+
+/**
+ * On-disk cache of module bytecode (`JS_WriteObject` of a compile-only module), one file per module under `dir()`.
+ * Keyed by FNV-1a of the module source and name plus `engineFingerprint()`, so a rebuilt `qianjs` or a different
+ * `QIANJS_MODULE_*` set never reads stale bytecode. A hit skips parsing and compilation.
+ */
+class CompileCache {
+public:
+    explicit CompileCache(std::filesystem::path dir);
+
+    const std::filesystem::path& dir() const { return dir_; }
+
+    /** Bytecode for `name` compiled from `source`; compiles and stores it on a miss. Empty on compile error (exception set). */
+    std::vector<uint8_t> moduleBytecode(JSContext* c, const std::string& name, const std::string& source);
+
+    /** Routes file imports of `c`'s runtime through this cache (default name normalization). Must outlive the context. */
+    void installModuleLoader(JSContext* c);
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    std::optional<std::vector<uint8_t>> load(uint64_t key, const std::string& name) const;
+    void store(uint64_t key, const std::string& name, const uint8_t* data, size_t len) const;
+    std::filesystem::path entryPath(uint64_t key) const;
+
+    std::filesystem::path dir_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+/** `QIANJS_CACHE_DIR` if set, else the per-user cache directory (`$XDG_CACHE_HOME/qianjs`, `~/.cache/qianjs`, `%LOCALAPPDATA%\qianjs`). */
+std::filesystem::path defaultCacheDir();
+
+/** Running executable's size and mtime plus the enabled native module set; computed once. */
+uint64_t engineFingerprint();
+
+/** 64-bit FNV-1a, continuing from `seed`. */
+uint64_t fnv1a(const void* data, size_t len, uint64_t seed = 14695981039346656037ull);
+
+} // namespace qianjs::compile_cache
@@ -5,10 +5,23 @@
 #include <vector>
 #include <cstring>
 #include <cstdint>
+#include <algorithm>
+#include <system_error>
+
+#include "runtime/lz4_block.h"
 
 #ifdef _WIN32
 #include <windows.h>
-#elif defined(__APPLE__)
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+#ifdef __APPLE__
 #include <mach-o/dyld.h>
 #endif
 
@@ -19,23 +32,48 @@ namespace fs = std::filesystem;
  *
  * 提供将字节码嵌入到可执行文件的功能，以及从可执行文件中读取嵌入的字节码。
  *
- * 嵌入格式：
+ * 嵌入格式 v1（只读兼容）：
  *   [原始可执行文件] [字节码数据] [16字节 Footer]
  *
+ * 嵌入格式 v2（`qianjs embed` 写出）：
+ *   [原始可执行文件] [补零至 64K 对齐，仅未压缩] [负载] [48字节 FooterV2] [16字节 Footer]
+ *
  * Footer 结构 (16 bytes):
- *   [8 bytes: magic "QIANJSBC"] [4 bytes: bytecode size] [4 bytes: reserved]
+ *   [8 bytes: magic "QIANJSBC"] [4 bytes: bytecode size，v2 为 0] [4 bytes: reserved，v2 为版本号 2]
+ *
+ * FooterV2 记录 64 位的原始可执行文件长度、负载偏移、存储长度与解压后长度、校验和、压缩方式（无 / LZ4 分块）。
+ *
+ * 启动时只读 Footer 探测，负载按页映射后直接执行；嵌入时流式拷贝原可执行文件，不整份读入内存。
  */
 class Embed {
 public:
     static constexpr char MAGIC[8] = {'Q', 'I', 'A', 'N', 'J', 'S', 'B', 'C'};
     static constexpr size_t FOOTER_SIZE = 16;
 
+    /** v2 时写入 `Footer::reserved`，此时 `bytecodeSize` 为 0（v1 加载器会当作无嵌入）。 */
+    static constexpr uint32_t FOOTER_VERSION_2 = 2;
+    static constexpr size_t FOOTER_V2_SIZE = 48;
+    /** 未压缩负载在文件中的对齐（覆盖 16K 页与 Windows 64K 分配粒度），可直接映射。 */
+    static constexpr uint64_t PAYLOAD_ALIGNMENT = 65536;
+
     struct Footer {
         char magic[8];
         uint32_t bytecodeSize;
         uint32_t reserved;
     };
 
+    /** 紧挨在 v2 `Footer` 之前。 */
+    struct FooterV2 {
+        uint64_t executableSize;
+        uint64_t payloadOffset;
+        uint64_t storedSize;
+        uint64_t rawSize;
+        uint64_t checksum;
+        uint32_t compression;
+        uint32_t blockSize;
+    };
+    static_assert(sizeof(FooterV2) == FOOTER_V2_SIZE, "FooterV2 layout");
+
     static fs::path getExecutablePath() {
 #ifdef _WIN32
         char path[MAX_PATH];
@@ -82,68 +120,234 @@ public:
         return std::string(std::istreambuf_iterator<char>(f), {});
     }
 
-    static bool hasEmbeddedBytecode() {
-        return !readEmbeddedBytecode().empty();
+    /**
+     * 映射到内存的嵌入字节码。
+     *
+     * 只映射负载所在的页，直接交给 `runBytecode`；映射失败时退回读入 `fallback`。
+     * 仅可移动，析构时解除映射。
+     */
+    class Payload {
+    public:
+        Payload() = default;
+        Payload(const Payload&) = delete;
+        Payload& operator=(const Payload&) = delete;
+        Payload(Payload&& o) noexcept { swap(o); }
+        Payload& operator=(Payload&& o) noexcept {
+            if (this != &o) {
+                release();
+                swap(o);
+            }
+            return *this;
+        }
+        ~Payload() { release(); }
+
+        const uint8_t* data() const { return data_; }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+    private:
+        friend class Embed;
+
+        void swap(Payload& o) noexcept {
+            std::swap(base_, o.base_);
+            std::swap(mapLen_, o.mapLen_);
+            std::swap(data_, o.data_);
+            std::swap(size_, o.size_);
+            fallback_.swap(o.fallback_);
+        }
+
+        void release() {
+            if (base_) {
+#ifdef _WIN32
+                UnmapViewOfFile(base_);
+#else
+                munmap(base_, mapLen_);
+#endif
+            }
+            base_ = nullptr;
+            mapLen_ = 0;
+            data_ = nullptr;
+            size_ = 0;
+            fallback_.clear();
+        }
+
+        void* base_ = nullptr;
+        size_t mapLen_ = 0;
+        const uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+        std::vector<uint8_t> fallback_;
+    };
+
+    /** 负载压缩方式（`FooterV2::compression`）。 */
+    enum class Compression : uint32_t { None = 0, Lz4 = 1 };
+
+    /** 探测得到的嵌入布局；v1 时 `executableSize == payloadOffset` 且不压缩、无校验和。 */
+    struct Layout {
+        uint32_t version = 1;
+        uint64_t executableSize = 0;
+        uint64_t payloadOffset = 0;
+        uint64_t storedSize = 0;
+        uint64_t rawSize = 0;
+        uint64_t checksum = 0;
+        Compression compression = Compression::None;
+        uint32_t blockSize = 0;
+    };
+
+    /** FNV-1a 的 64 位分组变体：按 8 字节一组混入，尾部逐字节；`seed` 可串接分段计算（前段长度须为 8 的倍数）。 */
+    static uint64_t checksum(const uint8_t* data, size_t len, uint64_t seed = 0xcbf29ce484222325ull) {
+        constexpr uint64_t prime = 0x100000001b3ull;
+        uint64_t h = seed;
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+            uint64_t w;
+            std::memcpy(&w, data + i, 8);
+            h = (h ^ w) * prime;
+        }
+        for (; i < len; i++) h = (h ^ data[i]) * prime;
+        return h;
     }
 
-    static std::vector<uint8_t> readEmbeddedBytecode() {
-        fs::path exePath = getExecutablePath();
-        std::ifstream f(exePath, std::ios::binary | std::ios::ate);
-        if (!f) return {};
+    /** 只读文件尾部（v1 16 字节，v2 再多 48 字节）并校验各字段范围。 */
+    static bool probeFooter(const fs::path& path, Layout& layout) {
+        std::ifstream f(path, std::ios::binary | std::ios::ate);
+        if (!f) return false;
 
-        auto fileSize = static_cast<size_t>(f.tellg());
-        if (fileSize < FOOTER_SIZE) return {};
+        const auto fileSize = static_cast<uint64_t>(f.tellg());
+        if (fileSize < FOOTER_SIZE) return false;
 
         f.seekg(-static_cast<std::streamoff>(FOOTER_SIZE), std::ios::end);
         Footer footer;
-        f.read(reinterpret_cast<char*>(&footer), sizeof(footer));
+        if (!f.read(reinterpret_cast<char*>(&footer), sizeof(footer))) return false;
+        if (std::memcmp(footer.magic, MAGIC, 8) != 0) return false;
 
-        if (std::memcmp(footer.magic, MAGIC, 8) != 0) return {};
+        if (footer.reserved == 0) {
+            if (footer.bytecodeSize == 0 || footer.bytecodeSize > fileSize - FOOTER_SIZE) return false;
+            layout = Layout{};
+            layout.storedSize = layout.rawSize = footer.bytecodeSize;
+            layout.payloadOffset = layout.executableSize = fileSize - FOOTER_SIZE - footer.bytecodeSize;
+            return true;
+        }
 
-        if (footer.bytecodeSize == 0 || footer.bytecodeSize > fileSize - FOOTER_SIZE) return {};
+        if (footer.reserved != FOOTER_VERSION_2 || footer.bytecodeSize != 0) return false;
+        if (fileSize < FOOTER_SIZE + FOOTER_V2_SIZE) return false;
+        f.seekg(-static_cast<std::streamoff>(FOOTER_SIZE + FOOTER_V2_SIZE), std::ios::end);
+        FooterV2 v2;
+        if (!f.read(reinterpret_cast<char*>(&v2), sizeof(v2))) return false;
 
-        f.seekg(-static_cast<std::streamoff>(FOOTER_SIZE + footer.bytecodeSize), std::ios::end);
-        std::vector<uint8_t> bytecode(footer.bytecodeSize);
-        f.read(reinterpret_cast<char*>(bytecode.data()), footer.bytecodeSize);
+        const uint64_t tail = fileSize - FOOTER_SIZE - FOOTER_V2_SIZE;
+        if (v2.executableSize > v2.payloadOffset || v2.payloadOffset > tail) return false;
+        if (v2.storedSize == 0 || v2.storedSize != tail - v2.payloadOffset || v2.rawSize == 0) return false;
+        if (v2.compression == static_cast<uint32_t>(Compression::None)) {
+            if (v2.rawSize != v2.storedSize) return false;
+        } else if (v2.compression != static_cast<uint32_t>(Compression::Lz4) || v2.blockSize == 0) {
+            return false;
+        }
 
-        return bytecode;
+        layout.version = 2;
+        layout.executableSize = v2.executableSize;
+        layout.payloadOffset = v2.payloadOffset;
+        layout.storedSize = v2.storedSize;
+        layout.rawSize = v2.rawSize;
+        layout.checksum = v2.checksum;
+        layout.compression = static_cast<Compression>(v2.compression);
+        layout.blockSize = v2.blockSize;
+        return true;
     }
 
-    static std::vector<uint8_t> getCleanExecutable() {
-        fs::path exePath = getExecutablePath();
-        std::vector<uint8_t> exeData = readBinaryFile(exePath);
-        if (exeData.empty()) return {};
-
-        if (exeData.size() >= FOOTER_SIZE) {
-            Footer* existingFooter = reinterpret_cast<Footer*>(
-                exeData.data() + exeData.size() - FOOTER_SIZE);
-            if (std::memcmp(existingFooter->magic, MAGIC, 8) == 0) {
-                size_t originalSize = exeData.size() - FOOTER_SIZE - existingFooter->bytecodeSize;
-                exeData.resize(originalSize);
-            }
+    static bool hasEmbeddedBytecode() {
+        Layout layout;
+        return probeFooter(getExecutablePath(), layout);
+    }
+
+    /**
+     * 映射 `path`（默认当前可执行文件）尾部的嵌入字节码；没有或校验失败则返回空 `Payload`。
+     * 未压缩负载直接映射；LZ4 负载从映射区逐块解压到堆上，随后解除映射。
+     */
+    static Payload mapEmbeddedBytecode(const fs::path& path = getExecutablePath()) {
+        Layout layout;
+        if (!probeFooter(path, layout) || layout.storedSize > SIZE_MAX || layout.rawSize > SIZE_MAX) return {};
+
+        Payload stored = mapRange(path, layout.payloadOffset, static_cast<size_t>(layout.storedSize));
+        if (stored.empty() || layout.version == 1) return stored;
+
+        if (layout.compression == Compression::None) {
+            if (checksum(stored.data(), stored.size()) != layout.checksum) return {};
+            return stored;
         }
 
-        return exeData;
+        Payload payload;
+        payload.fallback_.resize(static_cast<size_t>(layout.rawSize));
+        if (!decompressBlocks(stored.data(), stored.size(), payload.fallback_.data(), payload.fallback_.size(),
+                              layout.blockSize) ||
+            checksum(payload.fallback_.data(), payload.fallback_.size()) != layout.checksum) {
+            return {};
+        }
+        payload.data_ = payload.fallback_.data();
+        payload.size_ = payload.fallback_.size();
+        return payload;
     }
 
-    static bool createEmbeddedExecutable(const std::vector<uint8_t>& bytecode, const fs::path& outputPath) {
-        std::vector<uint8_t> exeData = getCleanExecutable();
-        if (exeData.empty()) return false;
+    /** 去掉已有嵌入负载后的可执行文件长度（无 Footer 时即文件长度）。 */
+    static uint64_t cleanExecutableSize(const fs::path& exePath) {
+        Layout layout;
+        if (probeFooter(exePath, layout)) return layout.executableSize;
+        std::error_code ec;
+        const auto total = fs::file_size(exePath, ec);
+        return ec ? 0 : static_cast<uint64_t>(total);
+    }
 
-        std::vector<uint8_t> outputData;
-        outputData.reserve(exeData.size() + bytecode.size() + FOOTER_SIZE);
-        outputData.insert(outputData.end(), exeData.begin(), exeData.end());
-        outputData.insert(outputData.end(), bytecode.begin(), bytecode.end());
+    /**
+     * 生成嵌入可执行文件（v2 Footer）：`sourceExe` 的干净部分流式拷贝到输出（Linux 走 `copy_file_range` /
+     * `sendfile`），未压缩负载先补零到 `PAYLOAD_ALIGNMENT`，再追加负载与 Footer。先写临时文件再重命名。
+     */
+    static bool createEmbeddedExecutable(const std::vector<uint8_t>& bytecode, const fs::path& outputPath,
+                                         Compression compression = Compression::None,
+                                         const fs::path& sourceExe = getExecutablePath()) {
+        if (bytecode.empty()) return false;
+        const uint64_t exeSize = cleanExecutableSize(sourceExe);
+        if (exeSize == 0) return false;
 
-        Footer footer;
-        std::memcpy(footer.magic, MAGIC, 8);
-        footer.bytecodeSize = static_cast<uint32_t>(bytecode.size());
-        footer.reserved = 0;
+        if (outputPath.has_parent_path()) {
+            fs::create_directories(outputPath.parent_path());
+        }
+        fs::path tmpPath = outputPath;
+        tmpPath += ".tmp";
 
-        const uint8_t* footerBytes = reinterpret_cast<const uint8_t*>(&footer);
-        outputData.insert(outputData.end(), footerBytes, footerBytes + sizeof(footer));
+        FooterV2 v2{};
+        v2.executableSize = exeSize;
+        v2.payloadOffset = exeSize;
+        v2.rawSize = bytecode.size();
+        v2.checksum = checksum(bytecode.data(), bytecode.size());
+        v2.compression = static_cast<uint32_t>(compression);
 
-        if (!writeBinaryFile(outputPath, outputData)) return false;
+        bool ok = copyPrefix(sourceExe, tmpPath, exeSize);
+        if (ok) {
+            std::ofstream f(tmpPath, std::ios::binary | std::ios::app);
+            if (compression == Compression::None) {
+                v2.payloadOffset = (exeSize + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT * PAYLOAD_ALIGNMENT;
+                const std::vector<char> pad(static_cast<size_t>(v2.payloadOffset - exeSize), 0);
+                f.write(pad.data(), static_cast<std::streamsize>(pad.size()));
+                f.write(reinterpret_cast<const char*>(bytecode.data()), static_cast<std::streamsize>(bytecode.size()));
+                v2.storedSize = bytecode.size();
+            } else {
+                v2.blockSize = static_cast<uint32_t>(LZ4_BLOCK_SIZE);
+                v2.storedSize = writeCompressedBlocks(f, bytecode.data(), bytecode.size());
+            }
+            Footer footer;
+            std::memcpy(footer.magic, MAGIC, 8);
+            footer.bytecodeSize = 0;
+            footer.reserved = FOOTER_VERSION_2;
+            f.write(reinterpret_cast<const char*>(&v2), sizeof(v2));
+            f.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+            ok = f.good();
+        }
+
+        std::error_code ec;
+        if (ok) fs::rename(tmpPath, outputPath, ec);
+        if (!ok || ec) {
+            fs::remove(tmpPath, ec);
+            return false;
+        }
 
 #ifndef _WIN32
         fs::permissions(outputPath, fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec,
@@ -152,4 +356,182 @@ public:
 
         return true;
     }
+
+private:
+    /** LZ4 负载的分块大小；每块独立压缩，前缀 4 字节长度，最高位置 1 表示该块按原样存储。 */
+    static constexpr size_t LZ4_BLOCK_SIZE = size_t{4} << 20;
+    static constexpr uint32_t LZ4_STORED_FLAG = 0x80000000u;
+
+    /** 映射文件中 `[offset, offset + size)`，映射失败时读入堆上。 */
+    static Payload mapRange(const fs::path& path, uint64_t offset, size_t size) {
+        Payload payload;
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file != INVALID_HANDLE_VALUE) {
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (mapping) {
+                SYSTEM_INFO info;
+                GetSystemInfo(&info);
+                const uint64_t aligned = offset - offset % info.dwAllocationGranularity;
+                const size_t mapLen = static_cast<size_t>(size + (offset - aligned));
+                void* base = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(aligned >> 32),
+                                           static_cast<DWORD>(aligned & 0xffffffffu), mapLen);
+                CloseHandle(mapping);
+                if (base) {
+                    payload.base_ = base;
+                    payload.mapLen_ = mapLen;
+                    payload.data_ = static_cast<const uint8_t*>(base) + (offset - aligned);
+                    payload.size_ = size;
+                    return payload;
+                }
+            }
+        }
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            const auto page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            const uint64_t aligned = offset - offset % page;
+            const size_t mapLen = static_cast<size_t>(size + (offset - aligned));
+            void* base = mmap(nullptr, mapLen, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(aligned));
+            ::close(fd);
+            if (base != MAP_FAILED) {
+                posix_madvise(base, mapLen, POSIX_MADV_SEQUENTIAL);
+                payload.base_ = base;
+                payload.mapLen_ = mapLen;
+                payload.data_ = static_cast<const uint8_t*>(base) + (offset - aligned);
+                payload.size_ = size;
+                return payload;
+            }
+        }
+#endif
+
+        std::ifstream f(path, std::ios::binary);
+        if (!f) return payload;
+        f.seekg(static_cast<std::streamoff>(offset));
+        payload.fallback_.resize(size);
+        if (!f.read(reinterpret_cast<char*>(payload.fallback_.data()), static_cast<std::streamsize>(size))) {
+            payload.fallback_.clear();
+            return payload;
+        }
+        payload.data_ = payload.fallback_.data();
+        payload.size_ = payload.fallback_.size();
+        return payload;
+    }
+
+    /** 逐块压缩写出，返回写入的字节数；压缩后不变小的块按原样存储。 */
+    static uint64_t writeCompressedBlocks(std::ofstream& f, const uint8_t* data, size_t len) {
+        uint64_t written = 0;
+        std::vector<uint8_t> block;
+        for (size_t off = 0; off < len; off += LZ4_BLOCK_SIZE) {
+            const size_t n = std::min(LZ4_BLOCK_SIZE, len - off);
+            block.clear();
+            qianjs::lz4::compress(data + off, n, block);
+            const bool stored = block.size() >= n;
+            const uint32_t prefix = static_cast<uint32_t>(stored ? n : block.size()) | (stored ? LZ4_STORED_FLAG : 0);
+            f.write(reinterpret_cast<const char*>(&prefix), sizeof(prefix));
+            if (stored)
+                f.write(reinterpret_cast<const char*>(data + off), static_cast<std::streamsize>(n));
+            else
+                f.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+            written += sizeof(prefix) + (stored ? n : block.size());
+        }
+        return written;
+    }
+
+    static bool decompressBlocks(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, uint32_t blockSize) {
+        size_t ip = 0;
+        size_t op = 0;
+        while (op < dstLen) {
+            uint32_t prefix;
+            if (srcLen - ip < sizeof(prefix)) return false;
+            std::memcpy(&prefix, src + ip, sizeof(prefix));
+            ip += sizeof(prefix);
+            const size_t stored = prefix & ~LZ4_STORED_FLAG;
+            const size_t n = std::min<size_t>(blockSize, dstLen - op);
+            if (stored > srcLen - ip) return false;
+            if (prefix & LZ4_STORED_FLAG) {
+                if (stored != n) return false;
+                std::memcpy(dst + op, src + ip, n);
+            } else if (!qianjs::lz4::decompress(src + ip, stored, dst + op, n)) {
+                return false;
+            }
+            ip += stored;
+            op += n;
+        }
+        return ip == srcLen;
+    }
+
+    /** 把 `src` 的前 `len` 字节写成新文件 `dst`。 */
+    static bool copyPrefix(const fs::path& src, const fs::path& dst, uint64_t len) {
+#ifdef _WIN32
+        std::ifstream in(src, std::ios::binary);
+        std::ofstream out(dst, std::ios::binary | std::ios::trunc);
+        if (!in || !out) return false;
+        std::vector<char> buf(1 << 20);
+        while (len > 0) {
+            const auto n = static_cast<std::streamsize>(std::min<uint64_t>(len, buf.size()));
+            if (!in.read(buf.data(), n) || !out.write(buf.data(), n)) return false;
+            len -= static_cast<uint64_t>(n);
+        }
+        return out.good();
+#else
+        const int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) return false;
+        const int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+        if (out < 0) {
+            ::close(in);
+            return false;
+        }
+
+        uint64_t done = 0;
+#ifdef __linux__
+        /** 同一文件系统内 `copy_file_range` 可走 reflink / 内核内拷贝；不支持时退到 `sendfile`。 */
+        bool kernelCopy = true;
+        while (kernelCopy && done < len) {
+            loff_t inOff = static_cast<loff_t>(done);
+            const ssize_t n = copy_file_range(in, &inOff, out, nullptr, static_cast<size_t>(len - done), 0);
+            if (n > 0) {
+                done += static_cast<uint64_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                kernelCopy = false;
+            }
+        }
+        kernelCopy = true;
+        while (kernelCopy && done < len) {
+            off_t inOff = static_cast<off_t>(done);
+            const ssize_t n = sendfile(out, in, &inOff, static_cast<size_t>(len - done));
+            if (n > 0) {
+                done += static_cast<uint64_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                kernelCopy = false;
+            }
+        }
+#endif
+        std::vector<char> buf(done < len ? (1 << 20) : 0);
+        while (done < len) {
+            const ssize_t n = pread(in, buf.data(), static_cast<size_t>(std::min<uint64_t>(len - done, buf.size())),
+                                    static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            ssize_t written = 0;
+            while (written < n) {
+                const ssize_t w = ::write(out, buf.data() + written, static_cast<size_t>(n - written));
+                if (w < 0 && errno == EINTR) continue;
+                if (w <= 0) break;
+                written += w;
+            }
+            if (written < n) break;
+            done += static_cast<uint64_t>(n);
+        }
+
+        ::close(in);
+        return ::close(out) == 0 && done == len;
+#endif
+    }
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <js_engine.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace qianjs::event_loop {
+
+/**
+ * Type-erased `void(qjs::JSEngine&)` with inline storage. Captures up to `kInlineSize` bytes (a `uv_stat_t` plus a
+ * promise handle, two strings plus a handle, …) are placed in the task itself; larger ones fall back to the heap.
+ * Not copyable or movable: tasks are constructed in place inside a pooled `DeferredNode`.
+ */
+class DeferredTask {
+public:
+    static constexpr std::size_t kInlineSize = 192;
+
+    DeferredTask() = default;
+    ~DeferredTask() { reset(); }
+
+    DeferredTask(const DeferredTask&) = delete;
+    DeferredTask& operator=(const DeferredTask&) = delete;
+
+    template <class F>
+    void emplace(F&& fn) {
+        using Fn = std::decay_t<F>;
+        reset();
+        if constexpr (sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t)) {
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(fn));
+            invoke_ = [](void* p, qjs::JSEngine& e) { (*static_cast<Fn*>(p))(e); };
+            destroy_ = [](void* p) { static_cast<Fn*>(p)->~Fn(); };
+        } else {
+            Fn* heap = new Fn(std::forward<F>(fn));
+            ::new (static_cast<void*>(storage_)) Fn*(heap);
+            invoke_ = [](void* p, qjs::JSEngine& e) { (**static_cast<Fn**>(p))(e); };
+            destroy_ = [](void* p) { delete *static_cast<Fn**>(p); };
+        }
+    }
+
+    void operator()(qjs::JSEngine& engine) { invoke_(storage_, engine); }
+
+    void reset() {
+        if (destroy_) {
+            destroy_(storage_);
+            destroy_ = nullptr;
+            invoke_ = nullptr;
+        }
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    void (*invoke_)(void*, qjs::JSEngine&) = nullptr;
+    void (*destroy_)(void*) = nullptr;
+};
+
+/** Intrusive node of the deferred MPSC queue; recycled through a pool instead of freed after each run. */
+struct DeferredNode {
+    std::atomic<DeferredNode*> next{nullptr};
+    /** `now_ns()` at `defer` while metrics are enabled, else 0. */
+    uint64_t enqueued_ns = 0;
+    DeferredTask task;
+};
+
+} // namespace qianjs::event_loop
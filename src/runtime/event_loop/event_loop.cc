@@ -1,79 +1,242 @@
 #include "runtime/event_loop/event_loop.h"
 
+#include "runtime/runtime_context.h"
+
 #if QIANJS_HAVE_LIBUV
 #include <uvw.hpp>
 #endif
 
 #include <atomic>
+#include <cstddef>
+#include <cstdio>
 #include <cstdlib>
 #include <mutex>
-#include <utility>
-#include <vector>
+
+namespace qianjs::event_loop {
 
 namespace {
 
-#if QIANJS_HAVE_LIBUV
-std::mutex g_loop_mutex;
-std::shared_ptr<uvw::loop> g_uvw_loop;
-#endif
+/** Bound on each loop's free list so a burst does not pin memory. */
+constexpr std::size_t kMaxPooledNodes = 4096;
+
+/**
+ * Producer-side node cache. Nodes are interchangeable between loops, so one cache per thread serves every loop it
+ * defers to; refilled by taking a loop's whole free list with one `exchange`, which avoids ABA without tagged pointers.
+ */
+struct NodeCache {
+    DeferredNode* head = nullptr;
+
+    ~NodeCache() {
+        while (head) {
+            DeferredNode* n = head;
+            head = n->next.load(std::memory_order_relaxed);
+            delete n;
+        }
+    }
+};
 
-std::mutex g_js_mutex;
-std::vector<std::function<void(qjs::JSEngine&)>> g_js_pending;
+thread_local NodeCache t_node_cache;
 
-std::atomic<int> g_pending_ops{0};
+/** Innermost `EventLoop::Scope` on this thread. */
+thread_local EventLoop* t_bound = nullptr;
 
 } // namespace
 
-#if QIANJS_HAVE_LIBUV
+EventLoop::EventLoop() = default;
 
-namespace qianjs::event_loop::uv {
+EventLoop::~EventLoop() {
+    /** Tasks nobody will run still own their captures; release them and every pooled node. */
+    while (DeferredNode* n = pop_node()) {
+        n->task.reset();
+        if (n != &stub_)
+            delete n;
+    }
+    DeferredNode* n = free_.exchange(nullptr, std::memory_order_acquire);
+    while (n) {
+        DeferredNode* next = n->next.load(std::memory_order_relaxed);
+        delete n;
+        n = next;
+    }
+#if QIANJS_HAVE_LIBUV
+    if (uvw_loop_) {
+        wake_.store(nullptr, std::memory_order_release);
+        wake_keep_->close();
+        wake_keep_.reset();
+        /** Owners close their handles first; anything still open would keep `uv_loop_close` from freeing the loop. */
+        uv_walk(
+            uvw_loop_->raw(),
+            [](uv_handle_t* h, void*) {
+                if (!uv_is_closing(h))
+                    uv_close(h, nullptr);
+            },
+            nullptr);
+        uvw_loop_->run(uvw::loop::run_mode::NOWAIT);
+        uvw_loop_.reset();
+    }
+#endif
+}
 
-std::shared_ptr<uvw::loop> uvw_loop() {
-    std::lock_guard<std::mutex> lock(g_loop_mutex);
-    if (!g_uvw_loop)
-        g_uvw_loop = uvw::loop::create();
-    return g_uvw_loop;
+LoopMetrics& EventLoop::enable_metrics() {
+    if (!metrics_owner_) {
+        metrics_owner_ = std::make_unique<LoopMetrics>();
+        metrics_.store(metrics_owner_.get(), std::memory_order_release);
+    }
+    return *metrics_owner_;
 }
 
-uv_loop_t* loop() { return uvw_loop()->raw(); }
+EventLoop::Scope::Scope(EventLoop& loop) : prev_(t_bound) { t_bound = &loop; }
 
-} // namespace qianjs::event_loop::uv
+EventLoop::Scope::~Scope() { t_bound = prev_; }
 
-#endif
+EventLoop* EventLoop::bound() { return t_bound; }
 
-namespace qianjs::event_loop {
+EventLoop& EventLoop::current() {
+    if (!t_bound) {
+        std::fputs("qianjs: no EventLoop is bound to this thread (missing EventLoop::Scope)\n", stderr);
+        std::abort();
+    }
+    return *t_bound;
+}
+
+EventLoop& EventLoop::of(qjs::JSEngine& engine) {
+    RuntimeContext* runtime = engine.host<RuntimeContext>();
+    if (runtime && runtime->loop)
+        return *runtime->loop;
+    return current();
+}
 
 #if QIANJS_HAVE_LIBUV
-void ensure_started() { (void)uv::uvw_loop(); }
 
-void tick() { uv::uvw_loop()->run(uvw::loop::run_mode::NOWAIT); }
+std::shared_ptr<uvw::loop> EventLoop::uvw_loop() {
+    if (!uvw_loop_) {
+        uvw_loop_ = uvw::loop::create();
+        // The loop thread only needs to return from `uv_run`; deferred work is drained by `run_deferred`.
+        wake_keep_ = uvw_loop_->resource<uvw::async_handle>();
+        wake_keep_->on<uvw::async_event>([](const uvw::async_event&, uvw::async_handle&) {});
+        wake_.store(wake_keep_->raw(), std::memory_order_release);
+    }
+    return uvw_loop_;
+}
+
+uv_loop_t* EventLoop::uv_loop() { return uvw_loop()->raw(); }
+
+void EventLoop::ensure_started() { (void)uvw_loop(); }
+
+void EventLoop::tick() { uvw_loop()->run(uvw::loop::run_mode::NOWAIT); }
+
+void EventLoop::run_once() { uvw_loop()->run(uvw::loop::run_mode::ONCE); }
+
+void EventLoop::wake() {
+    if (uv_async_t* a = wake_.load(std::memory_order_acquire))
+        uv_async_send(a);
+}
+
+namespace uv {
+
+std::shared_ptr<uvw::loop> uvw_loop() { return EventLoop::current().uvw_loop(); }
+
+uv_loop_t* loop() { return EventLoop::current().uv_loop(); }
+
+} // namespace uv
+
 #else
-void ensure_started() {}
 
-void tick() {}
-#endif
+void EventLoop::ensure_started() {}
+
+void EventLoop::tick() {}
 
-void defer(std::function<void(qjs::JSEngine&)> fn) {
-    std::lock_guard<std::mutex> lock(g_js_mutex);
-    g_js_pending.push_back(std::move(fn));
+void EventLoop::run_once() {
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    wait_cv_.wait(lock, [this] { return queued_.load(std::memory_order_acquire) > 0; });
 }
 
-void run_deferred(qjs::JSEngine& engine) {
-    std::vector<std::function<void(qjs::JSEngine&)>> batch;
-    {
-        std::lock_guard<std::mutex> lock(g_js_mutex);
-        batch.swap(g_js_pending);
+void EventLoop::wake() {
+    { std::lock_guard<std::mutex> lock(wait_mutex_); }
+    wait_cv_.notify_one();
+}
+
+#endif
+
+void EventLoop::release_node(DeferredNode* n) {
+    n->task.reset();
+    if (free_count_.load(std::memory_order_relaxed) >= kMaxPooledNodes) {
+        delete n;
+        return;
     }
-    for (auto& f : batch)
-        f(engine);
+    free_count_.fetch_add(1, std::memory_order_relaxed);
+    DeferredNode* top = free_.load(std::memory_order_relaxed);
+    do {
+        n->next.store(top, std::memory_order_relaxed);
+    } while (!free_.compare_exchange_weak(top, n, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void EventLoop::push_node(DeferredNode* n) {
+    n->next.store(nullptr, std::memory_order_relaxed);
+    DeferredNode* prev = head_.exchange(n, std::memory_order_acq_rel);
+    prev->next.store(n, std::memory_order_release);
 }
 
-void begin_operation() { g_pending_ops.fetch_add(1, std::memory_order_relaxed); }
+/** Consumer side; returns nullptr when empty or when the next producer has not linked its node yet. */
+DeferredNode* EventLoop::pop_node() {
+    DeferredNode* tail = tail_;
+    DeferredNode* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+        if (!next)
+            return nullptr;
+        tail_ = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire))
+        return nullptr;
+    push_node(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
 
-void end_operation() { g_pending_ops.fetch_sub(1, std::memory_order_relaxed); }
+DeferredNode* EventLoop::acquire_node() {
+    DeferredNode* n = t_node_cache.head;
+    if (!n) {
+        n = free_.exchange(nullptr, std::memory_order_acquire);
+        free_count_.store(0, std::memory_order_relaxed);
+    }
+    if (!n)
+        return new DeferredNode;
+    t_node_cache.head = n->next.load(std::memory_order_relaxed);
+    return n;
+}
 
-int pending_operations() { return g_pending_ops.load(std::memory_order_relaxed); }
+void EventLoop::enqueue(DeferredNode* node) {
+    node->enqueued_ns = metrics() ? now_ns() : 0;
+    queued_.fetch_add(1, std::memory_order_release);
+    push_node(node);
+    wake();
+}
 
-void shutdown() {}
+void EventLoop::run_deferred(qjs::JSEngine& engine) {
+    std::size_t budget = queued_.load(std::memory_order_acquire);
+    LoopMetrics* m = metrics();
+    if (m && budget > 0)
+        m->deferredDepth.record(budget);
+    while (budget > 0) {
+        DeferredNode* n = pop_node();
+        if (!n)
+            break;
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        budget--;
+        if (m && n->enqueued_ns != 0)
+            m->deferredWait.record(now_ns() - n->enqueued_ns);
+        n->task(engine);
+        release_node(n);
+    }
+}
 
 } // namespace qianjs::event_loop
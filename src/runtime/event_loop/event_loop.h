@@ -1,57 +1,219 @@
 #pragma once
 
+#include "runtime/event_loop/deferred_task.h"
+#include "runtime/event_loop/loop_metrics.h"
+
 #include <js_engine.h>
 
-#include <functional>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <utility>
 
 #if QIANJS_HAVE_LIBUV
 
 namespace uvw {
 class loop;
+class async_handle;
 }
 
 struct uv_loop_s;
 typedef struct uv_loop_s uv_loop_t;
+struct uv_async_s;
+typedef struct uv_async_s uv_async_t;
+
+#else
+
+#include <condition_variable>
+#include <mutex>
+
+#endif
+
+namespace qianjs::event_loop {
 
-namespace qianjs::event_loop::uv {
+/**
+ * Host-side event driver for one engine: deferred-task queue, pending-operation count and (with
+ * `QIANJS_HAVE_LIBUV`) a private uvw/libuv loop. Hosts own one per engine and publish it through
+ * `RuntimeContext::loop`; nothing is shared between instances, so N engines can be driven on N threads without
+ * contention (an engine may also move between threads as long as only one drives it at a time).
+ *
+ * `defer` may be called from any thread on a captured `EventLoop&`; everything else is for the thread driving it.
+ */
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * Binds a loop as the calling thread's `current()` for its lifetime (nestable). Hosts hold one while installing
+     * plugins and driving the engine, so native code using the free functions below reaches that engine's loop.
+     */
+    class Scope {
+    public:
+        explicit Scope(EventLoop& loop);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        EventLoop* prev_;
+    };
+
+    /** Innermost `Scope` on this thread; aborts when none is bound, since work queued there would never run. */
+    static EventLoop& current();
+
+    /** Innermost `Scope` on this thread, or null. */
+    static EventLoop* bound();
+
+    /** `RuntimeContext::loop` of `engine` when the host set one, else `current()`. */
+    static EventLoop& of(qjs::JSEngine& engine);
+
+    /** Idempotent; ensures the uv loop exists when libuv is enabled. */
+    void ensure_started();
+
+    /** One non-blocking pass when libuv is enabled (`UV_RUN_NOWAIT`); otherwise a no-op. */
+    void tick();
+
+    /**
+     * Block until the loop has something to do: one `UV_RUN_ONCE` pass when libuv is enabled (woken early by `defer`
+     * through a `uv_async_t`); otherwise waits until `defer` queues work. Call only while work is outstanding.
+     */
+    void run_once();
+
+    /**
+     * Queue work for this loop's JS thread (Promise settle, engine APIs); runs on its next `run_deferred`.
+     * Lock-free: the callable is built in place in a pooled node (`DeferredTask`), so steady-state calls do not allocate.
+     */
+    template <class F>
+    void defer(F&& fn) {
+        DeferredNode* node = acquire_node();
+        node->task.emplace(std::forward<F>(fn));
+        enqueue(node);
+    }
+
+    /** True when `defer` has queued work that `run_deferred` has not taken yet. */
+    bool has_deferred() const { return queued_.load(std::memory_order_acquire) > 0; }
+
+    /** Run the tasks queued before this call (tasks they defer wait for the next call); single consumer. */
+    void run_deferred(qjs::JSEngine& engine);
+
+    /** Book-keeping for async ops so the host knows when the engine can go idle. */
+    void begin_operation() { pending_ops_.fetch_add(1, std::memory_order_relaxed); }
+    void end_operation() { pending_ops_.fetch_sub(1, std::memory_order_relaxed); }
+    int pending_operations() const { return pending_ops_.load(std::memory_order_relaxed); }
+
+    /**
+     * Timed variant: same book-keeping, plus the begin-to-settle latency lands in `metrics()->op(kind)` when metrics
+     * are enabled. Pass the returned timer to `end_operation` from wherever the operation settles.
+     */
+    OpTimer begin_operation(OpKind kind) {
+        begin_operation();
+        return OpTimer{kind, metrics() ? now_ns() : 0};
+    }
+    void end_operation(const OpTimer& timer) {
+        end_operation();
+        if (timer.started != 0)
+            if (LoopMetrics* m = metrics())
+                m->op(timer.kind).record(now_ns() - timer.started);
+    }
+
+    /** Queued deferred tasks (approximate while producers race). */
+    std::size_t deferred_count() const { return queued_.load(std::memory_order_relaxed); }
+
+    /** Latency metrics, or nullptr until `enable_metrics()`; off by default so untimed runs pay one relaxed load. */
+    LoopMetrics* metrics() const { return metrics_.load(std::memory_order_acquire); }
+
+    /** Idempotent; call on the driving thread. The metrics live as long as the loop. */
+    LoopMetrics& enable_metrics();
 
-/** Shared uvw loop owned by the runtime (`event_loop.cc`). */
+#if QIANJS_HAVE_LIBUV
+    std::shared_ptr<uvw::loop> uvw_loop();
+    uv_loop_t* uv_loop();
+#endif
+
+private:
+    DeferredNode* acquire_node();
+    void enqueue(DeferredNode* node);
+    void release_node(DeferredNode* n);
+    void push_node(DeferredNode* n);
+    DeferredNode* pop_node();
+    void wake();
+
+    /*
+     * Deferred queue: intrusive Vyukov MPSC list. Producers `exchange` the head (wait-free); the owning thread is the
+     * only consumer. `queued_` counts published tasks so `run_deferred` can stop at the batch boundary and
+     * `has_deferred` stays exact even while a producer is between its `exchange` and its `next` store.
+     */
+    DeferredNode stub_;
+    std::atomic<DeferredNode*> head_{&stub_};
+    DeferredNode* tail_ = &stub_;
+    std::atomic<std::size_t> queued_{0};
+
+    /** Recycled nodes (Treiber push by the consumer); producers take the whole list into a thread-local cache. */
+    std::atomic<DeferredNode*> free_{nullptr};
+    std::atomic<std::size_t> free_count_{0};
+
+    std::atomic<int> pending_ops_{0};
+
+    std::unique_ptr<LoopMetrics> metrics_owner_;
+    std::atomic<LoopMetrics*> metrics_{nullptr};
+
+#if QIANJS_HAVE_LIBUV
+    std::shared_ptr<uvw::loop> uvw_loop_;
+    /** Wakes `run_once()` when work is deferred; raw handle so `defer` can signal from any thread. */
+    std::shared_ptr<uvw::async_handle> wake_keep_;
+    std::atomic<uv_async_t*> wake_{nullptr};
+#else
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+#endif
+};
+
+#if QIANJS_HAVE_LIBUV
+
+namespace uv {
+
+/** The calling thread's uvw loop (`EventLoop::current().uvw_loop()`). */
 std::shared_ptr<uvw::loop> uvw_loop();
 
 /** Underlying `uv_loop_t*`; same lifetime as `uvw_loop()`. */
 uv_loop_t* loop();
 
-} // namespace qianjs::event_loop::uv
+} // namespace uv
 
 #endif
 
-namespace qianjs::event_loop {
-
-/**
- * Host-side event driver. With `QIANJS_HAVE_LIBUV`, backed by uvw/libuv; otherwise `tick` / `ensure_started` are no-ops.
- * Native I/O code includes this header for `defer` / `tick` / `uvw_loop()`, and `<uvw.hpp>` for uvw types when libuv is enabled.
+/*
+ * Free functions below act on `EventLoop::current()`, i.e. the loop of the engine being driven on this thread, and
+ * abort when no `Scope` is bound. Native I/O code calls them from bindings and uv callbacks; code that hands work to
+ * another thread captures the loop first and defers on that.
  */
 
-/** Idempotent; ensures the loop exists when libuv is enabled. */
-void ensure_started();
+inline void ensure_started() { EventLoop::current().ensure_started(); }
 
-/** One non-blocking pass when libuv is enabled (`UV_RUN_NOWAIT`); otherwise a no-op. */
-void tick();
+inline void tick() { EventLoop::current().tick(); }
 
-/**
- * Queue work that must run on the JS thread (Promise settle, engine APIs).
- * Safe to call from libuv callbacks when enabled; runs on the next `run_deferred`.
- */
-void defer(std::function<void(qjs::JSEngine&)> fn);
+inline void run_once() { EventLoop::current().run_once(); }
+
+template <class F>
+void defer(F&& fn) {
+    EventLoop::current().defer(std::forward<F>(fn));
+}
+
+inline bool has_deferred() { return EventLoop::current().has_deferred(); }
 
-void run_deferred(qjs::JSEngine& engine);
+inline void run_deferred(qjs::JSEngine& engine) { EventLoop::current().run_deferred(engine); }
 
-/** Book-keeping for fs async ops so the host knows when the process can go idle. */
-void begin_operation();
-void end_operation();
-int pending_operations();
+inline void begin_operation() { EventLoop::current().begin_operation(); }
+inline void end_operation() { EventLoop::current().end_operation(); }
+inline int pending_operations() { return EventLoop::current().pending_operations(); }
+inline OpTimer begin_operation(OpKind kind) { return EventLoop::current().begin_operation(kind); }
+inline void end_operation(const OpTimer& timer) { EventLoop::current().end_operation(timer); }
 
-void shutdown();
+inline void shutdown() {}
 
 } // namespace qianjs::event_loop
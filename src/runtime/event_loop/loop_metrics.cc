@@ -0,0 +1,177 @@
+#include "runtime/event_loop/loop_metrics.h"
+
+#if QIANJS_HAVE_LIBUV
+#include <uv.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+
+namespace qianjs::event_loop {
+
+namespace {
+
+int highest_bit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int b = 0;
+    while (v >>= 1)
+        b++;
+    return b;
+#endif
+}
+
+void append_row(std::string& out, const char* name, const Histogram& h, double scale) {
+    if (h.count() == 0)
+        return;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-22s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+                  static_cast<unsigned long long>(h.count()), h.mean() * scale,
+                  static_cast<double>(h.percentile(0.5)) * scale, static_cast<double>(h.percentile(0.9)) * scale,
+                  static_cast<double>(h.percentile(0.99)) * scale, static_cast<double>(h.max()) * scale);
+    out += line;
+}
+
+} // namespace
+
+const char* opKindName(OpKind kind) {
+    switch (kind) {
+    case OpKind::ReadFile:
+        return "readFile";
+    case OpKind::WriteFile:
+        return "writeFile";
+    case OpKind::Stat:
+        return "stat";
+    case OpKind::Readdir:
+        return "readdir";
+    case OpKind::Mkdir:
+        return "mkdir";
+    case OpKind::Unlink:
+        return "unlink";
+    case OpKind::Rmdir:
+        return "rmdir";
+    case OpKind::Open:
+        return "open";
+    case OpKind::Close:
+        return "close";
+    case OpKind::Read:
+        return "read";
+    case OpKind::Write:
+        return "write";
+    case OpKind::ReadChunks:
+        return "readChunks";
+    case OpKind::Batch:
+        return "batch";
+    case OpKind::Walk:
+        return "walk";
+    case OpKind::ConsoleWrite:
+        return "consoleWrite";
+    case OpKind::Spawn:
+        return "spawn";
+    case OpKind::Other:
+    case OpKind::Count:
+        break;
+    }
+    return "other";
+}
+
+uint64_t now_ns() {
+#if QIANJS_HAVE_LIBUV
+    return uv_hrtime();
+#else
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+size_t Histogram::bucketOf(uint64_t value) {
+    if (value < kSub)
+        return static_cast<size_t>(value);
+    const int shift = highest_bit(value) - kSubBits;
+    const size_t sub = static_cast<size_t>(value >> shift) & (kSub - 1);
+    return static_cast<size_t>(shift + 1) * kSub + sub;
+}
+
+uint64_t Histogram::bucketUpper(size_t bucket) {
+    if (bucket < kSub)
+        return bucket;
+    const int shift = static_cast<int>(bucket / kSub) - 1;
+    const uint64_t lower = (static_cast<uint64_t>(kSub + bucket % kSub)) << shift;
+    return lower + ((uint64_t{1} << shift) - 1);
+}
+
+void Histogram::record(uint64_t value) {
+    buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::reset() {
+    for (auto& b : buckets_)
+        b.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+double Histogram::mean() const {
+    const uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(sum()) / static_cast<double>(n);
+}
+
+uint64_t Histogram::percentile(double q) const {
+    uint64_t total = 0;
+    for (const auto& b : buckets_)
+        total += b.load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0;
+    const double clamped = q < 0 ? 0 : (q > 1 ? 1 : q);
+    uint64_t rank = static_cast<uint64_t>(clamped * static_cast<double>(total) + 0.5);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            const uint64_t upper = bucketUpper(i);
+            const uint64_t m = max();
+            return upper < m ? upper : m;
+        }
+    }
+    return max();
+}
+
+void LoopMetrics::reset() {
+    for (auto& h : ops_)
+        h.reset();
+    deferredWait.reset();
+    deferredDepth.reset();
+    turn.reset();
+    microtasks.reset();
+    timerLag.reset();
+}
+
+std::string LoopMetrics::report() const {
+    constexpr double kMs = 1e-6;
+    std::string out;
+    char header[160];
+    std::snprintf(header, sizeof(header), "%-22s %10s %10s %10s %10s %10s %10s\n", "loop stats (ms)", "count", "mean",
+                  "p50", "p90", "p99", "max");
+    out += header;
+    for (size_t i = 0; i < static_cast<size_t>(OpKind::Count); i++) {
+        const std::string name = std::string("op ") + opKindName(static_cast<OpKind>(i));
+        append_row(out, name.c_str(), ops_[i], kMs);
+    }
+    append_row(out, "deferred wait", deferredWait, kMs);
+    append_row(out, "turn", turn, kMs);
+    append_row(out, "microtasks", microtasks, kMs);
+    append_row(out, "timer lag", timerLag, kMs);
+    append_row(out, "deferred depth (tasks)", deferredDepth, 1.0);
+    return out;
+}
+
+} // namespace qianjs::event_loop
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace qianjs::event_loop {
+
+/** What a timed pending operation was; one latency histogram per kind. */
+enum class OpKind : uint8_t {
+    ReadFile,
+    WriteFile,
+    Stat,
+    Readdir,
+    Mkdir,
+    Unlink,
+    Rmdir,
+    Open,
+    Close,
+    Read,
+    Write,
+    ReadChunks,
+    Batch,
+    Walk,
+    ConsoleWrite,
+    Spawn,
+    Other,
+    Count
+};
+
+const char* opKindName(OpKind kind);
+
+/** Monotonic nanoseconds (`uv_hrtime` when libuv is enabled); the clock of every histogram below. */
+uint64_t now_ns();
+
+/**
+ * Log-linear histogram in the style of HdrHistogram: values below 8 get a bucket each, larger ones 8 sub-buckets per
+ * power of two (relative error under 12.5%) up to 2^64. Recording is a handful of relaxed atomic adds, so any thread
+ * may record while another reads; readers see a slightly torn but never invalid picture.
+ */
+class Histogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr size_t kSub = size_t{1} << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+    void record(uint64_t value);
+    void reset();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /** Upper bound of the bucket holding the `q` quantile (0..1), capped at `max()`; 0 when empty. */
+    uint64_t percentile(double q) const;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t bucketUpper(size_t bucket);
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+/** Start of a timed operation; `started == 0` when metrics were off at `begin_operation`. */
+struct OpTimer {
+    OpKind kind = OpKind::Other;
+    uint64_t started = 0;
+};
+
+/**
+ * Opt-in metrics of one `EventLoop` (`EventLoop::enable_metrics`). Times are nanoseconds; `deferredDepth` counts
+ * tasks. Exposed to scripts by `process.loopStats()` and printed by `report()` when a run ends with `--loop-stats`.
+ */
+class LoopMetrics {
+public:
+    /** Begin-to-settle latency of timed operations (`begin_operation(kind)` … `end_operation(timer)`). */
+    Histogram& op(OpKind kind) { return ops_[static_cast<size_t>(kind)]; }
+    const Histogram& op(OpKind kind) const { return ops_[static_cast<size_t>(kind)]; }
+
+    /** From `defer` to the task running in `run_deferred`. */
+    Histogram deferredWait;
+    /** Tasks queued when a `run_deferred` batch starts (non-empty batches only). */
+    Histogram deferredDepth;
+    /** One host turn of JS work (deferred tasks, microtasks and a non-blocking loop pass); long turns are loop lag. */
+    Histogram turn;
+    /** One `pumpMicrotasks` that had jobs to run. */
+    Histogram microtasks;
+    /** How late a timer callback started relative to its due time. */
+    Histogram timerLag;
+
+    void reset();
+
+    /** Human-readable table (milliseconds), one row per non-empty histogram. */
+    std::string report() const;
+
+private:
+    Histogram ops_[static_cast<size_t>(OpKind::Count)];
+};
+
+} // namespace qianjs::event_loop
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * LZ4 block format codec (no frame header), used for compressed embedded payloads.
+ * The encoder is a single-pass greedy matcher; the decoder bounds-checks every sequence so a corrupt block fails
+ * instead of writing past `dst`.
+ */
+namespace qianjs::lz4 {
+
+inline constexpr size_t kMinMatch = 4;
+inline constexpr size_t kLastLiterals = 5;
+inline constexpr size_t kMatchFindLimit = 12;
+inline constexpr size_t kMaxOffset = 65535;
+
+namespace detail {
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void put_length(std::vector<uint8_t>& out, size_t len) {
+    for (; len >= 255; len -= 255)
+        out.push_back(255);
+    out.push_back(static_cast<uint8_t>(len));
+}
+
+inline void emit_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen) {
+    const size_t ml = matchLen - kMinMatch;
+    out.push_back(static_cast<uint8_t>(((litLen < 15 ? litLen : 15) << 4) | (ml < 15 ? ml : 15)));
+    if (litLen >= 15)
+        put_length(out, litLen - 15);
+    out.insert(out.end(), literals, literals + litLen);
+    out.push_back(static_cast<uint8_t>(offset & 0xff));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (ml >= 15)
+        put_length(out, ml - 15);
+}
+
+inline bool read_length(const uint8_t* src, size_t srcLen, size_t& ip, size_t& len) {
+    uint8_t b;
+    do {
+        if (ip >= srcLen)
+            return false;
+        b = src[ip++];
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace detail
+
+/** Upper bound of `compress` output for `n` input bytes. */
+inline size_t compressBound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+/** Compress one block; appends to `out` and returns the number of bytes written. */
+inline size_t compress(const uint8_t* src, size_t n, std::vector<uint8_t>& out) {
+    const size_t start = out.size();
+    out.reserve(start + compressBound(n));
+
+    size_t anchor = 0;
+    if (n > kMatchFindLimit) {
+        std::vector<uint32_t> table(1u << 16, 0);
+        const size_t limit = n - kMatchFindLimit;
+        const size_t matchLimit = n - kLastLiterals;
+        size_t i = 0;
+        while (i < limit) {
+            const uint32_t seq = detail::read32(src + i);
+            const uint32_t h = (seq * 2654435761u) >> 16;
+            const size_t cand = table[h];
+            table[h] = static_cast<uint32_t>(i + 1);
+            if (cand == 0 || i - (cand - 1) > kMaxOffset || detail::read32(src + cand - 1) != seq) {
+                i++;
+                continue;
+            }
+            const size_t m = cand - 1;
+            size_t len = kMinMatch;
+            while (i + len < matchLimit && src[m + len] == src[i + len])
+                len++;
+            detail::emit_sequence(out, src + anchor, i - anchor, i - m, len);
+            i += len;
+            anchor = i;
+        }
+    }
+
+    const size_t litLen = n - anchor;
+    out.push_back(static_cast<uint8_t>((litLen < 15 ? litLen : 15) << 4));
+    if (litLen >= 15)
+        detail::put_length(out, litLen - 15);
+    out.insert(out.end(), src + anchor, src + n);
+    return out.size() - start;
+}
+
+/** Decompress one block into exactly `dstLen` bytes; false on malformed input or size mismatch. */
+inline bool decompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen) {
+    size_t ip = 0;
+    size_t op = 0;
+    while (ip < srcLen) {
+        const uint8_t token = src[ip++];
+        size_t lit = token >> 4;
+        if (lit == 15 && !detail::read_length(src, srcLen, ip, lit))
+            return false;
+        if (lit > srcLen - ip || lit > dstLen - op)
+            return false;
+        std::memcpy(dst + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == srcLen)
+            break;
+
+        if (srcLen - ip < 2)
+            return false;
+        const size_t offset = static_cast<size_t>(src[ip]) | (static_cast<size_t>(src[ip + 1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return false;
+        size_t len = token & 15;
+        if (len == 15 && !detail::read_length(src, srcLen, ip, len))
+            return false;
+        len += kMinMatch;
+        if (len > dstLen - op)
+            return false;
+
+        const uint8_t* match = dst + op - offset;
+        if (offset >= len) {
+            std::memcpy(dst + op, match, len);
+        } else {
+            for (size_t k = 0; k < len; k++)
+                dst[op + k] = match[k];
+        }
+        op += len;
+    }
+    return op == dstLen;
+}
+
+} // namespace qianjs::lz4
@@ -0,0 +1,165 @@
+#include "runtime/output/std_output.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace qianjs::output {
+
+namespace {
+
+/** Batch capacity the writer thread keeps for reuse; a larger burst is released once written. */
+constexpr size_t kKeepCapacity = 1024 * 1024;
+
+/** One standard stream: what producers queued and how far the writer thread got. */
+struct Channel {
+    int fd = -1;
+    std::mutex mu;
+    /** Signalled when `queue` becomes non-empty. */
+    std::condition_variable ready;
+    /** Signalled after each batch; producers wait on it for room, `flush` for its bytes. */
+    std::condition_variable progress;
+    std::string queue;
+    /** Running totals; `queued - written` is what is still waiting, including the batch being written. */
+    uint64_t queued = 0;
+    uint64_t written = 0;
+    bool started = false;
+};
+
+/** Plain blocking write of all of `data`; gives up on errors such as `EPIPE`. */
+void write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+#ifdef _WIN32
+        const int n = ::_write(fd, data, static_cast<unsigned int>(len));
+#else
+        const ssize_t n = ::write(fd, data, len);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Someone else made the fd non-blocking; wait for room rather than dropping output.
+            pollfd p{fd, POLLOUT, 0};
+            ::poll(&p, 1, -1);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+#endif
+        if (n <= 0)
+            return;
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+void drain(Channel* ch) {
+    std::string batch;
+    std::unique_lock<std::mutex> lock(ch->mu);
+    for (;;) {
+        ch->ready.wait(lock, [ch] { return !ch->queue.empty(); });
+        batch.swap(ch->queue);
+        lock.unlock();
+        write_all(ch->fd, batch.data(), batch.size());
+        lock.lock();
+        ch->written += batch.size();
+        batch.clear();
+        if (batch.capacity() > kKeepCapacity)
+            std::string().swap(batch);
+        ch->progress.notify_all();
+    }
+}
+
+void flush_all() {
+    flush(1);
+    flush(2);
+}
+
+/** Never destroyed: writer threads and `exit()`-time flushes may still use it while statics are torn down. */
+Channel* channel(int fd) {
+    static Channel* const channels = [] {
+        auto* c = new Channel[2];
+        c[0].fd = 1;
+        c[1].fd = 2;
+        std::atexit(flush_all);
+        return c;
+    }();
+    return fd == 1 || fd == 2 ? &channels[fd - 1] : nullptr;
+}
+
+std::mutex g_batchers_mu;
+std::unordered_multimap<const event_loop::EventLoop*, Batcher*> g_batchers;
+
+} // namespace
+
+void write(int fd, std::string data) {
+    if (data.empty())
+        return;
+    Channel* ch = channel(fd);
+    if (!ch) {
+        write_all(fd, data.data(), data.size());
+        return;
+    }
+    std::unique_lock<std::mutex> lock(ch->mu);
+    ch->progress.wait(lock, [ch] { return ch->queued - ch->written < kMaxQueuedBytes; });
+    ch->queued += data.size();
+    if (ch->queue.empty())
+        ch->queue.swap(data);
+    else
+        ch->queue.append(data);
+    if (!ch->started) {
+        ch->started = true;
+        std::thread(drain, ch).detach();
+    }
+    ch->ready.notify_one();
+}
+
+void flush(int fd) {
+    Channel* ch = channel(fd);
+    if (!ch)
+        return;
+    std::unique_lock<std::mutex> lock(ch->mu);
+    const uint64_t target = ch->queued;
+    ch->progress.wait(lock, [ch, target] { return ch->written >= target; });
+}
+
+void addBatcher(event_loop::EventLoop& loop, Batcher* batcher) {
+    const std::lock_guard<std::mutex> lock(g_batchers_mu);
+    g_batchers.emplace(&loop, batcher);
+}
+
+void removeBatcher(event_loop::EventLoop& loop, Batcher* batcher) {
+    const std::lock_guard<std::mutex> lock(g_batchers_mu);
+    const auto range = g_batchers.equal_range(&loop);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == batcher) {
+            g_batchers.erase(it);
+            return;
+        }
+    }
+}
+
+void report(std::string text) {
+    std::vector<Batcher*> batchers;
+    if (const event_loop::EventLoop* loop = event_loop::EventLoop::bound()) {
+        const std::lock_guard<std::mutex> lock(g_batchers_mu);
+        const auto range = g_batchers.equal_range(loop);
+        for (auto it = range.first; it != range.second; ++it)
+            batchers.push_back(it->second);
+    }
+    // Batchers only go away on the thread driving their loop, which is this one.
+    for (Batcher* b : batchers)
+        b->flush();
+    write(2, std::move(text));
+}
+
+} // namespace qianjs::output
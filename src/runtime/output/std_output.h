@@ -0,0 +1,49 @@
+#pragma once
+
+#include "runtime/event_loop/event_loop.h"
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Process-wide writer for stdout (fd 1) and stderr (fd 2). Each fd has one queue and one writer thread, started on
+ * first use, that drains it with plain blocking `write` calls: the fds are never switched to non-blocking mode, so
+ * `std::cout`, children inheriting stdio and anything else sharing them keep the semantics they expect, and bytes
+ * from every engine reach each fd in the order they were queued. A slow reader stalls only the writer thread until
+ * `kMaxQueuedBytes` are waiting; `write` then blocks its caller, bounding memory. Whatever is queued is written out
+ * at `exit()`. Writes to an fd nobody reads any more (`EPIPE`) are dropped.
+ */
+namespace qianjs::output {
+
+/** Bytes waiting for one fd beyond which `write` blocks until the writer thread catches up. */
+inline constexpr size_t kMaxQueuedBytes = 16 * 1024 * 1024;
+
+/** Queues `data` for `fd` (1 or 2; anything else is written synchronously). */
+void write(int fd, std::string data);
+
+/** Blocks until everything queued for `fd` before the call has been handed to the OS. */
+void flush(int fd);
+
+/**
+ * Something holding back lines for a standard stream (the console sinks batch one JS turn at a time). Registered per
+ * event loop, so `report` can hand them over before a diagnostic from the same engine and keep them in call order.
+ */
+class Batcher {
+public:
+    virtual void flush() = 0;
+
+protected:
+    ~Batcher() = default;
+};
+
+/** Registers `batcher` for `loop` until `removeBatcher`; call both on the thread driving `loop`. */
+void addBatcher(event_loop::EventLoop& loop, Batcher* batcher);
+void removeBatcher(event_loop::EventLoop& loop, Batcher* batcher);
+
+/**
+ * Queues a diagnostic (uncaught callback exceptions, host errors) for stderr, after flushing the batchers registered
+ * for `EventLoop::bound()` (if any) so it lands after the console lines logged before it.
+ */
+void report(std::string text);
+
+} // namespace qianjs::output
@@ -0,0 +1,143 @@
+#include "runtime/plugins/lazy_plugins.h"
+
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+namespace qianjs::plugins {
+
+namespace {
+
+/** Context → table; touched on engine setup and for each bare import specifier, never on the call path. */
+std::mutex g_tables_mutex;
+std::unordered_map<JSContext*, LazyPlugins*> g_tables;
+
+/** Same result as QuickJS's `js_default_module_normalize`. */
+std::string default_normalize(const char* base, const char* name) {
+    if (name[0] != '.')
+        return name;
+    std::string dir(base ? base : "");
+    const size_t slash = dir.rfind('/');
+    dir.resize(slash == std::string::npos ? 0 : slash);
+
+    std::string_view rest(name);
+    for (;;) {
+        if (rest.rfind("./", 0) == 0) {
+            rest.remove_prefix(2);
+        } else if (rest.rfind("../", 0) == 0) {
+            if (dir.empty())
+                break;
+            const size_t up = dir.rfind('/');
+            const std::string_view last = std::string_view(dir).substr(up == std::string::npos ? 0 : up + 1);
+            if (last == "." || last == "..")
+                break;
+            dir.resize(up == std::string::npos ? 0 : up);
+            rest.remove_prefix(3);
+        } else {
+            break;
+        }
+    }
+    if (!dir.empty())
+        dir += '/';
+    dir.append(rest);
+    return dir;
+}
+
+} // namespace
+
+const LazyRegistry::Entry* LazyRegistry::find(std::string_view module) const {
+    for (const Entry& e : entries_) {
+        if (e.module == module)
+            return &e;
+    }
+    return nullptr;
+}
+
+LazyPlugins::LazyPlugins(qjs::JSEngine& engine, const LazyRegistry& registry)
+    : engine_(engine), ctx_(engine.ctx()), registry_(registry), installed_(registry.entries().size(), false) {
+    {
+        std::lock_guard<std::mutex> lock(g_tables_mutex);
+        g_tables[ctx_] = this;
+    }
+    setModuleLoader(ctx_, loadModuleFile, nullptr);
+    for (const LazyRegistry::Entry& e : registry_.entries()) {
+        if (e.eager)
+            ensure(e.module);
+    }
+}
+
+LazyPlugins::~LazyPlugins() {
+    std::lock_guard<std::mutex> lock(g_tables_mutex);
+    auto it = g_tables.find(ctx_);
+    if (it != g_tables.end() && it->second == this)
+        g_tables.erase(it);
+}
+
+LazyPlugins* LazyPlugins::of(JSContext* c) {
+    std::lock_guard<std::mutex> lock(g_tables_mutex);
+    auto it = g_tables.find(c);
+    return it == g_tables.end() ? nullptr : it->second;
+}
+
+bool LazyPlugins::ensure(std::string_view module) {
+    const std::vector<LazyRegistry::Entry>& entries = registry_.entries();
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].module != module)
+            continue;
+        if (!installed_[i]) {
+            installed_[i] = true;
+            entries[i].install(engine_, engine_.root());
+        }
+        return true;
+    }
+    return false;
+}
+
+bool LazyPlugins::installed(std::string_view module) const {
+    const std::vector<LazyRegistry::Entry>& entries = registry_.entries();
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].module == module)
+            return installed_[i];
+    }
+    return false;
+}
+
+size_t LazyPlugins::installedCount() const {
+    size_t n = 0;
+    for (const bool b : installed_)
+        n += b ? 1 : 0;
+    return n;
+}
+
+char* normalizeModuleName(JSContext* c, const char* base, const char* name, void*) {
+    const std::string normalized = default_normalize(base, name);
+    // Registering the plugin's modules here, before QuickJS looks the name up, lets the lookup find them as if they
+    // had been installed with the engine.
+    if (name[0] != '.') {
+        if (LazyPlugins* table = LazyPlugins::of(c))
+            table->ensure(normalized);
+    }
+    return js_strdup(c, normalized.c_str());
+}
+
+JSModuleDef* loadModuleFile(JSContext* c, const char* name, void*) {
+    std::ifstream f(name, std::ios::binary);
+    if (!f) {
+        JS_ThrowReferenceError(c, "could not load module '%s'", name);
+        return nullptr;
+    }
+    const std::string source(std::istreambuf_iterator<char>(f), {});
+    JSValue m = JS_Eval(c, source.c_str(), source.size(), name, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(m))
+        return nullptr;
+    auto* def = static_cast<JSModuleDef*>(JS_VALUE_GET_PTR(m));
+    JS_FreeValue(c, m);
+    return def;
+}
+
+void setModuleLoader(JSContext* c, JSModuleLoaderFunc* loader, void* opaque) {
+    JS_SetModuleLoaderFunc(JS_GetRuntime(c), normalizeModuleName, loader, opaque);
+}
+
+} // namespace qianjs::plugins
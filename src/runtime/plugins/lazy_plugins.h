@@ -0,0 +1,85 @@
+#pragma once
+
+#include <js_engine.h>
+#include <js_module.h>
+#include <quickjs.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qianjs::plugins {
+
+/** Installs one plugin's modules under `root`, e.g. `[](auto& e, auto& m) { FsPlugin().install(e, m); }`. */
+using InstallFn = void (*)(qjs::JSEngine& engine, qjs::JSModule& root);
+
+/**
+ * Native module names and how to build each one; filled by the generated `qianjs_populate_lazy_plugins` (see
+ * `lazyDefaultPlugins()`). Immutable once populated, so one registry serves every engine on every thread.
+ */
+class LazyRegistry {
+public:
+    struct Entry {
+        std::string module;
+        InstallFn install = nullptr;
+        /** Installed with the engine rather than on first import: for plugins with side effects beyond their module. */
+        bool eager = false;
+    };
+
+    void add(const char* module, InstallFn install, bool eager = false) {
+        entries_.push_back(Entry{module, install, eager});
+    }
+
+    const Entry* find(std::string_view module) const;
+    const std::vector<Entry>& entries() const { return entries_; }
+
+private:
+    std::vector<Entry> entries_;
+};
+
+/**
+ * Per-engine lazy plugin table. Construct after `initialize()` and `setHost`, with the engine's loop bound: eager
+ * plugins are installed right away, the rest when the module loader first resolves their specifier (static or dynamic
+ * `import`), so a script importing only `console` never builds `fs`. Also sets a file module loader that routes name
+ * normalization through `normalizeModuleName`; hosts that install their own loader use `setModuleLoader`.
+ *
+ * Must outlive module resolution on the engine; destroy it with (or after `cleanup()` of) the engine.
+ */
+class LazyPlugins {
+public:
+    LazyPlugins(qjs::JSEngine& engine, const LazyRegistry& registry);
+    ~LazyPlugins();
+
+    LazyPlugins(const LazyPlugins&) = delete;
+    LazyPlugins& operator=(const LazyPlugins&) = delete;
+
+    /** Installs the plugin providing `module` if it is registered and not installed yet; false if not registered. */
+    bool ensure(std::string_view module);
+
+    bool installed(std::string_view module) const;
+    size_t installedCount() const;
+
+    /** The table bound to `c`, or nullptr (build-time contexts, engines set up with `installAll`). */
+    static LazyPlugins* of(JSContext* c);
+
+private:
+    qjs::JSEngine& engine_;
+    JSContext* ctx_;
+    const LazyRegistry& registry_;
+    /** Parallel to `registry_.entries()`. */
+    std::vector<bool> installed_;
+};
+
+/**
+ * QuickJS's default normalization (relative specifiers resolved against the importing module's directory, bare ones
+ * unchanged), plus lazy installation of the native plugin a bare specifier names. `opaque` is unused.
+ */
+char* normalizeModuleName(JSContext* c, const char* base, const char* name, void* opaque);
+
+/** Reads and compiles the module file `name` (compile only); the loader `LazyPlugins` installs by default. */
+JSModuleDef* loadModuleFile(JSContext* c, const char* name, void* opaque);
+
+/** `JS_SetModuleLoaderFunc` with `normalizeModuleName`: what module loaders on runtime engines should call. */
+void setModuleLoader(JSContext* c, JSModuleLoaderFunc* loader, void* opaque);
+
+} // namespace qianjs::plugins
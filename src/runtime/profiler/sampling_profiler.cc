@@ -0,0 +1,243 @@
+#include "runtime/profiler/sampling_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace qianjs::profiler {
+
+namespace {
+
+thread_local SamplingProfiler* t_active = nullptr;
+
+bool all_digits(std::string_view s) {
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](char ch) { return ch >= '0' && ch <= '9'; });
+}
+
+/**
+ * One `Error().stack` line (`    at fn (file.js:12)`, `    at fn (file.js:12:5)`, `    at fn (native)`) appended as a
+ * folded frame: `fn (file.js:12)` or `fn [native]`. The column is dropped so samples aggregate per line.
+ */
+void append_frame(std::string& out, std::string_view line) {
+    while (!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+        line.remove_prefix(1);
+    if (line.rfind("at ", 0) == 0)
+        line.remove_prefix(3);
+
+    std::string_view name = "<anonymous>";
+    std::string_view loc = line;
+    const size_t open = line.find(" (");
+    if (open != std::string_view::npos && line.back() == ')') {
+        name = line.substr(0, open);
+        loc = line.substr(open + 2, line.size() - open - 3);
+    }
+
+    const size_t start = out.size();
+    out.append(name);
+    if (loc == "native") {
+        out += " [native]";
+    } else {
+        const size_t last = loc.rfind(':');
+        if (last != std::string_view::npos && all_digits(loc.substr(last + 1))) {
+            const size_t prev = loc.rfind(':', last - 1);
+            if (prev != std::string_view::npos && all_digits(loc.substr(prev + 1, last - prev - 1)))
+                loc = loc.substr(0, last);
+        }
+        out += " (";
+        out.append(loc);
+        out += ')';
+    }
+    std::replace(out.begin() + static_cast<std::ptrdiff_t>(start), out.end(), ';', ',');
+}
+
+} // namespace
+
+SamplingProfiler::SamplingProfiler(JSContext* ctx, std::chrono::microseconds interval)
+    : ctx_(ctx), interval_(interval.count() > 0 ? interval : kDefaultInterval) {}
+
+SamplingProfiler::~SamplingProfiler() {
+    stop();
+}
+
+SamplingProfiler* SamplingProfiler::active() {
+    return t_active;
+}
+
+void SamplingProfiler::start() {
+    if (running_)
+        return;
+    running_ = true;
+    prev_active_ = t_active;
+    t_active = this;
+
+    JSValue global = JS_GetGlobalObject(ctx_);
+    error_ctor_ = JS_GetPropertyStr(ctx_, global, "Error");
+    JS_FreeValue(ctx_, global);
+    JS_SetInterruptHandler(JS_GetRuntime(ctx_), &SamplingProfiler::on_interrupt, this);
+
+    stop_requested_ = false;
+    sampler_ = std::thread([this] { sampler_main(); });
+}
+
+void SamplingProfiler::stop() {
+    if (!running_)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stop_requested_ = true;
+    }
+    stop_cv_.notify_one();
+    sampler_.join();
+
+    JS_SetInterruptHandler(JS_GetRuntime(ctx_), nullptr, nullptr);
+    JS_FreeValue(ctx_, error_ctor_);
+    error_ctor_ = JS_UNDEFINED;
+    t_active = prev_active_;
+    running_ = false;
+}
+
+void SamplingProfiler::sampler_main() {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stop_cv_.wait_for(lock, interval_, [this] { return stop_requested_; })) {
+        if (native_depth_.load(std::memory_order_relaxed) > 0)
+            native_ticks_.fetch_add(1, std::memory_order_relaxed);
+        else if (idle_.load(std::memory_order_relaxed))
+            idle_samples_.fetch_add(1, std::memory_order_relaxed);
+        else if (requested_.exchange(true, std::memory_order_relaxed))
+            program_samples_.fetch_add(1, std::memory_order_relaxed); // last request never reached a JS poll
+    }
+}
+
+int SamplingProfiler::on_interrupt(JSRuntime*, void* opaque) {
+    auto* self = static_cast<SamplingProfiler*>(opaque);
+    if (self->requested_.load(std::memory_order_relaxed) && !self->recording_) {
+        self->requested_.store(false, std::memory_order_relaxed);
+        self->record_stack(nullptr, 1);
+    }
+    return 0;
+}
+
+void SamplingProfiler::enter_native(const char* label) {
+    if (native_depth_.fetch_add(1, std::memory_order_relaxed) == 0)
+        native_label_ = label;
+}
+
+void SamplingProfiler::leave_native() {
+    if (native_depth_.fetch_sub(1, std::memory_order_relaxed) != 1)
+        return;
+    const uint64_t ticks = native_ticks_.exchange(0, std::memory_order_relaxed);
+    if (ticks > 0 && !recording_)
+        record_stack(native_label_, ticks);
+}
+
+void SamplingProfiler::record_stack(const char* leaf, uint64_t count) {
+    recording_ = true;
+    // The Error constructor captures the frames that are live right now; from the interrupt handler that is the
+    // interrupted JS, from `leave_native` the binding's own C frame and its callers.
+    JSValue err = JS_CallConstructor(ctx_, error_ctor_, 0, nullptr);
+    std::string_view stack;
+    const char* text = nullptr;
+    size_t len = 0;
+    if (JS_IsException(err)) {
+        // Out of memory: drop the sample. A binding may be returning its own exception, so only clear ours when the
+        // handler interrupted plain JS.
+        if (!leaf)
+            JS_FreeValue(ctx_, JS_GetException(ctx_));
+    } else {
+        JSValue s = JS_GetPropertyStr(ctx_, err, "stack");
+        JS_FreeValue(ctx_, err);
+        if (JS_IsString(s))
+            text = JS_ToCStringLen(ctx_, &len, s);
+        JS_FreeValue(ctx_, s);
+        if (text)
+            stack = std::string_view(text, len);
+    }
+
+    thread_local std::vector<std::string_view> lines;
+    thread_local std::string key;
+    lines.clear();
+    key.clear();
+    while (!stack.empty()) {
+        const size_t nl = stack.find('\n');
+        const std::string_view line = stack.substr(0, nl);
+        if (line.find_first_not_of(" \t") != std::string_view::npos)
+            lines.push_back(line);
+        if (nl == std::string_view::npos)
+            break;
+        stack.remove_prefix(nl + 1);
+    }
+
+    if (task_) {
+        key += '[';
+        key += task_;
+        key += ']';
+    }
+    for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+        if (!key.empty())
+            key += ';';
+        append_frame(key, *it);
+    }
+    if (leaf) {
+        if (!key.empty())
+            key += ';';
+        key += '[';
+        key += leaf;
+        key += ']';
+    }
+    if (key.empty())
+        key = "(program)";
+    if (text)
+        JS_FreeCString(ctx_, text);
+
+    stacks_[key] += count;
+    js_samples_ += count;
+    recording_ = false;
+}
+
+uint64_t SamplingProfiler::samples() const {
+    return js_samples_ + idle_samples_.load(std::memory_order_relaxed) +
+           program_samples_.load(std::memory_order_relaxed);
+}
+
+std::string SamplingProfiler::collapsed() const {
+    std::vector<std::pair<std::string, uint64_t>> rows(stacks_.begin(), stacks_.end());
+    if (const uint64_t n = idle_samples_.load(std::memory_order_relaxed))
+        rows.emplace_back("(idle)", n);
+    if (const uint64_t n = program_samples_.load(std::memory_order_relaxed))
+        rows.emplace_back("(program)", n);
+    std::sort(rows.begin(), rows.end());
+
+    // `(program)` may also come from an empty JS stack; merge adjacent duplicates.
+    std::string out;
+    for (size_t i = 0; i < rows.size();) {
+        uint64_t n = rows[i].second;
+        size_t j = i + 1;
+        for (; j < rows.size() && rows[j].first == rows[i].first; j++)
+            n += rows[j].second;
+        out += rows[i].first;
+        out += ' ';
+        out += std::to_string(n);
+        out += '\n';
+        i = j;
+    }
+    return out;
+}
+
+bool SamplingProfiler::writeCollapsed(const std::filesystem::path& path, std::string& error) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot open " + path.string();
+        return false;
+    }
+    const std::string text = collapsed();
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!out) {
+        error = "cannot write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+} // namespace qianjs::profiler
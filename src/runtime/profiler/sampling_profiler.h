@@ -0,0 +1,164 @@
+#pragma once
+
+#include <quickjs.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace qianjs::profiler {
+
+/**
+ * Statistical CPU profiler for one engine (`qianjs run --prof`). A sampler thread wakes every `interval` and asks the
+ * JS thread for a sample; the request is picked up by the QuickJS interrupt handler at the next poll (function entry
+ * or loop back-edge), which reads the call stack through `Error().stack` and bumps a counter for the folded stack.
+ * Between samples the only cost is the handler's relaxed load, so the default 100 Hz is cheap enough for canaries.
+ *
+ * Time outside JS is attributed by the sampler itself: `(idle)` while the host waits in the event loop (`IdleScope`),
+ * `[label]` leaves for native plugin code marked with `NativeFrame` (charged to the JS stack that called it), and
+ * `(program)` when a request went unanswered for a whole interval (engine internals: compilation, GC, builtins).
+ *
+ * Owns the runtime's interrupt handler between `start()` and `stop()`; both run on the JS thread, and `stop()` must
+ * come before the context is freed.
+ */
+class SamplingProfiler {
+public:
+    static constexpr std::chrono::microseconds kDefaultInterval{10000};
+
+    SamplingProfiler(JSContext* ctx, std::chrono::microseconds interval = kDefaultInterval);
+    ~SamplingProfiler();
+
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+    void start();
+    void stop();
+
+    /** Samples taken so far, including `(idle)` and `(program)`. */
+    uint64_t samples() const;
+
+    /** Collapsed stacks (`root;...;leaf count` per line, sorted): the input of `flamegraph.pl` and speedscope. */
+    std::string collapsed() const;
+
+    /** Writes `collapsed()` to `path`; false with `error` set on I/O failure. */
+    bool writeCollapsed(const std::filesystem::path& path, std::string& error) const;
+
+    /** The profiler started on this thread, if any; what `NativeFrame` and friends report to. */
+    static SamplingProfiler* active();
+
+    /** Marks native plugin work; samples landing inside get a `[label]` leaf under the calling JS stack. */
+    class NativeFrame {
+    public:
+        explicit NativeFrame(const char* label) : profiler_(active()) {
+            if (profiler_)
+                profiler_->enter_native(label);
+        }
+        ~NativeFrame() {
+            if (profiler_)
+                profiler_->leave_native();
+        }
+
+        NativeFrame(const NativeFrame&) = delete;
+        NativeFrame& operator=(const NativeFrame&) = delete;
+
+    private:
+        SamplingProfiler* profiler_;
+    };
+
+    /**
+     * JS dispatched by the loop itself (e.g. a timer callback run inside `run_once`): not idle while it runs, and its
+     * samples are rooted at `[label]`. Nestable.
+     */
+    class TaskFrame {
+    public:
+        explicit TaskFrame(const char* label) : profiler_(active()) {
+            if (profiler_) {
+                prev_ = profiler_->task_;
+                was_idle_ = profiler_->idle_.exchange(false, std::memory_order_relaxed);
+                profiler_->task_ = label;
+            }
+        }
+        ~TaskFrame() {
+            if (profiler_) {
+                profiler_->task_ = prev_;
+                profiler_->idle_.store(was_idle_, std::memory_order_relaxed);
+            }
+        }
+
+        TaskFrame(const TaskFrame&) = delete;
+        TaskFrame& operator=(const TaskFrame&) = delete;
+
+    private:
+        SamplingProfiler* profiler_;
+        const char* prev_ = nullptr;
+        bool was_idle_ = false;
+    };
+
+    /** The host is blocked in the event loop; samples count as `(idle)`. */
+    class IdleScope {
+    public:
+        IdleScope() : profiler_(active()) {
+            if (profiler_)
+                profiler_->idle_.store(true, std::memory_order_relaxed);
+        }
+        ~IdleScope() {
+            if (profiler_)
+                profiler_->idle_.store(false, std::memory_order_relaxed);
+        }
+
+        IdleScope(const IdleScope&) = delete;
+        IdleScope& operator=(const IdleScope&) = delete;
+
+    private:
+        SamplingProfiler* profiler_;
+    };
+
+private:
+    static int on_interrupt(JSRuntime* rt, void* opaque);
+
+    void sampler_main();
+    void enter_native(const char* label);
+    void leave_native();
+    /** Folds the current JS stack (plus `leaf` when set) and adds `count` samples; JS thread only. */
+    void record_stack(const char* leaf, uint64_t count);
+
+    JSContext* ctx_;
+    std::chrono::microseconds interval_;
+    JSValue error_ctor_ = JS_UNDEFINED;
+    bool running_ = false;
+    SamplingProfiler* prev_active_ = nullptr;
+
+    std::thread sampler_;
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_requested_ = false;
+
+    /** Set by the sampler, consumed by the interrupt handler. */
+    std::atomic<bool> requested_{false};
+    std::atomic<bool> idle_{false};
+    /** Outermost `NativeFrame` depth and the ticks that landed inside it. */
+    std::atomic<int> native_depth_{0};
+    std::atomic<uint64_t> native_ticks_{0};
+    const char* native_label_ = nullptr;
+    const char* task_ = nullptr;
+    /** Guards `record_stack` against the interrupt handler firing inside the `Error` call it makes. */
+    bool recording_ = false;
+
+    std::atomic<uint64_t> idle_samples_{0};
+    std::atomic<uint64_t> program_samples_{0};
+    /** Folded stack → samples; touched by the JS thread only (read after `stop()`). */
+    std::unordered_map<std::string, uint64_t> stacks_;
+    uint64_t js_samples_ = 0;
+};
+
+using NativeFrame = SamplingProfiler::NativeFrame;
+using TaskFrame = SamplingProfiler::TaskFrame;
+using IdleScope = SamplingProfiler::IdleScope;
+
+} // namespace qianjs::profiler
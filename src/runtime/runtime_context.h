@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -13,11 +17,9 @@ extern char** environ;
 
 namespace qianjs {
 
-struct RuntimeContext {
-    std::vector<std::string> argv;
-    std::vector<std::pair<std::string, std::string>> env;
-    int exit_code = 0;
-};
+namespace event_loop {
+class EventLoop;
+}
 
 inline std::vector<std::pair<std::string, std::string>> captureEnvironment() {
     std::vector<std::pair<std::string, std::string>> out;
@@ -39,4 +41,226 @@ inline std::vector<std::pair<std::string, std::string>> captureEnvironment() {
     return out;
 }
 
+/** Immutable, indexed environment that many `Environment`s can share (e.g. every run of an `EnginePool`). */
+class EnvironmentSnapshot {
+public:
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+
+    explicit EnvironmentSnapshot(Entries entries) : entries_(std::move(entries)) {
+        index_.reserve(entries_.size());
+        for (size_t i = 0; i < entries_.size(); i++)
+            index_.emplace(entries_[i].first, i); // first duplicate wins, as with `getenv`
+    }
+
+    const Entries& entries() const { return entries_; }
+
+    const char* get(const std::string& key) const {
+        const auto it = index_.find(key);
+        return it == index_.end() ? nullptr : entries_[it->second].second.c_str();
+    }
+
+private:
+    Entries entries_;
+    std::unordered_map<std::string, size_t> index_;
+};
+
+/**
+ * Environment of one engine (`process.env`), with a key → entry hash index built on first lookup. A host either
+ * `assign`s entries, `share`s a snapshot or calls `inheritProcess()`; with the last two nothing is copied until a
+ * script changes the environment (inheriting also copies on first listing), and single-key reads go straight to the
+ * snapshot or `getenv`. `version()` moves on every change so cached JS views can be rebuilt. Changes stay in this
+ * object; the process environment and shared snapshots are never written.
+ */
+class Environment {
+public:
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+
+    void assign(Entries entries) {
+        entries_ = std::move(entries);
+        inherit_ = false;
+        shared_.reset();
+        reset_index();
+    }
+
+    /** Read through `snapshot` until the first change, which copies it. */
+    void share(std::shared_ptr<const EnvironmentSnapshot> snapshot) {
+        entries_.clear();
+        inherit_ = false;
+        shared_ = std::move(snapshot);
+        reset_index();
+    }
+
+    /** Lazily snapshot the process environment (`captureEnvironment`) on first listing or change. */
+    void inheritProcess() {
+        entries_.clear();
+        inherit_ = true;
+        shared_.reset();
+        reset_index();
+    }
+
+    /** True until an inherited process environment is first copied (listing or change), i.e. `environ` is current. */
+    bool inherited() const { return inherit_; }
+
+    /** Value of `key`, or null; valid until the next change. */
+    const char* get(const std::string& key) {
+        if (inherit_)
+            return std::getenv(key.c_str());
+        if (shared_)
+            return shared_->get(key);
+        ensure_index();
+        const auto it = index_.find(key);
+        return it == index_.end() ? nullptr : entries_[it->second].second.c_str();
+    }
+
+    void set(std::string key, std::string value) {
+        materialize();
+        ensure_index();
+        const auto it = index_.find(key);
+        if (it != index_.end()) {
+            entries_[it->second].second = std::move(value);
+        } else {
+            index_.emplace(key, entries_.size());
+            entries_.emplace_back(std::move(key), std::move(value));
+        }
+        version_++;
+    }
+
+    /** Removes `key`; the last entry takes its slot, so listing order is not preserved. */
+    bool erase(const std::string& key) {
+        materialize();
+        ensure_index();
+        const auto it = index_.find(key);
+        if (it == index_.end())
+            return false;
+        const size_t slot = it->second;
+        index_.erase(it);
+        if (slot + 1 != entries_.size()) {
+            entries_[slot] = std::move(entries_.back());
+            index_[entries_[slot].first] = slot;
+        }
+        entries_.pop_back();
+        version_++;
+        return true;
+    }
+
+    const Entries& entries() {
+        if (shared_)
+            return shared_->entries();
+        materialize();
+        return entries_;
+    }
+
+    bool empty() { return entries().empty(); }
+
+    uint64_t version() const { return version_; }
+
+private:
+    void materialize() {
+        if (shared_) {
+            entries_ = shared_->entries();
+            shared_.reset();
+            reset_index();
+            return;
+        }
+        if (!inherit_)
+            return;
+        inherit_ = false;
+        entries_ = captureEnvironment();
+        reset_index();
+    }
+
+    void ensure_index() {
+        if (indexed_)
+            return;
+        index_.reserve(entries_.size());
+        for (size_t i = 0; i < entries_.size(); i++)
+            index_.emplace(entries_[i].first, i); // first duplicate wins, as with `getenv`
+        indexed_ = true;
+    }
+
+    void reset_index() {
+        index_.clear();
+        indexed_ = false;
+        version_++;
+    }
+
+    Entries entries_;
+    std::shared_ptr<const EnvironmentSnapshot> shared_;
+    std::unordered_map<std::string, size_t> index_;
+    bool inherit_ = false;
+    bool indexed_ = false;
+    uint64_t version_ = 0;
+};
+
+/** `console` severities in increasing order; `Silent` drops everything. */
+enum class LogLevel { Debug, Info, Warn, Error, Silent };
+
+enum class LogFormat { Text, Json };
+
+struct RuntimeContext {
+    std::vector<std::string> argv;
+    Environment env;
+    int exit_code = 0;
+    /** Bumped by hosts that reuse the engine for another run, so plugins can drop per-run caches (e.g. `argv`). */
+    uint64_t run_id = 0;
+    /** Set to stop `drainAsyncWork` at its next turn (e.g. a terminated `worker`); pending operations are abandoned. */
+    bool exit_requested = false;
+    /** Loop driving this engine (see `event_loop::EventLoop::of`); owned by the host and outlives the engine. */
+    event_loop::EventLoop* loop = nullptr;
+    /** `console` calls below this level return before touching their arguments (`QIANJS_LOG_LEVEL`). */
+    LogLevel log_level = LogLevel::Debug;
+    /** `Json` writes one NDJSON object per call (`QIANJS_LOG_FORMAT=json`). */
+    LogFormat log_format = LogFormat::Text;
+};
+
+inline bool parseLogLevel(std::string_view name, LogLevel& out) {
+    static constexpr std::pair<std::string_view, LogLevel> kNames[] = {
+        {"debug", LogLevel::Debug}, {"info", LogLevel::Info},    {"log", LogLevel::Info},
+        {"warn", LogLevel::Warn},   {"error", LogLevel::Error}, {"silent", LogLevel::Silent},
+    };
+    for (const auto& [n, level] : kNames) {
+        if (n == name) {
+            out = level;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline const char* logLevelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug:
+        return "debug";
+    case LogLevel::Info:
+        return "info";
+    case LogLevel::Warn:
+        return "warn";
+    case LogLevel::Error:
+        return "error";
+    case LogLevel::Silent:
+        break;
+    }
+    return "silent";
+}
+
+inline bool parseLogFormat(std::string_view name, LogFormat& out) {
+    if (name == "text")
+        out = LogFormat::Text;
+    else if (name == "json")
+        out = LogFormat::Json;
+    else
+        return false;
+    return true;
+}
+
+/** Resets the `console` settings from `QIANJS_LOG_LEVEL` / `QIANJS_LOG_FORMAT` in `runtime.env`; ignores bad values. */
+inline void applyLogEnvironment(RuntimeContext& runtime) {
+    runtime.log_level = LogLevel::Debug;
+    runtime.log_format = LogFormat::Text;
+    if (const char* level = runtime.env.get("QIANJS_LOG_LEVEL"))
+        parseLogLevel(level, runtime.log_level);
+    if (const char* format = runtime.env.get("QIANJS_LOG_FORMAT"))
+        parseLogFormat(format, runtime.log_format);
+}
+
 } // namespace qianjs
@@ -3,96 +3,215 @@
 #include <js_engine.h>
 
 #include "native/default_plugins.h"
+#include "runtime/bundle/module_bundle.h"
+#include "runtime/compile_cache/compile_cache.h"
 #include "runtime/event_loop/event_loop.h"
 #include "runtime/embed.h"
+#include "runtime/output/std_output.h"
+#include "runtime/profiler/sampling_profiler.h"
 #include "runtime/runtime_context.h"
 
+#include <quickjs.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
-#include <iostream>
-#include <thread>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace qianjs {
 
-/** Run the event loop and microtasks until native I/O and JS jobs are idle (or timeout). */
+/**
+ * Run the engine's event loop (`EventLoop::of`) and microtasks until native I/O and JS jobs are idle; the loop is bound
+ * to this thread for the duration. While only native work is outstanding the thread blocks in `run_once()`; `defer`
+ * wakes it. Returns early once `RuntimeContext::exit_requested` is set; otherwise everything queued through `output`
+ * has reached stdout and stderr when it returns. With `EventLoop::metrics()` enabled, each turn (everything but the
+ * blocking wait) and each non-empty microtask pump is timed.
+ */
 inline void drainAsyncWork(qjs::JSEngine& engine) {
-    using clock = std::chrono::steady_clock;
-    const auto deadline = clock::now() + std::chrono::seconds(120);
-    int idleRounds = 0;
-
-    while (clock::now() < deadline) {
-        qianjs::event_loop::tick();
-        qianjs::event_loop::run_deferred(engine);
-        engine.pumpMicrotasks();
-
-        const bool noNativeWait = qianjs::event_loop::pending_operations() == 0;
-        const bool noJsJobs = !engine.isJobPending();
+    const RuntimeContext* runtime = engine.host<RuntimeContext>();
+    event_loop::EventLoop& loop = event_loop::EventLoop::of(engine);
+    const event_loop::EventLoop::Scope bind(loop);
+    for (;;) {
+        event_loop::LoopMetrics* metrics = loop.metrics();
+        const uint64_t turn_start = metrics ? event_loop::now_ns() : 0;
+        loop.run_deferred(engine);
+        if (runtime && runtime->exit_requested)
+            return;
+        if (metrics && engine.isJobPending()) {
+            const uint64_t start = event_loop::now_ns();
+            engine.pumpMicrotasks();
+            metrics->microtasks.record(event_loop::now_ns() - start);
+        } else {
+            engine.pumpMicrotasks();
+        }
 
-        if (noNativeWait && noJsJobs) {
-            if (++idleRounds >= 3)
-                return;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const bool more = engine.isJobPending() || loop.has_deferred();
+        if (more)
+            loop.tick();
+        if (metrics)
+            metrics->turn.record(event_loop::now_ns() - turn_start);
+        if (more)
             continue;
+        if (loop.pending_operations() == 0) {
+            output::flush(1);
+            output::flush(2);
+            return;
         }
-        idleRounds = 0;
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const profiler::IdleScope idle;
+        loop.run_once();
     }
+}
 
-    std::cerr << "Warning: timed out while waiting for pending native I/O to finish\n";
+/**
+ * Run a `.qbc` image: a plain single-module blob goes straight to `runBytecode`; a bundle installs its lazy module
+ * loader and runs the entry. `data` and `bundle` must stay alive until the engine is cleaned up.
+ */
+inline bool runBytecodeImage(qjs::JSEngine& engine, const uint8_t* data, size_t len, bundle::ModuleBundle& bundle) {
+    if (!bundle::ModuleBundle::isBundle(data, len))
+        return engine.runBytecode(data, len);
+    if (!bundle.parse(data, len)) {
+        output::report("Error: Corrupt bytecode bundle\n");
+        return false;
+    }
+    bundle.installModuleLoader(engine.ctx());
+    size_t entryLen = 0;
+    const uint8_t* entry = bundle.entryBytecode(&entryLen);
+    return engine.runBytecode(entry, entryLen);
 }
 
-/** Run a `.js` module or `.qbc` file from disk; installs default plugins and drains async work before exit. */
-inline int runScriptFile(const std::filesystem::path& inputPath, std::vector<std::string> argv = {}) {
+/** Per-invocation switches for `runScriptFile`. */
+struct RunOptions {
+    /** Set to enable the on-disk compile cache for `.js` entries and every file they import. */
+    std::optional<std::filesystem::path> cacheDir;
+    /** Set to sample the script with `profiler::SamplingProfiler` and write collapsed stacks here when it ends. */
+    std::optional<std::filesystem::path> profileOut;
+    std::chrono::microseconds profileInterval = profiler::SamplingProfiler::kDefaultInterval;
+    /** Set to enable `event_loop::LoopMetrics` and write `report()` here when the script ends; `-` is stderr. */
+    std::optional<std::filesystem::path> loopStatsOut;
+};
+
+/**
+ * Run a `.js` module or `.qbc` file from disk on a private event loop; default plugins are installed as the script
+ * imports them, and async work is drained before exit. Safe to call concurrently from several threads.
+ */
+inline int runScriptFile(const std::filesystem::path& inputPath, std::vector<std::string> argv = {}, const RunOptions& options = {}) {
+    event_loop::EventLoop loop;
+    const event_loop::EventLoop::Scope bind(loop);
     qjs::JSEngine engine;
     engine.initialize();
     RuntimeContext runtime;
+    runtime.loop = &loop;
+    if (options.loopStatsOut)
+        loop.enable_metrics();
     if (argv.empty())
         runtime.argv.push_back(inputPath.string());
     else
         runtime.argv = std::move(argv);
-    runtime.env = captureEnvironment();
+    runtime.env.inheritProcess();
+    applyLogEnvironment(runtime);
     engine.setHost<RuntimeContext>(&runtime);
-    defaultPlugins().installAll(engine, engine.root());
+    const plugins::LazyPlugins lazy(engine, lazyDefaultPlugins());
+
+    std::optional<profiler::SamplingProfiler> prof;
+    if (options.profileOut) {
+        prof.emplace(engine.ctx(), options.profileInterval);
+        prof->start();
+    }
+    const auto finish = [&](int code) {
+        if (prof) {
+            prof->stop();
+            std::string error;
+            if (prof->writeCollapsed(*options.profileOut, error))
+                output::report("Profile: " + std::to_string(prof->samples()) + " samples -> " +
+                               options.profileOut->string() + "\n");
+            else
+                output::report("Error: Cannot write profile: " + error + "\n");
+        }
+        if (options.loopStatsOut) {
+            const std::string report = loop.metrics()->report();
+            if (*options.loopStatsOut == "-") {
+                output::report(report);
+            } else {
+                std::ofstream out(*options.loopStatsOut, std::ios::binary | std::ios::trunc);
+                out << report;
+                if (!out)
+                    output::report("Error: Cannot write loop stats: " + options.loopStatsOut->string() + "\n");
+            }
+        }
+        engine.cleanup();
+        return code;
+    };
 
     bool ok = false;
+    std::unique_ptr<compile_cache::CompileCache> cache;
+    std::vector<uint8_t> image;
+    bundle::ModuleBundle bundle;
     if (inputPath.extension() == ".qbc") {
-        std::vector<uint8_t> bytecode = Embed::readBinaryFile(inputPath);
+        image = Embed::readBinaryFile(inputPath);
+        if (image.empty()) {
+            output::report("Error: Cannot read bytecode: " + inputPath.string() + "\n");
+            return finish(1);
+        }
+        ok = runBytecodeImage(engine, image.data(), image.size(), bundle);
+    } else if (options.cacheDir) {
+        const std::string source = Embed::readTextFile(inputPath);
+        cache = std::make_unique<compile_cache::CompileCache>(*options.cacheDir);
+        cache->installModuleLoader(engine.ctx());
+        std::vector<uint8_t> bytecode = cache->moduleBytecode(engine.ctx(), inputPath.string(), source);
         if (bytecode.empty()) {
-            std::cerr << "Error: Cannot read bytecode: " << inputPath << std::endl;
-            return 1;
+            JSValue exc = JS_GetException(engine.ctx());
+            const char* msg = JS_ToCString(engine.ctx(), exc);
+            output::report(std::string("Compile error: ") + (msg ? msg : "unknown") + "\n");
+            if (msg)
+                JS_FreeCString(engine.ctx(), msg);
+            JS_FreeValue(engine.ctx(), exc);
+            return finish(1);
         }
         ok = engine.runBytecode(bytecode.data(), bytecode.size());
     } else {
         ok = engine.runFile(inputPath.string());
     }
 
-    if (!ok) {
-        engine.cleanup();
-        return 1;
-    }
+    if (!ok)
+        return finish(1);
 
     drainAsyncWork(engine);
-    engine.cleanup();
-    return runtime.exit_code;
+    return finish(runtime.exit_code);
 }
 
-/** Run bytecode embedded in this executable (`Embed::readEmbeddedBytecode`); returns -1 if none. */
-inline int runEmbeddedBytecode(std::vector<std::string> argv = {}) {
-    std::vector<uint8_t> embedded = Embed::readEmbeddedBytecode();
+/**
+ * Run bytecode embedded in `executable` (this binary by default; mapped via `Embed::mapEmbeddedBytecode`); returns -1
+ * if none.
+ */
+inline int runEmbeddedBytecode(std::vector<std::string> argv = {},
+                               const std::filesystem::path& executable = Embed::getExecutablePath()) {
+    const Embed::Payload embedded = Embed::mapEmbeddedBytecode(executable);
     if (embedded.empty())
         return -1;
 
+    event_loop::EventLoop loop;
+    const event_loop::EventLoop::Scope bind(loop);
     qjs::JSEngine engine;
     engine.initialize();
     RuntimeContext runtime;
+    runtime.loop = &loop;
     runtime.argv = std::move(argv);
-    runtime.env = captureEnvironment();
+    runtime.env.inheritProcess();
+    applyLogEnvironment(runtime);
     engine.setHost<RuntimeContext>(&runtime);
-    defaultPlugins().installAll(engine, engine.root());
+    const plugins::LazyPlugins lazy(engine, lazyDefaultPlugins());
 
-    if (!engine.runBytecode(embedded.data(), embedded.size())) {
+    bundle::ModuleBundle bundle;
+    if (!runBytecodeImage(engine, embedded.data(), embedded.size(), bundle)) {
         engine.cleanup();
         return 1;
     }
@@ -102,4 +221,210 @@ inline int runEmbeddedBytecode(std::vector<std::string> argv = {}) {
     return runtime.exit_code;
 }
 
+/** Knobs for `EnginePool`. */
+struct EnginePoolOptions {
+    /** Warm engines kept by one pool; the least recently used one is destroyed when a release would exceed this. */
+    size_t maxIdle = 8;
+    /** An engine whose QuickJS heap (`memory_used_size`) is still above this after a GC is destroyed, not reused. */
+    size_t memoryLimit = size_t{32} << 20;
+    /** Measure the heap every this many runs of an engine (0 = every run); `JS_ComputeMemoryUsage` walks the heap. */
+    unsigned memoryCheckInterval = 16;
+};
+
+/**
+ * Warm engines for running many short scripts on one thread. Each engine keeps its plugins, its event loop and the
+ * modules it has loaded; a run only resets the `RuntimeContext` (argv, env, exit code) and evaluates the entry again.
+ * `.js` entries are compiled once, with their imports, into an in-memory bundle (see `bundle::compileModuleGraph`);
+ * `.qbc` files are read once. Both are reloaded when the entry's size or mtime changes (imports are not re-checked;
+ * call `clear()`).
+ *
+ * An engine serves only the entry it was created for. Imported modules are evaluated once per engine and globals
+ * written by a run stay visible to the next run on that engine, as in a long-lived process. Engines whose run failed,
+ * was terminated or left async work behind are discarded.
+ *
+ * Not thread-safe: use one pool per thread, and destroy it before the thread exits (the fs and net buffer pools its
+ * engines return memory to are thread-local).
+ */
+class EnginePool {
+public:
+    explicit EnginePool(EnginePoolOptions options = {}) : options_(options) {}
+
+    EnginePool(const EnginePool&) = delete;
+    EnginePool& operator=(const EnginePool&) = delete;
+
+    /**
+     * Environment handed to every run (`process.env`) instead of the process environment; indexed once and shared by
+     * all runs, each copying it only if the script changes it.
+     */
+    void setEnvironment(std::vector<std::pair<std::string, std::string>> env) {
+        env_ = std::make_shared<const EnvironmentSnapshot>(std::move(env));
+    }
+
+    /** Like `runScriptFile`, on a warm engine when one is idle for `script`; returns the script's exit code. */
+    int run(const std::filesystem::path& script, std::vector<std::string> argv = {}) {
+        std::shared_ptr<const Image> image = load(script);
+        if (!image)
+            return 1;
+        std::unique_ptr<Slot> slot = acquire(image);
+        if (!slot)
+            return 1;
+
+        bool ok = false;
+        {
+            const event_loop::EventLoop::Scope bind(slot->loop);
+            RuntimeContext& runtime = slot->runtime;
+            if (argv.empty())
+                runtime.argv.assign(1, script.string());
+            else
+                runtime.argv = std::move(argv);
+            if (env_)
+                runtime.env.share(env_);
+            else
+                runtime.env.inheritProcess();
+            runtime.run_id++;
+            applyLogEnvironment(runtime);
+            runtime.exit_code = 0;
+            runtime.exit_requested = false;
+
+            size_t len = image->bytes.size();
+            const uint8_t* entry = image->bytes.data();
+            if (slot->bundle.size() > 0)
+                entry = slot->bundle.entryBytecode(&len);
+            ok = slot->engine.runBytecode(entry, len);
+            if (ok)
+                drainAsyncWork(slot->engine);
+        }
+        const int code = ok ? slot->runtime.exit_code : 1;
+        release(std::move(slot), ok);
+        return code;
+    }
+
+    /** Number of warm engines currently parked. */
+    size_t idle() const { return idle_.size(); }
+
+    /** Drop every warm engine and cached image. */
+    void clear() {
+        idle_.clear();
+        images_.clear();
+    }
+
+private:
+    struct Image {
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size = 0;
+        /** `.qbc` file contents, or a bundle compiled from a `.js` entry. */
+        std::vector<uint8_t> bytes;
+    };
+
+    struct Slot {
+        event_loop::EventLoop loop;
+        qjs::JSEngine engine;
+        RuntimeContext runtime;
+        std::shared_ptr<const Image> image;
+        bundle::ModuleBundle bundle;
+        std::unique_ptr<plugins::LazyPlugins> plugins;
+        unsigned runs = 0;
+
+        ~Slot() {
+            const event_loop::EventLoop::Scope bind(loop);
+            engine.cleanup();
+        }
+    };
+
+    std::shared_ptr<const Image> load(const std::filesystem::path& script) {
+        std::error_code ec;
+        const auto mtime = std::filesystem::last_write_time(script, ec);
+        const std::uintmax_t size = ec ? 0 : std::filesystem::file_size(script, ec);
+        if (ec) {
+            output::report("Error: Cannot read script: " + script.string() + "\n");
+            return nullptr;
+        }
+        const std::string key = script.string();
+        auto it = images_.find(key);
+        if (it != images_.end()) {
+            if (it->second->mtime == mtime && it->second->size == size)
+                return it->second;
+            const std::shared_ptr<const Image> stale = it->second;
+            const auto is_stale = [&](const std::unique_ptr<Slot>& slot) { return slot->image == stale; };
+            idle_.erase(std::remove_if(idle_.begin(), idle_.end(), is_stale), idle_.end());
+            images_.erase(it);
+        }
+
+        auto image = std::make_shared<Image>();
+        image->mtime = mtime;
+        image->size = size;
+        if (script.extension() == ".qbc") {
+            image->bytes = Embed::readBinaryFile(script);
+        } else {
+            std::vector<bundle::BuiltModule> modules;
+            std::string error;
+            if (!bundle::compileModuleGraph(script, modules, error)) {
+                output::report("Compile error: " + error + "\n");
+                return nullptr;
+            }
+            image->bytes = bundle::writeBundle(std::move(modules));
+        }
+        if (image->bytes.empty()) {
+            output::report("Error: Cannot read bytecode: " + script.string() + "\n");
+            return nullptr;
+        }
+        images_[key] = image;
+        return image;
+    }
+
+    std::unique_ptr<Slot> acquire(const std::shared_ptr<const Image>& image) {
+        for (auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+            if ((*it)->image == image) {
+                std::unique_ptr<Slot> slot = std::move(*it);
+                idle_.erase(std::next(it).base());
+                return slot;
+            }
+        }
+
+        auto slot = std::make_unique<Slot>();
+        const event_loop::EventLoop::Scope bind(slot->loop);
+        slot->engine.initialize();
+        slot->runtime.loop = &slot->loop;
+        slot->engine.setHost<RuntimeContext>(&slot->runtime);
+        slot->plugins = std::make_unique<plugins::LazyPlugins>(slot->engine, lazyDefaultPlugins());
+        slot->image = image;
+        const std::vector<uint8_t>& bytes = image->bytes;
+        if (bundle::ModuleBundle::isBundle(bytes.data(), bytes.size())) {
+            if (!slot->bundle.parse(bytes.data(), bytes.size())) {
+                output::report("Error: Corrupt bytecode bundle\n");
+                return nullptr;
+            }
+            slot->bundle.installModuleLoader(slot->engine.ctx());
+        }
+        return slot;
+    }
+
+    void release(std::unique_ptr<Slot> slot, bool ok) {
+        if (!ok || slot->runtime.exit_requested || slot->loop.pending_operations() != 0)
+            return;
+        const unsigned every = options_.memoryCheckInterval ? options_.memoryCheckInterval : 1;
+        if (++slot->runs % every == 0 && overLimit(*slot)) {
+            JS_RunGC(JS_GetRuntime(slot->engine.ctx()));
+            if (overLimit(*slot))
+                return;
+        }
+        idle_.push_back(std::move(slot));
+        if (idle_.size() > options_.maxIdle)
+            idle_.pop_front();
+    }
+
+    bool overLimit(Slot& slot) const {
+        JSMemoryUsage usage{};
+        JS_ComputeMemoryUsage(JS_GetRuntime(slot.engine.ctx()), &usage);
+        return static_cast<uint64_t>(usage.memory_used_size) > options_.memoryLimit;
+    }
+
+    EnginePoolOptions options_;
+    /** Set by `setEnvironment`; otherwise each run inherits the process environment. */
+    std::shared_ptr<const EnvironmentSnapshot> env_;
+    std::unordered_map<std::string, std::shared_ptr<const Image>> images_;
+    /** Most recently released at the back. */
+    std::deque<std::unique_ptr<Slot>> idle_;
+};
+
 } // namespace qianjs
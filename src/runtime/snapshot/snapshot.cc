@@ -0,0 +1,210 @@
+#include "runtime/snapshot/snapshot.h"
+
+#include "runtime/script_host.h"
+
+#include <quickjs.h>
+
+#include <fstream>
+#include <iterator>
+
+namespace qianjs::snapshot {
+
+namespace {
+
+constexpr char kDriverName[] = "__qianjs_snapshot__.js";
+constexpr char kResultGlobal[] = "__qianjs_snapshot__";
+
+bool read_text(const std::filesystem::path& path, std::string& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        return false;
+    out.assign(std::istreambuf_iterator<char>(f), {});
+    return true;
+}
+
+std::string exception_message(JSContext* c) {
+    JSValue exc = JS_GetException(c);
+    const char* msg = JS_ToCString(c, exc);
+    std::string out = msg ? msg : "unknown error";
+    if (msg)
+        JS_FreeCString(c, msg);
+    JS_FreeValue(c, exc);
+    return out;
+}
+
+/** Import specifier for a normalized bundle name, resolved against the driver at the entry's directory. */
+std::string specifier_for(const std::string& name) {
+    std::string spec = (name[0] == '.' || name[0] == '/') ? name : "./" + name;
+    std::string quoted = "'";
+    for (char ch : spec) {
+        if (ch == '\'' || ch == '\\')
+            quoted.push_back('\\');
+        quoted.push_back(ch);
+    }
+    quoted.push_back('\'');
+    return quoted;
+}
+
+/** Copies a module namespace into a plain object and serializes it; false with `error` on unserializable exports. */
+bool capture_exports(JSContext* c, JSValueConst ns, bundle::BuiltModule& module, std::string& error) {
+    JSPropertyEnum* props = nullptr;
+    uint32_t count = 0;
+    if (JS_GetOwnPropertyNames(c, &props, &count, ns, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+        error = module.name + ": " + exception_message(c);
+        return false;
+    }
+
+    bool ok = true;
+    std::vector<std::string> names;
+    JSValue state = JS_NewObject(c);
+    for (uint32_t i = 0; i < count; i++) {
+        if (ok) {
+            JSValue v = JS_GetProperty(c, ns, props[i].atom);
+            const char* name = JS_AtomToCString(c, props[i].atom);
+            if (JS_IsException(v) || !name || JS_SetProperty(c, state, props[i].atom, v) < 0) {
+                error = module.name + ": " + exception_message(c);
+                ok = false;
+            } else {
+                names.emplace_back(name);
+            }
+            if (name)
+                JS_FreeCString(c, name);
+        }
+        JS_FreeAtom(c, props[i].atom);
+    }
+    js_free(c, props);
+
+    if (ok) {
+        size_t len = 0;
+        uint8_t* buf = JS_WriteObject(c, &len, state, 0);
+        if (buf) {
+            module.bytecode = bundle::writeSnapshotModule(names, buf, len);
+            js_free(c, buf);
+        } else {
+            error = module.name + ": exports are not serializable: " + exception_message(c);
+            ok = false;
+        }
+    }
+    JS_FreeValue(c, state);
+    return ok;
+}
+
+} // namespace
+
+bool hasSnapshotDirective(std::string_view source) {
+    size_t i = 0;
+    if (source.substr(0, 2) == "#!")
+        i = source.find('\n') == std::string_view::npos ? source.size() : source.find('\n');
+    for (;;) {
+        while (i < source.size() && (source[i] == ' ' || source[i] == '\t' || source[i] == '\r' || source[i] == '\n'))
+            i++;
+        if (source.substr(i, 2) == "//") {
+            i = source.find('\n', i);
+            if (i == std::string_view::npos)
+                return false;
+            continue;
+        }
+        if (source.substr(i, 2) == "/*") {
+            i = source.find("*/", i + 2);
+            if (i == std::string_view::npos)
+                return false;
+            i += 2;
+            continue;
+        }
+        if (i >= source.size() || (source[i] != '"' && source[i] != '\''))
+            return false;
+
+        const char quote = source[i];
+        size_t end = i + 1;
+        while (end < source.size() && source[end] != quote && source[end] != '\n')
+            end += source[end] == '\\' ? 2 : 1;
+        if (end >= source.size() || source[end] != quote)
+            return false;
+        if (source.substr(i + 1, end - i - 1) == "use snapshot")
+            return true;
+        i = end + 1;
+        while (i < source.size() && (source[i] == ' ' || source[i] == '\t'))
+            i++;
+        if (i < source.size() && source[i] == ';')
+            i++;
+    }
+}
+
+bool buildSnapshot(const std::filesystem::path& entry, std::vector<bundle::BuiltModule>& modules, size_t& snapshotted,
+    std::string& error) {
+    snapshotted = 0;
+    if (!bundle::compileModuleGraph(entry, modules, error))
+        return false;
+
+    const std::filesystem::path root = entry.has_parent_path() ? entry.parent_path() : std::filesystem::path(".");
+    std::vector<size_t> marked;
+    for (size_t i = 0; i < modules.size(); i++) {
+        std::string source;
+        if (!read_text(root / modules[i].name, source) || !hasSnapshotDirective(source))
+            continue;
+        if (i == 0) {
+            error = modules[i].name + ": the entry module cannot be marked \"use snapshot\"";
+            return false;
+        }
+        marked.push_back(i);
+    }
+    if (marked.empty())
+        return true;
+
+    /** Evaluate against the compiled graph so build-time and run-time module names and instances line up. */
+    const std::vector<uint8_t> image = bundle::writeBundle(modules);
+    bundle::ModuleBundle graph;
+    graph.parse(image.data(), image.size());
+
+    event_loop::EventLoop loop;
+    const event_loop::EventLoop::Scope bind(loop);
+    qjs::JSEngine engine;
+    engine.initialize();
+    RuntimeContext runtime;
+    runtime.loop = &loop;
+    runtime.argv.push_back(entry.string());
+    runtime.env.inheritProcess();
+    applyLogEnvironment(runtime);
+    engine.setHost<RuntimeContext>(&runtime);
+    const plugins::LazyPlugins lazy(engine, lazyDefaultPlugins());
+    graph.installModuleLoader(engine.ctx());
+    JSContext* c = engine.ctx();
+
+    std::string driver;
+    std::string list;
+    for (size_t k = 0; k < marked.size(); k++) {
+        driver += "import * as m" + std::to_string(k) + " from " + specifier_for(modules[marked[k]].name) + ";\n";
+        list += (k ? ", m" : "m") + std::to_string(k);
+    }
+    driver += std::string("globalThis.") + kResultGlobal + " = [" + list + "];\n";
+
+    JSValue r = JS_Eval(c, driver.c_str(), driver.size(), kDriverName, JS_EVAL_TYPE_MODULE);
+    bool ok = !JS_IsException(r);
+    if (!ok)
+        error = exception_message(c);
+    JS_FreeValue(c, r);
+
+    if (ok) {
+        drainAsyncWork(engine);
+        JSValue global = JS_GetGlobalObject(c);
+        JSValue results = JS_GetPropertyStr(c, global, kResultGlobal);
+        if (JS_IsArray(c, results) != 1) {
+            error = "snapshot modules did not finish evaluating";
+            ok = false;
+        }
+        for (size_t k = 0; ok && k < marked.size(); k++) {
+            JSValue ns = JS_GetPropertyUint32(c, results, static_cast<uint32_t>(k));
+            ok = capture_exports(c, ns, modules[marked[k]], error);
+            JS_FreeValue(c, ns);
+        }
+        JS_FreeValue(c, results);
+        JS_FreeValue(c, global);
+    }
+
+    engine.cleanup();
+    if (ok)
+        snapshotted = marked.size();
+    return ok;
+}
+
+} // namespace qianjs::snapshot
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "runtime/bundle/module_bundle.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qianjs::snapshot {
+
+/** True when the module's directive prologue (leading string literals, comments allowed) contains `"use snapshot"`. */
+bool hasSnapshotDirective(std::string_view source);
+
+/**
+ * `qianjs snapshot`: compiles `entry`'s import graph like `compileModuleGraph`, then evaluates every module marked
+ * `"use snapshot"` once in a full engine (default plugins, top-level await drained) and replaces its bytecode with a
+ * snapshot entry holding its serialized exports. Exports must be `JS_WriteObject`-serializable data (no functions or
+ * classes). The entry module itself cannot be marked. `snapshotted` receives how many modules were frozen.
+ */
+bool buildSnapshot(const std::filesystem::path& entry, std::vector<bundle::BuiltModule>& modules, size_t& snapshotted,
+    std::string& error);
+
+} // namespace qianjs::snapshot
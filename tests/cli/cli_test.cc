@@ -66,3 +66,15 @@ TEST(CliRunner, RunNonexistentPathReturns1) {
     char* argv[] = {arg_prog, cmd, path};
     EXPECT_EQ(qianjs_cli_run(3, argv), 1);
 }
+
+TEST(CliRunner, BuildUnmatchedGlobAndBadJobsReturn1) {
+    char cmd[] = "build";
+    char glob[] = "/nonexistent/qianjs_build_dir/*.js";
+    char* a0[] = {arg_prog, cmd, glob};
+    EXPECT_EQ(qianjs_cli_run(3, a0), 1);
+
+    char jobs[] = "--jobs=0";
+    char path[] = "main.js";
+    char* a1[] = {arg_prog, cmd, jobs, path};
+    EXPECT_EQ(qianjs_cli_run(4, a1), 1);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "script_fixture.h"
+
+#include <string>
+
+#ifndef _WIN32
+
+namespace {
+
+/** Runs `body` with `child_process` imported as `cp` and a `text(buf)` decoder (see `qianjs::test::runScript`). */
+int run_child_script(const std::string& body) {
+    return qianjs::test::runScript("import * as cp from 'child_process';\n"
+                                   "import { setExitCode } from 'process';\n"
+                                   "const text = (buf) => String.fromCharCode(...new Uint8Array(buf));\n",
+                                   body);
+}
+
+} // namespace
+
+TEST(ChildProcess, StreamsOutputBeforeExitAndPipesStdin) {
+    EXPECT_EQ(run_child_script(R"JS(
+    setExitCode(1);
+    let out = '', err = '';
+    const id = cp.spawn('/bin/sh', ['-c', 'cat; echo done >&2; exit 3'], {
+        stdin: 'pipe',
+        onStdout: (chunk) => { out += text(chunk); },
+        onStderr: (chunk) => { err += text(chunk); },
+    });
+    const ok = cp.pid(id) > 0;
+    await cp.write(id, 'hello ');
+    await cp.write(id, new Uint8Array([119, 111, 114, 108, 100]));
+    cp.closeStdin(id);
+    const r = await cp.wait(id);
+    setExitCode(ok && out === 'hello world' && err === 'done\n' && r.code === 3 && r.signal === null ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(ChildProcess, ExecCollectsOutputAndReportsSignalsAndSpawnErrors) {
+    EXPECT_EQ(run_child_script(R"JS(
+    setExitCode(1);
+    const r = await cp.exec('/bin/sh', ['-c', 'tr a-z A-Z; echo warn >&2'], { input: 'shout', env: { LC_ALL: 'C' } });
+    const okExec = r.code === 0 && text(r.stdout) === 'SHOUT' && text(r.stderr) === 'warn\n';
+
+    const id = cp.spawn('/bin/sh', ['-c', 'sleep 30']);
+    cp.kill(id, 'SIGKILL');
+    const killed = await cp.wait(id);
+
+    let missing = null;
+    try { await cp.wait(cp.spawn('/nonexistent/qianjs-tool')); } catch (e) { missing = e.code; }
+    let big = null;
+    try { await cp.exec('/bin/sh', ['-c', 'yes | head -c 100000'], { maxBuffer: 1000 }); } catch (e) { big = e.code; }
+
+    setExitCode(okExec && killed.code === null && killed.signal === 'SIGKILL' && missing === 'ENOENT' &&
+        big === 'ENOBUFS' ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(ChildProcess, LimiterCapsConcurrentChildren) {
+    EXPECT_EQ(run_child_script(R"JS(
+    setExitCode(1);
+    const { now } = await import('process');
+    const limiter = cp.createLimiter(2);
+    const started = now();
+    const jobs = [];
+    for (let i = 0; i < 8; i++)
+        jobs.push(cp.exec('/bin/sh', ['-c', 'sleep 0.1; echo ' + i], { limiter }));
+    // Queued behind the running pair: no process yet.
+    const queued = cp.spawn('/bin/sh', ['-c', 'exit 0'], { limiter });
+    const waitingPid = cp.pid(queued);
+    const outs = await Promise.all(jobs);
+    await cp.wait(queued);
+    // Four rounds of two 100 ms children; all eight at once would take about one round.
+    const elapsed = now() - started;
+    setExitCode(outs.every((r, i) => text(r.stdout) === i + '\n') && waitingPid === 0 && elapsed >= 350 ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(ChildProcess, ChildrenInheritTheEngineEnvironment) {
+    EXPECT_EQ(run_child_script(R"JS(
+    setExitCode(1);
+    const { setEnv } = await import('process');
+    setEnv('QIANJS_CP_ENV', 'engine');
+    const r = await cp.exec('/bin/sh', ['-c', 'echo "$QIANJS_CP_ENV"']);
+    const own = await cp.exec('/bin/sh', ['-c', 'echo "$QIANJS_CP_ENV"'], { env: { PATH: '/bin:/usr/bin' } });
+    setExitCode(text(r.stdout) === 'engine\n' && text(own.stdout) === '\n' ? 0 : 1);
+)JS"),
+        0);
+}
+
+#endif
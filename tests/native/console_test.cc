@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include "runtime/script_host.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+/** Points fd 1 at a pipe drained by a reader thread (optionally slow, so the pipe fills and the writer falls behind). */
+class StdoutPipe {
+public:
+    explicit StdoutPipe(bool slow) {
+        EXPECT_EQ(::pipe(fds_), 0);
+        std::fflush(stdout);
+        saved_ = ::dup(1);
+        ::dup2(fds_[1], 1);
+        ::close(fds_[1]);
+        reader_ = std::thread([this, slow] {
+            char buf[4096];
+            for (;;) {
+                const ssize_t n = ::read(fds_[0], buf, sizeof(buf));
+                if (n <= 0)
+                    break;
+                data_.append(buf, static_cast<size_t>(n));
+                if (slow)
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+    }
+
+    std::string finish() {
+        std::fflush(stdout);
+        ::dup2(saved_, 1);
+        ::close(saved_);
+        reader_.join();
+        ::close(fds_[0]);
+        return data_;
+    }
+
+private:
+    int fds_[2] = {-1, -1};
+    int saved_ = -1;
+    std::thread reader_;
+    std::string data_;
+};
+
+std::string run_logging_script(const std::string& name, const std::string& body, bool slow) {
+    const std::filesystem::path script = std::filesystem::temp_directory_path() / ("qianjs_" + name + ".js");
+    std::ofstream(script) << "import { log } from 'console';\n" << body << "\n";
+    StdoutPipe pipe(slow);
+    qianjs::runScriptFile(script);
+    std::string out = pipe.finish();
+    std::filesystem::remove(script);
+    return out;
+}
+
+std::string expected_lines(int n) {
+    std::ostringstream want;
+    for (int i = 0; i < n; i++)
+        want << "line " << i << '\n';
+    return want.str();
+}
+
+} // namespace
+
+TEST(Console, SlowPipeReceivesEveryLineInOrder) {
+    EXPECT_EQ(run_logging_script("console_slow", "for (let i = 0; i < 20000; i++) log('line', i);", true),
+              expected_lines(20000));
+}
+
+TEST(Console, LeavesStdoutBlocking) {
+    const std::filesystem::path script = std::filesystem::temp_directory_path() / "qianjs_console_blocking.js";
+    std::ofstream(script) << "import { log } from 'console';\nfor (let i = 0; i < 5000; i++) log('line', i);\n";
+    StdoutPipe pipe(true);
+    qianjs::runScriptFile(script);
+    const int flags = ::fcntl(1, F_GETFL);
+    qianjs::output::write(1, "done\n");
+    qianjs::output::flush(1);
+    const std::string out = pipe.finish();
+    std::filesystem::remove(script);
+    EXPECT_EQ(flags & O_NONBLOCK, 0);
+    EXPECT_EQ(out, expected_lines(5000) + "done\n");
+}
+
+TEST(Console, LinesFromTimersAndReentrantToStringAreFlushed) {
+    const std::string out = run_logging_script("console_timers", R"JS(
+import { setTimeout } from 'timers';
+const noisy = { toString() { log('inner'); return 'outer'; } };
+log('a', noisy);
+setTimeout(() => log('late'), 5);
+)JS",
+                                               false);
+    EXPECT_EQ(out, "inner\na outer\nlate\n");
+}
+
+TEST(Console, FilteredCallsNeverFormatTheirArguments) {
+    const std::string out = run_logging_script("console_level", R"JS(
+import { debug, info, warn } from 'console';
+import { setLogLevel } from 'process';
+let calls = 0;
+const probe = { toString() { calls++; return 'probe'; } };
+setLogLevel('info');
+debug(probe);
+setLogLevel('warn');
+log(probe);
+info(probe);
+setLogLevel('debug');
+debug('calls', calls);
+)JS",
+                                               false);
+    EXPECT_EQ(out, "calls 0\n");
+}
+
+TEST(Console, JsonFormatWritesOneRecordPerCall) {
+    const std::string out = run_logging_script("console_json", R"JS(
+import { setLogFormat } from 'process';
+setLogFormat('json');
+const cyclic = {};
+cyclic.self = cyclic;
+log('req "a"', 200, { path: '/x', ok: true }, [1, 2], cyclic);
+)JS",
+                                               false);
+    const std::size_t pos = out.find(",\"level\":\"info\"");
+    ASSERT_EQ(out.rfind("{\"time\":", 0), 0u) << out;
+    ASSERT_NE(pos, std::string::npos) << out;
+    EXPECT_EQ(out.substr(pos),
+              ",\"level\":\"info\",\"msg\":\"req \\\"a\\\" 200\",\"data\":[{\"path\":\"/x\",\"ok\":true},[1,2],"
+              "\"[object Object]\"]}\n");
+}
+
+#endif
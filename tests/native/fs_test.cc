@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+
+#include "script_fixture.h"
+
+#include <qianjs_modules.h>
+
+#include <string>
+
+namespace {
+
+/** Runs `body` with `fs` and `process` imported (see `qianjs::test::runScript`). */
+int run_fs_script(const std::string& body) {
+    return qianjs::test::runScript("import * as fs from 'fs';\n"
+                                   "import * as process from 'process';\n"
+                                   "import { setExitCode } from 'process';\n",
+                                   body);
+}
+
+} // namespace
+
+TEST(FsStream, ReadChunksCoversLargeFileInOrder) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    const data = new Uint8Array(200000);
+    for (let i = 0; i < data.length; i++) data[i] = i & 0xff;
+    await fs.writeFile(dir + '/big.bin', data);
+    let next = 0, bad = 0;
+    const total = await fs.readChunks(dir + '/big.bin', (chunk, offset) => {
+        if (offset !== next || chunk.byteLength > 65536) bad++;
+        const v = new Uint8Array(chunk);
+        for (let i = 0; i < v.length; i++) if (v[i] !== ((offset + i) & 0xff)) bad++;
+        next += chunk.byteLength;
+    });
+    const whole = await fs.readFileBytes(dir + '/big.bin');
+    setExitCode(total === data.length && next === total && whole.byteLength === total && bad === 0 ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsStream, FdReadWriteRoundTrip) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    const w = await fs.open(dir + '/f.txt', 'w');
+    const n1 = await fs.write(w, 'hello ');
+    const n2 = await fs.write(w, new Uint8Array([119, 111, 114, 108, 100]));
+    await fs.close(w);
+    const r = await fs.open(dir + '/f.txt');
+    const buf = new Uint8Array(64);
+    const got = await fs.read(r, buf, 0);
+    const eof = await fs.read(r, buf, got);
+    await fs.close(r);
+    let s = '';
+    for (let i = 0; i < got; i++) s += String.fromCharCode(buf[i]);
+    setExitCode(n1 === 6 && n2 === 5 && s === 'hello world' && eof === 0 ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsStream, ReadChunksRejectsMissingFile) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    try {
+        await fs.readChunks(dir + '/nope.bin', () => {});
+        setExitCode(1);
+    } catch (e) {
+        setExitCode(String(e.message || e).startsWith('ENOENT') ? 0 : 1);
+    }
+)JS"),
+        0);
+}
+
+TEST(FsMmap, MapsFileContentsAndKeepsWritesPrivate) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    await fs.writeFile(dir + '/m.bin', 'abcdef');
+    const ab = fs.mmap(dir + '/m.bin', 'sequential');
+    const v = new Uint8Array(ab);
+    const first = String.fromCharCode(v[0], v[5]);
+    v[0] = 0x7a;
+    const back = await fs.readFile(dir + '/m.bin');
+    await fs.writeFile(dir + '/e.bin', '');
+    const empty = fs.sync.mmap(dir + '/e.bin');
+    let threw = false;
+    try { fs.mmap(dir + '/m.bin', 'bogus'); } catch (e) { threw = true; }
+    setExitCode(ab.byteLength === 6 && first === 'af' && back === 'abcdef' && empty.byteLength === 0 && threw ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsBatch, SettlesEveryOpInInputOrder) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    const paths = [];
+    for (let i = 0; i < 40; i++) {
+        paths.push(dir + '/f' + i);
+        if (i % 2 === 0) await fs.writeFile(dir + '/f' + i, 'x'.repeat(i));
+    }
+    const stats = await fs.statMany(paths, { concurrency: 3 });
+    let bad = 0;
+    stats.forEach((st, i) => { if (i % 2 === 0 ? !st || st.size !== i : st !== null) bad++; });
+    const out = await fs.batch([
+        { op: 'mkdir', path: dir + '/d' },
+        { op: 'unlink', path: dir + '/missing' },
+        { op: 'readdir', path: dir },
+    ], { concurrency: 1 });
+    const empty = await fs.batch([]);
+    setExitCode(bad === 0 && out[0] === undefined && out[1] instanceof Error && out[1].code === 'ENOENT' &&
+        out[2].length === 22 && empty.length === 0 ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsWalk, ReportsTypedEntriesAndHonorsFilterAndDepth) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    await fs.mkdirRecursive(dir + '/t/a/b/c');
+    await fs.mkdirRecursive(dir + '/t/skip/deep');
+    await fs.writeFile(dir + '/t/a/one.txt', '1');
+    await fs.writeFile(dir + '/t/a/b/two.txt', '2');
+    const seen = {};
+    const total = await fs.walk(dir + '/t', (batch) => {
+        for (const e of batch) seen[e.path.slice(dir.length + 3)] = e.type;
+    }, { filter: (p) => !p.endsWith('/skip'), maxDepth: 3 });
+    const keys = Object.keys(seen).sort().join(',');
+    let rejected = false;
+    try { await fs.walk(dir + '/nope', () => {}); } catch (e) { rejected = true; }
+    setExitCode(total === 5 && keys === 'a,a/b,a/b/c,a/b/two.txt,a/one.txt' && seen['a/one.txt'] === 'file' &&
+        seen['a/b'] === 'dir' && rejected ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsLoopStats, TimesOpsByKindOnceEnabled) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    const off = process.loopStats();
+    process.enableLoopStats();
+    await fs.writeFile(dir + '/a.txt', 'abc');
+    await fs.readFile(dir + '/a.txt');
+    await fs.readFile(dir + '/a.txt');
+    await fs.stat(dir + '/a.txt');
+    const s = process.loopStats();
+    const r = s.ops.readFile;
+    const ok = off.enabled === false && off.ops === undefined && s.enabled === true && r.count === 2 &&
+        r.p50 > 0 && r.p50 <= r.max && s.ops.writeFile.count === 1 && s.ops.stat.count === 1 &&
+        s.deferredWait.count > 0 && s.turn.count > 0 && s.pendingOperations >= 0;
+    process.resetLoopStats();
+    const cleared = process.loopStats();
+    setExitCode(ok && cleared.ops.readFile === undefined ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsPathArgs, LongPathsWorkAndNulBytesAreRejected) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    const long = dir + '/' + 'd'.repeat(200) + '/' + 'f'.repeat(200) + '.txt';
+    await fs.mkdirRecursive(long.slice(0, long.lastIndexOf('/')));
+    await fs.writeFile(long, 'x');
+    const st = await fs.stat(long);
+    const synced = fs.sync.stat(long);
+    let nul = 0;
+    try { fs.stat(dir + '/a\0b'); } catch (e) { if (e instanceof TypeError) nul++; }
+    try { fs.sync.stat(dir + '/a\0b'); } catch (e) { if (e instanceof TypeError) nul++; }
+    let missing = '';
+    try { await fs.stat(dir + '/nope'); } catch (e) { missing = e.code; }
+    await fs.unlink(long);
+    setExitCode(st.size === 1 && synced.size === 1 && nul === 2 && missing === 'ENOENT' ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsStatInto, PacksFieldsIntoReusedFloat64Array) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    await fs.writeFile(dir + '/a.txt', 'hello');
+    const st = await fs.stat(dir + '/a.txt');
+    const one = new Float64Array(6);
+    await fs.statInto(dir + '/a.txt', one);
+    const sync = new Float64Array(6);
+    const found = fs.sync.statInto(dir + '/a.txt', sync);
+    const missing = fs.sync.statInto(dir + '/nope', sync);
+    const many = new Float64Array(12);
+    const failed = await fs.statManyInto([dir + '/nope', dir + '/a.txt'], many);
+    let short = false;
+    try { fs.statInto(dir + '/a.txt', new Float64Array(3)); } catch (e) { short = e instanceof RangeError; }
+    const ok = one[0] === 5 && one[1] === st.mtimeMs && one[2] === st.mode && one[3] === st.ino &&
+        sync[0] === 5 && found === true && missing === false && failed === 1 && Number.isNaN(many[0]) &&
+        many[6] === 5 && many[9] === st.ino && short;
+    setExitCode(ok ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(FsWatch, CoalescesEventsIntoBatchesAndUnwatchLetsTheLoopExit) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    await fs.mkdir(dir + '/sub');
+    setExitCode(1);
+    const batches = [];
+    const id = fs.watch(dir, (events) => {
+        batches.push(events);
+        if (!events.some((e) => e.path === dir + '/sub/b.txt'))
+            return;
+        fs.unwatch(id);
+        const unique = batches.every((b) => new Set(b.map((e) => e.path)).size === b.length);
+        const a = batches.flat().find((e) => e.path === dir + '/a.txt');
+        setExitCode(unique && a && a.type === 'rename' ? 0 : 3);
+    }, { recursive: true, debounceMs: 20 });
+    let missing = false;
+    try { fs.watch(dir + '/nope', () => {}); } catch (e) { missing = e instanceof TypeError; }
+    if (!missing)
+        fs.unwatch(id);
+    await fs.writeFile(dir + '/a.txt', 'x');
+    await fs.writeFile(dir + '/a.txt', 'xy');
+    await fs.writeFile(dir + '/sub/b.txt', 'y');
+)JS"),
+        0);
+}
+
+#if QIANJS_MODULE_TIMERS
+TEST(FsWatch, RecursiveWatchFollowsDirectoriesCreatedLater) {
+    EXPECT_EQ(run_fs_script(R"JS(
+    const { setTimeout } = await import('timers');
+    const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+    setExitCode(1);
+    let seen = false;
+    const id = fs.watch(dir, (events) => {
+        if (events.some((e) => e.path === dir + '/late/c.txt'))
+            seen = true;
+    }, { recursive: true, debounceMs: 5 });
+    await fs.mkdir(dir + '/late');
+    // The new directory is watched once the batch reporting it has been flushed and rescanned.
+    for (let i = 0; i < 100 && !seen; i++) {
+        await fs.writeFile(dir + '/late/c.txt', String(i));
+        await sleep(20);
+    }
+    fs.unwatch(id);
+    setExitCode(seen ? 0 : 3);
+)JS"),
+        0);
+}
+#endif
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "native/http/http_parser.h"
+#include "script_fixture.h"
+
+#include <cstring>
+#include <string>
+
+using qianjs::http::HttpLimits;
+using qianjs::http::HttpParser;
+
+namespace {
+
+/** Feeds `text` one byte at a time; returns the bytes consumed before the parser stopped asking for more. */
+size_t feed_bytewise(HttpParser& p, const std::string& text) {
+    size_t used = 0;
+    while (used < text.size() && p.status() == HttpParser::Status::NeedMore)
+        used += p.feed(text.data() + used, 1);
+    return used;
+}
+
+/** Runs `body` with `http`, `net` and `setExitCode` imported (see `qianjs::test::runScript`). */
+int run_http_script(const std::string& body) {
+    return qianjs::test::runScript("import * as http from 'http';\n"
+                                   "import * as net from 'net';\n"
+                                   "import { setExitCode } from 'process';\n",
+                                   body);
+}
+
+} // namespace
+
+TEST(HttpParser, ParsesRequestSplitAtEveryByte) {
+    const std::string text = "POST /submit?x=1 HTTP/1.1\r\nHost: a\r\nX-Tag:  v1 \r\nContent-Length: 5\r\n\r\nhello";
+    HttpParser p(HttpParser::Kind::Request);
+    EXPECT_EQ(feed_bytewise(p, text), text.size());
+    ASSERT_EQ(p.status(), HttpParser::Status::Done);
+    const auto& m = p.message();
+    EXPECT_EQ(m.method, "POST");
+    EXPECT_EQ(m.target, "/submit?x=1");
+    ASSERT_EQ(m.headers.size(), 3u);
+    EXPECT_EQ(m.headers[1].first, "x-tag");
+    EXPECT_EQ(m.headers[1].second, "v1");
+    EXPECT_EQ(m.body, "hello");
+    EXPECT_TRUE(m.keep_alive);
+}
+
+TEST(HttpParser, DecodesChunkedBodyWithTrailers) {
+    const std::string text = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                             "4\r\nWiki\r\n5;ext=1\r\npedia\r\n0\r\nX-Trailer: t\r\n\r\n";
+    HttpParser p(HttpParser::Kind::Response);
+    EXPECT_EQ(feed_bytewise(p, text), text.size());
+    ASSERT_EQ(p.status(), HttpParser::Status::Done);
+    EXPECT_EQ(p.message().status, 200);
+    EXPECT_EQ(p.message().body, "Wikipedia");
+}
+
+TEST(HttpParser, StopsAtMessageBoundaryForPipelinedRequests) {
+    const std::string first = "GET /a HTTP/1.1\r\nHost: h\r\n\r\n";
+    const std::string second = "GET /b HTTP/1.0\r\n\r\n";
+    const std::string both = first + second;
+    HttpParser p(HttpParser::Kind::Request);
+    EXPECT_EQ(p.feed(both.data(), both.size()), first.size());
+    ASSERT_EQ(p.status(), HttpParser::Status::Done);
+    EXPECT_EQ(p.message().target, "/a");
+
+    p.reset();
+    EXPECT_EQ(p.feed(both.data() + first.size(), second.size()), second.size());
+    ASSERT_EQ(p.status(), HttpParser::Status::Done);
+    EXPECT_EQ(p.message().target, "/b");
+    EXPECT_FALSE(p.message().keep_alive);
+}
+
+TEST(HttpParser, ResponseWithoutLengthRunsToEof) {
+    const std::string text = "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\npartial body";
+    HttpParser p(HttpParser::Kind::Response);
+    EXPECT_EQ(p.feed(text.data(), text.size()), text.size());
+    EXPECT_EQ(p.status(), HttpParser::Status::NeedMore);
+    EXPECT_EQ(p.finish(), HttpParser::Status::Done);
+    EXPECT_EQ(p.message().body, "partial body");
+}
+
+TEST(HttpParser, RejectsSmugglingAndOversizedInput) {
+    {
+        const std::string text = "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n";
+        HttpParser p(HttpParser::Kind::Request);
+        p.feed(text.data(), text.size());
+        EXPECT_EQ(p.status(), HttpParser::Status::Error);
+        EXPECT_EQ(p.errorStatus(), 400);
+    }
+    {
+        HttpLimits limits;
+        limits.max_header_bytes = 64;
+        const std::string text = "GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'a') + "\r\n\r\n";
+        HttpParser p(HttpParser::Kind::Request, limits);
+        p.feed(text.data(), text.size());
+        EXPECT_EQ(p.status(), HttpParser::Status::Error);
+        EXPECT_EQ(p.errorStatus(), 431);
+    }
+    {
+        HttpLimits limits;
+        limits.max_body_bytes = 4;
+        const std::string text = "POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\n";
+        HttpParser p(HttpParser::Kind::Request, limits);
+        p.feed(text.data(), text.size());
+        EXPECT_EQ(p.status(), HttpParser::Status::Error);
+        EXPECT_EQ(p.errorStatus(), 413);
+    }
+    {
+        const std::string text = "GET / HTTP/2.0\r\n\r\n";
+        HttpParser p(HttpParser::Kind::Request);
+        p.feed(text.data(), text.size());
+        EXPECT_EQ(p.status(), HttpParser::Status::Error);
+        EXPECT_EQ(p.errorStatus(), 505);
+    }
+}
+
+TEST(Http, ServesRequestsAndKeepsPipelinedConnectionAlive) {
+    EXPECT_EQ(run_http_script(R"JS(
+    setExitCode(1);
+    let served = 0;
+    const server = http.createServer((req, res) => {
+        served++;
+        const size = new Uint8Array(req.body).length;
+        http.respond(res, req.url === '/missing' ? 404 : 200, { 'x-url': req.url }, req.method + ':' + size);
+    });
+    const port = http.serverPort(server);
+
+    const r = await http.request({ port, method: 'POST', path: '/echo', body: 'abc' });
+    const text = String.fromCharCode(...new Uint8Array(r.body));
+    const okOne = r.status === 200 && r.headers['x-url'] === '/echo' && text === 'POST:3';
+
+    // Two pipelined requests on one keep-alive connection, then EOF after both responses.
+    const sock = await net.connect('127.0.0.1', port);
+    let raw = '';
+    const done = net.read(sock, (chunk) => {
+        raw += String.fromCharCode(...new Uint8Array(chunk));
+        if ((raw.match(/HTTP\/1\.1 /g) || []).length === 2) net.end(sock);
+    });
+    net.write(sock, 'GET /a HTTP/1.1\r\nHost: x\r\n\r\nGET /missing HTTP/1.1\r\nHost: x\r\n\r\n');
+    await done;
+    const okTwo = raw.indexOf('HTTP/1.1 200') >= 0 && raw.indexOf('HTTP/1.1 404') > raw.indexOf('HTTP/1.1 200');
+
+    http.closeServer(server);
+    setExitCode(okOne && okTwo && served === 3 ? 0 : 1);
+)JS"),
+        0);
+}
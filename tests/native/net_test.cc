@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include "script_fixture.h"
+
+#include <string>
+
+namespace {
+
+/** Runs `body` with `net` and `setExitCode` imported (see `qianjs::test::runScript`). */
+int run_net_script(const std::string& body) {
+    return qianjs::test::runScript("import * as net from 'net';\n"
+                                   "import { setExitCode } from 'process';\n",
+                                   body);
+}
+
+} // namespace
+
+TEST(Net, EchoesLargePayloadWithBackpressureAndHalfClose) {
+    EXPECT_EQ(run_net_script(R"JS(
+    setExitCode(1);
+    const server = net.createServer((sock) => {
+        net.read(sock, (chunk) => {
+            if (net.write(sock, chunk) > 0) {
+                net.pause(sock);
+                net.drain(sock).then(() => net.resume(sock));
+            }
+        });
+    });
+    const port = net.serverPort(server);
+    const client = await net.connect('127.0.0.1', port);
+    const data = new Uint8Array(1 << 20);
+    for (let i = 0; i < data.length; i++) data[i] = (i * 7) & 0xff;
+
+    let next = 0, bad = 0;
+    const echoed = net.read(client, (chunk) => {
+        const v = new Uint8Array(chunk);
+        for (let i = 0; i < v.length; i++) if (v[i] !== ((next + i) * 7 & 0xff)) bad++;
+        next += v.length;
+    });
+    net.write(client, [data.subarray(0, 1000), data.subarray(1000)]);
+    await net.drain(client);
+    net.end(client);
+    const total = await echoed;
+    net.closeServer(server);
+    setExitCode(total === data.length && next === total && bad === 0 ? 0 : 1);
+)JS"),
+        0);
+}
+
+TEST(Net, ConnectToClosedPortRejectsWithCode) {
+    EXPECT_EQ(run_net_script(R"JS(
+    const server = net.createServer(() => {});
+    const port = net.serverPort(server);
+    net.closeServer(server);
+    try {
+        await net.connect('127.0.0.1', port);
+        setExitCode(1);
+    } catch (e) {
+        setExitCode(e.code === 'ECONNREFUSED' ? 0 : 3);
+    }
+)JS"),
+        0);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include "script_fixture.h"
+
+#include <filesystem>
+#include <string>
+
+namespace {
+
+/** Runs `body` with `process` imported as `p` (see `qianjs::test::runScript`). */
+int run_process_script(const std::string& body) {
+    return qianjs::test::runScript("import * as p from 'process';\n", body);
+}
+
+} // namespace
+
+TEST(ProcessClock, HrtimeAndNowAreMonotonic) {
+    EXPECT_EQ(run_process_script(R"JS(
+const a = p.hrtimeBigint();
+const [s, ns] = p.hrtime();
+const t0 = p.now();
+let x = 0;
+for (let i = 0; i < 100000; i++) x += i;
+const b = p.hrtimeBigint();
+const t1 = p.now();
+const ok = typeof a === 'bigint' && b > a && ns >= 0 && ns < 1e9 && s >= 0 && t0 >= 0 && t1 >= t0 && x > 0;
+p.setExitCode(ok ? 0 : 1);
+)JS"),
+              0);
+}
+
+TEST(ProcessMemory, MemoryUsageReportsHeapAndGcReclaims) {
+    EXPECT_EQ(run_process_script(R"JS(
+const before = p.memoryUsage();
+let keep = [];
+for (let i = 0; i < 20000; i++) { const o = { i }; o.self = o; keep.push(o); }
+const grown = p.memoryUsage();
+keep = null;
+p.gc();
+const after = p.memoryUsage();
+p.setGCThreshold(8 * 1024 * 1024);
+p.setGCThreshold(-1);
+const ok = before.heapUsed > 0 && before.quickjs.objCount > 0 && grown.heapUsed > before.heapUsed &&
+    after.quickjs.objCount < grown.quickjs.objCount && typeof before.rss === 'number';
+p.setExitCode(ok ? 0 : 1);
+)JS"),
+              0);
+}
+
+TEST(ProcessInfo, CwdIsCachedUntilChdir) {
+    namespace fs = std::filesystem;
+    const fs::path before = fs::current_path();
+    const fs::path target = fs::canonical(fs::temp_directory_path());
+    const int rc = run_process_script("const target = '" + target.generic_string() + "';\n" + R"JS(
+const start = p.cwd();
+const same = p.cwd() === start && p.platform() === p.platform() && p.pid() === p.pid();
+p.chdir(target);
+const moved = p.cwd();
+let threw = false;
+try { p.chdir(target + '/qianjs_no_such_dir'); } catch (e) { threw = e instanceof TypeError; }
+p.setExitCode((same ? 1 : 0) + (moved === target ? 2 : 0) + (threw && p.cwd() === moved ? 4 : 0));
+)JS");
+    const fs::path after = fs::current_path();
+    fs::current_path(before);
+    EXPECT_EQ(rc, 7);
+    EXPECT_EQ(after, target);
+}
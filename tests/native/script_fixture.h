@@ -0,0 +1,85 @@
+#pragma once
+
+#include "runtime/script_host.h"
+
+#include <gtest/gtest.h>
+#include <qianjs_modules.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace qianjs::test {
+
+/**
+ * Scratch directory for the running test, named `qianjs_<suite>_<test>_<random>` under the temp directory so
+ * repeated, sharded or concurrent runs never share one; removed with everything in it on destruction.
+ */
+class ScratchDir {
+public:
+    ScratchDir() {
+        const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        std::string name = "qianjs_";
+        if (info)
+            name += std::string(info->test_suite_name()) + "_" + info->name() + "_";
+        name += std::to_string(std::random_device{}());
+        for (char& ch : name) {
+            if (ch == '/')
+                ch = '_';
+        }
+        path_ = std::filesystem::temp_directory_path() / name;
+        std::filesystem::create_directories(path_);
+    }
+
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+
+    const std::filesystem::path& path() const { return path_; }
+
+    /** Writes `text` to `name` inside the directory; returns its path. */
+    std::filesystem::path write(const std::string& name, const std::string& text) const {
+        const std::filesystem::path file = path_ / name;
+        std::ofstream(file, std::ios::binary) << text;
+        return file;
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+/** Extra files written next to `main.js` before it runs: name, contents. */
+using ScriptFiles = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * Runs `body` inside an async function as `main.js` in a fresh `ScratchDir`, after `prelude` (imports and helpers);
+ * `dir` holds the directory's path in the script. The body reports through `setExitCode`; if it rejects, the reason
+ * and its stack go to stderr (with the console module built in) and the exit code is 2.
+ */
+inline int runScript(const std::string& prelude, const std::string& body, const ScriptFiles& files = {}) {
+    const ScratchDir dir;
+    for (const auto& [name, text] : files)
+        dir.write(name, text);
+    std::string script = "import { setExitCode as fixtureSetExitCode } from 'process';\n";
+#if QIANJS_MODULE_CONSOLE
+    script += "import { error as fixtureError } from 'console';\n";
+#else
+    script += "const fixtureError = () => {};\n";
+#endif
+    script += prelude;
+    script += "\nconst dir = '" + dir.path().generic_string() + "';\n";
+    script += "(async () => {\n" + body + "\n})().catch((e) => {\n"
+              "    fixtureError('script rejected:', String(e), (e && e.stack) || '');\n"
+              "    fixtureSetExitCode(2);\n"
+              "});\n";
+    return runScriptFile(dir.write("main.js", script));
+}
+
+} // namespace qianjs::test
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include "native/timers/timer_queue.h"
+#include "runtime/event_loop/event_loop.h"
+
+#include <uvw.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+void run_until(const std::vector<int64_t>& fired, size_t count) {
+    auto loop = qianjs::event_loop::uv::uvw_loop();
+    while (fired.size() < count)
+        loop->run(uvw::loop::run_mode::ONCE);
+}
+
+} // namespace
+
+TEST(TimerQueue, FiresInDeadlineOrderAndSkipsCancelled) {
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    std::vector<int64_t> fired;
+    qianjs::timers::TimerQueue q([&](int64_t id, bool) { fired.push_back(id); });
+
+    q.start(1, 15, 0);
+    q.start(2, 1, 0);
+    q.start(3, 5, 0);
+    EXPECT_TRUE(q.cancel(3));
+    EXPECT_FALSE(q.cancel(3));
+    EXPECT_EQ(q.size(), 2u);
+
+    run_until(fired, 2);
+    EXPECT_EQ(fired, (std::vector<int64_t>{2, 1}));
+    EXPECT_EQ(q.size(), 0u);
+}
+
+TEST(TimerQueue, RepeatingTimerRearmsUntilCancelled) {
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    std::vector<int64_t> fired;
+    qianjs::timers::TimerQueue* self = nullptr;
+    qianjs::timers::TimerQueue q([&](int64_t id, bool repeating) {
+        EXPECT_TRUE(repeating);
+        fired.push_back(id);
+        if (fired.size() == 3)
+            self->cancel(id);
+    });
+    self = &q;
+
+    q.start(7, 1, 1);
+    run_until(fired, 3);
+    EXPECT_EQ(fired.size(), 3u);
+    EXPECT_FALSE(q.contains(7));
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include "script_fixture.h"
+
+#include <qianjs_modules.h>
+
+#include <string>
+
+namespace {
+
+/** Runs `parent` with `child` naming a `child.js` written from `child`; `imports` go ahead of `parent`. */
+int run_worker_script(const std::string& parent, const std::string& child, const std::string& imports = "") {
+    return qianjs::test::runScript("import * as worker from 'worker';\n"
+                                   "import { setExitCode } from 'process';\n" +
+                                       imports,
+                                   "const child = dir + '/child.js';\n" + parent,
+                                   {{"child.js", "import * as worker from 'worker';\n" + child + "\n"}});
+}
+
+} // namespace
+
+TEST(Worker, RoundTripsStructuredValues) {
+    EXPECT_EQ(run_worker_script(R"JS(
+    setExitCode(1);
+    let reply = null;
+    const id = worker.spawn(child, (v) => { reply = v; worker.terminate(id); }, (code) => {
+        setExitCode(reply && reply.sum === 6 && reply.tag === 'ok' && !worker.isWorker() ? 0 : 3);
+    });
+    worker.post(id, { nums: [1, 2, 3], tag: 'ok' });
+)JS",
+                                R"JS(
+    worker.onMessage((v) => {
+        worker.postMessage({ sum: v.nums.reduce((a, b) => a + b, 0), tag: v.tag });
+    });
+)JS"),
+        0);
+}
+
+TEST(Worker, SharesSabAndTransfersArrayBuffer) {
+    EXPECT_EQ(run_worker_script(R"JS(
+    setExitCode(1);
+    const sab = new SharedArrayBuffer(16);
+    const shared = new Int32Array(sab);
+    const big = new Uint8Array(1 << 20);
+    big[12345] = 7;
+    let got = -1;
+    const id = worker.spawn(child, (v, buffers) => { got = new Uint8Array(buffers[0])[12345]; }, () => {
+        setExitCode(Atomics.load(shared, 0) === 42 && got === 8 && big.byteLength === 0 ? 0 : 3);
+    });
+    worker.post(id, { sab }, [big.buffer]);
+)JS",
+                                R"JS(
+    worker.onMessage((v, buffers) => {
+        Atomics.store(new Int32Array(v.sab), 0, 42);
+        const view = new Uint8Array(buffers[0]);
+        view[12345]++;
+        worker.postMessage(null, [buffers[0]]);
+        worker.close();
+    });
+)JS"),
+        0);
+}
+
+#if QIANJS_MODULE_FS
+TEST(Worker, RefusesToTransferBufferOfPendingFsWrite) {
+    EXPECT_EQ(run_worker_script(R"JS(
+    setExitCode(1);
+    const bytes = new Uint8Array(1 << 16);
+    const id = worker.spawn(child, () => {}, () => {});
+    const written = fs.writeFile(child + '.bin', bytes);
+    let threw = false;
+    try {
+        worker.post(id, null, [bytes.buffer]);
+    } catch (e) {
+        threw = e instanceof TypeError;
+    }
+    written.then(() => {
+        const sent = worker.post(id, null, [bytes.buffer]);
+        worker.terminate(id);
+        setExitCode(threw && sent && bytes.byteLength === 0 ? 0 : 3);
+    });
+)JS",
+                                R"JS(
+    worker.onMessage(() => {});
+)JS",
+                                "import * as fs from 'fs';\n"),
+        0);
+}
+#endif
+
+TEST(Worker, TerminateStopsBusyWorker) {
+    EXPECT_EQ(run_worker_script(R"JS(
+    setExitCode(1);
+    const id = worker.spawn(child, () => worker.terminate(id), () => setExitCode(0));
+)JS",
+                                R"JS(
+    worker.postMessage('started');
+    for (;;) {}
+)JS"),
+        0);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include "runtime/script_host.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+void write_file(const fs::path& p, const std::string& text) {
+    std::ofstream(p, std::ios::binary) << text;
+}
+
+size_t entry_count(const fs::path& dir) {
+    size_t n = 0;
+    for (const auto& e : fs::directory_iterator(dir))
+        n += e.path().extension() == ".qbc";
+    return n;
+}
+
+} // namespace
+
+TEST(CompileCache, CachesEntryAndImportsAndRecompilesOnChange) {
+    const fs::path root = fs::temp_directory_path() / "qianjs_compile_cache_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "cache");
+    const fs::path entry = root / "main.js";
+    write_file(entry, "import { value } from './lib.js';\n"
+                      "import { setExitCode } from 'process';\n"
+                      "setExitCode(value);\n");
+    write_file(root / "lib.js", "export const value = 7;\n");
+
+    qianjs::RunOptions options;
+    options.cacheDir = root / "cache";
+    EXPECT_EQ(qianjs::runScriptFile(entry, {}, options), 7);
+    EXPECT_EQ(entry_count(root / "cache"), 2u);
+
+    EXPECT_EQ(qianjs::runScriptFile(entry, {}, options), 7);
+    EXPECT_EQ(entry_count(root / "cache"), 2u);
+
+    write_file(root / "lib.js", "export const value = 9;\n");
+    EXPECT_EQ(qianjs::runScriptFile(entry, {}, options), 9);
+    EXPECT_EQ(entry_count(root / "cache"), 3u);
+
+    fs::remove_all(root);
+}
+
+TEST(CompileCache, Fnv1aIsStableAndContentSensitive) {
+    const uint64_t a = qianjs::compile_cache::fnv1a("abc", 3);
+    const uint64_t b = qianjs::compile_cache::fnv1a("abd", 3);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(a, qianjs::compile_cache::fnv1a("abc", 3));
+    EXPECT_NE(qianjs::compile_cache::engineFingerprint(), 0u);
+}
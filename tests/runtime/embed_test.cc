@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include "runtime/embed.h"
+#include "runtime/lz4_block.h"
 
 #include <cstring>
 #include <fstream>
@@ -10,30 +11,9 @@ namespace {
 
 namespace fs = std::filesystem;
 
-/** Same layout as `Embed::readEmbeddedBytecode` but for an arbitrary file (test-only). */
 std::vector<uint8_t> read_embedded_at(const fs::path& path) {
-    std::ifstream f(path, std::ios::binary | std::ios::ate);
-    if (!f)
-        return {};
-
-    const auto fileSize = static_cast<size_t>(f.tellg());
-    if (fileSize < Embed::FOOTER_SIZE)
-        return {};
-
-    f.seekg(-static_cast<std::streamoff>(Embed::FOOTER_SIZE), std::ios::end);
-    Embed::Footer footer{};
-    f.read(reinterpret_cast<char*>(&footer), sizeof(footer));
-
-    if (std::memcmp(footer.magic, Embed::MAGIC, 8) != 0)
-        return {};
-
-    if (footer.bytecodeSize == 0 || footer.bytecodeSize > fileSize - Embed::FOOTER_SIZE)
-        return {};
-
-    f.seekg(-static_cast<std::streamoff>(Embed::FOOTER_SIZE + footer.bytecodeSize), std::ios::end);
-    std::vector<uint8_t> bytecode(footer.bytecodeSize);
-    f.read(reinterpret_cast<char*>(bytecode.data()), footer.bytecodeSize);
-    return bytecode;
+    const Embed::Payload payload = Embed::mapEmbeddedBytecode(path);
+    return std::vector<uint8_t>(payload.data(), payload.data() + payload.size());
 }
 
 void write_embedded_file(const fs::path& path, const std::vector<uint8_t>& base,
@@ -130,3 +110,83 @@ TEST(EmbedRuntime, BytecodeSizeOutOfRangeReturnsEmpty) {
     fs::remove(path);
     fs::remove(dir);
 }
+
+TEST(EmbedRuntime, CreateReplacesExistingPayload) {
+    const fs::path dir = fs::temp_directory_path() / "qianjs_test_embed_create";
+    fs::create_directories(dir);
+    const fs::path source = dir / "source.bin";
+    const fs::path output = dir / "out" / "app";
+    std::vector<uint8_t> base(3 * 4096 + 17);
+    for (size_t i = 0; i < base.size(); i++)
+        base[i] = static_cast<uint8_t>(i * 31);
+    write_embedded_file(source, base, {0x01, 0x02});
+
+    const std::vector<uint8_t> bytecode(5000, 0x5a);
+    ASSERT_TRUE(Embed::createEmbeddedExecutable(bytecode, output, Embed::Compression::None, source));
+    EXPECT_EQ(Embed::cleanExecutableSize(output), base.size());
+    EXPECT_EQ(read_embedded_at(output), bytecode);
+
+    Embed::Layout layout;
+    ASSERT_TRUE(Embed::probeFooter(output, layout));
+    EXPECT_EQ(layout.version, 2u);
+    EXPECT_EQ(layout.payloadOffset % Embed::PAYLOAD_ALIGNMENT, 0u);
+
+    std::vector<uint8_t> image = Embed::readBinaryFile(output);
+    image.resize(base.size());
+    EXPECT_EQ(image, base);
+
+    fs::remove_all(dir);
+}
+
+TEST(EmbedRuntime, Lz4BlockRoundTrip) {
+    std::vector<uint8_t> text;
+    for (int i = 0; i < 20000; i++)
+        text.push_back(static_cast<uint8_t>("function f() { return 42; }\n"[i % 28]));
+    std::vector<uint8_t> noise(3000);
+    uint32_t x = 12345;
+    for (uint8_t& b : noise) {
+        x = x * 1103515245u + 12345u;
+        b = static_cast<uint8_t>(x >> 24);
+    }
+
+    for (const std::vector<uint8_t>& input : {text, noise, std::vector<uint8_t>{7, 7, 7}}) {
+        std::vector<uint8_t> packed;
+        qianjs::lz4::compress(input.data(), input.size(), packed);
+        std::vector<uint8_t> back(input.size());
+        ASSERT_TRUE(qianjs::lz4::decompress(packed.data(), packed.size(), back.data(), back.size()));
+        EXPECT_EQ(back, input);
+    }
+
+    std::vector<uint8_t> packed;
+    qianjs::lz4::compress(text.data(), text.size(), packed);
+    EXPECT_LT(packed.size(), text.size() / 10);
+    std::vector<uint8_t> back(text.size());
+    EXPECT_FALSE(qianjs::lz4::decompress(packed.data(), packed.size() - 1, back.data(), back.size()));
+}
+
+TEST(EmbedRuntime, CompressedPayloadAndChecksum) {
+    const fs::path dir = fs::temp_directory_path() / "qianjs_test_embed_lz4";
+    fs::create_directories(dir);
+    const fs::path source = dir / "source.bin";
+    const fs::path output = dir / "app";
+    ASSERT_TRUE(Embed::writeBinaryFile(source, std::vector<uint8_t>(1000, 0x90)));
+
+    std::vector<uint8_t> bytecode;
+    for (int i = 0; i < 100000; i++)
+        bytecode.push_back(static_cast<uint8_t>(i % 251 < 200 ? i % 7 : i));
+    ASSERT_TRUE(Embed::createEmbeddedExecutable(bytecode, output, Embed::Compression::Lz4, source));
+
+    Embed::Layout layout;
+    ASSERT_TRUE(Embed::probeFooter(output, layout));
+    EXPECT_EQ(layout.compression, Embed::Compression::Lz4);
+    EXPECT_EQ(layout.rawSize, bytecode.size());
+    EXPECT_LT(layout.storedSize, bytecode.size());
+    EXPECT_EQ(read_embedded_at(output), bytecode);
+
+    std::vector<uint8_t> image = Embed::readBinaryFile(output);
+    image[static_cast<size_t>(layout.payloadOffset) + 10] ^= 0xff;
+    ASSERT_TRUE(Embed::writeBinaryFile(output, image));
+    EXPECT_TRUE(read_embedded_at(output).empty());
+
+    fs::remove_all(dir);
+}
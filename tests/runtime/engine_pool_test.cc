@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include "runtime/script_host.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct PoolDir {
+    fs::path root = fs::temp_directory_path() / "qianjs_engine_pool";
+
+    PoolDir() {
+        fs::remove_all(root);
+        fs::create_directories(root);
+    }
+    ~PoolDir() {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    fs::path write(const std::string& name, const std::string& body) const {
+        const fs::path p = root / name;
+        std::ofstream(p) << body;
+        return p;
+    }
+};
+
+/** Exit code = runs seen by this engine's globals, so reuse is visible from outside. */
+const char* kCounter = "import { setExitCode } from 'process';\n"
+                       "import { step } from './lib.js';\n"
+                       "globalThis.n = step(globalThis.n || 0);\n"
+                       "setExitCode(globalThis.n);\n";
+
+} // namespace
+
+TEST(EnginePool, ReusesWarmEngineAndResetsRuntimeContext) {
+    PoolDir dir;
+    dir.write("lib.js", "export const step = (n) => n + 1;\n");
+    const fs::path main = dir.write("main.js", kCounter);
+    const fs::path args = dir.write("args.js", "import { argv, setExitCode } from 'process';\n"
+                                               "setExitCode(argv().length);\n");
+
+    qianjs::EnginePool pool;
+    EXPECT_EQ(pool.run(main), 1);
+    EXPECT_EQ(pool.run(main), 2);
+    EXPECT_EQ(pool.run(main), 3);
+    EXPECT_EQ(pool.idle(), 1u);
+
+    EXPECT_EQ(pool.run(args, {"args.js", "a", "b"}), 3);
+    EXPECT_EQ(pool.run(args), 1);
+    EXPECT_EQ(pool.idle(), 2u);
+}
+
+TEST(EnginePool, EnvIsCachedUntilChangedAndResetPerRun) {
+    PoolDir dir;
+    const fs::path main = dir.write("env.js", R"JS(
+import { env, setEnv, setExitCode } from 'process';
+const before = env();
+const cached = before === env();
+setEnv('QIANJS_POOL_VAR', 'x');
+const after = env();
+setExitCode((cached ? 1 : 0) + (after !== before && after.QIANJS_POOL_VAR === 'x' ? 2 : 0) +
+            (before.QIANJS_POOL_VAR === undefined ? 4 : 0) + (env('QIANJS_POOL_VAR') === 'x' ? 8 : 0));
+)JS");
+
+    qianjs::EnginePool pool;
+    pool.setEnvironment({{"HOME", "/home/pool"}});
+    EXPECT_EQ(pool.run(main), 15);
+    EXPECT_EQ(pool.run(main), 15);
+    EXPECT_EQ(pool.idle(), 1u);
+}
+
+#ifndef _WIN32
+TEST(EnginePool, InheritsProcessEnvironmentUnlessSet) {
+    PoolDir dir;
+    const fs::path main = dir.write("inherit.js", R"JS(
+import { env, setExitCode } from 'process';
+setExitCode(Number(env('QIANJS_POOL_INHERIT') || 0));
+)JS");
+
+    qianjs::EnginePool pool;
+    ::setenv("QIANJS_POOL_INHERIT", "3", 1);
+    EXPECT_EQ(pool.run(main), 3);
+    ::setenv("QIANJS_POOL_INHERIT", "4", 1);
+    EXPECT_EQ(pool.run(main), 4);
+    ::unsetenv("QIANJS_POOL_INHERIT");
+    pool.setEnvironment({{"QIANJS_POOL_INHERIT", "5"}});
+    EXPECT_EQ(pool.run(main), 5);
+}
+#endif
+
+TEST(EnginePool, EvictsEnginesOverMemoryLimit) {
+    PoolDir dir;
+    dir.write("lib.js", "export const step = (n) => n + 1;\n");
+    const fs::path main = dir.write("main.js", kCounter);
+
+    qianjs::EnginePoolOptions options;
+    options.memoryLimit = 1;
+    options.memoryCheckInterval = 1;
+    qianjs::EnginePool pool(options);
+    EXPECT_EQ(pool.run(main), 1);
+    EXPECT_EQ(pool.run(main), 1);
+    EXPECT_EQ(pool.idle(), 0u);
+}
+
+TEST(EnginePool, ReloadsChangedEntryAndDiscardsFailedRuns) {
+    PoolDir dir;
+    dir.write("lib.js", "export const step = (n) => n + 1;\n");
+    const fs::path main = dir.write("main.js", kCounter);
+
+    qianjs::EnginePool pool;
+    EXPECT_EQ(pool.run(main), 1);
+    EXPECT_EQ(pool.run(main), 2);
+
+    dir.write("main.js", "import { setExitCode } from 'process';\nsetExitCode(40 + (globalThis.n || 0));\n");
+    fs::last_write_time(main, fs::last_write_time(main) + std::chrono::seconds(2));
+    EXPECT_EQ(pool.run(main), 40);
+    EXPECT_EQ(pool.idle(), 1u);
+
+    dir.write("main.js", "throw new Error('boom');\n");
+    fs::last_write_time(main, fs::last_write_time(main) + std::chrono::seconds(4));
+    EXPECT_EQ(pool.run(main), 1);
+    EXPECT_EQ(pool.idle(), 0u);
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include "runtime/event_loop/event_loop.h"
+#include "runtime/runtime_context.h"
+
+#include <js_engine.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+TEST(EventLoop, DeferFromOtherThreadWakesRunOnce) {
+    qjs::JSEngine engine;
+    engine.initialize();
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+    qianjs::event_loop::ensure_started();
+
+    std::atomic<bool> ran{false};
+    qianjs::event_loop::begin_operation();
+    std::thread producer([&ran, &loop]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        loop.defer([&ran, &loop](qjs::JSEngine&) {
+            ran = true;
+            loop.end_operation();
+        });
+    });
+
+    while (!qianjs::event_loop::has_deferred())
+        qianjs::event_loop::run_once();
+    qianjs::event_loop::run_deferred(engine);
+    producer.join();
+
+    EXPECT_TRUE(ran);
+    EXPECT_FALSE(qianjs::event_loop::has_deferred());
+    EXPECT_EQ(qianjs::event_loop::pending_operations(), 0);
+    engine.cleanup();
+}
+
+TEST(EventLoop, RunDeferredStopsAtBatchBoundary) {
+    qjs::JSEngine engine;
+    engine.initialize();
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+
+    int outer = 0;
+    int inner = 0;
+    for (int i = 0; i < 3; i++) {
+        qianjs::event_loop::defer([&](qjs::JSEngine&) {
+            outer++;
+            qianjs::event_loop::defer([&inner](qjs::JSEngine&) { inner++; });
+        });
+    }
+
+    qianjs::event_loop::run_deferred(engine);
+    EXPECT_EQ(outer, 3);
+    EXPECT_EQ(inner, 0);
+    EXPECT_TRUE(qianjs::event_loop::has_deferred());
+
+    qianjs::event_loop::run_deferred(engine);
+    EXPECT_EQ(inner, 3);
+    EXPECT_FALSE(qianjs::event_loop::has_deferred());
+    engine.cleanup();
+}
+
+TEST(EventLoop, LargeCapturesFallBackToHeap) {
+    qjs::JSEngine engine;
+    engine.initialize();
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+
+    struct Big {
+        unsigned char bytes[qianjs::event_loop::DeferredTask::kInlineSize * 2];
+    };
+    Big big{};
+    big.bytes[sizeof(big.bytes) - 1] = 42;
+    int seen = 0;
+    qianjs::event_loop::defer([big, &seen](qjs::JSEngine&) { seen = big.bytes[sizeof(big.bytes) - 1]; });
+    qianjs::event_loop::run_deferred(engine);
+    EXPECT_EQ(seen, 42);
+    engine.cleanup();
+}
+
+TEST(EventLoop, NothingIsBoundWithoutAScope) {
+    qianjs::event_loop::EventLoop loop;
+    const qianjs::event_loop::EventLoop::Scope bind(loop);
+
+    qianjs::event_loop::EventLoop* other = &loop;
+    std::thread t([&other]() { other = qianjs::event_loop::EventLoop::bound(); });
+    t.join();
+
+    EXPECT_EQ(other, nullptr);
+    EXPECT_EQ(qianjs::event_loop::EventLoop::bound(), &loop);
+}
+
+TEST(EventLoopDeathTest, CurrentAbortsWhenUnbound) {
+    EXPECT_DEATH(qianjs::event_loop::EventLoop::current(), "no EventLoop is bound");
+}
+
+TEST(EventLoop, ScopeBindsTheEngineLoop) {
+    using qianjs::event_loop::EventLoop;
+    qjs::JSEngine engine;
+    engine.initialize();
+
+    EXPECT_EQ(EventLoop::bound(), nullptr);
+    EventLoop a;
+    EventLoop b;
+    qianjs::RuntimeContext runtime;
+    runtime.loop = &a;
+    engine.setHost<qianjs::RuntimeContext>(&runtime);
+    EXPECT_EQ(&EventLoop::of(engine), &a);
+
+    int ran = 0;
+    {
+        const EventLoop::Scope outer(a);
+        EXPECT_EQ(&EventLoop::current(), &a);
+        {
+            const EventLoop::Scope inner(b);
+            qianjs::event_loop::defer([&ran](qjs::JSEngine&) { ran++; });
+            EXPECT_TRUE(b.has_deferred());
+            EXPECT_FALSE(a.has_deferred());
+        }
+        EXPECT_EQ(&EventLoop::current(), &a);
+    }
+    EXPECT_EQ(EventLoop::bound(), nullptr);
+
+    b.run_deferred(engine);
+    EXPECT_EQ(ran, 1);
+    engine.setHost<qianjs::RuntimeContext>(nullptr);
+    engine.cleanup();
+}
+
+TEST(LoopMetrics, HistogramPercentilesStayWithinBucketError) {
+    using qianjs::event_loop::Histogram;
+    Histogram h;
+    EXPECT_EQ(h.percentile(0.5), 0u);
+    for (uint64_t v = 1; v <= 1000; v++)
+        h.record(v * 1000);
+
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_EQ(h.max(), 1000000u);
+    EXPECT_DOUBLE_EQ(h.mean(), 500500.0);
+    const std::pair<double, double> expected[] = {{0.5, 500000}, {0.9, 900000}, {0.99, 990000}};
+    for (const auto& [q, want] : expected) {
+        const double got = static_cast<double>(h.percentile(q));
+        EXPECT_GE(got, want) << q;
+        EXPECT_LE(got, want * 1.125) << q;
+    }
+    EXPECT_EQ(h.percentile(1.0), 1000000u);
+
+    for (uint64_t v : {uint64_t{0}, uint64_t{7}, uint64_t{8}, uint64_t{1} << 40, ~uint64_t{0}}) {
+        const size_t b = Histogram::bucketOf(v);
+        ASSERT_LT(b, Histogram::kBuckets);
+        EXPECT_GE(Histogram::bucketUpper(b), v);
+    }
+
+    h.reset();
+    EXPECT_EQ(h.count(), 0u);
+    EXPECT_EQ(h.max(), 0u);
+}
+
+TEST(LoopMetrics, TimedOperationsAndDeferredTasksAreRecorded) {
+    using qianjs::event_loop::EventLoop;
+    using qianjs::event_loop::OpKind;
+    qjs::JSEngine engine;
+    engine.initialize();
+    EventLoop loop;
+
+    const auto untimed = loop.begin_operation(OpKind::Stat);
+    EXPECT_EQ(untimed.started, 0u);
+    loop.end_operation(untimed);
+    EXPECT_EQ(loop.metrics(), nullptr);
+
+    qianjs::event_loop::LoopMetrics& m = loop.enable_metrics();
+    EXPECT_EQ(&loop.enable_metrics(), &m);
+    const auto op = loop.begin_operation(OpKind::ReadFile);
+    EXPECT_EQ(loop.pending_operations(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    loop.end_operation(op);
+    EXPECT_EQ(loop.pending_operations(), 0);
+    EXPECT_EQ(m.op(OpKind::ReadFile).count(), 1u);
+    EXPECT_GE(m.op(OpKind::ReadFile).max(), 2000000u);
+    EXPECT_EQ(m.op(OpKind::Stat).count(), 0u);
+
+    int ran = 0;
+    for (int i = 0; i < 3; i++)
+        loop.defer([&ran](qjs::JSEngine&) { ran++; });
+    loop.run_deferred(engine);
+    EXPECT_EQ(ran, 3);
+    EXPECT_EQ(m.deferredWait.count(), 3u);
+    EXPECT_EQ(m.deferredDepth.count(), 1u);
+    EXPECT_EQ(m.deferredDepth.max(), 3u);
+    EXPECT_NE(m.report().find("op readFile"), std::string::npos);
+
+    m.reset();
+    EXPECT_EQ(m.op(OpKind::ReadFile).count(), 0u);
+    engine.cleanup();
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include "runtime/plugins/lazy_plugins.h"
+#include "runtime/script_host.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+/** One engine set up like `runScriptFile`, with the lazy table kept for inspection. */
+struct LazyEngine {
+    qianjs::event_loop::EventLoop loop;
+    qianjs::event_loop::EventLoop::Scope bind{loop};
+    qjs::JSEngine engine;
+    qianjs::RuntimeContext runtime;
+    std::unique_ptr<qianjs::plugins::LazyPlugins> plugins;
+
+    LazyEngine() {
+        engine.initialize();
+        runtime.loop = &loop;
+        engine.setHost<qianjs::RuntimeContext>(&runtime);
+        plugins = std::make_unique<qianjs::plugins::LazyPlugins>(engine, lazyDefaultPlugins());
+    }
+    ~LazyEngine() {
+        engine.cleanup();
+    }
+
+    bool run(const fs::path& script) {
+        const bool ok = engine.runFile(script.string());
+        if (ok)
+            qianjs::drainAsyncWork(engine);
+        return ok;
+    }
+};
+
+struct LazyDir {
+    fs::path root = fs::temp_directory_path() / "qianjs_lazy_plugins";
+
+    LazyDir() {
+        fs::remove_all(root);
+        fs::create_directories(root);
+    }
+    ~LazyDir() {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    fs::path write(const std::string& name, const std::string& body) const {
+        const fs::path p = root / name;
+        std::ofstream(p) << body;
+        return p;
+    }
+};
+
+} // namespace
+
+TEST(LazyPlugins, InstallsOnlyImportedPlugins) {
+    LazyDir dir;
+    const fs::path main = dir.write("main.js", "import { setExitCode } from 'process';\nsetExitCode(7);\n");
+
+    LazyEngine e;
+    EXPECT_FALSE(e.plugins->installed("process"));
+    ASSERT_TRUE(e.run(main));
+    EXPECT_EQ(e.runtime.exit_code, 7);
+    EXPECT_TRUE(e.plugins->installed("process"));
+    EXPECT_FALSE(e.plugins->installed("fs"));
+    EXPECT_FALSE(e.plugins->installed("console"));
+}
+
+TEST(LazyPlugins, DynamicImportInstallsOnDemand) {
+    LazyDir dir;
+    const fs::path data = dir.write("data.txt", "abc");
+    const fs::path main = dir.write("main.js", "import { setExitCode } from 'process';\n"
+                                               "import('fs')\n"
+                                               "  .then((fs) => setExitCode(fs.sync.readFile('" +
+                                                   data.generic_string() + "').length))\n"
+                                               "  .catch(() => setExitCode(100));\n");
+
+    LazyEngine e;
+    EXPECT_FALSE(e.plugins->installed("fs"));
+    ASSERT_TRUE(e.run(main));
+    EXPECT_TRUE(e.plugins->installed("fs"));
+    EXPECT_EQ(e.runtime.exit_code, 3);
+}
+
+TEST(LazyPlugins, RelativeSpecifierNamedLikeAPluginStaysAFile) {
+    LazyDir dir;
+    dir.write("fs.js", "export const local = 5;\n");
+    const fs::path main = dir.write("main.js", "import { local } from './fs.js';\n"
+                                               "import { setExitCode } from 'process';\n"
+                                               "setExitCode(local);\n");
+
+    LazyEngine e;
+    ASSERT_TRUE(e.run(main));
+    EXPECT_EQ(e.runtime.exit_code, 5);
+    EXPECT_FALSE(e.plugins->installed("fs"));
+}
+
+TEST(LazyPlugins, UnknownBareSpecifierFailsWithoutInstalling) {
+    LazyDir dir;
+    const fs::path main = dir.write("main.js", "import { x } from 'no_such_native';\n");
+
+    LazyEngine e;
+    const size_t before = e.plugins->installedCount();
+    EXPECT_FALSE(e.engine.runFile(main.string()));
+    EXPECT_EQ(e.plugins->installedCount(), before);
+    EXPECT_EQ(qianjs::plugins::LazyPlugins::of(e.engine.ctx()), e.plugins.get());
+}
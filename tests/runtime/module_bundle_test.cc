@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "runtime/bundle/module_bundle.h"
+#include "runtime/embed.h"
+#include "runtime/script_host.h"
+
+#include <qianjs_modules.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using qianjs::bundle::BuiltModule;
+using qianjs::bundle::ModuleBundle;
+
+/** main.js → ./a.js → ./sub/b.js, plus a native import that must not be bundled. */
+fs::path write_graph(const fs::path& root) {
+    fs::remove_all(root);
+    fs::create_directories(root / "sub");
+    std::ofstream(root / "main.js") << "import { a } from './a.js';\n"
+                                       "import { setExitCode } from 'process';\n"
+                                       "setExitCode(a + 1);\n";
+    std::ofstream(root / "a.js") << "import { b } from './sub/b.js';\nexport const a = b * 2;\n";
+    std::ofstream(root / "sub" / "b.js") << "export const b = 20;\n";
+    return root / "main.js";
+}
+
+} // namespace
+
+TEST(ModuleBundle, CompilesImportGraphAndIndexesByName) {
+    const fs::path root = fs::temp_directory_path() / "qianjs_bundle_graph";
+    std::vector<BuiltModule> modules;
+    std::string error;
+    ASSERT_TRUE(qianjs::bundle::compileModuleGraph(write_graph(root), modules, error)) << error;
+
+    std::vector<std::string> names;
+    for (const BuiltModule& m : modules)
+        names.push_back(m.name);
+    EXPECT_EQ(names.front(), "main.js");
+    std::sort(names.begin(), names.end());
+    EXPECT_EQ(names, (std::vector<std::string>{"a.js", "main.js", "sub/b.js"}));
+
+    const std::vector<uint8_t> image = qianjs::bundle::writeBundle(std::move(modules));
+    ModuleBundle bundle;
+    ASSERT_TRUE(bundle.parse(image.data(), image.size()));
+    EXPECT_EQ(bundle.size(), 3u);
+    EXPECT_EQ(bundle.entryName(), "main.js");
+    size_t len = 0;
+    EXPECT_NE(bundle.find("sub/b.js", &len), nullptr);
+    EXPECT_GT(len, 0u);
+    EXPECT_EQ(bundle.find("process", &len), nullptr);
+
+    std::vector<uint8_t> truncated(image.begin(), image.begin() + static_cast<std::ptrdiff_t>(image.size() / 2));
+    EXPECT_FALSE(ModuleBundle().parse(truncated.data(), truncated.size()));
+
+    fs::remove_all(root);
+}
+
+#if QIANJS_MODULE_PROCESS
+TEST(ModuleBundle, RunsBundleWithoutSourcesOnDisk) {
+    const fs::path root = fs::temp_directory_path() / "qianjs_bundle_run";
+    std::vector<BuiltModule> modules;
+    std::string error;
+    ASSERT_TRUE(qianjs::bundle::compileModuleGraph(write_graph(root), modules, error)) << error;
+    const fs::path qbc = fs::temp_directory_path() / "qianjs_bundle_run.qbc";
+    ASSERT_TRUE(Embed::writeBinaryFile(qbc, qianjs::bundle::writeBundle(std::move(modules))));
+    fs::remove_all(root);
+
+    EXPECT_EQ(qianjs::runScriptFile(qbc), 41);
+    fs::remove(qbc);
+}
+#endif
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include "runtime/bundle/module_bundle.h"
+#include "runtime/bundle/parallel_build.h"
+#include "runtime/embed.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+using qianjs::bundle::BuildOptions;
+using qianjs::bundle::BuildResult;
+using qianjs::bundle::BuildStatus;
+
+struct BuildDir {
+    fs::path root = fs::temp_directory_path() / "qianjs_parallel_build";
+
+    BuildDir() {
+        fs::remove_all(root);
+        fs::create_directories(root / "src" / "other");
+    }
+    ~BuildDir() {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    fs::path write(const std::string& name, const std::string& body) const {
+        const fs::path p = root / name;
+        std::ofstream(p) << body;
+        return p;
+    }
+
+    BuildOptions options() const {
+        BuildOptions o;
+        o.outDir = root / "dist";
+        o.jobs = 3;
+        return o;
+    }
+};
+
+size_t count(const std::vector<BuildResult>& results, BuildStatus status) {
+    return static_cast<size_t>(std::count_if(results.begin(), results.end(),
+                                             [status](const BuildResult& r) { return r.status == status; }));
+}
+
+} // namespace
+
+TEST(ParallelBuild, ExpandsGlobsSortedAndDeduplicated) {
+    BuildDir dir;
+    dir.write("src/b.js", "");
+    dir.write("src/a.js", "");
+    dir.write("src/notes.txt", "");
+    dir.write("src/other/c.js", "");
+
+    std::vector<fs::path> entries;
+    std::string error;
+    const std::string src = (dir.root / "src").string();
+    ASSERT_TRUE(qianjs::bundle::expandEntries({src + "/*.js", src + "/a.js", src + "/**/*.js"}, entries, error))
+        << error;
+    std::vector<std::string> names;
+    for (const fs::path& p : entries)
+        names.push_back(p.lexically_relative(dir.root).generic_string());
+    EXPECT_EQ(names, (std::vector<std::string>{"src/a.js", "src/b.js", "src/other/c.js"}));
+
+    entries.clear();
+    EXPECT_FALSE(qianjs::bundle::expandEntries({src + "/*.ts"}, entries, error));
+    EXPECT_NE(error.find("*.ts"), std::string::npos);
+}
+
+TEST(ParallelBuild, BuildsEachEntryWithItsOwnGraph) {
+    BuildDir dir;
+    // Same module name, different directories: one worker compiling both must not reuse the first `util.js`.
+    dir.write("src/util.js", "export const u = 1;\n");
+    const fs::path a = dir.write("src/a.js", "import { u } from './util.js';\nexport default u;\n");
+    dir.write("src/other/util.js", "import { x } from './extra.js';\nexport const u = x;\n");
+    dir.write("src/other/extra.js", "export const x = 2;\n");
+    const fs::path b = dir.write("src/other/b.js", "import { u } from './util.js';\nexport default u;\n");
+    const fs::path bad = dir.write("src/bad.js", "export const = ;\n");
+
+    BuildOptions options = dir.options();
+    options.jobs = 1;
+    size_t reported = 0;
+    const std::vector<BuildResult> results =
+        qianjs::bundle::buildEntries({a, b, bad}, options, [&](const BuildResult&) { reported++; });
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(reported, 3u);
+    EXPECT_EQ(results[0].status, BuildStatus::Built);
+    EXPECT_EQ(results[0].modules, 2u);
+    EXPECT_EQ(results[1].status, BuildStatus::Built);
+    EXPECT_EQ(results[1].modules, 3u);
+    EXPECT_EQ(results[2].status, BuildStatus::Failed);
+    EXPECT_FALSE(results[2].error.empty());
+    EXPECT_FALSE(fs::exists(results[2].output));
+
+    const std::vector<uint8_t> image = Embed::readBinaryFile(results[1].output);
+    qianjs::bundle::ModuleBundle bundle;
+    ASSERT_TRUE(bundle.parse(image.data(), image.size()));
+    EXPECT_EQ(bundle.entryName(), "b.js");
+    size_t len = 0;
+    EXPECT_NE(bundle.find("extra.js", &len), nullptr);
+}
+
+TEST(ParallelBuild, SkipsUnchangedEntriesAndRebuildsDependents) {
+    BuildDir dir;
+    dir.write("src/shared.js", "export const n = 1;\n");
+    std::vector<fs::path> entries;
+    for (int i = 0; i < 6; i++) {
+        const char* body = i % 2 ? "export const k = 0;\n" : "import { n } from './shared.js';\nexport default n;\n";
+        entries.push_back(dir.write("src/e" + std::to_string(i) + ".js", body));
+    }
+
+    const BuildOptions options = dir.options();
+    std::vector<BuildResult> results = qianjs::bundle::buildEntries(entries, options);
+    ASSERT_EQ(count(results, BuildStatus::Built), 6u);
+    EXPECT_TRUE(fs::exists(options.outDir / ".qianjs-build"));
+
+    results = qianjs::bundle::buildEntries(entries, options);
+    EXPECT_EQ(count(results, BuildStatus::UpToDate), 6u);
+
+    // Only the three entries that import the changed module are rebuilt.
+    dir.write("src/shared.js", "export const n = 2;\n");
+    results = qianjs::bundle::buildEntries(entries, options);
+    EXPECT_EQ(count(results, BuildStatus::Built), 3u);
+    EXPECT_EQ(results[0].status, BuildStatus::Built);
+    EXPECT_EQ(results[1].status, BuildStatus::UpToDate);
+
+    // A missing output is rebuilt, and building a subset keeps the other entries' manifest records.
+    fs::remove(results[1].output);
+    results = qianjs::bundle::buildEntries({entries[1]}, options);
+    EXPECT_EQ(results[0].status, BuildStatus::Built);
+    results = qianjs::bundle::buildEntries(entries, options);
+    EXPECT_EQ(count(results, BuildStatus::UpToDate), 6u);
+
+    BuildOptions force = options;
+    force.force = true;
+    results = qianjs::bundle::buildEntries(entries, force);
+    EXPECT_EQ(count(results, BuildStatus::Built), 6u);
+
+    for (const auto& f : fs::directory_iterator(options.outDir))
+        EXPECT_EQ(f.path().string().find(".tmp"), std::string::npos) << f.path();
+}
+
+TEST(ParallelBuild, RejectsEntriesWritingTheSameOutput) {
+    BuildDir dir;
+    const fs::path a = dir.write("src/main.js", "export const a = 1;\n");
+    const fs::path b = dir.write("src/other/main.js", "export const b = 2;\n");
+
+    const std::vector<BuildResult> results = qianjs::bundle::buildEntries({a, b}, dir.options());
+    EXPECT_EQ(results[0].status, BuildStatus::Built);
+    EXPECT_EQ(results[1].status, BuildStatus::Failed);
+    EXPECT_NE(results[1].error.find("also written by"), std::string::npos);
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "runtime/script_host.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string read_text(const fs::path& p) {
+    std::ifstream in(p, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+} // namespace
+
+TEST(SamplingProfiler, CollapsedStacksCoverJsNativeAndTimerFrames) {
+    const fs::path dir = fs::temp_directory_path() / "qianjs_profiler";
+    fs::create_directories(dir);
+    const fs::path script = dir / "main.js";
+    const fs::path out = dir / "main.folded";
+    std::ofstream(script) << "import * as fs from 'fs';\n"
+                             "import { setTimeout } from 'timers';\n"
+                             "const data = '"
+                          << (dir / "data.txt").generic_string() << "';\n"
+                          << R"JS(
+function spin(ms) { const end = Date.now() + ms; let x = 0; while (Date.now() < end) x++; return x; }
+function readLoop() { for (let i = 0; i < 400; i++) fs.sync.readFile(data); }
+spin(100);
+fs.sync.writeFile(data, 'x'.repeat(1 << 18));
+readLoop();
+setTimeout(() => spin(50), 1);
+)JS";
+
+    qianjs::RunOptions options;
+    options.profileOut = out;
+    options.profileInterval = std::chrono::microseconds(1000);
+    EXPECT_EQ(qianjs::runScriptFile(script, {}, options), 0);
+
+    const std::string folded = read_text(out);
+    fs::remove_all(dir);
+    ASSERT_FALSE(folded.empty());
+    EXPECT_NE(folded.find("spin ("), std::string::npos) << folded;
+    EXPECT_NE(folded.find(" [native];[fs]"), std::string::npos) << folded;
+    EXPECT_NE(folded.find("[timers];"), std::string::npos) << folded;
+
+    std::istringstream lines(folded);
+    std::string line;
+    while (std::getline(lines, line)) {
+        const size_t sp = line.rfind(' ');
+        ASSERT_NE(sp, std::string::npos) << line;
+        EXPECT_GT(std::stoull(line.substr(sp + 1)), 0u) << line;
+    }
+}
@@ -2,6 +2,8 @@
 
 #include "runtime/runtime_context.h"
 
+#include <cstdlib>
+#include <memory>
 #include <string>
 
 TEST(RuntimeContext, CaptureEnvironmentSmoke) {
@@ -17,4 +19,72 @@ TEST(RuntimeContext, RuntimeContextDefaults) {
     EXPECT_TRUE(ctx.argv.empty());
     EXPECT_TRUE(ctx.env.empty());
     EXPECT_EQ(ctx.exit_code, 0);
+    EXPECT_EQ(ctx.log_level, qianjs::LogLevel::Debug);
+    EXPECT_EQ(ctx.log_format, qianjs::LogFormat::Text);
 }
+
+TEST(RuntimeContext, ApplyLogEnvironmentReadsLevelAndFormat) {
+    qianjs::RuntimeContext ctx;
+    ctx.env.assign({{"QIANJS_LOG_LEVEL", "warn"}, {"QIANJS_LOG_FORMAT", "json"}});
+    qianjs::applyLogEnvironment(ctx);
+    EXPECT_EQ(ctx.log_level, qianjs::LogLevel::Warn);
+    EXPECT_EQ(ctx.log_format, qianjs::LogFormat::Json);
+
+    ctx.env.assign({{"QIANJS_LOG_LEVEL", "loud"}});
+    qianjs::applyLogEnvironment(ctx);
+    EXPECT_EQ(ctx.log_level, qianjs::LogLevel::Debug);
+    EXPECT_EQ(ctx.log_format, qianjs::LogFormat::Text);
+}
+
+TEST(RuntimeContext, EnvironmentIndexTracksChanges) {
+    qianjs::Environment env;
+    env.assign({{"A", "1"}, {"B", "2"}, {"C", "3"}});
+    const uint64_t v0 = env.version();
+    ASSERT_NE(env.get("B"), nullptr);
+    EXPECT_STREQ(env.get("B"), "2");
+    EXPECT_EQ(env.get("D"), nullptr);
+    EXPECT_EQ(env.version(), v0);
+
+    env.set("B", "two");
+    env.set("D", "4");
+    EXPECT_TRUE(env.erase("A"));
+    EXPECT_FALSE(env.erase("A"));
+    EXPECT_GT(env.version(), v0);
+    EXPECT_STREQ(env.get("B"), "two");
+    EXPECT_STREQ(env.get("C"), "3");
+    EXPECT_STREQ(env.get("D"), "4");
+    EXPECT_EQ(env.get("A"), nullptr);
+    EXPECT_EQ(env.entries().size(), 3u);
+}
+
+TEST(RuntimeContext, SharedEnvironmentCopiesOnlyOnChange) {
+    const auto snapshot = std::make_shared<const qianjs::EnvironmentSnapshot>(
+        qianjs::Environment::Entries{{"A", "1"}, {"B", "2"}});
+    qianjs::Environment first;
+    qianjs::Environment second;
+    first.share(snapshot);
+    second.share(snapshot);
+    EXPECT_EQ(&first.entries(), &snapshot->entries());
+    EXPECT_STREQ(first.get("B"), "2");
+
+    first.set("B", "two");
+    EXPECT_STREQ(first.get("B"), "two");
+    EXPECT_STREQ(second.get("B"), "2");
+    EXPECT_STREQ(snapshot->get("B"), "2");
+    EXPECT_NE(&first.entries(), &snapshot->entries());
+}
+
+#ifndef _WIN32
+TEST(RuntimeContext, InheritedEnvironmentReadsWithoutCapturing) {
+    ASSERT_EQ(::setenv("QIANJS_ENV_TEST", "inherited", 1), 0);
+    qianjs::Environment env;
+    env.inheritProcess();
+    EXPECT_STREQ(env.get("QIANJS_ENV_TEST"), "inherited");
+
+    env.set("QIANJS_ENV_TEST", "local");
+    EXPECT_STREQ(env.get("QIANJS_ENV_TEST"), "local");
+    EXPECT_STREQ(std::getenv("QIANJS_ENV_TEST"), "inherited");
+    EXPECT_FALSE(env.empty());
+    ::unsetenv("QIANJS_ENV_TEST");
+}
+#endif
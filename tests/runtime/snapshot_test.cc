@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include "runtime/embed.h"
+#include "runtime/script_host.h"
+#include "runtime/snapshot/snapshot.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using qianjs::snapshot::hasSnapshotDirective;
+
+TEST(Snapshot, DirectivePrologue) {
+    EXPECT_TRUE(hasSnapshotDirective("\"use snapshot\";\nexport const a = 1;"));
+    EXPECT_TRUE(hasSnapshotDirective("#!/usr/bin/env qianjs\n// tables\n/* built once */ 'use strict'; 'use snapshot'"));
+    EXPECT_FALSE(hasSnapshotDirective("export const a = 'use snapshot';"));
+    EXPECT_FALSE(hasSnapshotDirective("const s = 1;\n\"use snapshot\";"));
+    EXPECT_FALSE(hasSnapshotDirective(""));
+}
+
+#if QIANJS_MODULE_PROCESS
+/** The marked module runs at build time only; at launch its exports come back from the snapshot entry. */
+TEST(Snapshot, RestoresExportsWithoutRerunningModule) {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "qianjs_snapshot_app";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    std::ofstream(root / "main.js") << "import table, { meta } from './table.js';\n"
+                                       "import { setExitCode } from 'process';\n"
+                                       "const fresh = globalThis.tableBuilt === undefined;\n"
+                                       "setExitCode(fresh && table.length === 1000 && table[999] === 999 * 999 && meta.name === 'sq' ? 42 : 1);\n";
+    std::ofstream(root / "table.js") << "'use snapshot';\n"
+                                        "import { step } from './step.js';\n"
+                                        "globalThis.tableBuilt = true;\n"
+                                        "export default Array.from({ length: 1000 }, (_, i) => step(i));\n"
+                                        "export const meta = { name: 'sq' };\n";
+    std::ofstream(root / "step.js") << "export const step = (i) => i * i;\n";
+
+    std::vector<qianjs::bundle::BuiltModule> modules;
+    size_t snapshotted = 0;
+    std::string error;
+    ASSERT_TRUE(qianjs::snapshot::buildSnapshot(root / "main.js", modules, snapshotted, error)) << error;
+    EXPECT_EQ(snapshotted, 1u);
+
+    const fs::path qbc = fs::temp_directory_path() / "qianjs_snapshot_app.qbc";
+    ASSERT_TRUE(Embed::writeBinaryFile(qbc, qianjs::bundle::writeBundle(std::move(modules))));
+    fs::remove_all(root);
+
+    EXPECT_EQ(qianjs::runScriptFile(qbc), 42);
+    fs::remove(qbc);
+}
+#endif